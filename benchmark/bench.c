@@ -0,0 +1,53 @@
+#include <string.h>
+#include "bench.h"
+
+void slab_benchmark();
+void arena_benchmark();
+void table_benchmark();
+void gc_benchmark();
+void rc_benchmark();
+void variant_benchmark();
+void hash_benchmark();
+void sort_benchmark();
+void strbuf_benchmark();
+void rope_benchmark();
+
+static struct {
+	const char *name;
+	bench_func_t run;
+} benchmarks[] = {
+	{ "slab", slab_benchmark },
+	{ "arena", arena_benchmark },
+	{ "table", table_benchmark },
+	{ "gc", gc_benchmark },
+	{ "rc", rc_benchmark },
+	{ "variant", variant_benchmark },
+	{ "hash", hash_benchmark },
+	{ "sort", sort_benchmark },
+	{ "strbuf", strbuf_benchmark },
+	{ "rope", rope_benchmark },
+};
+
+// Run all the benchmarks, or only those whose name is passed on the command line.
+int main(int argc, char **argv)
+{
+	size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		bool selected = (argc < 2);
+
+		for (int j = 1; j < argc; ++j) {
+			if (strcmp(argv[j], benchmarks[i].name) == 0) selected = true;
+		}
+
+		if (selected)
+		{
+			printf("%s:\n", benchmarks[i].name);
+			benchmarks[i].run();
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef ELVEA_BENCH_H
+#define ELVEA_BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+#include <elvea/elvea.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+typedef void (*bench_func_t)(void);
+
+// Wall-clock time in seconds.
+static inline
+double bench_now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Deterministic pseudo-random numbers (xorshift), so that runs are comparable.
+static inline
+uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static inline
+void bench_report(const char *name, double seconds, size_t ops)
+{
+	printf("  %-44s %9.2f ms %9.1f ns/op\n", name, seconds * 1e3, seconds * 1e9 / (double) ops);
+}
+
+#endif // ELVEA_BENCH_H
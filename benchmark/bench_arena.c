@@ -0,0 +1,71 @@
+#include <elvea/arena.h>
+#include "bench.h"
+
+#define ALIAS_COUNT (1024 * 1024)
+
+static elvea_alias_t *aliases[ALIAS_COUNT];
+
+// Simulate a load spike: allocate many aliases, free most of them in random order, then compact the arena.
+static void load_spike(elvea_thread_t *thread, elvea_arena_t *arena)
+{
+	uint32_t seed = 4242;
+	size_t freed = 0;
+	double start = bench_now();
+
+	for (size_t i = 0; i < ALIAS_COUNT; ++i) {
+		aliases[i] = elvea_arena_alloc_alias(thread, arena);
+	}
+	bench_report("allocate aliases", bench_now() - start, ALIAS_COUNT);
+
+	// Free whole runs of slots (as when a burst of requests ends), and scattered slots.
+	start = bench_now();
+	for (size_t i = 0; i < ALIAS_COUNT; ++i)
+	{
+		bool burst = (i / (4 * ELVEA_PAGE_SIZE)) % 4 != 0;
+
+		if (burst || bench_random(&seed) % 2 == 0)
+		{
+			elvea_arena_recycle_alias(thread, arena, aliases[i]);
+			freed++;
+		}
+	}
+	bench_report("recycle aliases", bench_now() - start, freed);
+
+	elvea_size_t pages = arena->page_count;
+	start = bench_now();
+	elvea_arena_compact(thread, arena);
+	double elapsed = bench_now() - start;
+	printf("  compaction released %" ELVEA_FORMAT_SIZE " of %" ELVEA_FORMAT_SIZE " pages in %.3f ms\n",
+		   pages - arena->page_count, pages, elapsed * 1e3);
+
+	// Allocate again, which reuses the pages that are left before getting new ones.
+	start = bench_now();
+	for (size_t i = 0; i < ALIAS_COUNT / 2; ++i) {
+		elvea_arena_alloc_alias(thread, arena);
+	}
+	bench_report("allocate aliases after compaction", bench_now() - start, ALIAS_COUNT / 2);
+}
+
+void arena_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_arena_t arena;
+
+	printf(" pages from the allocator:\n");
+	elvea_arena_initialize(&arena);
+	load_spike(thread, &arena);
+	elvea_arena_finalize(thread, &arena);
+
+	printf(" pages from a virtual memory range:\n");
+	elvea_arena_initialize(&arena);
+	if (elvea_arena_reserve(thread, &arena, (size_t) 1 << 30, false)) load_spike(thread, &arena);
+	elvea_arena_finalize(thread, &arena);
+
+	printf(" pages from a virtual memory range with huge pages:\n");
+	elvea_arena_initialize(&arena);
+	if (elvea_arena_reserve(thread, &arena, (size_t) 1 << 30, true)) load_spike(thread, &arena);
+	elvea_arena_finalize(thread, &arena);
+
+	elvea_finalize(&runtime);
+}
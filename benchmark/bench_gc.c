@@ -0,0 +1,105 @@
+#include <elvea/elvea.h>
+#include <elvea/utils/alloc.h>
+#include "bench.h"
+
+#define CYCLE_COUNT (256 * 1024)
+#define RING_SIZE (1024 * 1024)
+#define RELEASE_COUNT (4 * 1024 * 1024)
+
+static void link_table(elvea_thread_t *thread, elvea_table_t *table, elvea_table_t *value)
+{
+	elvea_variant_t k, v;
+	elvea_init_num(thread, &k, 0);
+	elvea_init_object(thread, &v, value);
+	elvea_table_set(thread, table, &k, &v);
+	elvea_clear(thread, &v);
+}
+
+static elvea_table_t *new_table(elvea_thread_t *thread)
+{
+	elvea_table_t *table = elvea_table_new(thread, 1);
+	elvea_object_retain(thread, table);
+	return table;
+}
+
+void gc_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+
+	// Many small garbage cycles: collections are triggered by the root buffer.
+	double start = bench_now();
+	for (size_t i = 0; i < CYCLE_COUNT; ++i)
+	{
+		elvea_table_t *t1 = new_table(thread);
+		elvea_table_t *t2 = new_table(thread);
+		link_table(thread, t1, t2);
+		link_table(thread, t2, t1);
+		elvea_object_release(thread, t1);
+		elvea_object_release(thread, t2);
+	}
+	elvea_gc_collect_cycles(thread);
+	bench_report("create and collect 2-table cycles", bench_now() - start, CYCLE_COUNT);
+	printf("  %zu collections, %zu objects reclaimed\n", (size_t) thread->gc.collection_count,
+		   (size_t) thread->gc.collected_count);
+
+	// One large cycle, collected in a single pass.
+	elvea_table_t *first = new_table(thread);
+	elvea_table_t *last = first;
+	for (size_t i = 1; i < RING_SIZE; ++i)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, last, t);
+		if (last != first) elvea_object_release(thread, last);
+		last = t;
+	}
+	link_table(thread, last, first);
+	elvea_object_release(thread, last);
+	elvea_gc_collect_cycles(thread);
+	elvea_object_release(thread, first);
+	start = bench_now();
+	size_t count = elvea_gc_collect_cycles(thread);
+	bench_report("collect a ring of tables", bench_now() - start, count);
+
+	// The same ring, collected in steps of 100 us: the longest pause is reported.
+	first = new_table(thread);
+	last = first;
+	for (size_t i = 1; i < RING_SIZE; ++i)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, last, t);
+		if (last != first) elvea_object_release(thread, last);
+		last = t;
+	}
+	link_table(thread, last, first);
+	elvea_object_release(thread, last);
+	elvea_gc_collect_cycles(thread);
+	elvea_object_release(thread, first);
+	double longest = 0;
+	size_t steps = 0;
+	start = bench_now();
+	bool more = true;
+	while (more)
+	{
+		double t = bench_now();
+		more = elvea_gc_step(thread, 100000);
+		t = bench_now() - t;
+		if (t > longest) longest = t;
+		steps++;
+	}
+	bench_report("collect a ring of tables incrementally", bench_now() - start, RING_SIZE);
+	printf("  %zu steps, longest step: %.1f us\n", steps, longest * 1e6);
+
+	// Cost of buffering candidates for a live object which is shared.
+	elvea_table_t *shared = new_table(thread);
+	start = bench_now();
+	for (size_t i = 0; i < RELEASE_COUNT; ++i)
+	{
+		elvea_object_retain(thread, shared);
+		elvea_object_release(thread, shared);
+	}
+	bench_report("retain/release of a live table", bench_now() - start, RELEASE_COUNT);
+	elvea_object_release(thread, shared);
+
+	elvea_finalize(&runtime);
+}
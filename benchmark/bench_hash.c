@@ -0,0 +1,183 @@
+#include <string.h>
+#include <elvea/elvea.h>
+#include "bench.h"
+
+#define BUFFER_SIZE (64 * 1024)
+#define BYTES_PER_RUN (256 * 1024 * 1024)
+#define KEY_COUNT (64 * 1024)
+
+static uint8_t buffer[BUFFER_SIZE];
+static elvea_size_t counts[KEY_COUNT];
+static volatile uint64_t sink;
+
+// The number hash which was used before the hashing module.
+static elvea_size_t old_num_hash(double n)
+{
+	union { double number; struct { uint32_t x, y; } bits; } u;
+	u.number = n;
+	return u.bits.x + u.bits.y;
+}
+
+typedef uint64_t (*hash_func_t)(const void *data, size_t len);
+
+// MurmurHash2, which was used to hash strings before the hashing module. MurmurHash2 is released to the public domain
+// by Austin Appleby.
+static uint32_t murmur_hash2(const void *key, uint32_t len, uint32_t seed)
+{
+	const uint32_t m = 0x5bd1e995;
+	const int r = 24;
+	const uint8_t *data = (const uint8_t*) key;
+	uint32_t h = seed ^ len;
+
+	while (len >= 4)
+	{
+		uint32_t k;
+		memcpy(&k, data, 4);
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h *= m;
+		h ^= k;
+
+		data += 4;
+		len -= 4;
+	}
+
+	// The remaining bytes are mixed in together.
+	if (len > 0)
+	{
+		if (len == 3) h ^= (uint32_t) data[2] << 16;
+		if (len >= 2) h ^= (uint32_t) data[1] << 8;
+		h ^= data[0];
+		h *= m;
+	}
+
+	h ^= h >> 13;
+	h *= m;
+	h ^= h >> 15;
+
+	return h;
+}
+
+static uint64_t hash_murmur(const void *data, size_t len)
+{
+	return murmur_hash2(data, (uint32_t) len, 42);
+}
+
+static uint64_t hash_fast(const void *data, size_t len)
+{
+	return elvea_hash_bytes(data, len, 42);
+}
+
+static uint64_t hash_sip(const void *data, size_t len)
+{
+	static const uint64_t key[2] = { 42, 43 };
+	return elvea_siphash(data, len, key);
+}
+
+static struct {
+	const char *name;
+	hash_func_t hash;
+} functions[] = {
+	{ "murmur2", hash_murmur },
+	{ "fast", hash_fast },
+	{ "siphash", hash_sip },
+};
+
+// Report the throughput of a function for a given input length.
+static void run_throughput(size_t index, size_t len)
+{
+	// The inputs start at different offsets in the first half of the buffer.
+	size_t count = BYTES_PER_RUN / len / 16 + 1;
+	uint64_t h = 0;
+	double start = bench_now();
+
+	for (size_t i = 0; i < count; ++i) {
+		h += functions[index].hash(buffer + ((i * 64 + i) & (BUFFER_SIZE / 2 - 1)), len);
+	}
+	double seconds = bench_now() - start;
+	sink = h;
+	char name[64];
+	snprintf(name, sizeof name, "%s, %zu bytes (%.2f GB/s)", functions[index].name, len,
+			 (double) (count * len) / seconds * 1e-9);
+	bench_report(name, seconds, count);
+}
+
+// Distribution of hash values in a table with KEY_COUNT buckets which holds KEY_COUNT keys. With a random function,
+// about 36.8% of the buckets are empty and the largest bucket has 8 or 9 keys.
+static void report_distribution(const char *name)
+{
+	size_t empty = 0, largest = 0;
+
+	for (size_t i = 0; i < KEY_COUNT; ++i)
+	{
+		if (counts[i] == 0) empty++;
+		if (counts[i] > largest) largest = counts[i];
+		counts[i] = 0;
+	}
+	printf("  %-44s %5.1f%% empty, largest bucket: %zu\n", name, 100.0 * (double) empty / KEY_COUNT, largest);
+}
+
+static void run_distribution(elvea_thread_t *thread)
+{
+	char key[32];
+	memset(counts, 0, sizeof counts);
+
+	for (size_t f = 0; f < sizeof functions / sizeof functions[0]; ++f)
+	{
+		for (size_t i = 0; i < KEY_COUNT; ++i)
+		{
+			int len = snprintf(key, sizeof key, "key:%zu", i);
+			counts[elvea_hash_fold(functions[f].hash(key, (size_t) len)) % KEY_COUNT]++;
+		}
+		snprintf(key, sizeof key, "%s, \"key:<i>\"", functions[f].name);
+		report_distribution(key);
+	}
+
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		counts[old_num_hash((double) i * 1024) % KEY_COUNT]++;
+	}
+	report_distribution("old number hash, i * 1024");
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		counts[elvea_hash_num(thread, (double) i * 1024) % KEY_COUNT]++;
+	}
+	report_distribution("number hash, i * 1024");
+
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		counts[old_num_hash((double) i * 0.5) % KEY_COUNT]++;
+	}
+	report_distribution("old number hash, i * 0.5");
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		counts[elvea_hash_num(thread, (double) i * 0.5) % KEY_COUNT]++;
+	}
+	report_distribution("number hash, i * 0.5");
+
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		counts[elvea_hash_int(thread, (elvea_int_t) (i << 32)) % KEY_COUNT]++;
+	}
+	report_distribution("integer hash, i << 32");
+}
+
+void hash_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	uint32_t seed = 1234;
+
+	for (size_t i = 0; i < BUFFER_SIZE; ++i) {
+		buffer[i] = (uint8_t) bench_random(&seed);
+	}
+
+	size_t lengths[] = { 8, 16, 32, 64, 256, 1024, 16384 };
+	for (size_t f = 0; f < sizeof functions / sizeof functions[0]; ++f)
+	{
+		for (size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+			run_throughput(f, lengths[i]);
+		}
+	}
+	run_distribution(thread);
+
+	elvea_finalize(&runtime);
+}
@@ -0,0 +1,123 @@
+#include <elvea/elvea.h>
+#include <elvea/utils/alloc.h>
+#include "bench.h"
+
+#define VALUE_COUNT (256 * 1024)
+#define PASS_COUNT 16
+#define PIECE_COUNT (1024 * 1024)
+
+typedef struct iteration_t
+{
+	elvea_thread_t *thread;
+	elvea_variant_t *current;
+	size_t writes;
+} iteration_t;
+
+// Hold each value in a counted variable: the previous value is released and the new one is retained.
+static bool visit_counted(elvea_variant_t *key, elvea_variant_t *value, void *context)
+{
+	iteration_t *it = context;
+	elvea_copy(it->thread, it->current, value);
+	it->writes += 2;
+	return true;
+}
+
+// Hold each value in a scratch slot: no reference count is updated.
+static bool visit_deferred(elvea_variant_t *key, elvea_variant_t *value, void *context)
+{
+	iteration_t *it = context;
+	elvea_gc_scratch_set(it->thread, it->current, value);
+	return true;
+}
+
+// Each deferred object costs one increment when it enters the zero-count table and one decrement when it leaves it,
+// and each reconciliation counts the scratch slots.
+static size_t deferred_writes(elvea_thread_t *thread, elvea_size_t deferred, elvea_size_t reconciled, size_t slots)
+{
+	return 2 * (thread->gc.deferred_count - deferred) + 2 * slots * (thread->gc.reconcile_count - reconciled);
+}
+
+void rc_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+
+	elvea_table_t *table = elvea_table_new(thread, VALUE_COUNT);
+	elvea_object_retain(thread, table);
+	for (size_t i = 0; i < VALUE_COUNT; ++i)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof buffer, "value:%zu", i);
+		elvea_variant_t key, value;
+		elvea_init_num(thread, &key, (double) i);
+		elvea_init_object(thread, &value, elvea_string_new(thread, buffer, -1));
+		elvea_table_set(thread, table, &key, &value);
+		elvea_clear(thread, &value);
+	}
+
+	// Iterate over a table, holding the current value in a local variable.
+	elvea_variant_t current;
+	elvea_zero(&current);
+	iteration_t it = { thread, &current, 0 };
+	double start = bench_now();
+	for (int pass = 0; pass < PASS_COUNT; ++pass) {
+		elvea_table_apply(thread, table, visit_counted, &it);
+	}
+	bench_report("table iteration, counted", bench_now() - start, VALUE_COUNT * PASS_COUNT);
+	printf("  %zu refcount writes\n", it.writes);
+	elvea_clear(thread, &current);
+
+	elvea_size_t deferred = thread->gc.deferred_count;
+	elvea_size_t reconciled = thread->gc.reconcile_count;
+	it.current = elvea_gc_scratch_push(thread, 1);
+	start = bench_now();
+	for (int pass = 0; pass < PASS_COUNT; ++pass) {
+		elvea_table_apply(thread, table, visit_deferred, &it);
+	}
+	elvea_gc_scratch_pop(thread, 1);
+	bench_report("table iteration, deferred", bench_now() - start, VALUE_COUNT * PASS_COUNT);
+	printf("  %zu refcount writes\n", deferred_writes(thread, deferred, reconciled, 1));
+	elvea_object_release(thread, table);
+
+	// Build a string from temporary pieces.
+	size_t writes = 0;
+	elvea_string_t *builder = elvea_string_new(thread, "", 0);
+	elvea_object_retain(thread, builder);
+	start = bench_now();
+	for (size_t i = 0; i < PIECE_COUNT; ++i)
+	{
+		char buffer[32];
+		int len = snprintf(buffer, sizeof buffer, "%zu,", i);
+		elvea_variant_t piece;
+		elvea_init_object(thread, &piece, elvea_string_new(thread, buffer, len));
+		elvea_string_append(thread, &builder, ((elvea_string_t*) elvea_as_object(&piece))->data, len);
+		elvea_clear(thread, &piece);
+		writes += 2;
+	}
+	bench_report("string building, counted", bench_now() - start, PIECE_COUNT);
+	printf("  %zu refcount writes\n", writes);
+	elvea_object_release(thread, builder);
+
+	deferred = thread->gc.deferred_count;
+	reconciled = thread->gc.reconcile_count;
+	builder = elvea_string_new(thread, "", 0);
+	elvea_object_retain(thread, builder);
+	elvea_variant_t *piece = elvea_gc_scratch_push(thread, 1);
+	start = bench_now();
+	for (size_t i = 0; i < PIECE_COUNT; ++i)
+	{
+		char buffer[32];
+		int len = snprintf(buffer, sizeof buffer, "%zu,", i);
+		elvea_variant_t tmp;
+		elvea_box_object(&tmp, elvea_string_new(thread, buffer, len));
+		elvea_gc_scratch_set(thread, piece, &tmp);
+		elvea_string_append(thread, &builder, ((elvea_string_t*) elvea_as_object(piece))->data, len);
+	}
+	elvea_gc_scratch_pop(thread, 1);
+	bench_report("string building, deferred", bench_now() - start, PIECE_COUNT);
+	printf("  %zu refcount writes, %zu reconciliations\n", deferred_writes(thread, deferred, reconciled, 1),
+		   (size_t) (thread->gc.reconcile_count - reconciled));
+	elvea_object_release(thread, builder);
+
+	elvea_finalize(&runtime);
+}
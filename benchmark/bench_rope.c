@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include <elvea/elvea.h>
+#include "bench.h"
+
+// Edits in the middle of a large transcript. Before ropes, an insertion moved the end of the string, and an insertion
+// into a shared string (e.g. when the previous version is kept for undo) copied the whole string first.
+#define TEXT_SIZE (8 * 1024 * 1024)
+#define EDIT_COUNT 4096
+#define REPEAT 16
+
+static const char edit[] = "[inserted in the middle]";
+static volatile size_t sink;
+
+// The previous implementation of elvea_string_insert(), on a plain buffer.
+static void insert_with_memmove(char *text, size_t *size, size_t offset)
+{
+	memmove(text + offset + sizeof edit - 1, text + offset, *size - offset);
+	memcpy(text + offset, edit, sizeof edit - 1);
+	*size += sizeof edit - 1;
+}
+
+void rope_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	char *text = (char*) malloc(TEXT_SIZE + EDIT_COUNT * sizeof edit + 1);
+	uint32_t seed = 42;
+	double start;
+
+	for (size_t i = 0; i < TEXT_SIZE; ++i) {
+		text[i] = (char) ('a' + bench_random(&seed) % 26);
+	}
+	text[TEXT_SIZE] = '\0';
+
+	// Insertions.
+	size_t size = TEXT_SIZE;
+	start = bench_now();
+	for (size_t i = 0; i < EDIT_COUNT; ++i) {
+		insert_with_memmove(text, &size, bench_random(&seed) % size);
+	}
+	bench_report("insert, memmove", bench_now() - start, EDIT_COUNT);
+
+	elvea_string_t *s = elvea_string_new(thread, text, TEXT_SIZE);
+	elvea_object_retain(thread, s);
+	start = bench_now();
+	for (size_t i = 0; i < EDIT_COUNT; ++i) {
+		elvea_string_insert(thread, &s, 1 + bench_random(&seed) % s->size, edit, -1);
+	}
+	bench_report("insert, rope", bench_now() - start, EDIT_COUNT);
+
+	// Insertions which keep the previous version.
+	char *copy = NULL;
+	size = TEXT_SIZE;
+	start = bench_now();
+	for (size_t i = 0; i < EDIT_COUNT / REPEAT; ++i)
+	{
+		free(copy);
+		copy = (char*) malloc(size + sizeof edit);
+		memcpy(copy, text, size);
+		insert_with_memmove(copy, &size, bench_random(&seed) % size);
+		memcpy(text, copy, size);
+	}
+	bench_report("insert into shared string, copy", bench_now() - start, EDIT_COUNT / REPEAT);
+	free(copy);
+
+	elvea_string_t *previous = NULL;
+	start = bench_now();
+	for (size_t i = 0; i < EDIT_COUNT; ++i)
+	{
+		if (previous) elvea_object_release(thread, previous);
+		previous = s;
+		elvea_object_retain(thread, previous);
+		elvea_string_insert(thread, &s, 1 + bench_random(&seed) % s->size, edit, -1);
+	}
+	bench_report("insert into shared string, rope", bench_now() - start, EDIT_COUNT);
+	elvea_object_release(thread, previous);
+
+	// Reading the rope without flattening it.
+	elvea_string_t *flat = elvea_string_new(thread, text, TEXT_SIZE);
+	elvea_object_retain(thread, flat);
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		flat->hash = ELVEA_NPOS;
+		sink += elvea_string_hash(thread, flat);
+	}
+	bench_report("hash, flat (per MiB)", bench_now() - start, (size_t) REPEAT * TEXT_SIZE >> 20);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		s->hash = ELVEA_NPOS;
+		sink += elvea_string_hash(thread, s);
+	}
+	bench_report("hash, rope (per MiB)", bench_now() - start, (size_t) REPEAT * s->size >> 20);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		flat->utf8_size = ELVEA_NPOS;
+		sink += (size_t) elvea_string_length(thread, flat);
+	}
+	bench_report("length, flat (per MiB)", bench_now() - start, (size_t) REPEAT * TEXT_SIZE >> 20);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		s->utf8_size = ELVEA_NPOS;
+		sink += (size_t) elvea_string_length(thread, s);
+	}
+	bench_report("length, rope (per MiB)", bench_now() - start, (size_t) REPEAT * s->size >> 20);
+
+	// Compare with a flat copy, which has the same content.
+	elvea_strbuf_t buf;
+	elvea_strbuf_init(thread, &buf, s->size);
+	elvea_strbuf_append_string(thread, &buf, s);
+	elvea_string_t *same = elvea_strbuf_finish(thread, &buf);
+	elvea_object_retain(thread, same);
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r) {
+		sink += (size_t) elvea_string_compare(thread, s, same);
+	}
+	bench_report("compare, rope (per MiB)", bench_now() - start, (size_t) REPEAT * s->size >> 20);
+	elvea_object_release(thread, same);
+
+	start = bench_now();
+	elvea_string_flatten(thread, &s);
+	bench_report("flatten (per MiB)", bench_now() - start, (size_t) s->size >> 20);
+
+	elvea_object_release(thread, s);
+	elvea_object_release(thread, flat);
+	elvea_finalize(&runtime);
+	free(text);
+}
@@ -0,0 +1,150 @@
+#include <string.h>
+#include <elvea/utils/helpers.h>
+#include <elvea/utils/slab.h>
+#include "bench.h"
+
+#define NODE_COUNT 1000000
+#define STRING_COUNT 20000
+#define MIXED_SLOTS 65536
+#define MIXED_ROUNDS 4000000
+
+// Same as the runtime's default allocator.
+static void *system_alloc(void *ptr, size_t old_size, size_t new_size)
+{
+	if (new_size == 0)
+	{
+		free(ptr);
+		return NULL;
+	}
+
+	return realloc(ptr, new_size);
+}
+
+// Size of table nodes, and of tables and iterators with their headers.
+static const size_t node_size = 48;
+
+static void *blocks[NODE_COUNT];
+static uint32_t order[NODE_COUNT];
+
+// Allocate many table nodes, then free them in random order.
+static void node_churn(const char *name, elvea_allocator_t alloc, bool sized)
+{
+	uint32_t seed = 12345;
+
+	for (uint32_t i = 0; i < NODE_COUNT; ++i) {
+		order[i] = i;
+	}
+	for (size_t i = NODE_COUNT - 1; i > 0; --i)
+	{
+		size_t j = bench_random(&seed) % (i + 1);
+		uint32_t tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+
+	double start = bench_now();
+
+	for (int round = 0; round < 4; ++round)
+	{
+		for (size_t i = 0; i < NODE_COUNT; ++i) {
+			blocks[i] = alloc(NULL, 0, node_size);
+		}
+		for (size_t i = 0; i < NODE_COUNT; ++i) {
+			alloc(blocks[order[i]], sized ? node_size : 0, 0);
+		}
+	}
+
+	bench_report(name, bench_now() - start, 4 * NODE_COUNT);
+}
+
+// Grow strings the way elvea_string_append() does, from a few bytes to a few kilobytes.
+static void string_growth(const char *name, elvea_allocator_t alloc, bool sized)
+{
+	static const size_t header = 32;
+	static size_t sizes[STRING_COUNT];
+	size_t ops = 0;
+	double start = bench_now();
+
+	for (size_t i = 0; i < STRING_COUNT; ++i)
+	{
+		elvea_size_t capacity = 8;
+		sizes[i] = header + capacity;
+		blocks[i] = alloc(NULL, 0, sizes[i]);
+
+		while (capacity < 4096)
+		{
+			capacity = get_next_capacity(capacity);
+			size_t new_size = header + capacity;
+			blocks[i] = alloc(blocks[i], sized ? sizes[i] : 0, new_size);
+			sizes[i] = new_size;
+			ops++;
+		}
+	}
+	for (size_t i = 0; i < STRING_COUNT; ++i) {
+		alloc(blocks[i], sized ? sizes[i] : 0, 0);
+	}
+
+	bench_report(name, bench_now() - start, ops);
+}
+
+// Random replacement in a working set whose size distribution mimics the runtime's.
+static void mixed_workload(const char *name, elvea_allocator_t alloc, bool sized)
+{
+	static const size_t shapes[] = { 48, 48, 48, 48, 48, 44, 40, 56, 72, 104, 64, 128, 256, 512, 2048 };
+	static size_t sizes[MIXED_SLOTS];
+	uint32_t seed = 67890;
+	double start = bench_now();
+
+	memset(blocks, 0, sizeof(void*) * MIXED_SLOTS);
+
+	for (size_t i = 0; i < MIXED_ROUNDS; ++i)
+	{
+		size_t slot = bench_random(&seed) % MIXED_SLOTS;
+
+		if (blocks[slot]) {
+			alloc(blocks[slot], sized ? sizes[slot] : 0, 0);
+		}
+		sizes[slot] = shapes[bench_random(&seed) % (sizeof(shapes) / sizeof(shapes[0]))];
+		blocks[slot] = alloc(NULL, 0, sizes[slot]);
+	}
+	for (size_t i = 0; i < MIXED_SLOTS; ++i) {
+		if (blocks[i]) alloc(blocks[i], sized ? sizes[i] : 0, 0);
+	}
+
+	bench_report(name, bench_now() - start, MIXED_ROUNDS);
+}
+
+// Create and destroy strings through the runtime.
+static void runtime_strings(const char *name, elvea_allocator_t alloc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, alloc, NULL);
+	double start = bench_now();
+
+	for (size_t i = 0; i < NODE_COUNT; ++i)
+	{
+		elvea_string_t *s = elvea_string_new(thread, "hello", -1);
+		elvea_object_retain(thread, s);
+		elvea_string_append(thread, &s, " world", -1);
+		elvea_object_release(thread, s);
+	}
+
+	bench_report(name, bench_now() - start, NODE_COUNT);
+	elvea_finalize(&runtime);
+}
+
+void slab_benchmark()
+{
+	node_churn("table nodes (default_alloc)", system_alloc, false);
+	node_churn("table nodes (slab, unsized)", elvea_slab_alloc, false);
+	node_churn("table nodes (slab, sized)", elvea_slab_alloc, true);
+
+	string_growth("string growth (default_alloc)", system_alloc, false);
+	string_growth("string growth (slab, unsized)", elvea_slab_alloc, false);
+	string_growth("string growth (slab, sized)", elvea_slab_alloc, true);
+
+	mixed_workload("mixed shapes (default_alloc)", system_alloc, false);
+	mixed_workload("mixed shapes (slab, unsized)", elvea_slab_alloc, false);
+	mixed_workload("mixed shapes (slab, sized)", elvea_slab_alloc, true);
+
+	runtime_strings("runtime strings (default_alloc)", system_alloc);
+	runtime_strings("runtime strings (slab)", elvea_slab_alloc);
+}
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <string.h>
+#include <elvea/elvea.h>
+#include "bench.h"
+
+#define ELEMENT_COUNT (10 * 1000 * 1000)
+
+static elvea_thread_t *current_thread;
+static elvea_variant_t *original;
+static elvea_variant_t *values;
+
+// The naive sort, which goes through elvea_compare() for every comparison.
+static int naive_compare(const void *a, const void *b)
+{
+	return elvea_compare(current_thread, (elvea_variant_t*) a, (elvea_variant_t*) b);
+}
+
+static bool is_sorted(elvea_thread_t *thread)
+{
+	for (size_t i = 1; i < ELEMENT_COUNT; ++i)
+	{
+		if (elvea_compare(thread, &values[i - 1], &values[i]) > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Sort a copy of the original values with qsort() and with elvea_sort(), then sort the sorted values again. Since
+// sorting only permutes the values, they can be copied without touching the reference counts.
+static void run_sorts(elvea_thread_t *thread, const char *input)
+{
+	char name[64];
+	double start;
+
+	memcpy(values, original, ELEMENT_COUNT * sizeof(elvea_variant_t));
+	start = bench_now();
+	qsort(values, ELEMENT_COUNT, sizeof(elvea_variant_t), naive_compare);
+	snprintf(name, sizeof name, "qsort + elvea_compare, %s", input);
+	bench_report(name, bench_now() - start, ELEMENT_COUNT);
+
+	memcpy(values, original, ELEMENT_COUNT * sizeof(elvea_variant_t));
+	start = bench_now();
+	elvea_sort(thread, values, ELEMENT_COUNT);
+	snprintf(name, sizeof name, "elvea_sort, %s", input);
+	bench_report(name, bench_now() - start, ELEMENT_COUNT);
+
+	start = bench_now();
+	elvea_sort(thread, values, ELEMENT_COUNT);
+	snprintf(name, sizeof name, "elvea_sort, %s (sorted)", input);
+	bench_report(name, bench_now() - start, ELEMENT_COUNT);
+
+	if (! is_sorted(thread)) {
+		printf("  error: %s are not sorted\n", input);
+	}
+}
+
+void sort_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	uint32_t seed = 42;
+	char buffer[32];
+
+	current_thread = thread;
+	original = (elvea_variant_t*) malloc(ELEMENT_COUNT * sizeof(elvea_variant_t));
+	values = (elvea_variant_t*) malloc(ELEMENT_COUNT * sizeof(elvea_variant_t));
+
+	for (size_t i = 0; i < ELEMENT_COUNT; ++i)
+	{
+		uint64_t r = (uint64_t) bench_random(&seed) << 32 | bench_random(&seed);
+		elvea_init_int(thread, &original[i], (elvea_int_t) (r >> 16) - ((elvea_int_t) 1 << 47));
+	}
+	run_sorts(thread, "integers");
+
+	for (size_t i = 0; i < ELEMENT_COUNT; ++i) {
+		elvea_init_num(thread, &original[i], ((double) bench_random(&seed) - 2147483648.0) / 1024.0);
+	}
+	run_sorts(thread, "numbers");
+
+	// Integers and numbers mixed together go through the merge sort.
+	for (size_t i = 0; i < ELEMENT_COUNT; i += 2) {
+		elvea_init_int(thread, &original[i], (elvea_int_t) (bench_random(&seed) % 1000000));
+	}
+	run_sorts(thread, "mixed numbers");
+
+	for (size_t i = 0; i < ELEMENT_COUNT; ++i)
+	{
+		int len = snprintf(buffer, sizeof buffer, "key:%u", bench_random(&seed) % 100000000);
+		elvea_init_object(thread, &original[i], elvea_string_new(thread, buffer, len));
+	}
+	run_sorts(thread, "strings");
+
+	elvea_release_n(thread, original, ELEMENT_COUNT);
+	free(original);
+	free(values);
+	elvea_finalize(&runtime);
+}
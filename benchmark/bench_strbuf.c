@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <elvea/elvea.h>
+#include "bench.h"
+
+#define PIECE_COUNT (1024 * 1024)
+#define REPEAT 4
+
+static volatile size_t sink;
+
+// Build "<i>:<i / 8>,<string> " for each piece by appending to a string.
+static void build_with_append(elvea_thread_t *thread, elvea_string_t *piece)
+{
+	elvea_string_t *s = elvea_string_new(thread, "", 0);
+	elvea_object_retain(thread, s);
+
+	for (size_t i = 0; i < PIECE_COUNT; ++i)
+	{
+		char buffer[64];
+		int len = snprintf(buffer, sizeof buffer, "%zu:%.15g,", i, (double) i / 8);
+		elvea_string_append(thread, &s, buffer, len);
+		elvea_string_append(thread, &s, piece->data, piece->size);
+		elvea_string_append(thread, &s, " ", 1);
+	}
+	sink = s->size;
+	elvea_object_release(thread, s);
+}
+
+static void build_with_strbuf(elvea_thread_t *thread, elvea_string_t *piece, size_t capacity)
+{
+	elvea_strbuf_t buf;
+	elvea_strbuf_init(thread, &buf, capacity);
+
+	for (size_t i = 0; i < PIECE_COUNT; ++i)
+	{
+		elvea_strbuf_append_int(thread, &buf, (elvea_int_t) i);
+		elvea_strbuf_append_char(thread, &buf, ':');
+		elvea_strbuf_append_num(thread, &buf, (double) i / 8);
+		elvea_strbuf_append_char(thread, &buf, ',');
+		elvea_strbuf_append_string(thread, &buf, piece);
+		elvea_strbuf_append_char(thread, &buf, ' ');
+	}
+
+	elvea_string_t *s = elvea_strbuf_finish(thread, &buf);
+	elvea_object_retain(thread, s);
+	sink = s->size;
+	elvea_object_release(thread, s);
+}
+
+void strbuf_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_string_t *piece = elvea_string_new(thread, "piece", -1);
+	elvea_object_retain(thread, piece);
+	double start;
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r) {
+		build_with_append(thread, piece);
+	}
+	bench_report("snprintf + elvea_string_append", bench_now() - start, (size_t) PIECE_COUNT * REPEAT);
+	size_t size = sink;
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r) {
+		build_with_strbuf(thread, piece, 0);
+	}
+	bench_report("elvea_strbuf_t", bench_now() - start, (size_t) PIECE_COUNT * REPEAT);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r) {
+		build_with_strbuf(thread, piece, size);
+	}
+	bench_report("elvea_strbuf_t, with capacity", bench_now() - start, (size_t) PIECE_COUNT * REPEAT);
+	printf("  %zu bytes (%zu with the builder)\n", size, (size_t) sink);
+
+	elvea_object_release(thread, piece);
+	elvea_finalize(&runtime);
+}
@@ -0,0 +1,77 @@
+#include <elvea/elvea.h>
+#include <elvea/utils/alloc.h>
+#include "bench.h"
+
+#define KEY_COUNT (256 * 1024)
+#define CHURN_COUNT (1024 * 1024)
+
+static elvea_variant_t keys[KEY_COUNT];
+
+static void create_keys(elvea_thread_t *thread)
+{
+	for (size_t i = 0; i < KEY_COUNT; ++i)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof buffer, "key:%zu", i);
+		elvea_init_object(thread, &keys[i], elvea_string_new(thread, buffer, -1));
+	}
+}
+
+static elvea_table_t *fill_table(elvea_thread_t *thread, size_t count)
+{
+	elvea_table_t *table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, table);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		elvea_variant_t value;
+		elvea_init_num(thread, &value, (double) i);
+		elvea_table_set(thread, table, &keys[i], &value);
+	}
+
+	return table;
+}
+
+void table_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	uint32_t seed = 1234;
+	create_keys(thread);
+
+	double start = bench_now();
+	elvea_table_t *table = fill_table(thread, KEY_COUNT);
+	bench_report("insert", bench_now() - start, KEY_COUNT);
+	printf("  %zu KiB in use\n", elvea_memory_used(thread) / 1024);
+
+	// Remove a random key and insert another one, keeping the table half full.
+	for (size_t i = KEY_COUNT / 2; i < KEY_COUNT; ++i) {
+		elvea_table_remove(thread, table, &keys[i]);
+	}
+	start = bench_now();
+	for (size_t i = 0; i < CHURN_COUNT; ++i)
+	{
+		elvea_variant_t *key = &keys[bench_random(&seed) % KEY_COUNT];
+		elvea_variant_t value;
+		elvea_init_num(thread, &value, (double) i);
+
+		if (! elvea_table_remove(thread, table, key)) {
+			elvea_table_set(thread, table, key, &value);
+		}
+	}
+	bench_report("insert/remove churn", bench_now() - start, CHURN_COUNT);
+
+	start = bench_now();
+	elvea_object_release(thread, table);
+	bench_report("teardown (half full)", bench_now() - start, KEY_COUNT / 2);
+
+	table = fill_table(thread, KEY_COUNT);
+	start = bench_now();
+	elvea_object_release(thread, table);
+	bench_report("teardown (full)", bench_now() - start, KEY_COUNT);
+
+	for (size_t i = 0; i < KEY_COUNT; ++i) {
+		elvea_release(thread, &keys[i]);
+	}
+	elvea_finalize(&runtime);
+}
@@ -0,0 +1,219 @@
+#include <elvea/elvea.h>
+#include <elvea/utils/alloc.h>
+#include "bench.h"
+
+// The layout of variants is chosen at compile time: run this benchmark in a build configured with
+// -DELVEA_NAN_BOXING=ON and in a default build to compare them.
+
+#define VARIANT_COUNT (1024 * 1024)
+#define TABLE_SIZE (256 * 1024)
+#define REPEAT 16
+
+static elvea_variant_t values[VARIANT_COUNT];
+static elvea_variant_t copies[VARIANT_COUNT];
+static elvea_variant_t sparse[VARIANT_COUNT];
+
+// Fill the values with a mix of numbers, booleans, nulls and strings.
+static void create_values(elvea_thread_t *thread, elvea_string_t *string)
+{
+	uint32_t seed = 42;
+
+	for (size_t i = 0; i < VARIANT_COUNT; ++i)
+	{
+		switch (bench_random(&seed) % 8)
+		{
+			case 0:
+				elvea_zero(&values[i]);
+				break;
+			case 1:
+				elvea_init_bool(thread, &values[i], i % 2 == 0);
+				break;
+			case 2:
+				elvea_init_object(thread, &values[i], string);
+				break;
+			default:
+				elvea_init_num(thread, &values[i], (double) i * 0.5);
+		}
+		elvea_zero(&copies[i]);
+	}
+}
+
+// Compare the bulk operations with loops, on values which mostly don't hold references and on the mixed values.
+static void bulk_benchmark(elvea_thread_t *thread, elvea_string_t *string)
+{
+	for (size_t i = 0; i < VARIANT_COUNT; ++i)
+	{
+		if (i % 256 == 0) {
+			elvea_init_object(thread, &sparse[i], string);
+		}
+		else {
+			elvea_init_int(thread, &sparse[i], (elvea_int_t) i);
+		}
+	}
+
+	const elvea_variant_t *sources[] = { sparse, values };
+	const char *names[] = { "copy loop (sparse)", "copy_n (sparse)", "copy loop (mixed)", "copy_n (mixed)" };
+	double start;
+
+	for (int k = 0; k < 2; ++k)
+	{
+		start = bench_now();
+		for (int r = 0; r < REPEAT; ++r)
+		{
+			for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+				elvea_copy(thread, &copies[i], &sources[k][i]);
+			}
+		}
+		bench_report(names[2 * k], bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+		start = bench_now();
+		for (int r = 0; r < REPEAT; ++r)
+		{
+			elvea_copy_n(thread, copies, sources[k], VARIANT_COUNT);
+		}
+		bench_report(names[2 * k + 1], bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+	}
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			elvea_retain(thread, &sparse[i]);
+		}
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			elvea_release(thread, &sparse[i]);
+		}
+	}
+	bench_report("retain/release loop (sparse)", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT * 2);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		elvea_retain_n(thread, sparse, VARIANT_COUNT);
+		elvea_release_n(thread, sparse, VARIANT_COUNT);
+	}
+	bench_report("retain_n/release_n (sparse)", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT * 2);
+
+	elvea_release_n(thread, sparse, VARIANT_COUNT);
+}
+
+void variant_benchmark()
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_string_t *string = elvea_string_new(thread, "variant", -1);
+	elvea_object_retain(thread, string);
+
+	printf("  layout: %s, %zu bytes per variant, %zu bytes per alias\n", ELVEA_NAN_BOXING ? "NaN-boxed" : "tagged union",
+		   sizeof(elvea_variant_t), sizeof(elvea_alias_t));
+
+	// Memory.
+	size_t before = elvea_memory_used(thread);
+	elvea_table_t *table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, table);
+	for (size_t i = 0; i < TABLE_SIZE; ++i)
+	{
+		elvea_variant_t key, value;
+		elvea_init_num(thread, &key, (double) i);
+		elvea_init_num(thread, &value, (double) i * 2);
+		elvea_table_set(thread, table, &key, &value);
+	}
+	printf("  %zu KiB for %d variants, %zu KiB for a table with %d entries\n", sizeof values / 1024, VARIANT_COUNT,
+		   (elvea_memory_used(thread) - before) / 1024, TABLE_SIZE);
+
+	// Throughput.
+	create_values(thread, string);
+
+	double start = bench_now();
+	size_t numbers = 0;
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			numbers += elvea_check_num(&values[i]);
+		}
+	}
+	bench_report("type check", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+	start = bench_now();
+	double sum = 0;
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			if (elvea_check_num(&values[i])) sum += elvea_get_num(thread, &values[i]);
+		}
+	}
+	bench_report("number read", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+	start = bench_now();
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			elvea_copy(thread, &copies[i], &values[(i + r) % VARIANT_COUNT]);
+		}
+	}
+	bench_report("copy", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+	start = bench_now();
+	size_t hash = 0;
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			if (! elvea_check_null(&values[i])) hash += elvea_hash(thread, &values[i]);
+		}
+	}
+	bench_report("hash", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+	start = bench_now();
+	size_t equal = 0;
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < VARIANT_COUNT; ++i) {
+			equal += elvea_equal(thread, &values[i], &copies[i]);
+		}
+	}
+	bench_report("equal", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+
+	start = bench_now();
+	elvea_variant_t key;
+	size_t found = 0;
+	for (int r = 0; r < REPEAT; ++r)
+	{
+		for (size_t i = 0; i < TABLE_SIZE; ++i)
+		{
+			elvea_init_num(thread, &key, (double) i);
+			found += elvea_table_get(thread, table, &key) != NULL;
+		}
+	}
+	bench_report("table lookup", bench_now() - start, (size_t) TABLE_SIZE * REPEAT);
+
+	// Arithmetic on integers and on numbers.
+	elvea_variant_t acc, step;
+	elvea_init_int(thread, &acc, 0);
+	elvea_init_int(thread, &step, 3);
+	start = bench_now();
+	for (size_t i = 0; i < (size_t) VARIANT_COUNT * REPEAT; ++i) {
+		elvea_add(thread, &acc, &acc, &step);
+	}
+	bench_report("integer add", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+	sum += (double) elvea_get_int(thread, &acc);
+
+	elvea_init_num(thread, &acc, 0);
+	elvea_init_num(thread, &step, 3);
+	start = bench_now();
+	for (size_t i = 0; i < (size_t) VARIANT_COUNT * REPEAT; ++i) {
+		elvea_add(thread, &acc, &acc, &step);
+	}
+	bench_report("number add", bench_now() - start, (size_t) VARIANT_COUNT * REPEAT);
+	sum += elvea_get_num(thread, &acc);
+	printf("  (%zu, %g, %zu, %zu, %zu)\n", numbers, sum, hash, equal, found);
+	bulk_benchmark(thread, string);
+
+	for (size_t i = 0; i < VARIANT_COUNT; ++i)
+	{
+		elvea_release(thread, &values[i]);
+		elvea_release(thread, &copies[i]);
+	}
+	elvea_object_release(thread, table);
+	elvea_object_release(thread, string);
+	elvea_finalize(&runtime);
+}
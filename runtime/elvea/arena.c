@@ -23,50 +23,275 @@
  ***********************************************************************************************************************/
 
 #include <stddef.h>
+#include <string.h>
 #include <elvea/arena.h>
 #include <elvea/utils/alloc.h>
+#include <elvea/utils/vmem.h>
 
 struct elvea_heap_slot_t
 {
 	elvea_alias_t data;
-	struct elvea_heap_slot_t *next;
+
+	union
+	{
+		// Next free slot in the page, when the slot is free.
+		struct elvea_heap_slot_t *next;
+
+		// Page the slot belongs to, when the slot is in use.
+		elvea_heap_page_t *page;
+	} link;
 };
 
+// Each page keeps track of its own free slots, so that empty pages can be released without scanning them.
 struct elvea_heap_page_t
 {
-	elvea_heap_page_t *next;
+	// Pages are chained in the list that corresponds to their occupancy.
+	elvea_heap_page_t *previous, *next;
+
+	// Free slots in this page which have already been used.
+	struct elvea_heap_slot_t *free_list;
+
+	// Number of slots in use.
+	uint32_t live;
+
+	// Index of the first slot which has never been used. Slots are handed out lazily, so that fresh pages don't
+	// need to be initialized.
+	uint32_t unused;
+
+	// List the page is in: a bin index, or one of the values below.
+	int32_t list;
+
+	// Thread which owns the arena.
+	elvea_thread_t *owner;
+
+	// One bit per slot, which is set if the slot is in use.
+	uint64_t bitmap[ELVEA_PAGE_SIZE / 64];
+
 	struct elvea_heap_slot_t data[ELVEA_PAGE_SIZE];
 };
 
-static void link_nodes(elvea_heap_page_t *page)
+enum
+{
+	LIST_CURRENT = -1,
+	LIST_FULL    = -2,
+	LIST_EMPTY   = -3
+};
+
+
+static elvea_heap_page_t **get_list(elvea_arena_t *arena, int32_t list)
+{
+	switch (list)
+	{
+		case LIST_FULL:
+			return &arena->full;
+		case LIST_EMPTY:
+			return &arena->empty;
+		default:
+			assert(list >= 0 && list < ELVEA_ARENA_BIN_COUNT);
+			return &arena->bins[list];
+	}
+}
+
+static void unlink_page(elvea_arena_t *arena, elvea_heap_page_t *page)
+{
+	if (page->list == LIST_CURRENT) {
+		return;
+	}
+
+	if (page->previous) {
+		page->previous->next = page->next;
+	}
+	else {
+		*get_list(arena, page->list) = page->next;
+	}
+
+	if (page->next) {
+		page->next->previous = page->previous;
+	}
+
+	if (page->list == LIST_EMPTY) {
+		arena->empty_count--;
+	}
+}
+
+static void link_page(elvea_arena_t *arena, elvea_heap_page_t *page, int32_t list)
+{
+	elvea_heap_page_t **head = get_list(arena, list);
+
+	page->list = list;
+	page->previous = NULL;
+	page->next = *head;
+
+	if (*head) {
+		(*head)->previous = page;
+	}
+	*head = page;
+
+	if (list == LIST_EMPTY) {
+		arena->empty_count++;
+	}
+}
+
+// Find out which list a page that is not the current page belongs to.
+static int32_t classify_page(elvea_heap_page_t *page)
+{
+	if (page->live == 0) {
+		return LIST_EMPTY;
+	}
+	if (page->live == ELVEA_PAGE_SIZE) {
+		return LIST_FULL;
+	}
+
+	return (int32_t) ((uint64_t) page->live * ELVEA_ARENA_BIN_COUNT / ELVEA_PAGE_SIZE);
+}
+
+static bool in_range(elvea_arena_range_t *range, elvea_heap_page_t *page)
+{
+	char *address = (char*) page;
+	return range->base && address >= range->base && address < range->base + range->size;
+}
+
+// Get a page from the virtual memory range, or NULL if the range is exhausted.
+static elvea_heap_page_t *carve_page(elvea_arena_range_t *range)
+{
+	char *address;
+
+	if (range->released_count > 0)
+	{
+		address = range->base + range->stride * range->released[--range->released_count];
+	}
+	else if ((size_t) (range->used + 1) * range->stride <= range->size)
+	{
+		address = range->base + range->stride * range->used++;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (! elvea_vmem_commit(address, range->stride)) {
+		return NULL;
+	}
+
+	return (elvea_heap_page_t *) address;
+}
+
+static elvea_heap_page_t *new_page(elvea_thread_t *thread, elvea_arena_t *arena)
+{
+	elvea_heap_page_t *page = NULL;
+
+	if (arena->range.base) {
+		page = carve_page(&arena->range);
+	}
+
+	// Fall back to the allocator if there is no range or if it is exhausted.
+	if (page == NULL) {
+		page = (elvea_heap_page_t *) elvea_alloc(thread, sizeof(elvea_heap_page_t));
+	}
+
+	if (! elvea_check_memory(thread, page)) {
+		return NULL;
+	}
+
+	page->free_list = NULL;
+	page->owner = thread;
+	page->live = 0;
+	page->unused = 0;
+	memset(page->bitmap, 0, sizeof(page->bitmap));
+	arena->page_count++;
+
+	return page;
+}
+
+static void delete_page(elvea_thread_t *thread, elvea_arena_t *arena, elvea_heap_page_t *page)
 {
-	static const size_t last_index = ELVEA_PAGE_SIZE - 1;
+	elvea_arena_range_t *range = &arena->range;
 
-	for (size_t i = 0; i < last_index; ++i)
+	if (in_range(range, page))
 	{
-		page->data[i].next = &page->data[i+1];
+		if (range->released_count == range->released_capacity)
+		{
+			uint32_t capacity = range->released_capacity ? range->released_capacity * 2 : 64;
+			uint32_t *released = (uint32_t *) elvea_realloc(thread, range->released,
+					range->released_capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+
+			// If we can't remember the page, leave it alone: it's still committed and it will be lost, but it is
+			// not worth throwing an error over.
+			if (released == NULL) {
+				return;
+			}
+			range->released = released;
+			range->released_capacity = capacity;
+		}
+
+		// The page's memory is given back to the system by elvea_arena_compact().
+		range->released[range->released_count++] = (uint32_t) (((char*) page - range->base) / range->stride);
+	}
+	else
+	{
+		elvea_free(thread, page, sizeof(elvea_heap_page_t));
 	}
 
-	page->data[last_index].next = NULL;
+	arena->page_count--;
 }
 
-static void add_page(elvea_thread_t *thread, elvea_arena_t *arena)
+// Pick a new page to allocate from: the fullest page that still has free slots, an empty page or a new page.
+static bool next_page(elvea_thread_t *thread, elvea_arena_t *arena)
 {
-	elvea_heap_page_t *page = (elvea_heap_page_t *) elvea_alloc(thread, sizeof(elvea_heap_page_t));
-	page->next = arena->pages;
-	arena->pages = page;
-	link_nodes(page);
-	arena->free_list = &page->data[0];
+	elvea_heap_page_t *page = NULL;
+
+	if (arena->current) {
+		link_page(arena, arena->current, classify_page(arena->current));
+	}
+
+	for (int32_t i = ELVEA_ARENA_BIN_COUNT - 1; i >= 0 && page == NULL; --i) {
+		page = arena->bins[i];
+	}
+
+	if (page == NULL) {
+		page = arena->empty;
+	}
+
+	if (page) {
+		unlink_page(arena, page);
+	}
+	else if ((page = new_page(thread, arena)) == NULL) {
+		arena->current = NULL;
+		return false;
+	}
+
+	page->list = LIST_CURRENT;
+	page->previous = page->next = NULL;
+	arena->current = page;
+
+	return true;
 }
 
 static struct elvea_heap_slot_t *get_slot(elvea_thread_t *thread, elvea_arena_t *arena)
 {
-	if (arena->free_list == NULL) {
-		add_page(thread, arena);
+	elvea_heap_page_t *page = arena->current;
+
+	if (page == NULL || page->live == ELVEA_PAGE_SIZE)
+	{
+		if (! next_page(thread, arena)) {
+			return NULL;
+		}
+		page = arena->current;
 	}
 
-	struct elvea_heap_slot_t *slot = arena->free_list;
-	arena->free_list = slot->next;
+	struct elvea_heap_slot_t *slot = page->free_list;
+
+	if (slot) {
+		page->free_list = slot->link.next;
+	}
+	else {
+		slot = &page->data[page->unused++];
+	}
+
+	size_t index = (size_t) (slot - page->data);
+	page->bitmap[index / 64] |= ((uint64_t) 1) << (index % 64);
+	page->live++;
+	slot->link.page = page;
 	slot->data.meta.arena = true;
 
 	return slot;
@@ -74,15 +299,123 @@ static struct elvea_heap_slot_t *get_slot(elvea_thread_t *thread, elvea_arena_t
 
 static void recycle_slot(elvea_thread_t *thread, elvea_arena_t *arena, struct elvea_heap_slot_t *slot)
 {
-	slot->next = arena->free_list;
-	arena->free_list = slot;
+	elvea_heap_page_t *page = slot->link.page;
+	size_t index = (size_t) (slot - page->data);
+	assert(page->bitmap[index / 64] & (((uint64_t) 1) << (index % 64)));
+
+	page->bitmap[index / 64] &= ~(((uint64_t) 1) << (index % 64));
+	page->live--;
 	slot->data.meta.arena = false;
+	slot->link.next = page->free_list;
+	page->free_list = slot;
+
+	// Move the page to the list that matches its new occupancy.
+	if (page->list != LIST_CURRENT)
+	{
+		int32_t list = classify_page(page);
+
+		if (list != page->list)
+		{
+			unlink_page(arena, page);
+			link_page(arena, page, list);
+		}
+	}
+}
+
+static void delete_list(elvea_thread_t *thread, elvea_arena_t *arena, elvea_heap_page_t *page)
+{
+	while (page)
+	{
+		elvea_heap_page_t *next = page->next;
+		delete_page(thread, arena, page);
+		page = next;
+	}
+}
+
+static int compare_indices(const void *a, const void *b)
+{
+	uint32_t i = *(const uint32_t *) a;
+	uint32_t j = *(const uint32_t *) b;
+
+	return (i > j) - (i < j);
+}
+
+static void free_heap_pages(elvea_thread_t *thread, elvea_arena_range_t *range, elvea_heap_page_t *page)
+{
+	while (page)
+	{
+		elvea_heap_page_t *next = page->next;
+
+		if (! in_range(range, page)) {
+			elvea_free(thread, page, sizeof(elvea_heap_page_t));
+		}
+		page = next;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void elvea_arena_initialize(elvea_arena_t *arena)
+{
+	memset(arena, 0, sizeof(elvea_arena_t));
+}
+
+void elvea_arena_finalize(elvea_thread_t *thread, elvea_arena_t *arena)
+{
+	elvea_arena_range_t *range = &arena->range;
+
+	// Pages in the range are released all at once below: only heap pages need to be freed one by one.
+	free_heap_pages(thread, range, arena->current);
+	for (int32_t i = 0; i < ELVEA_ARENA_BIN_COUNT; ++i) {
+		free_heap_pages(thread, range, arena->bins[i]);
+	}
+	free_heap_pages(thread, range, arena->full);
+	free_heap_pages(thread, range, arena->empty);
+
+	if (range->base)
+	{
+		elvea_vmem_release(range->base, range->size);
+		elvea_free(thread, range->released, range->released_capacity * sizeof(uint32_t));
+	}
+	elvea_arena_initialize(arena);
+}
+
+bool elvea_arena_reserve(elvea_thread_t *thread, elvea_arena_t *arena, size_t reserve, bool huge_pages)
+{
+	elvea_arena_range_t *range = &arena->range;
+	size_t system_page_size = elvea_vmem_page_size();
+	size_t stride = (sizeof(elvea_heap_page_t) + system_page_size - 1) / system_page_size * system_page_size;
+	assert(arena->page_count == 0 && range->base == NULL);
+
+	if (reserve < stride) {
+		return false;
+	}
+
+	char *base = (char*) elvea_vmem_reserve(reserve);
+
+	if (base == NULL) {
+		return false;
+	}
+
+	if (huge_pages) {
+		elvea_vmem_use_huge_pages(base, reserve);
+	}
+
+	range->base = base;
+	range->size = reserve;
+	range->stride = stride;
+	range->used = 0;
+	range->released = NULL;
+	range->released_count = range->released_capacity = 0;
+
+	return true;
 }
 
 elvea_variant_t * elvea_arena_alloc_variant(elvea_thread_t *thread, elvea_arena_t *arena)
 {
 	struct elvea_heap_slot_t *slot = get_slot(thread, arena);
-	return &slot->data.variant;
+	return slot ? &slot->data.variant : NULL;
 }
 
 void elvea_arena_recycle_variant(elvea_thread_t *thread, elvea_arena_t *arena, elvea_variant_t *variant)
@@ -95,7 +428,7 @@ void elvea_arena_recycle_variant(elvea_thread_t *thread, elvea_arena_t *arena, e
 elvea_alias_t * elvea_arena_alloc_alias(elvea_thread_t *thread, elvea_arena_t *arena)
 {
 	struct elvea_heap_slot_t *slot = get_slot(thread, arena);
-	return &slot->data;
+	return slot ? &slot->data : NULL;
 }
 
 void elvea_arena_recycle_alias(elvea_thread_t *thread, elvea_arena_t *arena, elvea_alias_t *alias)
@@ -104,50 +437,68 @@ void elvea_arena_recycle_alias(elvea_thread_t *thread, elvea_arena_t *arena, elv
 	recycle_slot(thread, arena, slot);
 }
 
-void elvea_arena_compact(elvea_thread_t *thread, elvea_arena_t *arena)
+elvea_thread_t *elvea_arena_alias_owner(elvea_alias_t *alias)
 {
-	elvea_heap_page_t **page_address = &arena->pages;
+	return ((struct elvea_heap_slot_t *) alias)->link.page->owner;
+}
 
-	while (*page_address != NULL)
+static void for_each_slot(elvea_heap_page_t *page, void (*callback)(elvea_alias_t*, size_t, void*), void *context)
+{
+	for (uint32_t i = 0; i < page->unused; i++)
 	{
-		elvea_heap_page_t *page = *page_address;
-		bool used = false;
-		struct elvea_heap_slot_t *slots = &page->data[0];
+		if (page->bitmap[i / 64] & (((uint64_t) 1) << (i % 64))) {
+			callback(&page->data[i].data, sizeof(struct elvea_heap_slot_t), context);
+		}
+	}
+}
 
-		for (size_t i = 0; i < ELVEA_PAGE_SIZE; ++i)
-		{
-			if (slots[i].data.meta.arena)
-			{
-				used = true;
-				break;
-			}
+void elvea_arena_for_each_slot(elvea_arena_t *arena, void (*callback)(elvea_alias_t *slot, size_t size, void *context),
+		void *context)
+{
+	// Empty pages don't have any slot in use, and the current page is not in any list.
+	if (arena->current) {
+		for_each_slot(arena->current, callback, context);
+	}
+	for (int32_t i = 0; i < ELVEA_ARENA_BIN_COUNT; ++i)
+	{
+		for (elvea_heap_page_t *page = arena->bins[i]; page != NULL; page = page->next) {
+			for_each_slot(page, callback, context);
 		}
+	}
+	for (elvea_heap_page_t *page = arena->full; page != NULL; page = page->next) {
+		for_each_slot(page, callback, context);
+	}
+}
 
-		if (!used)
-		{
-			// Remove page items from the free list.
-			struct elvea_heap_slot_t *start_address = &page->data[0];
-			struct elvea_heap_slot_t *end_address = &slots[ELVEA_PAGE_SIZE-1];
-			struct elvea_heap_slot_t **slot_address = &arena->free_list;
-
-			while (*slot_address)
-			{
-				struct elvea_heap_slot_t *slot = *slot_address;
-
-				if (start_address <= slot && slot <= end_address)
-				{
-					// Detach node
-					*slot_address = slot->next;
-				}
-				else
-				{
-					// Move to next node
-					slot_address = &slot->next;
-				}
-			}
+void elvea_arena_compact(elvea_thread_t *thread, elvea_arena_t *arena)
+{
+	elvea_arena_range_t *range = &arena->range;
+	uint32_t first_released = range->released_count;
+	elvea_heap_page_t *page = arena->empty;
+	arena->empty = NULL;
+	arena->empty_count = 0;
+	delete_list(thread, arena, page);
+
+	// The current page can go too if it is not used.
+	if (arena->current && arena->current->live == 0)
+	{
+		delete_page(thread, arena, arena->current);
+		arena->current = NULL;
+	}
+
+	// Give the memory of released pages back to the system. Adjacent pages are merged, to limit the number of calls.
+	uint32_t *released = range->released + first_released;
+	uint32_t count = range->released_count - first_released;
+	if (count > 1) qsort(released, count, sizeof(uint32_t), compare_indices);
+
+	for (uint32_t i = 0; i < count; )
+	{
+		uint32_t j = i + 1;
 
-			*page_address = page->next;
-			elvea_free(thread, page_address);
+		while (j < count && released[j] == released[j-1] + 1) {
+			j++;
 		}
+		elvea_vmem_decommit(range->base + released[i] * range->stride, (j - i) * range->stride);
+		i = j;
 	}
 }
@@ -35,15 +35,68 @@ typedef struct elvea_heap_page_t elvea_heap_page_t;
 typedef struct elvea_arena_t elvea_arena_t;
 struct elvea_heap_slot_t;
 
+// Partially used pages are sorted into bins according to how full they are, so that allocation can prefer the fullest
+// pages and leave the emptiest ones a chance to become empty and be released.
+#define ELVEA_ARENA_BIN_COUNT 8
+
+// Virtual memory range from which pages are carved when the arena is backed by virtual memory.
+typedef struct elvea_arena_range_t
+{
+	// Start of the range, or NULL if pages come from the runtime's allocator.
+	char *base;
+
+	// Number of bytes reserved.
+	size_t size;
+
+	// Distance between two pages, which is the size of a page rounded up to the system's page size.
+	size_t stride;
+
+	// Number of pages carved from the range so far.
+	uint32_t used;
+
+	// Indices of pages whose memory was given back to the system, and which can be reused.
+	uint32_t *released;
+	uint32_t released_count;
+	uint32_t released_capacity;
+} elvea_arena_range_t;
+
 struct elvea_arena_t
 {
-	struct elvea_heap_slot_t *free_list;
-	elvea_heap_page_t *pages;
+	// Page we are currently allocating from. It is not in any list.
+	elvea_heap_page_t *current;
+
+	// Partially used pages. Bin i contains pages whose occupancy is in [i/BIN_COUNT, (i+1)/BIN_COUNT).
+	elvea_heap_page_t *bins[ELVEA_ARENA_BIN_COUNT];
+
+	// Pages which are completely used.
+	elvea_heap_page_t *full;
+
+	// Pages which are completely free. They are released by elvea_arena_compact().
+	elvea_heap_page_t *empty;
+
+	// Total number of pages, and number of empty pages.
+	elvea_size_t page_count;
+	elvea_size_t empty_count;
+
+	// Backing virtual memory range, if any.
+	elvea_arena_range_t range;
 };
 
 
 //----------------------------------------------------------------------------------------------------------------------
 
+void elvea_arena_initialize(elvea_arena_t *arena);
+
+// Release all the pages owned by the arena.
+void elvea_arena_finalize(elvea_thread_t *thread, elvea_arena_t *arena);
+
+// Carve pages from a virtual memory range of [reserve] bytes instead of getting them from the runtime's allocator.
+// Pages are committed when they are first needed, and compaction gives the memory of empty pages back to the system.
+// If [huge_pages] is true, the range is backed by transparent huge pages when the system supports it. This must be
+// called before the arena is used. Returns false if the range could not be reserved, in which case the arena keeps
+// using the allocator.
+bool elvea_arena_reserve(elvea_thread_t *thread, elvea_arena_t *arena, size_t reserve, bool huge_pages);
+
 // Get an uninitialized storage area large enough to hold a variant.
 elvea_variant_t *elvea_arena_alloc_variant(elvea_thread_t *thread, elvea_arena_t *arena);
 
@@ -56,7 +109,16 @@ elvea_alias_t * elvea_arena_alloc_alias(elvea_thread_t *thread, elvea_arena_t *a
 // Put back alias into the arena.
 void elvea_arena_recycle_alias(elvea_thread_t *thread, elvea_arena_t *arena, elvea_alias_t *alias);
 
-// Remove memory pages which are unused.
+// Get the thread which owns the arena an alias was allocated from.
+elvea_thread_t *elvea_arena_alias_owner(elvea_alias_t *alias);
+
+// Invoke [callback] on each slot in use, which holds either an alias or a variant (in which case only the alias's
+// variant field is meaningful). [size] is the number of bytes taken by a slot.
+void elvea_arena_for_each_slot(elvea_arena_t *arena, void (*callback)(elvea_alias_t *slot, size_t size, void *context),
+		void *context);
+
+// Release memory pages which are unused. This takes time proportional to the number of empty pages. If the arena is
+// backed by virtual memory, the pages' memory is given back to the system but their addresses are kept for reuse.
 void elvea_arena_compact(elvea_thread_t *thread, elvea_arena_t *arena);
 
 
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <elvea/class.h>
+#include <elvea/thread.h>
 #include <elvea/utils/alloc.h>
 
 
@@ -40,5 +41,9 @@ elvea_class_t *elvea_class_new(elvea_thread_t *thread, const char *name, uint32_
 		memcpy(self->bases, bases, sizeof(elvea_class_t*) * base_count);
 	}
 
+	self->thread = thread;
+	self->next = thread->classes;
+	thread->classes = self;
+
 	return self;
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
 #define ELVEA_CLASS_H
 
 #include <elvea/definitions.h>
+#include <elvea/profiler.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +50,9 @@ struct elvea_class_t
 
 	// Chain classes together so that we can easily keep track of all registered classes.
 	elvea_class_t *next;
+
+	// Thread which created the class. Instances of the class belong to this thread.
+	elvea_thread_t *thread;
 	
 	// Generic methods.
 	elvea_finalize_callback_t finalize;
@@ -58,11 +62,18 @@ struct elvea_class_t
 	elvea_equal_callback_t equal;
 	elvea_hash_callback_t hash;
 	elvea_iterate_callback_t iterate;
+	elvea_size_callback_t size;
+
+	// Allocation statistics for instances of the class (see profiler.h).
+	elvea_alloc_stats_t stats;
 };
 
 
 //----------------------------------------------------------------------------------------------------------------------
 
+// Retain a reference to an object from another thread, or to an object which is no longer biased (see remote.h).
+void elvea_object_retain_shared(elvea_object_t *object);
+
 elvea_class_t *elvea_class_new(elvea_thread_t *thread, const char *name, uint32_t size, uint32_t base_count, elvea_class_t **bases);
 
 
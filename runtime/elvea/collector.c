@@ -0,0 +1,205 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+
+#include <string.h>
+#include <elvea/collector.h>
+#include <elvea/runtime.h>
+#include <elvea/thread.h>
+#include <elvea/third_party/tinycthread/tinycthread.h>
+
+struct elvea_collector_t
+{
+	elvea_runtime_t *runtime;
+
+	// Native thread running the collector.
+	thrd_t native_thread;
+
+	// Protects the fields below. The collector holds the lock while it works, so that threads can't be removed from
+	// under its feet.
+	mtx_t lock;
+	cnd_t wakeup;
+
+	// Registered threads.
+	elvea_thread_t **threads;
+	size_t count, capacity;
+
+	uint64_t slice_ns, period_ns;
+	bool woken;
+	bool stopping;
+};
+
+
+// Run one time slice on a thread if its heap is detached. Returns true if there is more work to do.
+static bool collect_thread(elvea_collector_t *collector, elvea_thread_t *thread)
+{
+	bool more;
+
+	if (! elvea_atomic_cas_int(&thread->heap_state, ELVEA_HEAP_DETACHED, ELVEA_HEAP_COLLECTING)) {
+		return false;
+	}
+	more = elvea_gc_step_detached(thread, collector->slice_ns);
+	elvea_atomic_store_int(&thread->heap_state, ELVEA_HEAP_DETACHED);
+
+	return more;
+}
+
+static int run_collector(void *arg)
+{
+	elvea_collector_t *collector = (elvea_collector_t*) arg;
+
+	mtx_lock(&collector->lock);
+
+	while (! collector->stopping)
+	{
+		bool busy = false;
+
+		for (size_t i = 0; i < collector->count; i++)
+		{
+			if (collect_thread(collector, collector->threads[i])) {
+				busy = true;
+			}
+		}
+
+		if (busy)
+		{
+			// Give the native threads a chance to attach their heap between two slices.
+			mtx_unlock(&collector->lock);
+			thrd_yield();
+			mtx_lock(&collector->lock);
+		}
+		else if (! collector->woken)
+		{
+			struct timespec ts;
+			timespec_get(&ts, TIME_UTC);
+			uint64_t ns = (uint64_t) ts.tv_nsec + collector->period_ns;
+			ts.tv_sec += (time_t) (ns / 1000000000u);
+			ts.tv_nsec = (long) (ns % 1000000000u);
+			cnd_timedwait(&collector->wakeup, &collector->lock, &ts);
+		}
+		collector->woken = false;
+	}
+
+	mtx_unlock(&collector->lock);
+	return 0;
+}
+
+elvea_collector_t *elvea_collector_start(elvea_runtime_t *runtime, uint64_t slice_ns, uint64_t period_ns)
+{
+	elvea_collector_t *collector = (elvea_collector_t*) runtime->alloc(NULL, 0, sizeof(elvea_collector_t));
+
+	if (collector == NULL) {
+		return NULL;
+	}
+	memset(collector, 0, sizeof(elvea_collector_t));
+	collector->runtime = runtime;
+	collector->slice_ns = slice_ns ? slice_ns : ELVEA_COLLECTOR_SLICE_NS;
+	collector->period_ns = period_ns ? period_ns : ELVEA_COLLECTOR_PERIOD_NS;
+
+	if (mtx_init(&collector->lock, mtx_plain) != thrd_success) {
+		goto failure;
+	}
+	if (cnd_init(&collector->wakeup) != thrd_success)
+	{
+		mtx_destroy(&collector->lock);
+		goto failure;
+	}
+	if (thrd_create(&collector->native_thread, run_collector, collector) != thrd_success)
+	{
+		cnd_destroy(&collector->wakeup);
+		mtx_destroy(&collector->lock);
+		goto failure;
+	}
+
+	return collector;
+
+failure:
+	runtime->alloc(collector, sizeof(elvea_collector_t), 0);
+	return NULL;
+}
+
+void elvea_collector_stop(elvea_collector_t *collector)
+{
+	elvea_runtime_t *runtime = collector->runtime;
+
+	mtx_lock(&collector->lock);
+	collector->stopping = true;
+	cnd_signal(&collector->wakeup);
+	mtx_unlock(&collector->lock);
+	thrd_join(collector->native_thread, NULL);
+
+	runtime->alloc(collector->threads, collector->capacity * sizeof(elvea_thread_t*), 0);
+	cnd_destroy(&collector->wakeup);
+	mtx_destroy(&collector->lock);
+	runtime->alloc(collector, sizeof(elvea_collector_t), 0);
+}
+
+void elvea_collector_add(elvea_collector_t *collector, elvea_thread_t *thread)
+{
+	mtx_lock(&collector->lock);
+
+	if (collector->count == collector->capacity)
+	{
+		size_t capacity = collector->capacity ? collector->capacity * 2 : 8;
+		elvea_thread_t **threads = (elvea_thread_t**) collector->runtime->alloc(collector->threads,
+				collector->capacity * sizeof(elvea_thread_t*), capacity * sizeof(elvea_thread_t*));
+
+		if (! elvea_check_memory(thread, threads))
+		{
+			mtx_unlock(&collector->lock);
+			return;
+		}
+		collector->threads = threads;
+		collector->capacity = capacity;
+	}
+	collector->threads[collector->count++] = thread;
+	thread->gc.background = true;
+
+	mtx_unlock(&collector->lock);
+}
+
+void elvea_collector_remove(elvea_collector_t *collector, elvea_thread_t *thread)
+{
+	mtx_lock(&collector->lock);
+
+	for (size_t i = 0; i < collector->count; i++)
+	{
+		if (collector->threads[i] == thread)
+		{
+			collector->threads[i] = collector->threads[--collector->count];
+			thread->gc.background = false;
+			break;
+		}
+	}
+
+	mtx_unlock(&collector->lock);
+}
+
+void elvea_collector_wake(elvea_collector_t *collector)
+{
+	mtx_lock(&collector->lock);
+	collector->woken = true;
+	cnd_signal(&collector->wakeup);
+	mtx_unlock(&collector->lock);
+}
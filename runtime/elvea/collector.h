@@ -0,0 +1,70 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: background cycle collector. A collector thread periodically examines the elvea threads which are           *
+ * registered with it, and runs the cycle collector (see gc.h) on those whose heap is detached, i.e. whose native      *
+ * thread has promised not to touch its objects, typically because it is waiting for I/O. elvea's reference counts and *
+ * containers are not thread-safe, so the collector never examines a heap while its native thread is using it;         *
+ * instead, work is split into short time slices and a thread which wants its heap back only waits for the current     *
+ * slice to end. Each collection is validated by the delta test (no member was touched by the mutator between slices)  *
+ * and the sigma test (all the references to the garbage come from the garbage) before the garbage is handed back to   *
+ * its owner, which finalizes and frees it at its next safe point.                                                     *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_COLLECTOR_H
+#define ELVEA_COLLECTOR_H
+
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct elvea_collector_t elvea_collector_t;
+
+
+// Start a collector thread. The collector holds a thread's heap for at most [slice_ns] nanoseconds at a time, and
+// checks the threads every [period_ns] nanoseconds when it has nothing to do. If either argument is 0, a default value
+// is used. Returns NULL if the thread can't be started.
+elvea_collector_t *elvea_collector_start(elvea_runtime_t *runtime, uint64_t slice_ns, uint64_t period_ns);
+
+// Stop the collector thread and wait for it to finish. All the threads must have been removed, and this must be called
+// before the runtime is finalized.
+void elvea_collector_stop(elvea_collector_t *collector);
+
+// Let the collector collect cycles on behalf of [thread]. Once a thread is registered, it only collects cycles itself
+// if its root buffer grows beyond ELVEA_COLLECTOR_ROOT_BUFFER_SIZE candidates. This and elvea_collector_remove() must
+// be called by the native thread which uses [thread], while its heap is attached.
+void elvea_collector_add(elvea_collector_t *collector, elvea_thread_t *thread);
+
+// Unregister a thread. When this returns, the collector no longer uses the thread. A collection which was started by
+// the collector is completed by the thread itself (e.g. with elvea_gc_step()).
+void elvea_collector_remove(elvea_collector_t *collector, elvea_thread_t *thread);
+
+// Wake the collector up, e.g. after a thread has detached its heap.
+void elvea_collector_wake(elvea_collector_t *collector);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_COLLECTOR_H
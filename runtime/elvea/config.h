@@ -25,12 +25,110 @@
 #ifndef ELVEA_CONFIG_H
 #define ELVEA_CONFIG_H
 
-// Number of slots in a memory page (see arena.h).
+// Number of slots in a memory page (see arena.h). This must be a multiple of 64.
 #define ELVEA_PAGE_SIZE 1024
 
+// If this is not 0, each thread's arena is backed by a virtual memory range of this many bytes instead of getting its
+// pages from the allocator (see elvea_arena_reserve()).
+#ifndef ELVEA_ARENA_RESERVE_SIZE
+#define ELVEA_ARENA_RESERVE_SIZE 0
+#endif
+
+// Request transparent huge pages for arenas backed by virtual memory.
+#ifndef ELVEA_ARENA_HUGE_PAGES
+#define ELVEA_ARENA_HUGE_PAGES 0
+#endif
+
+// Number of candidates in the cycle collector's root buffer. A collection starts when the buffer is full.
+#ifndef ELVEA_GC_ROOT_BUFFER_SIZE
+#define ELVEA_GC_ROOT_BUFFER_SIZE 4096
+#endif
+
+// Number of collections an object must survive to be promoted to the old generation (at most 7, or 0 to disable
+// promotion), and number of minor collections between two major collections, which also examine old objects.
+#ifndef ELVEA_GC_PROMOTION_AGE
+#define ELVEA_GC_PROMOTION_AGE 3
+#endif
+
+#ifndef ELVEA_GC_MAJOR_RATIO
+#define ELVEA_GC_MAJOR_RATIO 8
+#endif
+
+// Number of scratch slots per thread, and number of objects in the zero-count table at which a thread reconciles
+// deferred reference counts at the next safe point (see elvea_gc_scratch_push()).
+#ifndef ELVEA_GC_SCRATCH_SIZE
+#define ELVEA_GC_SCRATCH_SIZE 256
+#endif
+
+#ifndef ELVEA_GC_ZCT_SIZE
+#define ELVEA_GC_ZCT_SIZE 4096
+#endif
+
+// Maximum number of objects which are destroyed at a time when an object graph is released. The remaining objects are
+// destroyed at safe points (see elvea_gc_destroy_pending()).
+#ifndef ELVEA_GC_DESTROY_BATCH
+#define ELVEA_GC_DESTROY_BATCH 1024
+#endif
+
+// Number of candidates at which a thread which is registered with a background collector collects cycles itself.
+#ifndef ELVEA_COLLECTOR_ROOT_BUFFER_SIZE
+#define ELVEA_COLLECTOR_ROOT_BUFFER_SIZE 65536
+#endif
+
+// Default time slice and polling period of the background collector, in nanoseconds (see collector.h).
+#ifndef ELVEA_COLLECTOR_SLICE_NS
+#define ELVEA_COLLECTOR_SLICE_NS 200000
+#endif
+
+#ifndef ELVEA_COLLECTOR_PERIOD_NS
+#define ELVEA_COLLECTOR_PERIOD_NS 1000000
+#endif
+
+// Pack variants into a single 64-bit word instead of a tagged union (see variant.h). This halves the size of variants
+// and of the containers which store them, but requires 64-bit pointers with 48-bit addresses.
+#ifndef ELVEA_NAN_BOXING
+#define ELVEA_NAN_BOXING 0
+#endif
+
+// Algorithm used to hash strings: ELVEA_HASH_FAST or ELVEA_HASH_SIPHASH (see hash.h). SipHash is about 3 times slower,
+// but makes hash tables resistant to flooding with keys chosen to collide.
+#ifndef ELVEA_HASH_ALGORITHM
+#define ELVEA_HASH_ALGORITHM ELVEA_HASH_FAST
+#endif
+
+// Strings which reach this many bytes switch to a rope when they are edited in the middle or concatenated (see rope.h),
+// and maximum number of bytes in a leaf of a rope.
+#ifndef ELVEA_STRING_ROPE_THRESHOLD
+#define ELVEA_STRING_ROPE_THRESHOLD (64 * 1024)
+#endif
+
+#ifndef ELVEA_ROPE_LEAF_SIZE
+#define ELVEA_ROPE_LEAF_SIZE 4096
+#endif
+
 // Maximum number of base classes for a class.
 #define ELVEA_MAX_BASE_COUNT 8
 
 #define ELVEA_ERROR_BUFFER_SIZE 256
 
+// Size of a region chunk, in bytes (see region.h).
+#define ELVEA_REGION_CHUNK_SIZE (64 * 1024)
+
+// Maximum number of region chunks a thread keeps for reuse after a region ends.
+#define ELVEA_REGION_SPARE_COUNT 4
+
+// Use the slab allocator (see utils/slab.h) when no allocator is passed to elvea_initialize().
+#ifndef ELVEA_USE_SLAB_ALLOCATOR
+#define ELVEA_USE_SLAB_ALLOCATOR 0
+#endif
+
+// Compile the allocation profiler's hooks into the allocation routines (see profiler.h). When the hooks are compiled
+// in, they cost a single test of the thread's profiler when profiling is off.
+#ifndef ELVEA_WITH_PROFILER
+#define ELVEA_WITH_PROFILER 1
+#endif
+
+// Maximum number of stack frames recorded for a call site by the allocation profiler.
+#define ELVEA_PROFILER_MAX_DEPTH 32
+
 #endif // ELVEA_CONFIG_H
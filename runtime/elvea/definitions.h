@@ -32,6 +32,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <elvea/utils/atomic.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,9 +45,12 @@ static const bool ELVEA_ARCH32 = (sizeof(void *) == 4);
 
 //----------------------------------------------------------------------------------------------------------------------
 
-// All elvea numbers are represented internally as double precision floating point number.
+// Floating point numbers are represented internally as double precision floating point number.
 typedef double elvea_float_t;
 
+// Integers are represented internally as 64-bit signed integers (see the note about NaN boxing in variant.h).
+typedef int64_t elvea_int_t;
+
 // Type for sizes and and indices. Indices are expressed in base 1 and can be negative.
 typedef intptr_t elvea_index_t;
 
@@ -68,14 +72,16 @@ typedef uint32_t elvea_size_t;
 // Color for the garbage collector. Objects that are acyclic (i.e. contain no cyclic reference)
 // are green. Base types such as string and regex are acyclic because there is no way they
 // can store a reference to themselves. Collections (list, table, etc.) are considered cyclic
-// and are therefore candidates for GC.
+// and are therefore candidates for GC. Colors from grey onwards are only used for objects
+// which are examined by the collection in progress.
 typedef enum elvea_gc_color_t
 {
 	ELVEA_GC_GREEN,      // object which is not collectable
 	ELVEA_GC_BLACK,      // Assumed to be alive
+	ELVEA_GC_PURPLE,     // Root candidate for a GC cycle
 	ELVEA_GC_GREY,       // Possible member of a GC cycle
 	ELVEA_GC_WHITE,      // Possibly dead
-	ELVEA_GC_PURPLE      // Root candidate for a GC cycle
+	ELVEA_GC_ORANGE      // Member of a GC cycle which was found to be alive
 } elvea_gc_color_t;
 
 // Forward declarations.
@@ -126,6 +132,10 @@ typedef uint32_t(*elvea_hash_callback_t)(elvea_thread_t*, elvea_object_t*);
 // collection.
 typedef bool(*elvea_iterate_callback_t)(elvea_thread_t*, elvea_object_t *, elvea_variant_t *state, elvea_variant_t *result);
 
+// Return the number of bytes allocated for an object, excluding the GC header. This only needs to be implemented by
+// classes whose instances are larger than the class's alloc_size.
+typedef size_t(*elvea_size_callback_t)(elvea_thread_t*, const elvea_object_t*);
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -141,19 +151,48 @@ struct elvea_metadata_t
 	// Flag for aliases and variants allocated from the memory arena.
 	bool arena : 1;
 
+	// Flag for objects allocated in a region (see region.h).
+	bool region : 1;
+
+	// Flag for collectable objects which currently don't hold any reference to a collectable object: they can't be
+	// part of a cycle, so the cycle collector treats them as if they were green.
+	bool acyclic : 1;
+
+	// Flag for objects which are in the zero-count table (see elvea_gc_reconcile()).
+	bool deferred : 1;
+
+	// Flag for objects whose owner has released all its references while other threads still hold some: all the
+	// reference count operations, including the owner's, then go through the shared count (see remote.h).
+	bool unbiased : 1;
+
 	// Reserved for future use.
-	uint16_t reserved : 12;
+	uint16_t reserved : 8;
 
 	// Flags for subclasses to do all sorts of naughty things...
 	uint16_t flags;
 };
 
+// Flags and unit of the shared reference count. The count may be negative when other threads have released references
+// the owner gave them: the object is then queued so that the owner merges the count into its own. An unbiased object
+// whose last reference is released by another thread is queued in the same way so that the owner destroys it.
+enum
+{
+	ELVEA_SHARED_MERGED = 1,
+	ELVEA_SHARED_QUEUED = 2,
+	ELVEA_SHARED_UNIT   = 4
+};
+
 // Base class for all non-primitive objects.
 struct elvea_object_t
 {
 	// Object metadata.
 	struct elvea_metadata_t meta;
 
+	// Number of references held by threads other than the owner, multiplied by ELVEA_SHARED_UNIT, with the
+	// ELVEA_SHARED_* flags in the low bits. This is not part of the metadata since aliases are not shared between
+	// threads; it fills the padding before isa on 64-bit platforms.
+	elvea_atomic_int_t shared;
+
 	// Type of the object.
 	elvea_class_t *isa;
 };
@@ -175,9 +214,12 @@ struct elvea_object_t
 #define ELVEA_UNUSED(x) (void)x
 
 
-#define elvea_is_shared(obj) (((struct elvea_metadata_t*)(obj))->ref_count > 1)
+#define elvea_is_shared(obj) (((struct elvea_metadata_t*)(obj))->ref_count > 1 || \
+	elvea_atomic_load_int(&((elvea_object_t*)(obj))->shared) != 0)
 
-#define elvea_assign(thread, dst, src) elvea_object_release(thread, dst); (dst = src); elvea_object_retain(thread, dst)
+#define elvea_assign(thread, dst, src) do { \
+	void *elvea_old_ = (dst); (dst) = (src); elvea_object_retain(thread, dst); elvea_object_release(thread, elvea_old_); \
+} while (0)
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -187,6 +229,16 @@ void *elvea_new(elvea_thread_t *thread, elvea_class_t *type, bool collectable, i
 // Destroy an object.
 void elvea_delete(elvea_thread_t *thread, void *ptr);
 
+// Destroy an object whose last reference was released, from the thread that owns it. While scratch slots are in use,
+// a slot may still refer to the object, so its destruction is deferred (see elvea_gc_scratch_push()).
+void elvea_object_destroy(elvea_thread_t *thread, elvea_object_t *self);
+
+// Change the size of a non-collectable object created with elvea_new(). The object may be moved.
+void *elvea_renew(elvea_thread_t *thread, void *ptr, size_t size);
+
+// Get the number of bytes allocated for an object, excluding the GC header.
+size_t elvea_object_size(elvea_thread_t *thread, const elvea_object_t *self);
+
 // Non-collectable are always colored green and are not tracked by the GC.
 static inline
 bool elvea_is_collectable(const elvea_object_t *self)
@@ -194,11 +246,11 @@ bool elvea_is_collectable(const elvea_object_t *self)
 	return self->meta.gc_color != ELVEA_GC_GREEN;
 }
 
-static inline
-void elvea_object_retain(elvea_thread_t *thread, void *ptr)
-{
-	elvea_ref(ptr);
-}
+// Notify the collector that the reference count of an object it is examining has changed.
+void elvea_gc_barrier(elvea_thread_t *thread, elvea_object_t *object);
+
+// Retain an object.
+void elvea_object_retain(elvea_thread_t *thread, void *ptr);
 
 static inline
 void elvea_alias_retain(elvea_thread_t *thread, void *ptr)
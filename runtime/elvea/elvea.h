@@ -29,8 +29,15 @@
 #include <elvea/thread.h>
 #include <elvea/class.h>
 #include <elvea/string.h>
+#include <elvea/rope.h>
+#include <elvea/strbuf.h>
 #include <elvea/iterator.h>
 #include <elvea/table.h>
+#include <elvea/hash.h>
+#include <elvea/sort.h>
+#include <elvea/profiler.h>
+#include <elvea/collector.h>
+#include <elvea/snapshot.h>
 
 
 #endif // ELVEA_ELVEA_H
@@ -23,11 +23,17 @@
  ***********************************************************************************************************************/
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
 #include <elvea/class.h>
 #include <elvea/gc.h>
 #include <elvea/thread.h>
+#include <elvea/runtime.h>
 #include <elvea/error.h>
+#include <elvea/variant.h>
 #include <elvea/utils/alloc.h>
+#include <elvea/utils/helpers.h>
 
 /*
  * Header for all objects managed by the garbage collector. Managed objects have the following layout in memory:
@@ -54,6 +60,29 @@ struct elvea_gc_object_t
 	// GC chain for collectable objects. The list is doubly-linked so that objects can detach themselves from the chain.
 	struct elvea_gc_object_t *previous, *next;
 
+	// Index of the object in the root buffer (or in the old root buffer if it is old) or, if it is a member of the
+	// collection in progress, in the collector's member list. This is NOT_BUFFERED if the object is in neither.
+	uint32_t root_index : 25;
+
+	// Whether root_index refers to the member list.
+	uint32_t member : 1;
+
+	// Whether the object was a candidate when it became a member: it is put back in the root buffer if the collection
+	// is aborted.
+	uint32_t candidate : 1;
+
+	// Whether the object is a member which was found to be alive because a scratch slot refers to it: it is put back
+	// in the root buffer when the collection completes, since it may be garbage once the slot is released.
+	uint32_t pinned : 1;
+
+	// Whether the object has been promoted to the old generation, and number of collections it has survived (this
+	// saturates at MAX_AGE).
+	uint32_t old : 1;
+	uint32_t age : 3;
+
+	// Reference count minus the references held by other members, computed during a collection.
+	uint32_t gc_count;
+
 	// Access root of the object from the GC header.
 	elvea_object_t object;
 };
@@ -65,22 +94,60 @@ struct elvea_gc_object_t
 // Get the start of a collectable object's header.
 #define GET_GC_OBJECT(ptr) ((struct elvea_gc_object_t*) (((char*)(ptr)) - GC_OBJECT_SIZE))
 
+#define NOT_BUFFERED ((1u << 25) - 1)
+
+#define MAX_AGE 7
+
+// Check the clock after this number of units of work.
+#define CLOCK_INTERVAL 64
+
+#define NO_DEADLINE UINT64_MAX
+
+// Visitor passed as the context of traverse callbacks.
+typedef struct gc_visitor_t
+{
+	void (*visit)(elvea_thread_t *thread, elvea_object_t *object);
+
+	// If this is set, all the variants are passed to it instead (see elvea_gc_for_each_reference()).
+	elvea_reference_callback_t visit_variant;
+	void *context;
+} gc_visitor_t;
+
+
+// Allocate memory for a new object, from the current region if there is one.
+static void *allocate(elvea_thread_t *thread, size_t byte_count)
+{
+	return thread->region ? elvea_region_alloc(thread, byte_count) : elvea_alloc(thread, byte_count);
+}
 
 void *elvea_new(elvea_thread_t *thread, elvea_class_t *type, bool collectable, int extra)
 {
 	elvea_object_t *self;
+	elvea_thread_safe_point(thread);
 
 	if (collectable)
 	{
 		// Allocate object preceded by a header for the GC.
 		size_t byte_count = type->alloc_size + extra + GC_OBJECT_SIZE;
-		struct elvea_gc_object_t *gc_object = (struct elvea_gc_object_t*) elvea_alloc(thread, byte_count);
+		struct elvea_gc_object_t *gc_object = (struct elvea_gc_object_t*) allocate(thread, byte_count);
+
+		if (gc_object == NULL) {
+			return NULL;
+		}
+		gc_object->previous = NULL;
+		gc_object->root_index = NOT_BUFFERED;
+		gc_object->member = 0;
+		gc_object->candidate = 0;
+		gc_object->pinned = 0;
+		gc_object->old = 0;
+		gc_object->age = 0;
 
 		// Attach object to the GC chain.
 		struct elvea_gc_object_t *old_root = thread->gc.root;
 		gc_object->next = old_root;
 		if (old_root) old_root->previous = gc_object;
 		thread->gc.root = gc_object;
+		thread->gc.object_count++;
 
 		// Get pointer to the actual object.
 		self = &gc_object->object;
@@ -88,43 +155,144 @@ void *elvea_new(elvea_thread_t *thread, elvea_class_t *type, bool collectable, i
 	else
 	{
 		size_t byte_count = type->alloc_size + extra;
-		self = (elvea_object_t*) elvea_alloc(thread, byte_count);
+		self = (elvea_object_t*) allocate(thread, byte_count);
+
+		if (self == NULL) {
+			return NULL;
+		}
 	}
 
 	self->isa = type;
 	self->meta.ref_count = 0;
 	self->meta.gc_color = collectable ? ELVEA_GC_BLACK : ELVEA_GC_GREEN;
+	self->meta.arena = false;
+	self->meta.region = (thread->region != NULL);
+	self->meta.acyclic = false;
+	self->meta.deferred = false;
+	self->meta.unbiased = false;
 	self->meta.flags = 0;
+	elvea_atomic_init_int(&self->shared, 0);
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler) elvea_profiler_on_new(thread, type, type->alloc_size + extra);
+#endif
 
 	return self;
 }
 
-void elvea_delete(elvea_thread_t *thread, void *ptr)
+void *elvea_renew(elvea_thread_t *thread, void *ptr, size_t size)
 {
 	elvea_object_t *self = (elvea_object_t*) ptr;
-	elvea_finalize_callback_t finalize = self->isa->finalize;
+	assert(!elvea_is_collectable(self));
+	elvea_class_t *type = self->isa;
+	size_t old_size = elvea_object_size(thread, self);
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler) elvea_profiler_on_delete(thread, type, old_size);
+#endif
 
-	if (elvea_is_collectable(self))
+	if (self->meta.region)
 	{
-		// Get pointer to the object's header.
-		struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(ptr);
-		ptr = gc_object;
+		bool in_region;
+		self = (elvea_object_t*) elvea_region_realloc(thread, ptr, size, &in_region);
 
-		// Detach object from the GC chain.
-		if (gc_object == thread->gc.root)
-		{
-			thread->gc.root = gc_object->next;
+		if (self) {
+			self->meta.region = in_region;
 		}
+	}
+	else
+	{
+		self = (elvea_object_t*) elvea_realloc(thread, ptr, old_size, size);
+	}
 
-		if (gc_object->previous)
-		{
-			gc_object->previous->next = gc_object->next;
-		}
-		if (gc_object->next)
+	// Update the zero-count table if the object was moved. It was most likely deferred recently.
+	if (self && self != ptr && self->meta.deferred)
+	{
+		elvea_gc_stack_t *zct = &thread->gc.zct;
+
+		for (elvea_size_t i = zct->count; i-- > 0; )
 		{
-			gc_object->next->previous = gc_object->previous;
+			if (zct->items[i] == ptr)
+			{
+				zct->items[i] = self;
+				break;
+			}
 		}
 	}
+#if ELVEA_WITH_PROFILER
+	// A resized object is accounted for as a new allocation.
+	if (thread->profiler && self) elvea_profiler_on_new(thread, type, size);
+#endif
+
+	return self;
+}
+
+size_t elvea_object_size(elvea_thread_t *thread, const elvea_object_t *self)
+{
+	elvea_class_t *type = self->isa;
+	return type->size ? type->size(thread, self) : type->alloc_size;
+}
+
+// Detach a collectable object from the GC chain and from the root buffer.
+static void unlink_object(elvea_thread_t *thread, struct elvea_gc_object_t *gc_object)
+{
+	if (gc_object == thread->gc.root)
+	{
+		thread->gc.root = gc_object->next;
+	}
+
+	if (gc_object->previous)
+	{
+		gc_object->previous->next = gc_object->next;
+	}
+	if (gc_object->next)
+	{
+		gc_object->next->previous = gc_object->previous;
+	}
+	thread->gc.object_count--;
+
+	if (gc_object->member)
+	{
+		// The collector's view of the object graph is no longer valid.
+		thread->gc.members.items[gc_object->root_index] = NULL;
+		gc_object->member = 0;
+		elvea_gc_barrier(thread, &gc_object->object);
+	}
+	else if (gc_object->root_index != NOT_BUFFERED)
+	{
+		(gc_object->old ? thread->gc.old_roots.items : thread->gc.roots)[gc_object->root_index] = NULL;
+	}
+	gc_object->root_index = NOT_BUFFERED;
+}
+
+// Free an object's memory. It must have been finalized and unlinked.
+static void free_object(elvea_thread_t *thread, elvea_object_t *self, size_t size)
+{
+	void *ptr = self;
+
+	if (elvea_is_collectable(self))
+	{
+		ptr = GET_GC_OBJECT(self);
+		size += GC_OBJECT_SIZE;
+	}
+	thread->gc.freed_count++;
+	thread->gc.freed_bytes += size;
+
+	// Objects allocated in a region are reclaimed when the region ends.
+	if (self->meta.region) {
+		elvea_region_free(thread, ptr);
+	}
+	else {
+		elvea_free(thread, ptr, size);
+	}
+}
+
+// Finalize and free an object which has been unlinked.
+static void destroy_object(elvea_thread_t *thread, elvea_object_t *self)
+{
+	elvea_finalize_callback_t finalize = self->isa->finalize;
+	size_t size = elvea_object_size(thread, self);
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler) elvea_profiler_on_delete(thread, self->isa, size);
+#endif
 
 	// Release resources managed by the object.
 	if (finalize)
@@ -133,19 +301,291 @@ void elvea_delete(elvea_thread_t *thread, void *ptr)
 	}
 
 	// Now the object can be freed.
-	elvea_free(thread, ptr);
+	free_object(thread, self, size);
 }
 
-void elvea_object_release(elvea_thread_t *thread, void *ptr)
+void elvea_delete(elvea_thread_t *thread, void *ptr)
+{
+	elvea_object_t *self = (elvea_object_t*) ptr;
+
+	if (elvea_is_collectable(self)) {
+		unlink_object(thread, GET_GC_OBJECT(self));
+	}
+	destroy_object(thread, self);
+}
+
+static bool push_object(elvea_thread_t *thread, elvea_gc_stack_t *stack, elvea_object_t *object);
+static bool run_collector(elvea_thread_t *thread, uint64_t deadline, bool handoff);
+
+// Number of candidates at which the thread collects cycles. If a background collector takes care of the thread, we only
+// step in if it can't keep up.
+static elvea_size_t root_limit(elvea_recycler_t *gc)
+{
+	return gc->background ? ELVEA_COLLECTOR_ROOT_BUFFER_SIZE : ELVEA_GC_ROOT_BUFFER_SIZE;
+}
+
+// Record an object whose reference count was decremented to a non-zero value as a potential root of a garbage cycle.
+static void possible_root(elvea_thread_t *thread, elvea_object_t *self)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(self);
+
+	if (self->meta.gc_color != ELVEA_GC_BLACK || self->meta.acyclic) {
+		return;
+	}
+	self->meta.gc_color = ELVEA_GC_PURPLE;
+
+	if (gc_object->root_index != NOT_BUFFERED) {
+		return;
+	}
+
+	// Old candidates are kept separately since they are only examined by major collections.
+	if (gc_object->old)
+	{
+		elvea_gc_stack_t *old_roots = &gc->old_roots;
+
+		if (old_roots->count >= NOT_BUFFERED || ! push_object(thread, old_roots, self)) {
+			return;
+		}
+		gc_object->root_index = (uint32_t) (old_roots->count - 1);
+
+		if (old_roots->count >= root_limit(gc) && gc->phase == ELVEA_GC_IDLE && ! gc->collecting) {
+			run_collector(thread, NO_DEADLINE, false);
+		}
+		return;
+	}
+
+	if (gc->root_count == gc->root_capacity)
+	{
+		// The buffer can only grow beyond its normal size while a collection is in progress, and never beyond what
+		// root_index can address. If we can't record the candidate, a cycle may leak, but the object remains valid.
+		if (gc->root_capacity >= NOT_BUFFERED) {
+			return;
+		}
+		elvea_size_t capacity = ELVEA_MAX(gc->root_capacity * 2, ELVEA_GC_ROOT_BUFFER_SIZE);
+		capacity = ELVEA_MIN(capacity, NOT_BUFFERED);
+		elvea_object_t **roots = (elvea_object_t**) thread->runtime->alloc(gc->roots,
+				gc->root_capacity * sizeof(elvea_object_t*), capacity * sizeof(elvea_object_t*));
+
+		if (roots == NULL) {
+			return;
+		}
+		gc->roots = roots;
+		gc->root_capacity = capacity;
+	}
+
+	gc_object->root_index = (uint32_t) gc->root_count;
+	gc->roots[gc->root_count++] = self;
+
+	// If an incremental collection is in progress, the buffer grows until it is complete.
+	if (gc->root_count >= root_limit(gc) && gc->phase == ELVEA_GC_IDLE && ! gc->collecting) {
+		run_collector(thread, NO_DEADLINE, false);
+	}
+}
+
+static void release_member(elvea_thread_t *thread, elvea_object_t *self);
+static void defer_object(elvea_thread_t *thread, elvea_object_t *self);
+
+// Biased reference counting (see J. Choi, T. Shull and J. Torrellas, "Biased Reference Counting: Minimizing Atomic
+// Operations in Garbage Collection", 2018).
+//
+// The owner of an object counts its references in meta.ref_count without synchronization, and other threads count
+// theirs in the object's shared count with atomic operations. The shared count goes negative when another thread
+// releases a reference which the owner counted: the object is then queued, and the owner merges the shared count into
+// its own at its next safe point. If the owner's count drops to 0 while other threads still hold references, the object is unbiased: the
+// shared count becomes the only count, and the last thread to release a reference hands the object over for
+// destruction.
+
+// Number of references to an object, including those held by other threads.
+static uint32_t total_count(elvea_object_t *self)
+{
+	int shared = elvea_atomic_load_int(&self->shared);
+	uint32_t count = self->meta.ref_count + (uint32_t) ((shared & ~(ELVEA_SHARED_UNIT - 1)) / ELVEA_SHARED_UNIT);
+
+	// An object in the remote queue is kept alive until its owner takes it off the queue.
+	return (shared & ELVEA_SHARED_QUEUED) ? count + 1 : count;
+}
+
+// The owner's count has dropped to 0. Returns true if the object can be destroyed, or false if it was unbiased because
+// other threads still refer to it or because the owner must merge their count first.
+static bool release_bias(elvea_object_t *self)
+{
+	elvea_atomic_int_t *shared = &self->shared;
+	int count = elvea_atomic_load_int(shared);
+
+	while (count != 0)
+	{
+		if (elvea_atomic_cas_int(shared, count, count | ELVEA_SHARED_MERGED))
+		{
+			self->meta.unbiased = true;
+			return false;
+		}
+		count = elvea_atomic_load_int(shared);
+	}
+
+	return true;
+}
+
+void elvea_object_destroy(elvea_thread_t *thread, elvea_object_t *self)
+{
+	// No other thread refers to the object, so it can be biased again.
+	if (self->meta.unbiased)
+	{
+		self->meta.unbiased = false;
+		elvea_atomic_store_int(&self->shared, 0);
+	}
+
+	if (thread->gc.scratch_top > 0 || thread->gc.reconciling)
+	{
+		defer_object(thread, self);
+	}
+	else if (thread->gc.destroying || thread->gc.pending.count > 0)
+	{
+		// The object's finalizer will run from the outermost call, so that releasing a large object graph doesn't
+		// recurse. The object is unlinked right away since the cycle collector must not see it again.
+		if (elvea_is_collectable(self)) {
+			unlink_object(thread, GET_GC_OBJECT(self));
+		}
+		if (! push_object(thread, &thread->gc.pending, self)) {
+			destroy_object(thread, self);
+		}
+		else if (! thread->gc.destroying) {
+			elvea_gc_destroy_pending(thread, ELVEA_GC_DESTROY_BATCH);
+		}
+	}
+	else
+	{
+		thread->gc.destroying = true;
+		elvea_delete(thread, self);
+		thread->gc.destroying = false;
+		if (thread->gc.pending.count > 0) elvea_gc_destroy_pending(thread, ELVEA_GC_DESTROY_BATCH);
+	}
+}
+
+// The owner has released a reference to an object which is still alive.
+static void release_live(elvea_thread_t *thread, elvea_object_t *self)
 {
-	if (elvea_unref(ptr))
+	// Potentially cyclic object.
+	if (elvea_is_collectable(self))
 	{
-		elvea_delete(thread, ptr);
+		if (self->meta.gc_color >= ELVEA_GC_GREY) {
+			release_member(thread, self);
+		}
+		else {
+			possible_root(thread, self);
+		}
 	}
-	else if (elvea_is_collectable(ptr))
+}
+
+void elvea_object_retain_shared(elvea_object_t *object)
+{
+	elvea_atomic_add_int(&object->shared, ELVEA_SHARED_UNIT);
+}
+
+void elvea_object_retain(elvea_thread_t *thread, void *ptr)
+{
+	elvea_object_t *object = (elvea_object_t*) ptr;
+
+	// The owner updates the biased count without synchronization. Other threads must not read the metadata's flags.
+	if (object->isa->thread != thread)
 	{
-		// Potentially cyclic object.
-		((elvea_object_t*)ptr)->meta.gc_color = ELVEA_GC_PURPLE;
+		elvea_object_retain_shared(object);
+		return;
+	}
+	if (object->meta.unbiased) {
+		elvea_object_retain_shared(object);
+	}
+	else {
+		elvea_ref(object);
+	}
+
+	if (object->meta.gc_color >= ELVEA_GC_GREY) {
+		elvea_gc_barrier(thread, object);
+	}
+}
+
+static void release_shared(elvea_thread_t *thread, elvea_object_t *self)
+{
+	elvea_thread_t *owner = self->isa->thread;
+	elvea_atomic_int_t *shared = &self->shared;
+	int count = elvea_atomic_load_int(shared);
+	int desired;
+
+	while (true)
+	{
+		desired = count - ELVEA_SHARED_UNIT;
+
+		// The owner counted the reference: it must merge the counts. If this is the last reference to an unbiased
+		// object that belongs to another thread, the owner must destroy it.
+		if (desired < 0 && ! (desired & ELVEA_SHARED_MERGED)) {
+			desired |= ELVEA_SHARED_QUEUED;
+		}
+		else if (desired == ELVEA_SHARED_MERGED && owner != thread) {
+			desired |= ELVEA_SHARED_QUEUED;
+		}
+		if (elvea_atomic_cas_int(shared, count, desired)) {
+			break;
+		}
+		count = elvea_atomic_load_int(shared);
+	}
+
+	if ((desired & ELVEA_SHARED_QUEUED) && ! (count & ELVEA_SHARED_QUEUED))
+	{
+		elvea_remote_merge(owner, self);
+	}
+	else if (desired == ELVEA_SHARED_MERGED)
+	{
+		// This was the last reference to an unbiased object.
+		elvea_object_destroy(thread, self);
+	}
+	else if (owner == thread)
+	{
+		release_live(thread, self);
+	}
+}
+
+void elvea_object_merge(elvea_thread_t *thread, elvea_object_t *object)
+{
+	elvea_atomic_int_t *shared = &object->shared;
+	int count, desired;
+
+	// Once the object is unbiased, the shared count is the only count: we just take it off the queue.
+	do {
+		count = elvea_atomic_load_int(shared);
+		desired = (count & ELVEA_SHARED_MERGED) ? (count & ~ELVEA_SHARED_QUEUED) : 0;
+	}
+	while (! elvea_atomic_cas_int(shared, count, desired));
+
+	if (count & ELVEA_SHARED_MERGED)
+	{
+		if (desired == ELVEA_SHARED_MERGED) elvea_object_destroy(thread, object);
+		return;
+	}
+
+	object->meta.ref_count += (uint32_t) ((count & ~(ELVEA_SHARED_UNIT - 1)) / ELVEA_SHARED_UNIT);
+
+	if (object->meta.ref_count == 0) {
+		elvea_object_destroy(thread, object);
+	}
+	else {
+		release_live(thread, object);
+	}
+}
+
+void elvea_object_release(elvea_thread_t *thread, void *ptr)
+{
+	elvea_object_t *self = (elvea_object_t*) ptr;
+
+	// Other threads must not read the metadata's flags.
+	if (self->isa->thread != thread || self->meta.unbiased) {
+		release_shared(thread, self);
+	}
+	else if (elvea_unref(self))
+	{
+		if (release_bias(self)) elvea_object_destroy(thread, self);
+	}
+	else {
+		release_live(thread, self);
 	}
 }
 
@@ -153,8 +593,15 @@ void elvea_alias_release(elvea_thread_t *thread, elvea_alias_t *alias)
 {
 	if (elvea_unref(alias))
 	{
+		elvea_thread_t *owner = elvea_arena_alias_owner(alias);
 		elvea_release(thread, &alias->variant);
-		elvea_recycle_alias(thread, alias);
+
+		if (owner == thread) {
+			elvea_recycle_alias(thread, alias);
+		}
+		else {
+			elvea_remote_recycle_alias(owner, alias);
+		}
 	}
 }
 
@@ -164,21 +611,1013 @@ bool elvea_check_memory(elvea_thread_t *thread, void *ptr)
 {
 	if (ptr == NULL)
 	{
-		elvea_throw(thread, ELVEA_ERROR_MEMORY, "memory allocation failed");
+		// Don't report the error twice if the allocator already did.
+		if (! thread->memory.reported) {
+			elvea_throw(thread, ELVEA_ERROR_MEMORY, "memory allocation failed");
+		}
+		thread->memory.reported = false;
 		return false;
 	}
 
 	return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// Cycle collection (see D.F. Bacon and V.T. Rajan, "Concurrent Cycle Collection in Reference Counted Systems", 2001).
+//
+// The collector works on a snapshot of the candidates in the root buffer and on the objects reachable from them,
+// which are called members. Instead of decrementing the reference counts of members in place, it computes a separate
+// count (gc_count) which excludes the references held by other members. This lets a collection be split into small
+// steps which are interleaved with the mutator: members are colored grey, white or orange, and any change to their
+// reference count goes through a barrier which marks the collection as dirty. A dirty collection is aborted before
+// any object is destroyed, and its candidates are put back in the root buffer.
+//
+// All the phases are iterative so that deep object graphs can't overflow the native stack. The work stacks are
+// allocated with the runtime's allocator and are not accounted for in the thread's memory budget, since the collector
+// must be able to run when the thread is close to its limit.
+//----------------------------------------------------------------------------------------------------------------------
+
+
+static bool push_object(elvea_thread_t *thread, elvea_gc_stack_t *stack, elvea_object_t *object)
+{
+	if (stack->count == stack->capacity)
+	{
+		elvea_size_t capacity = ELVEA_MAX(stack->capacity * 2, 64);
+		elvea_object_t **items = (elvea_object_t**) thread->runtime->alloc(stack->items,
+				stack->capacity * sizeof(elvea_object_t*), capacity * sizeof(elvea_object_t*));
+
+		// The collection in progress is aborted, so that no object is destroyed based on an incomplete traversal. No
+		// error is raised: this may run on the collector thread, and the mutator can carry on without the collection.
+		if (items == NULL)
+		{
+			thread->gc.dirty = true;
+			return false;
+		}
+		stack->items = items;
+		stack->capacity = capacity;
+	}
+
+	stack->items[stack->count++] = object;
+	return true;
+}
+
+static void free_stack(elvea_thread_t *thread, elvea_gc_stack_t *stack)
+{
+	thread->runtime->alloc(stack->items, stack->capacity * sizeof(elvea_object_t*), 0);
+	stack->items = NULL;
+	stack->count = stack->capacity = 0;
+}
+
+static void traverse(elvea_thread_t *thread, elvea_object_t *object, void (*visit)(elvea_thread_t*, elvea_object_t*))
+{
+	elvea_traverse_callback_t callback = object->isa->traverse;
+
+	if (callback && ! object->meta.acyclic)
+	{
+		gc_visitor_t visitor;
+		visitor.visit = visit;
+		visitor.visit_variant = NULL;
+		callback(thread, object, &visitor);
+	}
+}
+
+void elvea_gc_visit(elvea_thread_t *thread, elvea_variant_t *variant, void *context)
+{
+	gc_visitor_t *visitor = (gc_visitor_t*) context;
+
+	if (visitor->visit_variant)
+	{
+		visitor->visit_variant(thread, variant, visitor->context);
+		return;
+	}
+
+	// Aliases are not traversed: a collectable object which is referenced by an alias is treated as externally
+	// reachable, which is conservative. Objects owned by another thread are ignored for the same reason.
+	if (elvea_check_object(variant))
+	{
+		elvea_object_t *object = elvea_as_object(variant);
+
+		if (elvea_is_collectable(object) && object->isa->thread == thread) {
+			visitor->visit(thread, object);
+		}
+	}
+}
+
+size_t elvea_gc_header_size()
+{
+	return GC_OBJECT_SIZE;
+}
+
+uint32_t elvea_object_total_count(elvea_object_t *object)
+{
+	return total_count(object);
+}
+
+void elvea_gc_for_each_object(elvea_thread_t *thread, elvea_object_callback_t callback, void *context)
+{
+	for (struct elvea_gc_object_t *gc_object = thread->gc.root; gc_object != NULL; gc_object = gc_object->next) {
+		callback(thread, &gc_object->object, context);
+	}
+}
+
+void elvea_gc_for_each_reference(elvea_thread_t *thread, elvea_object_t *object, elvea_reference_callback_t callback,
+		void *context)
+{
+	elvea_traverse_callback_t traverse = object->isa->traverse;
+
+	if (traverse)
+	{
+		gc_visitor_t visitor;
+		visitor.visit = NULL;
+		visitor.visit_variant = callback;
+		visitor.context = context;
+		traverse(thread, object, &visitor);
+	}
+}
+
+void elvea_gc_barrier(elvea_thread_t *thread, elvea_object_t *object)
+{
+	elvea_recycler_t *gc = &object->isa->thread->gc;
+
+	// Once the collector has found the garbage, the mutator can't interfere with it since it is unreachable.
+	if (gc->phase == ELVEA_GC_MARK || gc->phase == ELVEA_GC_SCAN) {
+		gc->dirty = true;
+	}
+}
+
+static void add_member(elvea_thread_t *thread, elvea_object_t *object)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(object);
+
+	uint32_t index = (uint32_t) gc->members.count;
+
+	if (index >= NOT_BUFFERED)
+	{
+		gc->dirty = true;
+		return;
+	}
+	if (! push_object(thread, &gc->members, object)) {
+		return;
+	}
+	if (gc_object->root_index != NOT_BUFFERED) {
+		(gc_object->old ? gc->old_roots.items : gc->roots)[gc_object->root_index] = NULL;
+	}
+	gc_object->candidate = (object->meta.gc_color == ELVEA_GC_PURPLE);
+	gc_object->gc_count = total_count(object);
+	gc_object->member = 1;
+	gc_object->root_index = index;
+	object->meta.gc_color = ELVEA_GC_GREY;
+}
+
+// Remove an object from the member list and restore its color.
+static void remove_member(elvea_thread_t *thread, elvea_object_t *object, elvea_gc_color_t color)
+{
+	struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(object);
+
+	thread->gc.members.items[gc_object->root_index] = NULL;
+	gc_object->member = 0;
+	gc_object->candidate = 0;
+	gc_object->pinned = 0;
+	gc_object->root_index = NOT_BUFFERED;
+	object->meta.gc_color = color;
+}
+
+// A member has been released by the mutator: it leaves the collection and is buffered as a candidate for the next one.
+static void release_member(elvea_thread_t *thread, elvea_object_t *self)
+{
+	// Garbage which is being destroyed is released by the finalizers of other garbage.
+	if (! GET_GC_OBJECT(self)->member) {
+		return;
+	}
+
+	elvea_gc_barrier(thread, self);
+	remove_member(thread, self, ELVEA_GC_BLACK);
+	possible_root(thread, self);
+}
+
+static void visit_gray(elvea_thread_t *thread, elvea_object_t *child)
+{
+	if (child->meta.gc_color < ELVEA_GC_GREY)
+	{
+		// Acyclic objects are treated like green objects: if they are only reachable from garbage, they are destroyed
+		// when the garbage is finalized. Minor collections treat old objects as if they were externally reachable.
+		if (child->meta.acyclic || (GET_GC_OBJECT(child)->old && ! thread->gc.major)) {
+			return;
+		}
+		add_member(thread, child);
+	}
+
+	// This can only wrap around if the mutator has interfered, in which case the collection will be aborted. (The same
+	// applies if the child couldn't be added.)
+	GET_GC_OBJECT(child)->gc_count--;
+}
+
+static void visit_black(elvea_thread_t *thread, elvea_object_t *child)
+{
+	elvea_gc_color_t color = child->meta.gc_color;
+
+	if (color == ELVEA_GC_GREY || color == ELVEA_GC_WHITE)
+	{
+		child->meta.gc_color = ELVEA_GC_ORANGE;
+		push_object(thread, &thread->gc.black_stack, child);
+	}
+}
+
+// References held by scratch slots are not counted, so the members they refer to are alive. Returns true if any member
+// was found to be alive.
+static bool pin_scratch(elvea_thread_t *thread)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	bool pinned = false;
+
+	for (elvea_size_t i = 0; i < gc->scratch_top; i++)
+	{
+		if (elvea_check_object(&gc->scratch[i]))
+		{
+			elvea_object_t *object = elvea_as_object(&gc->scratch[i]);
+
+			if (object->meta.gc_color == ELVEA_GC_GREY || object->meta.gc_color == ELVEA_GC_WHITE)
+			{
+				object->meta.gc_color = ELVEA_GC_ORANGE;
+				GET_GC_OBJECT(object)->pinned = 1;
+				push_object(thread, &gc->black_stack, object);
+				pinned = true;
+			}
+		}
+	}
+
+	return pinned;
+}
+
+static bool has_candidates(elvea_recycler_t *gc, bool major)
+{
+	return gc->root_count > 0 || (major && gc->old_roots.count > 0);
+}
+
+// Start a new collection. A major collection also examines old objects.
+static void start_collection(elvea_thread_t *thread, bool major)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	gc->major = major;
+	memset(&gc->event, 0, sizeof(elvea_gc_event_t));
+	gc->event.major = major;
+	gc->start_ns = elvea_clock_ns();
+
+	for (elvea_size_t i = 0; i < gc->root_count; i++)
+	{
+		if (gc->roots[i]) {
+			add_member(thread, gc->roots[i]);
+		}
+	}
+	gc->root_count = 0;
+
+	if (major)
+	{
+		elvea_gc_stack_t *old_roots = &gc->old_roots;
+
+		for (elvea_size_t i = 0; i < old_roots->count; i++)
+		{
+			if (old_roots->items[i]) {
+				add_member(thread, old_roots->items[i]);
+			}
+		}
+		old_roots->count = 0;
+		gc->minor_count = 0;
+		gc->major_count++;
+	}
+	else
+	{
+		gc->minor_count++;
+	}
+	gc->event.candidate_count = gc->members.count;
+	gc->candidate_count += gc->members.count;
+	gc->cursor = 0;
+	gc->dirty = false;
+	gc->phase = ELVEA_GC_MARK;
+}
+
+// Record the end of a collection. The callback is invoked once the collector has stopped running.
+static void end_collection(elvea_thread_t *thread, bool aborted)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_gc_event_t *event = &gc->event;
+
+	event->aborted = aborted;
+	event->duration_ns = elvea_clock_ns() - gc->start_ns;
+
+	if (aborted)
+	{
+		gc->abort_count++;
+	}
+	else
+	{
+		gc->collection_count++;
+		gc->collected_count += event->collected_count;
+		gc->collected_bytes += event->collected_bytes;
+	}
+	gc->notify = (gc->callback != NULL);
+	gc->phase = ELVEA_GC_IDLE;
+}
+
+static void abort_collection(elvea_thread_t *thread)
+{
+	// The work stack may contain objects which have been destroyed since they were pushed.
+	thread->gc.black_stack.count = 0;
+	thread->gc.cursor = 0;
+	thread->gc.phase = ELVEA_GC_ABORT;
+}
+
+static void visit_sigma(elvea_thread_t *thread, elvea_object_t *child)
+{
+	if (child->meta.gc_color == ELVEA_GC_WHITE) {
+		GET_GC_OBJECT(child)->gc_count--;
+	}
+}
+
+// Perform one unit of work, which is proportional to the size of a single object. If [handoff] is true, the garbage
+// is handed over to the owner of the heap instead of being destroyed (see elvea_gc_step_detached()).
+static void collect_step(elvea_thread_t *thread, bool handoff)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_gc_stack_t *members = &gc->members;
+	elvea_gc_stack_t *garbage = &gc->garbage;
+
+	switch (gc->phase)
+	{
+		case ELVEA_GC_IDLE:
+			break;
+
+		// Compute the number of references to each member which are held by non-members. Since the member list grows
+		// as we go, this visits all the objects which are reachable from the candidates.
+		case ELVEA_GC_MARK:
+			if (gc->dirty) {
+				abort_collection(thread);
+			}
+			else if (gc->cursor < members->count)
+			{
+				elvea_object_t *object = members->items[gc->cursor++];
+				if (object) traverse(thread, object, visit_gray);
+			}
+			else
+			{
+				gc->event.scanned_count = members->count;
+				gc->scanned_count += members->count;
+				gc->cursor = 0;
+				gc->phase = ELVEA_GC_SCAN;
+			}
+			break;
+
+		// Members which are referenced by non-members are alive, as well as all the members they can reach. Those are
+		// colored orange. The remaining members are colored white: they are garbage.
+		case ELVEA_GC_SCAN:
+			if (gc->dirty) {
+				abort_collection(thread);
+			}
+			else if (gc->black_stack.count > 0)
+			{
+				traverse(thread, gc->black_stack.items[--gc->black_stack.count], visit_black);
+			}
+			else if (gc->cursor < members->count)
+			{
+				elvea_object_t *object = members->items[gc->cursor++];
+
+				if (object && object->meta.gc_color == ELVEA_GC_GREY)
+				{
+					if (GET_GC_OBJECT(object)->gc_count > 0)
+					{
+						object->meta.gc_color = ELVEA_GC_ORANGE;
+						push_object(thread, &gc->black_stack, object);
+					}
+					else
+					{
+						object->meta.gc_color = ELVEA_GC_WHITE;
+					}
+				}
+			}
+			else if (! pin_scratch(thread))
+			{
+				gc->cursor = 0;
+				gc->pass = 0;
+				gc->phase = ELVEA_GC_SIGMA;
+			}
+			break;
+
+		// Sigma test: before anything is destroyed, check that all the references to white members come from other
+		// white members. The first pass copies the reference counts, the second one subtracts internal references
+		// and the last one checks that nothing is left. (The delta test is performed by elvea_gc_barrier().)
+		case ELVEA_GC_SIGMA:
+			if (gc->dirty) {
+				abort_collection(thread);
+			}
+			else if (gc->cursor < members->count)
+			{
+				elvea_object_t *object = members->items[gc->cursor++];
+
+				if (object && object->meta.gc_color == ELVEA_GC_WHITE)
+				{
+					struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(object);
+
+					if (gc->pass == 0) {
+						gc_object->gc_count = total_count(object);
+					}
+					else if (gc->pass == 1) {
+						traverse(thread, object, visit_sigma);
+					}
+					else if (gc_object->gc_count != 0) {
+						gc->dirty = true;
+					}
+				}
+			}
+			else if (gc->pass < 2)
+			{
+				gc->cursor = 0;
+				gc->pass++;
+			}
+			else if (gc->dirty)
+			{
+				abort_collection(thread);
+			}
+			else
+			{
+				gc->cursor = 0;
+				gc->phase = ELVEA_GC_SWEEP;
+			}
+			break;
+
+		// Move the garbage out of the member list. We hold a reference to each garbage object so that finalizers
+		// which release references to other garbage objects don't destroy them.
+		case ELVEA_GC_SWEEP:
+			if (gc->cursor < members->count)
+			{
+				elvea_object_t *object = members->items[gc->cursor++];
+
+				if (object == NULL) {
+					break;
+				}
+				if (object->meta.gc_color == ELVEA_GC_WHITE && push_object(thread, garbage, object))
+				{
+					remove_member(thread, object, ELVEA_GC_WHITE);
+					object->meta.ref_count++;
+					gc->event.collected_count++;
+					gc->event.collected_bytes += elvea_object_size(thread, object) + GC_OBJECT_SIZE;
+				}
+				else if (object->meta.gc_color == ELVEA_GC_WHITE)
+				{
+					// Garbage which couldn't be recorded is left for the next collection.
+					remove_member(thread, object, ELVEA_GC_BLACK);
+					possible_root(thread, object);
+				}
+				else
+				{
+					struct elvea_gc_object_t *gc_object = GET_GC_OBJECT(object);
+					bool pinned = gc_object->pinned;
+					remove_member(thread, object, ELVEA_GC_BLACK);
+
+					// Objects which survive enough collections are promoted.
+					if (gc_object->age < MAX_AGE) gc_object->age++;
+					if (gc->promotion_age > 0 && gc_object->age >= gc->promotion_age) gc_object->old = 1;
+					if (pinned) possible_root(thread, object);
+				}
+			}
+			else if (handoff)
+			{
+				elvea_gc_stack_t *collected = &gc->collected;
+				members->count = 0;
+				gc->cursor = 0;
+
+				// The owner destroys the garbage at its next safe point. (A detached collection doesn't start until it has
+				// reclaimed the previous one, so the list of collected objects is empty.)
+				elvea_gc_stack_t tmp = *collected;
+				*collected = *garbage;
+				*garbage = tmp;
+				end_collection(thread, false);
+			}
+			else
+			{
+				members->count = 0;
+				gc->cursor = 0;
+				gc->phase = ELVEA_GC_FINALIZE;
+			}
+			break;
+
+		// Give the members back to the mutator, and put the candidates back in the root buffer.
+		case ELVEA_GC_ABORT:
+			if (gc->cursor < members->count)
+			{
+				elvea_object_t *object = members->items[gc->cursor++];
+
+				if (object)
+				{
+					bool candidate = GET_GC_OBJECT(object)->candidate;
+					remove_member(thread, object, ELVEA_GC_BLACK);
+					if (candidate) possible_root(thread, object);
+				}
+			}
+			else
+			{
+				members->count = 0;
+				gc->cursor = 0;
+				gc->dirty = false;
+				end_collection(thread, true);
+			}
+			break;
+
+		// Finalize all the garbage before freeing any of it, since finalizers release references to other garbage.
+		case ELVEA_GC_FINALIZE:
+			if (gc->cursor < garbage->count)
+			{
+				elvea_object_t *object = garbage->items[gc->cursor++];
+				elvea_finalize_callback_t finalize = object->isa->finalize;
+
+				if (finalize) {
+					finalize(thread, object);
+				}
+			}
+			else
+			{
+				gc->cursor = 0;
+				gc->phase = ELVEA_GC_FREE;
+			}
+			break;
+
+		case ELVEA_GC_FREE:
+			if (gc->cursor < garbage->count)
+			{
+				elvea_object_t *object = garbage->items[gc->cursor++];
+				size_t size = elvea_object_size(thread, object);
+#if ELVEA_WITH_PROFILER
+				if (thread->profiler) elvea_profiler_on_delete(thread, object->isa, size);
+#endif
+				unlink_object(thread, GET_GC_OBJECT(object));
+				free_object(thread, object, size);
+			}
+			else
+			{
+				garbage->count = 0;
+				gc->cursor = 0;
+				end_collection(thread, false);
+			}
+			break;
+	}
+}
+
+static void record_pause(elvea_recycler_t *gc, uint64_t duration_ns)
+{
+	uint64_t us = duration_ns / 1000;
+	unsigned int bucket = 0;
+
+	while (us > 0 && bucket < ELVEA_GC_PAUSE_BUCKETS - 1)
+	{
+		us >>= 1;
+		bucket++;
+	}
+	gc->pauses[bucket]++;
+	gc->pause_count++;
+	gc->pause_ns += duration_ns;
+	gc->max_pause_ns = ELVEA_MAX(gc->max_pause_ns, duration_ns);
+}
+
+// Run the collector until the current collection is complete, or until the deadline has passed. If no collection is
+// in progress, a new one is started. Returns true if the collection is not complete.
+static bool run_collector(elvea_thread_t *thread, uint64_t deadline, bool handoff)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	unsigned int work = 0;
+
+	if (gc->collecting) {
+		return gc->phase != ELVEA_GC_IDLE;
+	}
+	gc->collecting = true;
+	uint64_t start = elvea_clock_ns();
+
+	if (gc->phase == ELVEA_GC_IDLE)
+	{
+		// Objects released by other threads are reclaimed first, so that the collection sees their final counts. The
+		// background collector can't do this: it doesn't run on the thread that owns them.
+		if (! handoff) {
+			elvea_remote_drain(thread);
+		}
+
+		// Every major_ratio minor collections, or when too many old candidates are buffered, the next collection is
+		// a major collection.
+		bool major = (gc->minor_count >= gc->major_ratio || gc->old_roots.count >= root_limit(gc));
+
+		if (has_candidates(gc, major)) {
+			start_collection(thread, major);
+		}
+	}
+
+	while (gc->phase != ELVEA_GC_IDLE)
+	{
+		if (++work % CLOCK_INTERVAL == 0 && deadline != NO_DEADLINE && elvea_clock_ns() >= deadline) {
+			break;
+		}
+		collect_step(thread, handoff);
+	}
+	gc->collecting = false;
+
+	if (work > 0 && ! handoff) {
+		record_pause(gc, elvea_clock_ns() - start);
+	}
+	if (gc->notify)
+	{
+		gc->notify = false;
+		gc->callback(thread, &gc->event, gc->callback_context);
+	}
+
+	return gc->phase != ELVEA_GC_IDLE;
+}
+
+static uint64_t get_deadline(uint64_t budget_ns)
+{
+	uint64_t deadline = elvea_clock_ns() + budget_ns;
+	return deadline < budget_ns ? NO_DEADLINE : deadline;
+}
+
+elvea_size_t elvea_gc_collect_cycles(elvea_thread_t *thread)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_size_t collected = gc->collected_count;
+	elvea_gc_reclaim(thread);
+
+	// Complete the collection in progress, if any: it doesn't include the candidates which were buffered since it
+	// started, so we need a new one, which examines all the candidates.
+	if (gc->phase != ELVEA_GC_IDLE) {
+		run_collector(thread, NO_DEADLINE, false);
+	}
+	if (gc->phase == ELVEA_GC_IDLE && ! gc->collecting && has_candidates(gc, true)) {
+		start_collection(thread, true);
+	}
+	run_collector(thread, NO_DEADLINE, false);
+
+	return gc->collected_count - collected;
+}
+
+bool elvea_gc_step(elvea_thread_t *thread, uint64_t budget_ns)
+{
+	elvea_gc_reclaim(thread);
+	return run_collector(thread, get_deadline(budget_ns), false);
+}
+
+bool elvea_gc_step_detached(elvea_thread_t *thread, uint64_t budget_ns)
+{
+	elvea_recycler_t *gc = &thread->gc;
+
+	// The owner hasn't finished the previous collection, or it must still reclaim the garbage.
+	if (gc->phase >= ELVEA_GC_FINALIZE || gc->collected.count > 0) {
+		return false;
+	}
+
+	return run_collector(thread, get_deadline(budget_ns), true);
+}
+
+void elvea_gc_set_generations(elvea_thread_t *thread, unsigned int promotion_age, unsigned int major_ratio)
+{
+	thread->gc.promotion_age = ELVEA_MIN(promotion_age, MAX_AGE);
+	thread->gc.major_ratio = major_ratio;
+	thread->gc.minor_count = 0;
+}
+
+void elvea_gc_reclaim(elvea_thread_t *thread)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_gc_stack_t garbage = gc->collected;
+	elvea_size_t i;
+
+	if (garbage.count == 0) {
+		return;
+	}
+
+	// Finalizers may start a collection which hands over more garbage, so we take the garbage out of the recycler.
+	memset(&gc->collected, 0, sizeof(elvea_gc_stack_t));
+	uint64_t start = elvea_clock_ns();
+
+	for (i = 0; i < garbage.count; i++)
+	{
+		elvea_object_t *object = garbage.items[i];
+		elvea_finalize_callback_t finalize = object->isa->finalize;
+
+		if (finalize) {
+			finalize(thread, object);
+		}
+	}
+	for (i = 0; i < garbage.count; i++)
+	{
+		elvea_object_t *object = garbage.items[i];
+		size_t size = elvea_object_size(thread, object);
+#if ELVEA_WITH_PROFILER
+		if (thread->profiler) elvea_profiler_on_delete(thread, object->isa, size);
+#endif
+		unlink_object(thread, GET_GC_OBJECT(object));
+		free_object(thread, object, size);
+	}
+	record_pause(gc, elvea_clock_ns() - start);
+
+	// Keep the buffer for the next collection.
+	if (gc->collected.items == NULL)
+	{
+		garbage.count = 0;
+		gc->collected = garbage;
+	}
+	else
+	{
+		free_stack(thread, &garbage);
+	}
+}
+
+bool elvea_gc_destroy_pending(elvea_thread_t *thread, elvea_size_t limit)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_gc_stack_t *pending = &gc->pending;
+
+	// Objects released by finalizers are queued, and destroyed by this loop rather than by a nested call.
+	if (! gc->destroying)
+	{
+		gc->destroying = true;
+
+		for (elvea_size_t i = 0; pending->count > 0 && (limit == 0 || i < limit); i++) {
+			destroy_object(thread, pending->items[--pending->count]);
+		}
+		gc->destroying = false;
+	}
+
+	return pending->count > 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Deferred reference counting (see L.P. Deutsch and D.G. Bobrow, "An Efficient, Incremental, Automatic Garbage
+// Collector", 1976).
+//
+// Scratch slots hold temporaries whose references are not counted. While they are in use, an object whose reference
+// count drops to 0 may still be referred to by a scratch slot, so it is put in the zero-count table (ZCT) instead of
+// being destroyed. The table holds a counted reference to each of its objects, which keeps them valid for the cycle
+// collector and for other threads, and an object enters it at most once between two reconciliations, however many
+// times its count drops to 0 in the meantime. Reconciliation counts the references held by scratch slots and releases
+// the table's references: objects which are still unreferenced are destroyed.
+//----------------------------------------------------------------------------------------------------------------------
+
+static void defer_object(elvea_thread_t *thread, elvea_object_t *self)
+{
+	elvea_recycler_t *gc = &thread->gc;
+
+	// If we can't record the object, it leaks, since a scratch slot may still refer to it.
+	if (! push_object(thread, &gc->zct, self)) {
+		return;
+	}
+	elvea_ref(self);
+	self->meta.deferred = true;
+	gc->deferred_count++;
+
+	// The collection in progress may have seen the reference that was released.
+	if (self->meta.gc_color >= ELVEA_GC_GREY) {
+		elvea_gc_barrier(thread, self);
+	}
+}
+
+elvea_variant_t *elvea_gc_scratch_push(elvea_thread_t *thread, elvea_size_t count)
+{
+	elvea_recycler_t *gc = &thread->gc;
+
+	if (gc->scratch == NULL)
+	{
+		gc->scratch = (elvea_variant_t*) thread->runtime->alloc(NULL, 0, ELVEA_GC_SCRATCH_SIZE * sizeof(elvea_variant_t));
+
+		if (! elvea_check_memory(thread, gc->scratch)) {
+			return NULL;
+		}
+	}
+	if (count > ELVEA_GC_SCRATCH_SIZE - gc->scratch_top)
+	{
+		elvea_throw(thread, ELVEA_ERROR_MEMORY, "too many scratch slots");
+		return NULL;
+	}
+
+	elvea_variant_t *slots = gc->scratch + gc->scratch_top;
+
+	for (elvea_size_t i = 0; i < count; i++) {
+		elvea_zero(&slots[i]);
+	}
+	gc->scratch_top += count;
+
+	return slots;
+}
+
+void elvea_gc_scratch_pop(elvea_thread_t *thread, elvea_size_t count)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	assert(count <= gc->scratch_top);
+	gc->scratch_top -= count;
+
+	if (gc->scratch_top == 0) {
+		elvea_gc_reconcile(thread);
+	}
+}
+
+void elvea_gc_scratch_set(elvea_thread_t *thread, elvea_variant_t *slot, const elvea_variant_t *value)
+{
+	elvea_variant_t *resolved = (elvea_variant_t*) value;
+	elvea_resolve_alias(thread, &resolved);
+	*slot = *resolved;
+
+	if (elvea_check_object(slot))
+	{
+		elvea_object_t *object = elvea_as_object(slot);
+		assert(object->isa->thread == thread);
+
+		if (object->meta.ref_count == 0 && ! object->meta.unbiased) {
+			defer_object(thread, object);
+		}
+	}
+}
+
+void elvea_gc_reconcile(elvea_thread_t *thread)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	elvea_gc_stack_t *zct = &gc->zct;
+
+	if (zct->count == 0 || gc->reconciling) {
+		return;
+	}
+	gc->reconciling = true;
+	gc->reconcile_count++;
+
+	// Count the references held by scratch slots for the duration of the reconciliation.
+	for (elvea_size_t i = 0; i < gc->scratch_top; i++)
+	{
+		if (elvea_check_object(&gc->scratch[i])) {
+			elvea_ref(elvea_as_object(&gc->scratch[i]));
+		}
+	}
+
+	// Objects released by finalizers are deferred as well, so long chains of objects are destroyed iteratively.
+	while (zct->count > 0)
+	{
+		elvea_object_t *object = zct->items[--zct->count];
+		object->meta.deferred = false;
+
+		if (! elvea_unref(object)) {
+			release_live(thread, object);
+		}
+		else if (release_bias(object)) {
+			elvea_delete(thread, object);
+		}
+	}
+	gc->reconciling = false;
+
+	// Objects which are only referred to by scratch slots go back to the table.
+	for (elvea_size_t i = 0; i < gc->scratch_top; i++)
+	{
+		if (elvea_check_object(&gc->scratch[i]))
+		{
+			elvea_object_t *object = elvea_as_object(&gc->scratch[i]);
+			if (elvea_unref(object) && release_bias(object)) defer_object(thread, object);
+		}
+	}
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 void elvea_gc_initialize(elvea_recycler_t *gc)
 {
-	// TODO : init GC
+	elvea_arena_initialize(&gc->arena);
+	gc->root = NULL;
+	gc->roots = NULL;
+	gc->root_count = gc->root_capacity = 0;
+	memset(&gc->members, 0, sizeof(elvea_gc_stack_t));
+	memset(&gc->black_stack, 0, sizeof(elvea_gc_stack_t));
+	memset(&gc->garbage, 0, sizeof(elvea_gc_stack_t));
+	memset(&gc->collected, 0, sizeof(elvea_gc_stack_t));
+	memset(&gc->old_roots, 0, sizeof(elvea_gc_stack_t));
+	gc->promotion_age = ELVEA_GC_PROMOTION_AGE;
+	gc->major_ratio = ELVEA_GC_MAJOR_RATIO;
+	gc->minor_count = 0;
+	gc->major_count = 0;
+	gc->major = false;
+	gc->phase = ELVEA_GC_IDLE;
+	gc->cursor = 0;
+	gc->pass = 0;
+	gc->dirty = false;
+	gc->collecting = false;
+	gc->background = false;
+	memset(&gc->pending, 0, sizeof(elvea_gc_stack_t));
+	gc->destroying = false;
+	memset(&gc->zct, 0, sizeof(elvea_gc_stack_t));
+	gc->scratch = NULL;
+	gc->scratch_top = 0;
+	gc->reconciling = false;
+	gc->deferred_count = 0;
+	gc->reconcile_count = 0;
+	gc->collection_count = 0;
+	gc->collected_count = 0;
+	gc->abort_count = 0;
+	gc->object_count = 0;
+	gc->candidate_count = gc->scanned_count = 0;
+	gc->collected_bytes = 0;
+	gc->freed_count = gc->freed_bytes = 0;
+	gc->pause_count = gc->pause_ns = gc->max_pause_ns = 0;
+	memset(gc->pauses, 0, sizeof gc->pauses);
+	memset(&gc->event, 0, sizeof(elvea_gc_event_t));
+	gc->start_ns = 0;
+	gc->notify = false;
+	gc->callback = NULL;
+	gc->callback_context = NULL;
+}
+
+void elvea_gc_finalize(elvea_thread_t *thread, elvea_recycler_t *gc)
+{
+	thread->runtime->alloc(gc->roots, gc->root_capacity * sizeof(elvea_object_t*), 0);
+	gc->roots = NULL;
+	gc->root_count = gc->root_capacity = 0;
+	free_stack(thread, &gc->members);
+	free_stack(thread, &gc->black_stack);
+	free_stack(thread, &gc->garbage);
+	free_stack(thread, &gc->collected);
+	free_stack(thread, &gc->old_roots);
+	free_stack(thread, &gc->pending);
+	free_stack(thread, &gc->zct);
+	thread->runtime->alloc(gc->scratch, gc->scratch ? ELVEA_GC_SCRATCH_SIZE * sizeof(elvea_variant_t) : 0, 0);
+	gc->scratch = NULL;
+	elvea_arena_finalize(thread, &gc->arena);
+}
+
+void elvea_gc_get_stats(elvea_thread_t *thread, elvea_gc_stats_t *stats)
+{
+	elvea_recycler_t *gc = &thread->gc;
+
+	stats->collection_count = gc->collection_count;
+	stats->major_count = gc->major_count;
+	stats->abort_count = gc->abort_count;
+	stats->candidate_count = gc->candidate_count;
+	stats->scanned_count = gc->scanned_count;
+	stats->collected_count = gc->collected_count;
+	stats->collected_bytes = gc->collected_bytes;
+	stats->freed_count = gc->freed_count;
+	stats->freed_bytes = gc->freed_bytes;
+	stats->deferred_count = gc->deferred_count;
+	stats->reconcile_count = gc->reconcile_count;
+	stats->pause_count = gc->pause_count;
+	stats->pause_ns = gc->pause_ns;
+	stats->max_pause_ns = gc->max_pause_ns;
+	memcpy(stats->pauses, gc->pauses, sizeof gc->pauses);
+	stats->object_count = gc->object_count;
+	stats->root_count = gc->root_count + gc->old_roots.count;
+	stats->pending_count = gc->pending.count;
+	stats->page_count = gc->arena.page_count;
+	stats->empty_page_count = gc->arena.empty_count;
+	stats->memory_used = elvea_memory_used(thread);
 }
 
-void elvea_gc_finalize(elvea_recycler_t *gc)
+void elvea_gc_dump_stats(elvea_thread_t *thread, FILE *file)
 {
+	elvea_gc_stats_t stats;
+	elvea_gc_get_stats(thread, &stats);
 
-}
\ No newline at end of file
+	fprintf(file, "collections: %" PRIu64 " (%" PRIu64 " major, %" PRIu64 " aborted)\n", stats.collection_count,
+			stats.major_count, stats.abort_count);
+	fprintf(file, "candidates:  %" PRIu64 " (%" PRIu64 " objects scanned)\n", stats.candidate_count,
+			stats.scanned_count);
+	fprintf(file, "collected:   %" PRIu64 " objects, %" PRIu64 " bytes\n", stats.collected_count,
+			stats.collected_bytes);
+	fprintf(file, "freed:       %" PRIu64 " objects, %" PRIu64 " bytes\n", stats.freed_count, stats.freed_bytes);
+	fprintf(file, "deferred:    %" PRIu64 " objects (%" PRIu64 " reconciliations)\n", stats.deferred_count,
+			stats.reconcile_count);
+	fprintf(file, "objects:     %" PRIu64 " collectable, %" PRIu64 " candidates, %" PRIu64 " pending\n",
+			stats.object_count, stats.root_count, stats.pending_count);
+	fprintf(file, "arena pages: %" PRIu64 " (%" PRIu64 " empty)\n", stats.page_count, stats.empty_page_count);
+	fprintf(file, "memory used: %" PRIu64 " bytes\n", stats.memory_used);
+	fprintf(file, "pauses:      %" PRIu64 " (total %" PRIu64 " ns, max %" PRIu64 " ns)\n", stats.pause_count,
+			stats.pause_ns, stats.max_pause_ns);
+
+	// Histogram of pause durations, in microseconds.
+	for (int i = 0; i < ELVEA_GC_PAUSE_BUCKETS; i++)
+	{
+		uint64_t low = (i == 0) ? 0 : (uint64_t) 1 << (i - 1);
+
+		if (stats.pauses[i] == 0) {
+			continue;
+		}
+		if (i == ELVEA_GC_PAUSE_BUCKETS - 1) {
+			fprintf(file, "  >= %" PRIu64 " us: %" PRIu64 "\n", low, stats.pauses[i]);
+		}
+		else {
+			fprintf(file, "  %" PRIu64 "-%" PRIu64 " us: %" PRIu64 "\n", low, (uint64_t) 1 << i, stats.pauses[i]);
+		}
+	}
+}
+
+void elvea_gc_set_callback(elvea_thread_t *thread, elvea_gc_callback_t callback, void *context)
+{
+	thread->gc.callback = callback;
+	thread->gc.callback_context = context;
+}
+
+void elvea_gc_collect(elvea_thread_t *thread)
+{
+	elvea_remote_drain(thread);
+	elvea_gc_destroy_pending(thread, 0);
+
+	elvea_gc_collect_cycles(thread);
+	elvea_arena_compact(thread, &thread->gc.arena);
+	elvea_region_trim(thread);
+}
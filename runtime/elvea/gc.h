@@ -26,12 +26,24 @@
  * objects become candidates as soon as there is more that one reference pointing to them, since they might contain    *
  * a cycle; however, if the object's reference count reaches 0, the object is detached from the GC chain and it is     *
  * destroyed.                                                                                                          *
+ * Candidates are recorded in a bounded root buffer, and a collection starts when the buffer is full. Since this can   *
+ * happen whenever a reference is released, a holder must stop referring to a value before it releases it.             *
+ * Collections can also be run incrementally with elvea_gc_step(), in which case a barrier in retain/release aborts    *
+ * a collection whose objects are modified by the mutator before it has identified the garbage.                        *
+ * References held in scratch slots are not counted. While scratch slots are in use, objects whose reference count     *
+ * drops to 0 are put in a zero-count table instead of being destroyed, and are reclaimed when the thread reconciles   *
+ * reference counts, provided that no scratch slot refers to them.                                                     *
+ * Objects released by a finalizer are queued and destroyed iteratively, in bounded batches, so that releasing a       *
+ * large object graph neither overflows the native stack nor causes a long pause.                                      *
+ * The collector keeps cheap counters (collections, objects scanned and reclaimed, pause histogram...) which can be    *
+ * queried at any time with elvea_gc_get_stats(), and it can report each collection to a callback.                     *
  *                                                                                                                     *
  ***********************************************************************************************************************/
 
 #ifndef ELVEA_RECYCLER_H
 #define ELVEA_RECYCLER_H
 
+#include <stdio.h>
 #include <elvea/definitions.h>
 #include <elvea/arena.h>
 
@@ -41,6 +53,100 @@ extern "C" {
 
 struct elvea_gc_object_t;
 
+// Phases of a collection. See gc.c for details.
+typedef enum elvea_gc_phase_t
+{
+	ELVEA_GC_IDLE,
+	ELVEA_GC_MARK,
+	ELVEA_GC_SCAN,
+	ELVEA_GC_SIGMA,
+	ELVEA_GC_SWEEP,
+	ELVEA_GC_ABORT,
+	ELVEA_GC_FINALIZE,
+	ELVEA_GC_FREE
+} elvea_gc_phase_t;
+
+// Stack of objects used by the collector.
+typedef struct elvea_gc_stack_t
+{
+	elvea_object_t **items;
+	elvea_size_t count, capacity;
+} elvea_gc_stack_t;
+
+// Number of buckets in the pause histogram. Bucket 0 counts pauses shorter than 1 µs, bucket i counts pauses in
+// [2^(i-1), 2^i) µs, and the last bucket counts all the longer pauses.
+#define ELVEA_GC_PAUSE_BUCKETS 24
+
+// Report passed to the collection callback when a collection completes or is aborted.
+typedef struct elvea_gc_event_t
+{
+	// Whether the collection was major, and whether it was aborted because the mutator interfered.
+	bool major;
+	bool aborted;
+
+	// Number of candidates the collection started from, and number of objects it examined (candidates included).
+	elvea_size_t candidate_count;
+	elvea_size_t scanned_count;
+
+	// Number of garbage objects found, and their size in bytes (GC headers included).
+	elvea_size_t collected_count;
+	size_t collected_bytes;
+
+	// Time elapsed since the collection started, which includes the time spent by the mutator between the steps of
+	// an incremental collection.
+	uint64_t duration_ns;
+} elvea_gc_event_t;
+
+// Callback invoked at the end of each collection. It is called by the native thread which ran the collection, which
+// is the background collector's thread for detached collections (see collector.h), so it must not use any object owned
+// by [thread].
+typedef void (*elvea_gc_callback_t)(elvea_thread_t *thread, const elvea_gc_event_t *event, void *context);
+
+// Collector and memory statistics for a thread. Counters are cumulative since the thread was created.
+typedef struct elvea_gc_stats_t
+{
+	// Number of complete collections, how many of them were major, and number of aborted collections.
+	uint64_t collection_count;
+	uint64_t major_count;
+	uint64_t abort_count;
+
+	// Number of candidates examined by collections, and number of objects scanned (candidates included).
+	uint64_t candidate_count;
+	uint64_t scanned_count;
+
+	// Number of objects and bytes reclaimed by the cycle collector.
+	uint64_t collected_count;
+	uint64_t collected_bytes;
+
+	// Number of objects and bytes freed, whether their reference count dropped to 0 or they were part of a cycle. This
+	// only counts the objects' own blocks, not buffers such as table buckets or rope nodes.
+	uint64_t freed_count;
+	uint64_t freed_bytes;
+
+	// Number of objects put in the zero-count table, and number of reconciliations.
+	uint64_t deferred_count;
+	uint64_t reconcile_count;
+
+	// Pauses caused by the cycle collector on the thread: number of pauses, total and longest duration, and histogram
+	// of durations (see ELVEA_GC_PAUSE_BUCKETS). Work done by the background collector is not a pause.
+	uint64_t pause_count;
+	uint64_t pause_ns;
+	uint64_t max_pause_ns;
+	uint64_t pauses[ELVEA_GC_PAUSE_BUCKETS];
+
+	// Current number of collectable objects (i.e. the length of the GC chain), of buffered candidates, and of objects
+	// waiting to be destroyed.
+	uint64_t object_count;
+	uint64_t root_count;
+	uint64_t pending_count;
+
+	// Current number of pages in the thread's arena, and number of empty pages.
+	uint64_t page_count;
+	uint64_t empty_page_count;
+
+	// Number of bytes currently allocated by the thread.
+	uint64_t memory_used;
+} elvea_gc_stats_t;
 
 struct elvea_recycler_t
 {
@@ -50,6 +156,95 @@ struct elvea_recycler_t
 	// Root of the GC chain. This is a doubly-linked list so that objects can detach themselves from the list
 	// when their reference count reaches 0. This is fine as long as the runtime is kept in a single thread.
 	struct elvea_gc_object_t *root;
+
+	// Buffer of purple objects, which may be the root of a garbage cycle. Entries are set to NULL when an object is
+	// destroyed before the next collection.
+	elvea_object_t **roots;
+	elvea_size_t root_count, root_capacity;
+
+	// Candidates which belong to the old generation. They are only examined by major collections.
+	elvea_gc_stack_t old_roots;
+
+	// Number of collections an object must survive to be promoted to the old generation (0 disables promotion), and
+	// number of minor collections between two major collections.
+	unsigned int promotion_age;
+	unsigned int major_ratio;
+
+	// Number of minor collections since the last major collection, and whether the collection in progress is major.
+	unsigned int minor_count;
+	bool major;
+
+	// Objects examined by the collection in progress, objects found to be alive which must be scanned, and garbage.
+	elvea_gc_stack_t members, black_stack, garbage;
+
+	// Garbage found by the background collector, which the owner must destroy (see elvea_gc_reclaim()).
+	elvea_gc_stack_t collected;
+
+	// Current phase, position of the collector in the member list or in the garbage, and pass number within a phase.
+	elvea_gc_phase_t phase;
+	elvea_size_t cursor;
+	unsigned int pass;
+
+	// Whether the mutator has changed the reference count of a member since the collection started.
+	bool dirty;
+
+	// Whether the collector is running. (Finalizers may release objects while it is.)
+	bool collecting;
+
+	// Whether the thread is registered with a background collector.
+	bool background;
+
+	// Objects whose reference count dropped to 0 while another object was being destroyed. They are unlinked, and are
+	// waiting to be finalized and freed.
+	elvea_gc_stack_t pending;
+
+	// Whether an object is being destroyed.
+	bool destroying;
+
+	// Objects whose reference count dropped to 0 while deferral was active. The table holds one reference to each.
+	elvea_gc_stack_t zct;
+
+	// Scratch slots, whose references are not counted, and number of slots in use.
+	elvea_variant_t *scratch;
+	elvea_size_t scratch_top;
+
+	// Whether reference counts are being reconciled.
+	bool reconciling;
+
+	// Number of objects which were put in the zero-count table, and number of reconciliations.
+	elvea_size_t deferred_count;
+	elvea_size_t reconcile_count;
+
+	// Number of complete and aborted collections so far, and number of objects reclaimed.
+	elvea_size_t collection_count;
+	elvea_size_t major_count;
+	elvea_size_t abort_count;
+	elvea_size_t collected_count;
+
+	// Number of collectable objects in the GC chain.
+	elvea_size_t object_count;
+
+	// Counters reported by elvea_gc_get_stats().
+	uint64_t candidate_count;
+	uint64_t scanned_count;
+	uint64_t collected_bytes;
+	uint64_t freed_count;
+	uint64_t freed_bytes;
+	uint64_t pause_count;
+	uint64_t pause_ns;
+	uint64_t max_pause_ns;
+	uint64_t pauses[ELVEA_GC_PAUSE_BUCKETS];
+
+	// Report on the collection in progress, and time at which it started.
+	elvea_gc_event_t event;
+	uint64_t start_ns;
+
+	// Whether a collection has ended and the callback hasn't been invoked yet.
+	bool notify;
+
+	// Collection callback, if any.
+	elvea_gc_callback_t callback;
+	void *callback_context;
 };
 
 
@@ -57,7 +252,92 @@ struct elvea_recycler_t
 
 void elvea_gc_initialize(elvea_recycler_t *gc);
 
-void elvea_gc_finalize(elvea_recycler_t *gc);
+void elvea_gc_finalize(elvea_thread_t *thread, elvea_recycler_t *gc);
+
+// Find and destroy garbage cycles among the candidates in the root buffer. Returns the number of objects destroyed.
+elvea_size_t elvea_gc_collect_cycles(elvea_thread_t *thread);
+
+// Run the cycle collector incrementally for about [budget_ns] nanoseconds, starting a new collection if none is in
+// progress and there are candidates in the root buffer. Returns true if the collection is not complete. This is meant
+// to be called when the thread is idle: the mutator may run between steps, and a collection is aborted (and restarted
+// later) if the mutator retains or releases an object the collection is examining.
+bool elvea_gc_step(elvea_thread_t *thread, uint64_t budget_ns);
+
+// Same as elvea_gc_step(), but the garbage is not destroyed: it is handed over to the thread, which destroys it when it
+// calls elvea_gc_reclaim(). This is used by the background collector (see collector.h), and must only be called while
+// the thread's heap is not in use by its native thread.
+bool elvea_gc_step_detached(elvea_thread_t *thread, uint64_t budget_ns);
+
+// Configure generational collection: objects which survive [promotion_age] collections (at most 7, or 0 to disable
+// promotion) are promoted to the old generation, which is only examined by one collection out of [major_ratio] + 1.
+// elvea_gc_collect_cycles() always performs a major collection.
+void elvea_gc_set_generations(elvea_thread_t *thread, unsigned int promotion_age, unsigned int major_ratio);
+
+// Destroy the garbage which was handed over by the background collector. This is done at safe points.
+void elvea_gc_reclaim(elvea_thread_t *thread);
+
+// Destroy up to [limit] objects which are waiting to be destroyed, or all of them if [limit] is 0. Returns true if some
+// objects are still waiting. When an object is destroyed, the objects it releases are queued instead of being destroyed
+// by its finalizer, so that releasing a large object graph neither recurses nor pauses the thread for long: at most
+// ELVEA_GC_DESTROY_BATCH objects are destroyed at a time, and the rest are destroyed in batches at safe points.
+bool elvea_gc_destroy_pending(elvea_thread_t *thread, elvea_size_t limit);
+
+// Reserve [count] scratch slots, which are initialized to null, and return the first one. Scratch slots hold borrowed
+// references: storing a value with elvea_gc_scratch_set() doesn't change any reference count, and the slots are simply
+// dropped by elvea_gc_scratch_pop(). While any slot is in use, objects whose reference count drops to 0 are deferred
+// to the zero-count table, so an object may be released by its holders while a scratch slot still refers to it.
+// A scratch slot must not be used to modify the value it refers to (e.g. a string which may be shared), and it may only
+// hold objects owned by the thread. Returns NULL and throws an error if there are not enough slots left.
+elvea_variant_t *elvea_gc_scratch_push(elvea_thread_t *thread, elvea_size_t count);
+
+// Release the last [count] scratch slots. Reference counts are reconciled when the last slot is released.
+void elvea_gc_scratch_pop(elvea_thread_t *thread, elvea_size_t count);
+
+// Store a value in a scratch slot without counting the reference. Aliases are resolved. An object whose reference count
+// is 0 (e.g. a new object) is put in the zero-count table, so that it is reclaimed once it is no longer used.
+void elvea_gc_scratch_set(elvea_thread_t *thread, elvea_variant_t *slot, const elvea_variant_t *value);
+
+// Destroy the objects in the zero-count table which are still unreferenced and are not held by a scratch slot. This is
+// done when the last scratch slot is released, and at safe points if the table is full.
+void elvea_gc_reconcile(elvea_thread_t *thread);
+
+// Get the thread's collector and memory statistics. This is cheap: most counters are maintained as the collector runs,
+// and none of them requires walking the heap.
+void elvea_gc_get_stats(elvea_thread_t *thread, elvea_gc_stats_t *stats);
+
+// Write the thread's statistics in a human-readable format.
+void elvea_gc_dump_stats(elvea_thread_t *thread, FILE *file);
+
+// Invoke [callback] at the end of each collection, or remove the callback if it is NULL.
+void elvea_gc_set_callback(elvea_thread_t *thread, elvea_gc_callback_t callback, void *context);
+
+// Number of bytes taken by the header of a collectable object, which precedes the object.
+size_t elvea_gc_header_size();
+
+// Get the number of references to an object: those counted by its owner, and those held by other threads. References
+// held in scratch slots are not counted.
+uint32_t elvea_object_total_count(elvea_object_t *object);
+
+// Callbacks used to walk the heap.
+typedef void (*elvea_object_callback_t)(elvea_thread_t *thread, elvea_object_t *object, void *context);
+typedef void (*elvea_reference_callback_t)(elvea_thread_t *thread, elvea_variant_t *variant, void *context);
+
+// Invoke [callback] on each collectable object owned by the thread, from the most recent to the oldest. The callback
+// must not create or destroy collectable objects.
+void elvea_gc_for_each_object(elvea_thread_t *thread, elvea_object_callback_t callback, void *context);
+
+// Invoke [callback] on each variant held by [object], as reported by its class's traverse callback. Unlike the cycle
+// collector, which only follows references to collectable objects owned by the thread, this reports all the variants,
+// including aliases.
+void elvea_gc_for_each_reference(elvea_thread_t *thread, elvea_object_t *object, elvea_reference_callback_t callback,
+		void *context);
+
+// Traverse callbacks receive an opaque context, which they must pass to this function along with each variant held by
+// the object they traverse.
+void elvea_gc_visit(elvea_thread_t *thread, elvea_variant_t *variant, void *context);
+
+// Reclaim as much memory as possible: collect reference cycles and release the arena's empty pages.
+void elvea_gc_collect(elvea_thread_t *thread);
 
 #ifdef __cplusplus
 }
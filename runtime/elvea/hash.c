@@ -0,0 +1,515 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <elvea/hash.h>
+#include <elvea/thread.h>
+#include <elvea/runtime.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Mixing constants of wyhash.
+#define P0 UINT64_C(0xa0761d6478bd642f)
+#define P1 UINT64_C(0xe7037ed1a0b428db)
+#define P2 UINT64_C(0x8ebc6af09c88c6e3)
+#define P3 UINT64_C(0x589965cc75374cc3)
+
+// Inputs which are longer than this are hashed in stripes.
+#define LONG_INPUT 256
+#define STRIPE_SIZE 64
+#define LANE_COUNT 8
+
+// Number of stripes after which the accumulators are scrambled.
+#define BLOCK_STRIPES 16
+
+#define PRIME32 UINT32_C(0x9e3779b1)
+
+static inline
+uint64_t read64(const uint8_t *p)
+{
+	return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24 |
+		   (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+static inline
+uint64_t read32(const uint8_t *p)
+{
+	return (uint64_t) p[0] | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24;
+}
+
+// Multiply two 64-bit integers, and fold the 128-bit product.
+static inline
+uint64_t mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t) a * b;
+	return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+	uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	return lo ^ hi;
+#endif
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Long inputs are processed in the style of XXH3: each 64-bit lane of a stripe is combined with a secret derived from
+// the seed, and the product of its 32-bit halves is added to an accumulator. The lane itself is added to the
+// neighbouring accumulator, so that no input bit is lost. The SSE2 and scalar versions compute the same values.
+
+#if defined(__SSE2__)
+
+static void accumulate(uint64_t acc[LANE_COUNT], const uint8_t *p, size_t stripes, const uint64_t secret[LANE_COUNT])
+{
+	__m128i a[LANE_COUNT / 2], s[LANE_COUNT / 2];
+
+	for (int i = 0; i < LANE_COUNT / 2; i++)
+	{
+		a[i] = _mm_loadu_si128((const __m128i*) &acc[2 * i]);
+		s[i] = _mm_loadu_si128((const __m128i*) &secret[2 * i]);
+	}
+	for (size_t n = 0; n < stripes; n++, p += STRIPE_SIZE)
+	{
+		for (int i = 0; i < LANE_COUNT / 2; i++)
+		{
+			__m128i data = _mm_loadu_si128((const __m128i*) (p + 16 * i));
+			__m128i key = _mm_xor_si128(data, s[i]);
+			__m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+			__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+		}
+	}
+	for (int i = 0; i < LANE_COUNT / 2; i++) {
+		_mm_storeu_si128((__m128i*) &acc[2 * i], a[i]);
+	}
+}
+
+static void scramble(uint64_t acc[LANE_COUNT], const uint64_t secret[LANE_COUNT])
+{
+	const __m128i prime = _mm_set1_epi32((int) PRIME32);
+
+	for (int i = 0; i < LANE_COUNT / 2; i++)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*) &acc[2 * i]);
+		__m128i s = _mm_loadu_si128((const __m128i*) &secret[2 * i]);
+		a = _mm_xor_si128(_mm_xor_si128(a, _mm_srli_epi64(a, 47)), s);
+
+		// 64-bit multiplication by a 32-bit constant.
+		__m128i lo = _mm_mul_epu32(a, prime);
+		__m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+		_mm_storeu_si128((__m128i*) &acc[2 * i], _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+	}
+}
+
+#else
+
+static void accumulate(uint64_t acc[LANE_COUNT], const uint8_t *p, size_t stripes, const uint64_t secret[LANE_COUNT])
+{
+	for (size_t n = 0; n < stripes; n++, p += STRIPE_SIZE)
+	{
+		for (int i = 0; i < LANE_COUNT; i++)
+		{
+			uint64_t data = read64(p + 8 * i);
+			uint64_t key = data ^ secret[i];
+			acc[i ^ 1] += data;
+			acc[i] += (key & 0xffffffff) * (key >> 32);
+		}
+	}
+}
+
+static void scramble(uint64_t acc[LANE_COUNT], const uint64_t secret[LANE_COUNT])
+{
+	for (int i = 0; i < LANE_COUNT; i++) {
+		acc[i] = (acc[i] ^ (acc[i] >> 47) ^ secret[i]) * PRIME32;
+	}
+}
+
+#endif
+
+static void long_init(uint64_t acc[LANE_COUNT], uint64_t secret[LANE_COUNT], uint64_t seed)
+{
+	static const uint64_t init[LANE_COUNT] = {
+		UINT64_C(0xc2b2ae3d), UINT64_C(0x9e3779b185ebca87), UINT64_C(0xc2b2ae3d27d4eb4f), UINT64_C(0x165667b19e3779f9),
+		UINT64_C(0x85ebca77c2b2ae63), UINT64_C(0x85ebca77), UINT64_C(0x27d4eb2f165667c5), UINT64_C(0x9e3779b1)
+	};
+
+	for (int i = 0; i < LANE_COUNT; i++)
+	{
+		acc[i] = init[i];
+		secret[i] = elvea_hash_mix64(seed + (uint64_t) (i + 1) * P0);
+	}
+}
+
+// Process stripes, scrambling the accumulators after each block. [done] is the number of stripes already processed.
+static void long_stripes(uint64_t acc[LANE_COUNT], const uint64_t secret[LANE_COUNT], const uint8_t *p, size_t stripes,
+						 size_t *done)
+{
+	while (stripes > 0)
+	{
+		size_t count = BLOCK_STRIPES - *done % BLOCK_STRIPES;
+		if (count > stripes) count = stripes;
+
+		accumulate(acc, p, count, secret);
+		p += count * STRIPE_SIZE;
+		stripes -= count;
+		*done += count;
+
+		if (*done % BLOCK_STRIPES == 0) {
+			scramble(acc, secret);
+		}
+	}
+}
+
+// [last] points to the last stripe of the input.
+static uint64_t long_final(uint64_t acc[LANE_COUNT], const uint64_t secret[LANE_COUNT], const uint8_t *last, size_t len)
+{
+	accumulate(acc, last, 1, secret);
+
+	uint64_t h = len * P0;
+	for (int i = 0; i < LANE_COUNT; i += 2) {
+		h += mum(acc[i] ^ secret[i + 1], acc[i + 1] ^ secret[i]);
+	}
+
+	return elvea_hash_mix64(h);
+}
+
+static uint64_t hash_long(const uint8_t *p, size_t len, uint64_t seed)
+{
+	uint64_t acc[LANE_COUNT], secret[LANE_COUNT];
+	size_t done = 0;
+
+	// The last stripe is always processed separately, and it may overlap with the previous one.
+	long_init(acc, secret, seed);
+	long_stripes(acc, secret, p, (len - 1) / STRIPE_SIZE, &done);
+
+	return long_final(acc, secret, p + len - STRIPE_SIZE, len);
+}
+
+uint64_t elvea_hash_bytes(const void *data, size_t len, uint64_t seed)
+{
+	const uint8_t *p = (const uint8_t*) data;
+	uint64_t a, b;
+	seed ^= mum(seed ^ P0, P1);
+
+	if (len <= 16)
+	{
+		if (len >= 4)
+		{
+			// Two overlapping reads cover the whole input.
+			size_t offset = (len >> 3) << 2;
+			a = (read32(p) << 32) | read32(p + offset);
+			b = (read32(p + len - 4) << 32) | read32(p + len - 4 - offset);
+		}
+		else if (len > 0)
+		{
+			a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else if (len <= LONG_INPUT)
+	{
+		size_t i = len;
+
+		if (i > 48)
+		{
+			uint64_t seed1 = seed, seed2 = seed;
+
+			do {
+				seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+				seed1 = mum(read64(p + 16) ^ P2, read64(p + 24) ^ seed1);
+				seed2 = mum(read64(p + 32) ^ P3, read64(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+
+			seed ^= seed1 ^ seed2;
+		}
+		while (i > 16)
+		{
+			seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = read64(p + i - 16);
+		b = read64(p + i - 8);
+	}
+	else
+	{
+		seed = hash_long(p, len, seed);
+		a = read64(p + len - 16);
+		b = read64(p + len - 8);
+	}
+
+	return mum(P1 ^ len, mum(a ^ P1, b ^ seed));
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#define ROTL(x, b) (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND \
+	do { \
+		v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+		v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+		v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+		v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); \
+	} while (0)
+
+static inline
+void sip_init(uint64_t v[4], const uint64_t key[2])
+{
+	v[0] = key[0] ^ UINT64_C(0x736f6d6570736575);
+	v[1] = key[1] ^ UINT64_C(0x646f72616e646f6d);
+	v[2] = key[0] ^ UINT64_C(0x6c7967656e657261);
+	v[3] = key[1] ^ UINT64_C(0x7465646279746573);
+}
+
+// Process [count] 8-byte words.
+static inline
+void sip_words(uint64_t v[4], const uint8_t *p, size_t count)
+{
+	uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+
+	for (size_t i = 0; i < count; i++, p += 8)
+	{
+		uint64_t m = read64(p);
+		v3 ^= m;
+		SIPROUND;
+		SIPROUND;
+		v0 ^= m;
+	}
+	v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
+}
+
+// Process the last (len % 8) bytes of the input, which [p] points to, and finalize the hash.
+static inline
+uint64_t sip_final(uint64_t v[4], const uint8_t *p, size_t len)
+{
+	uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+	uint64_t m = (uint64_t) len << 56;
+
+	for (size_t i = 0; i < (len & 7); i++) {
+		m |= (uint64_t) p[i] << (8 * i);
+	}
+	v3 ^= m;
+	SIPROUND;
+	SIPROUND;
+	v0 ^= m;
+
+	v2 ^= 0xff;
+	SIPROUND;
+	SIPROUND;
+	SIPROUND;
+	SIPROUND;
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t elvea_siphash(const void *data, size_t len, const uint64_t key[2])
+{
+	const uint8_t *p = (const uint8_t*) data;
+	uint64_t v[4];
+
+	sip_init(v, key);
+	sip_words(v, p, len / 8);
+
+	return sip_final(v, p + (len & ~(size_t) 7), len);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Hash a 64-bit word. [tweak] selects one of the two halves of the key, so that different kinds of values which happen
+// to have the same representation don't collide.
+static inline
+elvea_size_t hash_word(elvea_thread_t *thread, uint64_t x, int tweak)
+{
+#if ELVEA_HASH_ALGORITHM == ELVEA_HASH_SIPHASH
+	uint8_t bytes[8];
+	for (int i = 0; i < 8; i++) {
+		bytes[i] = (uint8_t) (x >> (8 * i));
+	}
+	uint64_t key[2] = { thread->runtime->hash_key[tweak], thread->runtime->hash_key[1 - tweak] };
+
+	return elvea_hash_fold(elvea_siphash(bytes, sizeof bytes, key));
+#else
+	return elvea_hash_fold(elvea_hash_mix64(x ^ thread->runtime->hash_key[tweak]));
+#endif
+}
+
+elvea_size_t elvea_hash_data(elvea_thread_t *thread, const void *data, size_t len)
+{
+#if ELVEA_HASH_ALGORITHM == ELVEA_HASH_SIPHASH
+	return elvea_hash_fold(elvea_siphash(data, len, thread->runtime->hash_key));
+#else
+	return elvea_hash_fold(elvea_hash_bytes(data, len, thread->runtime->hash_key[0]));
+#endif
+}
+
+void elvea_hash_stream_init(elvea_thread_t *thread, elvea_hash_stream_t *stream, size_t len)
+{
+	stream->length = len;
+	stream->position = 0;
+	stream->stripes = 0;
+	stream->buffered = 0;
+#if ELVEA_HASH_ALGORITHM == ELVEA_HASH_SIPHASH
+	sip_init(stream->state, thread->runtime->hash_key);
+#else
+	stream->seed = thread->runtime->hash_key[0];
+
+	// Long inputs are processed as they come, so we need the same setup as elvea_hash_bytes().
+	if (len > LONG_INPUT)
+	{
+		stream->seed ^= mum(stream->seed ^ P0, P1);
+		long_init(stream->state, stream->secret, stream->seed);
+	}
+#endif
+}
+
+#if ELVEA_HASH_ALGORITHM == ELVEA_HASH_SIPHASH
+
+void elvea_hash_stream_update(elvea_hash_stream_t *stream, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t*) data;
+	stream->position += len;
+
+	if (stream->buffered > 0)
+	{
+		size_t count = ELVEA_MIN(len, 8 - stream->buffered);
+		memcpy(stream->buffer + stream->buffered, p, count);
+		stream->buffered += count;
+		p += count;
+		len -= count;
+
+		if (stream->buffered < 8) {
+			return;
+		}
+		sip_words(stream->state, stream->buffer, 1);
+		stream->buffered = 0;
+	}
+	sip_words(stream->state, p, len / 8);
+	stream->buffered = len & 7;
+	memcpy(stream->buffer, p + (len & ~(size_t) 7), stream->buffered);
+}
+
+elvea_size_t elvea_hash_stream_final(elvea_hash_stream_t *stream)
+{
+	return elvea_hash_fold(sip_final(stream->state, stream->buffer, stream->length));
+}
+
+#else
+
+void elvea_hash_stream_update(elvea_hash_stream_t *stream, const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t*) data;
+	size_t position = stream->position;
+	stream->position += len;
+
+	if (stream->length <= LONG_INPUT)
+	{
+		memcpy(stream->buffer + position, p, len);
+		return;
+	}
+
+	// Keep a copy of the last stripe, which is processed by long_final().
+	size_t last = stream->length - STRIPE_SIZE;
+	if (position + len > last)
+	{
+		size_t from = ELVEA_MAX(position, last);
+		memcpy(stream->tail + (from - last), p + (from - position), position + len - from);
+	}
+
+	// Feed complete stripes to the accumulators, and stage the others in the buffer.
+	size_t limit = (stream->length - 1) / STRIPE_SIZE * STRIPE_SIZE;
+	if (position >= limit) {
+		return;
+	}
+	len = ELVEA_MIN(len, limit - position);
+
+	if (stream->buffered > 0)
+	{
+		size_t count = ELVEA_MIN(len, STRIPE_SIZE - stream->buffered);
+		memcpy(stream->buffer + stream->buffered, p, count);
+		stream->buffered += count;
+		p += count;
+		len -= count;
+
+		if (stream->buffered < STRIPE_SIZE) {
+			return;
+		}
+		long_stripes(stream->state, stream->secret, stream->buffer, 1, &stream->stripes);
+		stream->buffered = 0;
+	}
+	long_stripes(stream->state, stream->secret, p, len / STRIPE_SIZE, &stream->stripes);
+	stream->buffered = len % STRIPE_SIZE;
+	memcpy(stream->buffer, p + len - stream->buffered, stream->buffered);
+}
+
+elvea_size_t elvea_hash_stream_final(elvea_hash_stream_t *stream)
+{
+	size_t len = stream->length;
+
+	if (len <= LONG_INPUT) {
+		return elvea_hash_fold(elvea_hash_bytes(stream->buffer, len, stream->seed));
+	}
+
+	// This is the end of elvea_hash_bytes() for long inputs.
+	uint64_t seed = long_final(stream->state, stream->secret, stream->tail, len);
+	uint64_t a = read64(stream->tail + STRIPE_SIZE - 16);
+	uint64_t b = read64(stream->tail + STRIPE_SIZE - 8);
+
+	return elvea_hash_fold(mum(P1 ^ len, mum(a ^ P1, b ^ seed)));
+}
+
+#endif
+
+elvea_size_t elvea_hash_int(elvea_thread_t *thread, elvea_int_t i)
+{
+	return hash_word(thread, (uint64_t) i, 0);
+}
+
+elvea_size_t elvea_hash_num(elvea_thread_t *thread, elvea_float_t n)
+{
+	if (elvea_num_is_int(n)) {
+		return elvea_hash_int(thread, (elvea_int_t) n);
+	}
+
+	// All the NaNs hash alike.
+	union { elvea_float_t number; uint64_t bits; } u;
+	u.number = (n != n) ? NAN : n;
+
+	return hash_word(thread, u.bits, 1);
+}
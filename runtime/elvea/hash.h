@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: hashing functions. A fast general-purpose hash for byte strings, which processes 8 or 16 bytes per step    *
+ * and uses SIMD for long inputs, a keyed SipHash for flood resistance, and mixers for integers and numbers.           *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_HASH_H
+#define ELVEA_HASH_H
+
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Algorithms which can be used to hash strings (see ELVEA_HASH_ALGORITHM in config.h).
+#define ELVEA_HASH_FAST    1
+#define ELVEA_HASH_SIPHASH 2
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Mix the bits of a 64-bit integer (this is the finalizer of MurmurHash3). This is a bijection.
+static inline
+uint64_t elvea_hash_mix64(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= UINT64_C(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x *= UINT64_C(0xc4ceb9fe1a85ec53);
+	x ^= x >> 33;
+
+	return x;
+}
+
+// Fold a 64-bit hash into a hash value.
+static inline
+elvea_size_t elvea_hash_fold(uint64_t h)
+{
+	return (elvea_size_t) (h ^ (h >> 32));
+}
+
+// Fast non-cryptographic hash, in the style of wyhash. Short inputs are hashed 16 bytes at a time, and inputs longer
+// than 256 bytes are processed in 64-byte stripes by 8 independent accumulators, using SSE2 when it is available.
+uint64_t elvea_hash_bytes(const void *data, size_t len, uint64_t seed);
+
+// SipHash-2-4 keyed with a 128-bit secret. This is slower than elvea_hash_bytes(), but an attacker who doesn't know the
+// key can't produce collisions.
+uint64_t elvea_siphash(const void *data, size_t len, const uint64_t key[2]);
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Hash a byte string with the algorithm selected by ELVEA_HASH_ALGORITHM, keyed with the runtime's hash key.
+elvea_size_t elvea_hash_data(elvea_thread_t *thread, const void *data, size_t len);
+
+// State of an incremental hash, for data which is not contiguous in memory. The total length must be known in advance:
+// feeding exactly [len] bytes in any number of pieces to elvea_hash_stream_update() produces the same value as
+// elvea_hash_data().
+typedef struct elvea_hash_stream_t
+{
+	// Accumulators of the long path, or SipHash's state.
+	uint64_t state[8];
+	uint64_t secret[8];
+	uint64_t seed;
+
+	// Total length, and number of bytes received so far.
+	size_t length;
+	size_t position;
+
+	// Number of stripes which have been accumulated.
+	size_t stripes;
+
+	// Bytes which have been received but not processed yet. Inputs which fit in the buffer are hashed at the end.
+	size_t buffered;
+	uint8_t buffer[256];
+
+	// Copy of the last 64 bytes of the input.
+	uint8_t tail[64];
+} elvea_hash_stream_t;
+
+// Start hashing [len] bytes.
+
+void elvea_hash_stream_init(elvea_thread_t *thread, elvea_hash_stream_t *stream, size_t len);
+
+// Hash the next bytes of the input.
+void elvea_hash_stream_update(elvea_hash_stream_t *stream, const void *data, size_t len);
+
+// Get the hash value, once all the bytes have been received.
+elvea_size_t elvea_hash_stream_final(elvea_hash_stream_t *stream);
+
+// Hash an integer.
+elvea_size_t elvea_hash_int(elvea_thread_t *thread, elvea_int_t i);
+
+// Hash a number. Numbers which have an integral value hash like the equivalent integer, since they compare equal.
+elvea_size_t elvea_hash_num(elvea_thread_t *thread, elvea_float_t n);
+
+// Check whether a number has an integral value which can be represented exactly as an integer.
+static inline
+bool elvea_num_is_int(elvea_float_t n)
+{
+	// 2^63 is exactly representable as a double, but doesn't fit in an integer.
+	return n >= -9223372036854775808.0 && n < 9223372036854775808.0 && (elvea_float_t) (elvea_int_t) n == n;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_HASH_H
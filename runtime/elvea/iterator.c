@@ -35,9 +35,9 @@ elvea_iterator_t *elvea_iterator_new(elvea_thread_t *thread, elvea_variant_t *ta
 	}
 
 	elvea_make_alias(thread, target);
-	elvea_alias_t *alias = target->as.alias;
+	elvea_alias_t *alias = elvea_as_alias(target);
 	self->alias = alias;
-	self->object = alias->variant.as.object;
+	self->object = elvea_as_object(&alias->variant);
 	elvea_alias_retain(thread, alias);
 	elvea_zero(&self->data);
 
@@ -0,0 +1,623 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <elvea/profiler.h>
+#include <elvea/class.h>
+#include <elvea/thread.h>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#	include <execinfo.h>
+#	define HAVE_BACKTRACE 1
+#endif
+
+#if defined(__GNUC__)
+#	define NOINLINE __attribute__((noinline))
+#	define RETURN_ADDRESS() __builtin_return_address(0)
+#else
+#	define NOINLINE
+#	define RETURN_ADDRESS() NULL
+#endif
+
+// Frames which don't belong to the caller: capture_stack, elvea_profiler_on_alloc and the allocation routine that called
+// it (elvea_alloc, elvea_calloc or elvea_realloc). Sanitizers may add a frame for their backtrace() interceptor, so the
+// actual number is found by looking for the return address into the allocation routine, if we know it.
+#define SKIPPED_FRAMES 3
+#define EXTRA_FRAMES 2
+
+typedef struct profiler_site_t
+{
+	uint64_t hash;
+	int depth;
+	void *frames[ELVEA_PROFILER_MAX_DEPTH];
+	elvea_alloc_stats_t stats;
+} profiler_site_t;
+
+// A sampled allocation which is still alive.
+typedef struct profiler_sample_t
+{
+	// Address of the block, or NULL if the entry is unused.
+	void *ptr;
+
+	// Index of the call site.
+	uint32_t site;
+
+	// Number of allocations and bytes this sample stands for.
+	uint64_t count;
+	uint64_t bytes;
+} profiler_sample_t;
+
+struct elvea_profiler_t
+{
+	// Average number of bytes between two samples.
+	size_t sample_interval;
+
+	// Number of bytes left before the next sample.
+	int64_t countdown;
+
+	// State of the random number generator used to pick samples.
+	uint32_t random;
+
+	// Statistics for all allocations.
+	elvea_alloc_stats_t total;
+
+	// Call sites, and hash table of indices (plus 1) into the array of call sites.
+	profiler_site_t *sites;
+	uint32_t site_count, site_capacity;
+	uint32_t *site_table;
+	uint32_t site_table_capacity;
+
+	// Hash table of live samples, indexed by address.
+	profiler_sample_t *samples;
+	size_t sample_count, sample_capacity;
+};
+
+// The profiler's own memory is not allocated with the runtime's allocator, so that it doesn't profile itself.
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline
+size_t hash_pointer(const void *ptr)
+{
+	uint64_t h = (uint64_t) (uintptr_t) ptr;
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+
+	return (size_t) h;
+}
+
+static uint64_t hash_stack(void * const *frames, int depth)
+{
+	uint64_t h = UINT64_C(14695981039346656037);
+
+	for (int i = 0; i < depth; ++i)
+	{
+		h ^= (uint64_t) (uintptr_t) frames[i];
+		h *= UINT64_C(1099511628211);
+	}
+
+	return h;
+}
+
+static inline
+void add_stats(elvea_alloc_stats_t *stats, uint64_t count, uint64_t bytes)
+{
+	stats->alloc_count += count;
+	stats->alloc_bytes += bytes;
+	stats->live_count += count;
+	stats->live_bytes += bytes;
+
+	if (stats->live_bytes > stats->peak_bytes) {
+		stats->peak_bytes = stats->live_bytes;
+	}
+}
+
+static inline
+void remove_stats(elvea_alloc_stats_t *stats, uint64_t count, uint64_t bytes)
+{
+	// Objects which were allocated before profiling started are not accounted for.
+	stats->live_count -= ELVEA_MIN(count, stats->live_count);
+	stats->live_bytes -= ELVEA_MIN(bytes, stats->live_bytes);
+}
+
+static NOINLINE int capture_stack(void **frames, void *allocator)
+{
+#ifdef HAVE_BACKTRACE
+	void *buffer[ELVEA_PROFILER_MAX_DEPTH + SKIPPED_FRAMES + EXTRA_FRAMES];
+	int count = backtrace(buffer, ELVEA_PROFILER_MAX_DEPTH + SKIPPED_FRAMES + EXTRA_FRAMES);
+	int skipped = SKIPPED_FRAMES;
+
+	for (int i = 1; allocator && i < count && i < SKIPPED_FRAMES + EXTRA_FRAMES; ++i)
+	{
+		if (buffer[i] == allocator)
+		{
+			skipped = i + 1;
+			break;
+		}
+	}
+
+	int depth = ELVEA_MIN(count - skipped, ELVEA_PROFILER_MAX_DEPTH);
+
+	if (depth <= 0) {
+		return 0;
+	}
+	memcpy(frames, buffer + skipped, (size_t) depth * sizeof(void*));
+
+	return depth;
+#else
+	ELVEA_UNUSED(frames);
+	ELVEA_UNUSED(allocator);
+	return 0;
+#endif
+}
+
+// Decide whether the next allocation of [size] bytes is sampled, and if so, compute its weight.
+static bool pick_sample(elvea_profiler_t *profiler, size_t size, double *scale)
+{
+	if (profiler->sample_interval == 0)
+	{
+		*scale = 1.0;
+		return true;
+	}
+
+	profiler->countdown -= (int64_t) size;
+
+	if (profiler->countdown > 0) {
+		return false;
+	}
+
+	// Sample points follow a Poisson process, so the distance between two samples is exponentially distributed.
+	uint32_t x = profiler->random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	profiler->random = x;
+	double u = ((double) (x >> 8) + 0.5) / 16777216.0;
+	double interval = (double) profiler->sample_interval;
+	profiler->countdown = (int64_t) (-log(u) * interval) + 1;
+
+	// An allocation of [size] bytes is sampled with probability 1 - exp(-size/interval).
+	*scale = 1.0 / (1.0 - exp(-(double) size / interval));
+
+	return true;
+}
+
+static uint32_t find_site(elvea_profiler_t *profiler, void **frames, int depth)
+{
+	uint64_t hash = hash_stack(frames, depth);
+
+	// Keep the site table at most half full.
+	if (profiler->site_count * 2 >= profiler->site_table_capacity)
+	{
+		uint32_t capacity = profiler->site_table_capacity ? profiler->site_table_capacity * 2 : 256;
+		uint32_t *table = (uint32_t*) calloc(capacity, sizeof(uint32_t));
+
+		if (table == NULL) {
+			return UINT32_MAX;
+		}
+
+		for (uint32_t i = 0; i < profiler->site_count; ++i)
+		{
+			uint32_t j = (uint32_t) profiler->sites[i].hash & (capacity - 1);
+			while (table[j]) j = (j + 1) & (capacity - 1);
+			table[j] = i + 1;
+		}
+
+		free(profiler->site_table);
+		profiler->site_table = table;
+		profiler->site_table_capacity = capacity;
+	}
+
+	uint32_t mask = profiler->site_table_capacity - 1;
+	uint32_t j = (uint32_t) hash & mask;
+
+	while (profiler->site_table[j])
+	{
+		profiler_site_t *site = &profiler->sites[profiler->site_table[j] - 1];
+
+		if (site->hash == hash && site->depth == depth && memcmp(site->frames, frames, depth * sizeof(void*)) == 0) {
+			return profiler->site_table[j] - 1;
+		}
+		j = (j + 1) & mask;
+	}
+
+	if (profiler->site_count == profiler->site_capacity)
+	{
+		uint32_t capacity = profiler->site_capacity ? profiler->site_capacity * 2 : 128;
+		profiler_site_t *sites = (profiler_site_t*) realloc(profiler->sites, capacity * sizeof(profiler_site_t));
+
+		if (sites == NULL) {
+			return UINT32_MAX;
+		}
+		profiler->sites = sites;
+		profiler->site_capacity = capacity;
+	}
+
+	profiler_site_t *site = &profiler->sites[profiler->site_count];
+	memset(site, 0, sizeof(profiler_site_t));
+	site->hash = hash;
+	site->depth = depth;
+	memcpy(site->frames, frames, depth * sizeof(void*));
+	profiler->site_table[j] = ++profiler->site_count;
+
+	return profiler->site_count - 1;
+}
+
+static bool insert_sample(elvea_profiler_t *profiler, profiler_sample_t *sample)
+{
+	// Keep the sample table at most half full.
+	if (profiler->sample_count * 2 >= profiler->sample_capacity)
+	{
+		size_t capacity = profiler->sample_capacity ? profiler->sample_capacity * 2 : 1024;
+		profiler_sample_t *samples = (profiler_sample_t*) calloc(capacity, sizeof(profiler_sample_t));
+
+		if (samples == NULL) {
+			return false;
+		}
+
+		for (size_t i = 0; i < profiler->sample_capacity; ++i)
+		{
+			if (profiler->samples[i].ptr == NULL) continue;
+			size_t j = hash_pointer(profiler->samples[i].ptr) & (capacity - 1);
+			while (samples[j].ptr) j = (j + 1) & (capacity - 1);
+			samples[j] = profiler->samples[i];
+		}
+
+		free(profiler->samples);
+		profiler->samples = samples;
+		profiler->sample_capacity = capacity;
+	}
+
+	size_t mask = profiler->sample_capacity - 1;
+	size_t j = hash_pointer(sample->ptr) & mask;
+
+	while (profiler->samples[j].ptr) {
+		j = (j + 1) & mask;
+	}
+	profiler->samples[j] = *sample;
+	profiler->sample_count++;
+
+	return true;
+}
+
+static bool remove_sample(elvea_profiler_t *profiler, void *ptr, profiler_sample_t *result)
+{
+	size_t mask = profiler->sample_capacity - 1;
+	size_t i = hash_pointer(ptr) & mask;
+
+	while (profiler->samples[i].ptr != ptr)
+	{
+		if (profiler->samples[i].ptr == NULL) {
+			return false;
+		}
+		i = (i + 1) & mask;
+	}
+
+	*result = profiler->samples[i];
+	profiler->sample_count--;
+
+	// Shift back the entries that follow, so that lookups don't need tombstones.
+	size_t j = i;
+
+	while (true)
+	{
+		profiler->samples[i].ptr = NULL;
+
+		while (true)
+		{
+			j = (j + 1) & mask;
+
+			if (profiler->samples[j].ptr == NULL) {
+				return true;
+			}
+
+			size_t k = hash_pointer(profiler->samples[j].ptr) & mask;
+
+			// Move the entry at j to i if its home slot k is not cyclically in (i, j].
+			if ((i <= j) ? (i >= k || k > j) : (i >= k && k > j)) {
+				break;
+			}
+		}
+
+		profiler->samples[i] = profiler->samples[j];
+		i = j;
+	}
+}
+
+// Get the name of a frame: the function's name if it is known, otherwise the module and offset.
+static void get_frame_name(const char *symbol, void *frame, char *buffer, size_t size)
+{
+	const char *start = symbol ? strchr(symbol, '(') : NULL;
+
+	if (start)
+	{
+		const char *end = strpbrk(start + 1, "+)");
+
+		if (end && end > start + 1)
+		{
+			snprintf(buffer, size, "%.*s", (int) (end - start - 1), start + 1);
+			return;
+		}
+
+		// No symbol: use the module's file name and the offset.
+		const char *module = symbol;
+		for (const char *s = symbol; s < start; ++s) {
+			if (*s == '/') module = s + 1;
+		}
+		const char *close = strchr(start, ')');
+		snprintf(buffer, size, "%.*s%.*s", (int) (start - module), module,
+				 close ? (int) (close - start - 1) : 0, start + 1);
+		return;
+	}
+
+	snprintf(buffer, size, "%p", frame);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool elvea_profiler_start(elvea_thread_t *thread, size_t sample_interval)
+{
+#if ELVEA_WITH_PROFILER
+	elvea_profiler_stop(thread);
+	elvea_profiler_t *profiler = (elvea_profiler_t*) calloc(1, sizeof(elvea_profiler_t));
+
+	if (profiler == NULL) {
+		return false;
+	}
+
+	profiler->sample_interval = sample_interval;
+	profiler->random = thread->seed | 1;
+	profiler->countdown = (int64_t) sample_interval;
+
+	for (elvea_class_t *klass = thread->classes; klass != NULL; klass = klass->next) {
+		memset(&klass->stats, 0, sizeof(elvea_alloc_stats_t));
+	}
+
+	thread->profiler = profiler;
+	return true;
+#else
+	ELVEA_UNUSED(thread);
+	ELVEA_UNUSED(sample_interval);
+	return false;
+#endif
+}
+
+void elvea_profiler_stop(elvea_thread_t *thread)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+
+	if (profiler)
+	{
+		free(profiler->sites);
+		free(profiler->site_table);
+		free(profiler->samples);
+		free(profiler);
+		thread->profiler = NULL;
+	}
+}
+
+const elvea_alloc_stats_t *elvea_profiler_total(elvea_thread_t *thread)
+{
+	return thread->profiler ? &thread->profiler->total : NULL;
+}
+
+const elvea_alloc_stats_t *elvea_profiler_class_stats(elvea_class_t *klass)
+{
+	return &klass->stats;
+}
+
+void elvea_profiler_for_each_site(elvea_thread_t *thread, elvea_site_callback_t callback, void *context)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+
+	for (uint32_t i = 0; profiler && i < profiler->site_count; ++i)
+	{
+		profiler_site_t *site = &profiler->sites[i];
+		callback(context, site->frames, site->depth, &site->stats);
+	}
+}
+
+void elvea_profiler_dump_classes(elvea_thread_t *thread, FILE *file)
+{
+	fprintf(file, "%-24s %12s %14s %12s %14s %14s\n", "class", "live", "live bytes", "allocs", "alloc bytes",
+			"peak bytes");
+
+	for (elvea_class_t *klass = thread->classes; klass != NULL; klass = klass->next)
+	{
+		elvea_alloc_stats_t *s = &klass->stats;
+		fprintf(file, "%-24s %12" PRIu64 " %14" PRIu64 " %12" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n", klass->name,
+				s->live_count, s->live_bytes, s->alloc_count, s->alloc_bytes, s->peak_bytes);
+	}
+}
+
+void elvea_profiler_dump_collapsed(elvea_thread_t *thread, FILE *file)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+
+	for (uint32_t i = 0; profiler && i < profiler->site_count; ++i)
+	{
+		profiler_site_t *site = &profiler->sites[i];
+		char **symbols = NULL;
+
+		if (site->stats.live_bytes == 0) {
+			continue;
+		}
+#ifdef HAVE_BACKTRACE
+		symbols = backtrace_symbols(site->frames, site->depth);
+#endif
+		if (site->depth == 0) {
+			fputs("[unknown]", file);
+		}
+
+		// Flame graphs expect the outermost frame first.
+		for (int j = site->depth - 1; j >= 0; --j)
+		{
+			char name[256];
+			get_frame_name(symbols ? symbols[j] : NULL, site->frames[j], name, sizeof name);
+			fprintf(file, "%s%s", name, j ? ";" : "");
+		}
+
+		fprintf(file, " %" PRIu64 "\n", site->stats.live_bytes);
+		free(symbols);
+	}
+}
+
+void elvea_profiler_dump_pprof(elvea_thread_t *thread, FILE *file)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+	elvea_alloc_stats_t empty = { 0 };
+	elvea_alloc_stats_t *total = profiler ? &profiler->total : &empty;
+
+	// Values are already scaled up, so we declare a sampling rate of 1 to prevent pprof from scaling them again.
+	fprintf(file, "heap profile: %" PRIu64 ": %" PRIu64 " [%" PRIu64 ": %" PRIu64 "] @ heap_v2/1\n",
+			total->live_count, total->live_bytes, total->alloc_count, total->alloc_bytes);
+
+	for (uint32_t i = 0; profiler && i < profiler->site_count; ++i)
+	{
+		profiler_site_t *site = &profiler->sites[i];
+		elvea_alloc_stats_t *s = &site->stats;
+		fprintf(file, "%" PRIu64 ": %" PRIu64 " [%" PRIu64 ": %" PRIu64 "] @", s->live_count, s->live_bytes,
+				s->alloc_count, s->alloc_bytes);
+
+		for (int j = 0; j < site->depth; ++j) {
+			fprintf(file, " %p", site->frames[j]);
+		}
+		fputc('\n', file);
+	}
+
+	// pprof needs the memory map to symbolize addresses.
+	fputs("\nMAPPED_LIBRARIES:\n", file);
+#ifdef ELVEA_LINUX
+	FILE *maps = fopen("/proc/self/maps", "r");
+
+	if (maps)
+	{
+		char buffer[4096];
+		size_t count;
+
+		while ((count = fread(buffer, 1, sizeof buffer, maps)) > 0) {
+			fwrite(buffer, 1, count, file);
+		}
+		fclose(maps);
+	}
+#endif
+}
+
+void elvea_profiler_on_alloc(elvea_thread_t *thread, void *ptr, size_t size)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+	double scale;
+
+	profiler->total.alloc_count++;
+	profiler->total.alloc_bytes += size;
+
+	if (! pick_sample(profiler, size, &scale)) {
+		return;
+	}
+
+	void *frames[ELVEA_PROFILER_MAX_DEPTH];
+	int depth = capture_stack(frames, RETURN_ADDRESS());
+	uint32_t site = find_site(profiler, frames, depth);
+
+	if (site == UINT32_MAX) {
+		return;
+	}
+
+	profiler_sample_t sample;
+	sample.ptr = ptr;
+	sample.site = site;
+	sample.count = (uint64_t) (scale + 0.5);
+	sample.bytes = (uint64_t) ((double) size * scale + 0.5);
+
+	if (insert_sample(profiler, &sample))
+	{
+		add_stats(&profiler->sites[site].stats, sample.count, sample.bytes);
+
+		// The total's allocation figures are exact: only add live figures.
+		profiler->total.live_count += sample.count;
+		profiler->total.live_bytes += sample.bytes;
+		if (profiler->total.live_bytes > profiler->total.peak_bytes) {
+			profiler->total.peak_bytes = profiler->total.live_bytes;
+		}
+	}
+}
+
+void elvea_profiler_on_free(elvea_thread_t *thread, void *ptr)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+	profiler_sample_t sample;
+
+	if (profiler->sample_count == 0 || ! remove_sample(profiler, ptr, &sample)) {
+		return;
+	}
+
+	remove_stats(&profiler->sites[sample.site].stats, sample.count, sample.bytes);
+	remove_stats(&profiler->total, sample.count, sample.bytes);
+}
+
+void elvea_profiler_on_realloc(elvea_thread_t *thread, void *old_ptr, void *new_ptr, size_t old_size, size_t new_size)
+{
+	elvea_profiler_t *profiler = thread->profiler;
+	profiler_sample_t sample;
+
+	// A resized block is still the same allocation: it is not counted again, and it keeps the call site and the
+	// sampling decision of the allocation that created it.
+	if (new_size > old_size) {
+		profiler->total.alloc_bytes += new_size - old_size;
+	}
+
+	if (profiler->sample_count == 0 || ! remove_sample(profiler, old_ptr, &sample)) {
+		return;
+	}
+
+	elvea_alloc_stats_t *stats = &profiler->sites[sample.site].stats;
+	uint64_t bytes = old_size ? (uint64_t) ((double) sample.bytes * new_size / old_size + 0.5) : sample.count * new_size;
+
+	if (bytes > sample.bytes) {
+		stats->alloc_bytes += bytes - sample.bytes;
+	}
+	stats->live_bytes += bytes - sample.bytes;
+	profiler->total.live_bytes += bytes - sample.bytes;
+	stats->peak_bytes = ELVEA_MAX(stats->peak_bytes, stats->live_bytes);
+	profiler->total.peak_bytes = ELVEA_MAX(profiler->total.peak_bytes, profiler->total.live_bytes);
+
+	// The table can't grow, since the sample was just removed from it.
+	sample.ptr = new_ptr;
+	sample.bytes = bytes;
+	insert_sample(profiler, &sample);
+}
+
+void elvea_profiler_on_new(elvea_thread_t *thread, elvea_class_t *klass, size_t size)
+{
+	add_stats(&klass->stats, 1, size);
+}
+
+void elvea_profiler_on_delete(elvea_thread_t *thread, elvea_class_t *klass, size_t size)
+{
+	remove_stats(&klass->stats, 1, size);
+}
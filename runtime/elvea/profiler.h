@@ -0,0 +1,106 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: allocation profiler. When a profiler is attached to a thread, it keeps track of live bytes, allocation     *
+ * counts and peak usage for each class, and for native call sites. Call sites are sampled: on average, one allocation *
+ * is recorded every [sample_interval] bytes, and its stack trace is captured. Profiles can be queried at runtime or   *
+ * dumped in a format that can be read by pprof or turned into a flame graph. When no profiler is attached, the cost   *
+ * is a single branch per allocation, and the profiler can be compiled out altogether by setting ELVEA_WITH_PROFILER   *
+ * to 0.                                                                                                               *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_PROFILER_H
+#define ELVEA_PROFILER_H
+
+#include <stdio.h>
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct elvea_profiler_t elvea_profiler_t;
+
+// Allocation statistics. For call sites, these are estimates scaled up from the sampled allocations.
+typedef struct elvea_alloc_stats_t
+{
+	// Number of allocations since profiling started.
+	uint64_t alloc_count;
+
+	// Number of bytes allocated since profiling started.
+	uint64_t alloc_bytes;
+
+	// Number of allocations which are still alive.
+	uint64_t live_count;
+
+	// Number of bytes which are still alive.
+	uint64_t live_bytes;
+
+	// Highest value of live_bytes.
+	uint64_t peak_bytes;
+} elvea_alloc_stats_t;
+
+// Callback used to enumerate call sites. Frames are return addresses, from the innermost to the outermost.
+typedef void(*elvea_site_callback_t)(void *context, void * const *frames, int depth, const elvea_alloc_stats_t *stats);
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Attach a profiler to a thread. On average, one allocation every [sample_interval] bytes is attributed to its call
+// site; if [sample_interval] is 0, all allocations are. Per-class statistics are exact. Returns false if the profiler
+// could not be created or was compiled out.
+bool elvea_profiler_start(elvea_thread_t *thread, size_t sample_interval);
+
+// Detach the profiler from the thread and discard its data.
+void elvea_profiler_stop(elvea_thread_t *thread);
+
+// Get statistics for all the allocations made by the thread since profiling started.
+const elvea_alloc_stats_t *elvea_profiler_total(elvea_thread_t *thread);
+
+// Get statistics for instances of a class. They only count the instances' own blocks: buffers such as table buckets or
+// rope nodes are counted in the totals and call sites, but not here.
+const elvea_alloc_stats_t *elvea_profiler_class_stats(elvea_class_t *klass);
+
+// Invoke [callback] on every call site that has been sampled.
+void elvea_profiler_for_each_site(elvea_thread_t *thread, elvea_site_callback_t callback, void *context);
+
+// Write per-class statistics as a table.
+void elvea_profiler_dump_classes(elvea_thread_t *thread, FILE *file);
+
+// Write live bytes per call site in the "collapsed stack" format used by flamegraph.pl and speedscope.
+void elvea_profiler_dump_collapsed(elvea_thread_t *thread, FILE *file);
+
+// Write a heap profile in the legacy text format understood by pprof.
+void elvea_profiler_dump_pprof(elvea_thread_t *thread, FILE *file);
+
+// Hooks called by the allocation routines. (For internal use only.)
+void elvea_profiler_on_alloc(elvea_thread_t *thread, void *ptr, size_t size);
+void elvea_profiler_on_free(elvea_thread_t *thread, void *ptr);
+void elvea_profiler_on_realloc(elvea_thread_t *thread, void *old_ptr, void *new_ptr, size_t old_size, size_t new_size);
+void elvea_profiler_on_new(elvea_thread_t *thread, elvea_class_t *klass, size_t size);
+void elvea_profiler_on_delete(elvea_thread_t *thread, elvea_class_t *klass, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_PROFILER_H
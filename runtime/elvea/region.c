@@ -0,0 +1,300 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/region.h>
+#include <elvea/thread.h>
+#include <elvea/utils/alloc.h>
+
+struct elvea_region_chunk_t
+{
+	// Next chunk in the region or in the thread's spare list.
+	struct elvea_region_chunk_t *next;
+
+	// Region which owns the chunk, or NULL if the region has ended.
+	elvea_region_t *region;
+
+	// Number of usable bytes after the header.
+	size_t size;
+
+	// Number of blocks which have not been released yet.
+	uint32_t live;
+
+	// Whether the chunk outlived its region because some of its blocks escaped.
+	bool pinned;
+};
+
+// Header in front of each block.
+typedef struct region_block_t
+{
+	struct elvea_region_chunk_t *chunk;
+	size_t size;
+} region_block_t;
+
+#define ALIGN(n) (((n) + 15) & ~((size_t) 15))
+
+#define CHUNK_HEADER_SIZE ALIGN(sizeof(struct elvea_region_chunk_t))
+
+#define CHUNK_DATA(chunk) (((char*)(chunk)) + CHUNK_HEADER_SIZE)
+
+// Blocks larger than this get a chunk of their own, so that they don't waste the rest of the current chunk.
+#define LARGE_BLOCK_SIZE (ELVEA_REGION_CHUNK_SIZE / 4)
+
+
+static struct elvea_region_chunk_t *new_chunk(elvea_thread_t *thread, elvea_region_t *region, size_t size)
+{
+	struct elvea_region_chunk_t *chunk = thread->spare_chunks;
+
+	if (size == ELVEA_REGION_CHUNK_SIZE && chunk != NULL)
+	{
+		thread->spare_chunks = chunk->next;
+	}
+	else
+	{
+		chunk = (struct elvea_region_chunk_t*) elvea_alloc(thread, CHUNK_HEADER_SIZE + size);
+
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunk->size = size;
+	}
+
+	chunk->region = region;
+	chunk->live = 0;
+	chunk->pinned = false;
+
+	return chunk;
+}
+
+static void recycle_chunk(elvea_thread_t *thread, struct elvea_region_chunk_t *chunk)
+{
+	size_t spare_count = 0;
+
+	for (struct elvea_region_chunk_t *c = thread->spare_chunks; c != NULL; c = c->next) {
+		spare_count++;
+	}
+
+	if (chunk->size == ELVEA_REGION_CHUNK_SIZE && spare_count < ELVEA_REGION_SPARE_COUNT)
+	{
+		chunk->next = thread->spare_chunks;
+		thread->spare_chunks = chunk;
+	}
+	else
+	{
+		elvea_free(thread, chunk, CHUNK_HEADER_SIZE + chunk->size);
+	}
+}
+
+static void *init_block(char *address, struct elvea_region_chunk_t *chunk, size_t size)
+{
+	region_block_t *block = (region_block_t*) address;
+	block->chunk = chunk;
+	block->size = size;
+	chunk->live++;
+
+	return block + 1;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void elvea_region_begin(elvea_thread_t *thread, elvea_region_policy_t policy)
+{
+	elvea_region_t *region = (elvea_region_t*) elvea_alloc(thread, sizeof(elvea_region_t));
+
+	if (! elvea_check_memory(thread, region)) {
+		return;
+	}
+
+	region->parent = thread->region;
+	region->chunks = NULL;
+	region->bump = region->end = NULL;
+	region->policy = policy;
+	thread->region = region;
+}
+
+elvea_size_t elvea_region_end(elvea_thread_t *thread)
+{
+	elvea_region_t *region = thread->region;
+	elvea_size_t escaped = 0;
+
+	if (region == NULL) {
+		return 0;
+	}
+
+	// Objects whose destruction was deferred haven't escaped.
+	elvea_gc_reconcile(thread);
+	elvea_gc_destroy_pending(thread, 0);
+
+	thread->region = region->parent;
+	struct elvea_region_chunk_t *chunk = region->chunks;
+
+	while (chunk != NULL)
+	{
+		struct elvea_region_chunk_t *next = chunk->next;
+
+		if (chunk->live == 0)
+		{
+			recycle_chunk(thread, chunk);
+		}
+		else
+		{
+			// Some objects escaped: the chunk will be freed when the last of them is destroyed.
+			chunk->region = NULL;
+			chunk->pinned = true;
+			escaped += chunk->live;
+		}
+		chunk = next;
+	}
+
+	elvea_region_policy_t policy = region->policy;
+	elvea_free(thread, region, sizeof(elvea_region_t));
+
+	if (escaped != 0 && policy == ELVEA_REGION_STRICT) {
+		elvea_throw(thread, ELVEA_ERROR_RUNTIME, "%" ELVEA_FORMAT_SIZE " object(s) escaped their region", escaped);
+	}
+
+	return escaped;
+}
+
+static void *region_alloc(elvea_thread_t *thread, elvea_region_t *region, size_t size)
+{
+	size_t block_size = ALIGN(sizeof(region_block_t) + size);
+
+	if (block_size > LARGE_BLOCK_SIZE)
+	{
+		struct elvea_region_chunk_t *chunk = new_chunk(thread, region, block_size);
+
+		if (chunk == NULL) {
+			return NULL;
+		}
+
+		// Insert the chunk after the current one, so that we keep allocating from the latter.
+		if (region->chunks)
+		{
+			chunk->next = region->chunks->next;
+			region->chunks->next = chunk;
+		}
+		else
+		{
+			chunk->next = NULL;
+			region->chunks = chunk;
+			region->bump = region->end = CHUNK_DATA(chunk) + block_size;
+		}
+
+		return init_block(CHUNK_DATA(chunk), chunk, size);
+	}
+
+	if ((size_t) (region->end - region->bump) < block_size)
+	{
+		struct elvea_region_chunk_t *chunk = new_chunk(thread, region, ELVEA_REGION_CHUNK_SIZE);
+
+		if (chunk == NULL) {
+			return NULL;
+		}
+
+		chunk->next = region->chunks;
+		region->chunks = chunk;
+		region->bump = CHUNK_DATA(chunk);
+		region->end = region->bump + chunk->size;
+	}
+
+	char *address = region->bump;
+	region->bump += block_size;
+
+	return init_block(address, region->chunks, size);
+}
+
+void *elvea_region_alloc(elvea_thread_t *thread, size_t size)
+{
+	assert(thread->region != NULL);
+	return region_alloc(thread, thread->region, size);
+}
+
+void *elvea_region_realloc(elvea_thread_t *thread, void *ptr, size_t size, bool *in_region)
+{
+	region_block_t *block = ((region_block_t*) ptr) - 1;
+	elvea_region_t *region = block->chunk->region;
+	*in_region = (region != NULL);
+
+	// If this is the last block in its region's current chunk, try to grow it in place.
+	if (region && region->chunks == block->chunk)
+	{
+		char *block_end = ((char*) block) + ALIGN(sizeof(region_block_t) + block->size);
+		size_t new_end = ALIGN(sizeof(region_block_t) + size);
+
+		if (block_end == region->bump && ((char*) block) + new_end <= region->end)
+		{
+			region->bump = ((char*) block) + new_end;
+			block->size = size;
+			return ptr;
+		}
+	}
+
+	// The block stays in its region, which may not be the current one, so that it doesn't escape a nested region.
+	void *tmp = region ? region_alloc(thread, region, size) : elvea_alloc(thread, size);
+
+	if (tmp == NULL) {
+		return NULL;
+	}
+
+	memcpy(tmp, ptr, ELVEA_MIN(block->size, size));
+	elvea_region_free(thread, ptr);
+
+	return tmp;
+}
+
+void elvea_region_free(elvea_thread_t *thread, void *ptr)
+{
+	region_block_t *block = ((region_block_t*) ptr) - 1;
+	struct elvea_region_chunk_t *chunk = block->chunk;
+
+	if (--chunk->live == 0 && chunk->pinned) {
+		elvea_free(thread, chunk, CHUNK_HEADER_SIZE + chunk->size);
+	}
+}
+
+void elvea_region_finalize(elvea_thread_t *thread)
+{
+	while (thread->region != NULL)
+	{
+		thread->region->policy = ELVEA_REGION_PROMOTE;
+		elvea_region_end(thread);
+	}
+
+	elvea_region_trim(thread);
+}
+
+void elvea_region_trim(elvea_thread_t *thread)
+{
+	struct elvea_region_chunk_t *chunk = thread->spare_chunks;
+
+	while (chunk != NULL)
+	{
+		struct elvea_region_chunk_t *next = chunk->next;
+		elvea_free(thread, chunk, CHUNK_HEADER_SIZE + chunk->size);
+		chunk = next;
+	}
+	thread->spare_chunks = NULL;
+}
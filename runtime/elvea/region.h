@@ -0,0 +1,97 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: region (bump-pointer) heaps. While a region is active on a thread, new objects (strings, tables,           *
+ * iterators...) are carved from the region's chunks by bumping a pointer instead of going through the allocator.      *
+ * Objects are still finalized individually when their reference count drops to 0, which keeps reference counts        *
+ * correct, but their memory is only reclaimed when the region ends, in one step. Buffers owned by objects (e.g. table *
+ * buckets) are still allocated with the runtime's allocator. Objects which are still alive when the region ends have  *
+ * escaped: their chunk is detached from the region and kept alive until the last of them is destroyed (promotion); in *
+ * strict mode, an error is thrown as well.                                                                            *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_REGION_H
+#define ELVEA_REGION_H
+
+#include <stddef.h>
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct elvea_region_t elvea_region_t;
+struct elvea_region_chunk_t;
+
+// What to do with objects that are still alive when their region ends.
+typedef enum elvea_region_policy_t
+{
+	ELVEA_REGION_PROMOTE, // keep escaped objects alive
+	ELVEA_REGION_STRICT   // keep escaped objects alive and throw an error
+} elvea_region_policy_t;
+
+struct elvea_region_t
+{
+	// Enclosing region, if any. Regions can be nested.
+	elvea_region_t *parent;
+
+	// Chunks owned by the region. The first chunk is the one we are currently allocating from.
+	struct elvea_region_chunk_t *chunks;
+
+	// Free space in the current chunk.
+	char *bump, *end;
+
+	// Policy for escaped objects.
+	elvea_region_policy_t policy;
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Start a new region on the thread. All the objects created until the matching call to elvea_region_end() are
+// allocated in this region.
+void elvea_region_begin(elvea_thread_t *thread, elvea_region_policy_t policy);
+
+// End the current region and reclaim its memory. Returns the number of objects that escaped the region.
+elvea_size_t elvea_region_end(elvea_thread_t *thread);
+
+// Allocate a block in the current region, which must exist. (For internal use only.)
+void *elvea_region_alloc(elvea_thread_t *thread, size_t size);
+
+// Resize a block allocated in a region. The block stays in the region it was allocated from, or is moved to the heap
+// if that region has ended, in which case [in_region] is set to false. (For internal use only.)
+void *elvea_region_realloc(elvea_thread_t *thread, void *ptr, size_t size, bool *in_region);
+
+// Release a block allocated in a region. (For internal use only.)
+void elvea_region_free(elvea_thread_t *thread, void *ptr);
+
+// End all active regions and free the chunks kept for reuse.
+void elvea_region_finalize(elvea_thread_t *thread);
+
+// Free the chunks kept for reuse.
+void elvea_region_trim(elvea_thread_t *thread);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_REGION_H
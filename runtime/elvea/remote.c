@@ -0,0 +1,122 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/remote.h>
+#include <elvea/thread.h>
+#include <elvea/class.h>
+#include <elvea/runtime.h>
+
+// Aliases are linked through their metadata, whose first word is replaced with a pointer to the next alias.
+static void push(elvea_thread_t *owner, elvea_alias_t *alias)
+{
+	void **link = (void**) alias;
+	void *head = elvea_atomic_load_ptr(&owner->remote_frees);
+
+	// Treiber stack push: the link is written before the alias is published by the CAS.
+	do {
+		*link = head;
+	}
+	while (! elvea_atomic_cas_ptr(&owner->remote_frees, &head, alias));
+}
+
+// Objects may still be in their owner's root buffer, or examined by its collector, so they are linked through separate
+// nodes and their metadata is left untouched.
+typedef struct merge_node_t
+{
+	struct merge_node_t *next;
+	elvea_object_t *object;
+} merge_node_t;
+
+void elvea_remote_recycle_alias(elvea_thread_t *owner, elvea_alias_t *alias)
+{
+	push(owner, alias);
+}
+
+void elvea_remote_merge(elvea_thread_t *owner, elvea_object_t *object)
+{
+	merge_node_t *node = (merge_node_t*) owner->runtime->alloc(NULL, 0, sizeof(merge_node_t));
+
+	// The object leaks if we can't queue it: the owner never destroys it while it is marked as queued.
+	if (node == NULL) {
+		return;
+	}
+	node->object = object;
+	void *head = elvea_atomic_load_ptr(&owner->remote_merges);
+
+	do {
+		node->next = (merge_node_t*) head;
+	}
+	while (! elvea_atomic_cas_ptr(&owner->remote_merges, &head, node));
+}
+
+static elvea_size_t drain_merges(elvea_thread_t *thread)
+{
+	merge_node_t *node = (merge_node_t*) elvea_atomic_exchange_ptr(&thread->remote_merges, NULL);
+	elvea_size_t count = 0;
+
+	while (node != NULL)
+	{
+		merge_node_t *next = node->next;
+		elvea_object_merge(thread, node->object);
+		thread->runtime->alloc(node, sizeof(merge_node_t), 0);
+		node = next;
+		count++;
+	}
+
+	return count;
+}
+
+elvea_size_t elvea_remote_drain(elvea_thread_t *thread)
+{
+	elvea_size_t count = 0;
+
+	// Finalizers may release more objects owned by other threads, which may in turn hand objects back to us, so we
+	// keep going until the queues are empty.
+	while (true)
+	{
+		count += drain_merges(thread);
+		void *item = elvea_atomic_exchange_ptr(&thread->remote_frees, NULL);
+
+		if (item == NULL && elvea_atomic_load_ptr(&thread->remote_merges) == NULL) {
+			break;
+		}
+
+		while (item != NULL)
+		{
+			void *next = *(void**) item;
+
+			// Restore the metadata.
+			struct elvea_metadata_t *meta = (struct elvea_metadata_t*) item;
+			memset(meta, 0, sizeof(struct elvea_metadata_t));
+			meta->arena = true;
+			elvea_recycle_alias(thread, (elvea_alias_t*) item);
+
+			item = next;
+			count++;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,66 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: remote frees. Objects and aliases belong to the thread which allocated them: objects are linked in its GC  *
+ * chain and aliases live in its arena, and neither is thread-safe. When the last reference to an object or alias is   *
+ * released by another thread, it is pushed onto a lock-free queue owned by the thread it belongs to, which reclaims   *
+ * it at its next safe point (see elvea_thread_safe_point()). This is similar to mimalloc's thread-delayed free lists: *
+ * the releasing thread never touches the owner's data structures, and no lock is needed.                              *
+ * Objects use biased reference counting: their owner counts its references without synchronization, while other       *
+ * threads use an atomic shared count. When another thread releases a reference which the owner counted, the object is *
+ * queued in the same way so that the owner merges the two counts, or destroys the object if the released reference   *
+ * was the last one.                                                                                                   *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_REMOTE_H
+#define ELVEA_REMOTE_H
+
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Hand an alias whose reference count has dropped to 0 over to the thread that owns it. The alias's value must have
+// been released already.
+void elvea_remote_recycle_alias(elvea_thread_t *owner, elvea_alias_t *alias);
+
+// Queue an object whose shared reference count has become negative, so that its owner merges it into its own count,
+// or whose last reference was released by another thread, so that its owner destroys it. The caller must have set
+// ELVEA_SHARED_QUEUED in the shared count.
+void elvea_remote_merge(elvea_thread_t *owner, elvea_object_t *object);
+
+// Merge the shared reference count of an object into the owner's count. This is called by elvea_remote_drain() for the
+// objects queued by elvea_remote_merge().
+void elvea_object_merge(elvea_thread_t *thread, elvea_object_t *object);
+
+// Reclaim everything other threads have handed over to this thread, and merge the reference counts of the objects they
+// have queued. This must only be called by the thread itself.
+// Returns the number of objects and aliases reclaimed or merged.
+elvea_size_t elvea_remote_drain(elvea_thread_t *thread);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_REMOTE_H
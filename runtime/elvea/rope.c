@@ -0,0 +1,382 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/rope.h>
+#include <elvea/utils/alloc.h>
+
+// Number of bytes allocated for an inner node, or for a leaf without its bytes.
+#define NODE_SIZE offsetof(elvea_rope_t, data)
+
+// The functions below take over the references to the nodes they are passed, and return a new reference. An empty
+// rope is represented by NULL. Once an allocation has failed, they only release the nodes they are passed and return
+// NULL, so that the caller can check for errors at the end.
+typedef struct rope_context_t
+{
+	elvea_thread_t *thread;
+	bool failed;
+} rope_context_t;
+
+// Bytes which are copied into new leaves. They come from up to 3 separate pieces.
+typedef struct rope_source_t
+{
+	const char *data[3];
+	elvea_size_t size[3];
+	int count;
+} rope_source_t;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void elvea_rope_release(elvea_thread_t *thread, elvea_rope_t *rope)
+{
+	// The right child is released iteratively, and the recursion on the left child is bounded by the height.
+	while (rope != NULL && --rope->ref_count == 0)
+	{
+		elvea_rope_t *right = rope->right;
+
+		if (rope->height == 0)
+		{
+			elvea_free(thread, rope, NODE_SIZE + rope->size);
+			return;
+		}
+		elvea_rope_release(thread, rope->left);
+		elvea_free(thread, rope, NODE_SIZE);
+		rope = right;
+	}
+}
+
+static elvea_rope_t *make_leaf(rope_context_t *ctx, elvea_size_t size)
+{
+	if (ctx->failed) {
+		return NULL;
+	}
+	elvea_rope_t *leaf = (elvea_rope_t*) elvea_alloc(ctx->thread, NODE_SIZE + size);
+
+	if (! elvea_check_memory(ctx->thread, leaf))
+	{
+		ctx->failed = true;
+		return NULL;
+	}
+	leaf->ref_count = 1;
+	leaf->height = 0;
+	leaf->size = size;
+	leaf->footprint = NODE_SIZE + size;
+	leaf->left = leaf->right = NULL;
+
+	return leaf;
+}
+
+static elvea_rope_t *make_node(rope_context_t *ctx, elvea_rope_t *left, elvea_rope_t *right)
+{
+	elvea_rope_t *node = NULL;
+
+	if (! ctx->failed)
+	{
+		if (left == NULL) return right;
+		if (right == NULL) return left;
+		node = (elvea_rope_t*) elvea_alloc(ctx->thread, NODE_SIZE);
+		ctx->failed = ! elvea_check_memory(ctx->thread, node);
+	}
+	if (ctx->failed)
+	{
+		elvea_rope_release(ctx->thread, left);
+		elvea_rope_release(ctx->thread, right);
+		return NULL;
+	}
+	node->ref_count = 1;
+	node->height = 1 + (ELVEA_MAX(left->height, right->height));
+	node->size = left->size + right->size;
+	node->footprint = NODE_SIZE + left->footprint + right->footprint;
+	node->left = left;
+	node->right = right;
+
+	return node;
+}
+
+// Get the children of an inner node and release it. Unless the node is shared, the references are moved.
+static void unpack(rope_context_t *ctx, elvea_rope_t *node, elvea_rope_t **left, elvea_rope_t **right)
+{
+	*left = node->left;
+	*right = node->right;
+
+	if (node->ref_count == 1)
+	{
+		elvea_free(ctx->thread, node, NODE_SIZE);
+	}
+	else
+	{
+		node->ref_count--;
+		elvea_rope_retain(*left);
+		elvea_rope_retain(*right);
+	}
+}
+
+static void read_source(const rope_source_t *src, elvea_size_t offset, char *buffer, elvea_size_t size)
+{
+	for (int i = 0; i < src->count && size > 0; i++)
+	{
+		if (offset >= src->size[i])
+		{
+			offset -= src->size[i];
+			continue;
+		}
+		elvea_size_t count = ELVEA_MIN(size, src->size[i] - offset);
+		memcpy(buffer, src->data[i] + offset, count);
+		buffer += count;
+		size -= count;
+		offset = 0;
+	}
+}
+
+// Build a perfectly balanced tree whose leaves have about the same size.
+static elvea_rope_t *build(rope_context_t *ctx, const rope_source_t *src, elvea_size_t offset, elvea_size_t size,
+						   elvea_size_t leaf_count)
+{
+	if (leaf_count == 1)
+	{
+		elvea_rope_t *leaf = make_leaf(ctx, size);
+		if (leaf) read_source(src, offset, leaf->data, size);
+
+		return leaf;
+	}
+	elvea_size_t half = leaf_count / 2;
+	elvea_size_t left_size = (elvea_size_t) ((uint64_t) size * half / leaf_count);
+	elvea_rope_t *left = build(ctx, src, offset, left_size, half);
+	elvea_rope_t *right = build(ctx, src, offset + left_size, size - left_size, leaf_count - half);
+
+	return make_node(ctx, left, right);
+}
+
+static elvea_rope_t *from_source(rope_context_t *ctx, const rope_source_t *src)
+{
+	elvea_size_t size = 0;
+
+	for (int i = 0; i < src->count; i++) {
+		size += src->size[i];
+	}
+	if (size == 0) {
+		return NULL;
+	}
+
+	return build(ctx, src, 0, size, (size - 1) / ELVEA_ROPE_LEAF_SIZE + 1);
+}
+
+// Create a node whose children are valid AVL trees whose heights differ by at most 2, rotating them if needed.
+static elvea_rope_t *balance(rope_context_t *ctx, elvea_rope_t *left, elvea_rope_t *right)
+{
+	elvea_rope_t *a, *b, *c, *d;
+
+	if (ctx->failed || left == NULL || right == NULL) {
+		return make_node(ctx, left, right);
+	}
+	if (left->height > right->height + 1)
+	{
+		unpack(ctx, left, &a, &b);
+		if (a->height >= b->height) {
+			return make_node(ctx, a, make_node(ctx, b, right));
+		}
+		unpack(ctx, b, &c, &d);
+
+		return make_node(ctx, make_node(ctx, a, c), make_node(ctx, d, right));
+	}
+	if (right->height > left->height + 1)
+	{
+		unpack(ctx, right, &a, &b);
+		if (b->height >= a->height) {
+			return make_node(ctx, make_node(ctx, left, a), b);
+		}
+		unpack(ctx, a, &c, &d);
+
+		return make_node(ctx, make_node(ctx, left, c), make_node(ctx, d, b));
+	}
+
+	return make_node(ctx, left, right);
+}
+
+// Concatenate two trees of any height. This walks down the spine of the taller tree until it finds a subtree with
+// the height of the shorter one, so it takes O(difference in height) steps. Small adjacent leaves are merged.
+static elvea_rope_t *join(rope_context_t *ctx, elvea_rope_t *left, elvea_rope_t *right)
+{
+	elvea_rope_t *a, *b;
+
+	if (ctx->failed || left == NULL || right == NULL) {
+		return make_node(ctx, left, right);
+	}
+	if (left->height == 0 && right->height == 0 && left->size + right->size <= ELVEA_ROPE_LEAF_SIZE)
+	{
+		rope_source_t src = { { left->data, right->data }, { left->size, right->size }, 2 };
+		elvea_rope_t *leaf = from_source(ctx, &src);
+		elvea_rope_release(ctx->thread, left);
+		elvea_rope_release(ctx->thread, right);
+
+		return leaf;
+	}
+	if (left->height > right->height + 1)
+	{
+		unpack(ctx, left, &a, &b);
+		return balance(ctx, a, join(ctx, b, right));
+	}
+	if (right->height > left->height + 1)
+	{
+		unpack(ctx, right, &a, &b);
+		return balance(ctx, join(ctx, left, a), b);
+	}
+
+	return make_node(ctx, left, right);
+}
+
+// Insert bytes in the leaf which contains the offset, and rebuild the path to it. If the leaf overflows, it is
+// replaced by a balanced subtree.
+static elvea_rope_t *insert(rope_context_t *ctx, elvea_rope_t *node, elvea_size_t offset, const char *data,
+							elvea_size_t size)
+{
+	elvea_rope_t *left, *right;
+
+	if (node == NULL)
+	{
+		rope_source_t src = { { data }, { size }, 1 };
+		return from_source(ctx, &src);
+	}
+	if (node->height == 0)
+	{
+		rope_source_t src = { { node->data, data, node->data + offset }, { offset, size, node->size - offset }, 3 };
+		elvea_rope_t *result = from_source(ctx, &src);
+		elvea_rope_release(ctx->thread, node);
+
+		return result;
+	}
+
+	unpack(ctx, node, &left, &right);
+	if (offset <= left->size) {
+		left = insert(ctx, left, offset, data, size);
+	}
+	else {
+		right = insert(ctx, right, offset - left->size, data, size);
+	}
+
+	return join(ctx, left, right);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+elvea_rope_t *elvea_rope_new(elvea_thread_t *thread, const char *data, elvea_size_t size)
+{
+	rope_context_t ctx = { thread, false };
+	rope_source_t src = { { data }, { size }, 1 };
+
+	return from_source(&ctx, &src);
+}
+
+elvea_rope_t *elvea_rope_concat(elvea_thread_t *thread, elvea_rope_t *left, elvea_rope_t *right)
+{
+	rope_context_t ctx = { thread, false };
+	elvea_rope_retain(left);
+	elvea_rope_retain(right);
+
+	return join(&ctx, left, right);
+}
+
+elvea_rope_t *elvea_rope_insert(elvea_thread_t *thread, elvea_rope_t *rope, elvea_size_t offset, const char *data,
+								elvea_size_t size)
+{
+	rope_context_t ctx = { thread, false };
+	if (rope) elvea_rope_retain(rope);
+
+	return insert(&ctx, rope, offset, data, size);
+}
+
+void elvea_rope_copy(const elvea_rope_t *rope, elvea_size_t offset, char *buffer, elvea_size_t size)
+{
+	elvea_rope_iter_t iter;
+	const char *data;
+	elvea_size_t count;
+
+	elvea_rope_iter_init(&iter, (elvea_rope_t*) rope, offset);
+	while (size > 0 && elvea_rope_iter_next(&iter, &data, &count))
+	{
+		count = ELVEA_MIN(count, size);
+		memcpy(buffer, data, count);
+		buffer += count;
+		size -= count;
+	}
+}
+
+void elvea_rope_iter_init(elvea_rope_iter_t *iter, elvea_rope_t *rope, elvea_size_t offset)
+{
+	iter->count = 0;
+	iter->leaf = NULL;
+	iter->offset = 0;
+
+	if (rope == NULL || offset >= rope->size) {
+		return;
+	}
+	while (rope->height > 0)
+	{
+		if (offset < rope->left->size)
+		{
+			iter->stack[iter->count++] = rope;
+			rope = rope->left;
+		}
+		else
+		{
+			offset -= rope->left->size;
+			rope = rope->right;
+		}
+	}
+	iter->leaf = rope;
+	iter->offset = offset;
+}
+
+bool elvea_rope_iter_next(elvea_rope_iter_t *iter, const char **data, elvea_size_t *size)
+{
+	elvea_rope_t *leaf = iter->leaf;
+
+	if (leaf == NULL) {
+		return false;
+	}
+	*data = leaf->data + iter->offset;
+	*size = leaf->size - iter->offset;
+	iter->offset = 0;
+
+	// The next leaf is the leftmost leaf of the right child of the last node we went left from.
+	if (iter->count == 0)
+	{
+		iter->leaf = NULL;
+	}
+	else
+	{
+		elvea_rope_t *node = iter->stack[--iter->count]->right;
+
+		while (node->height > 0)
+		{
+			iter->stack[iter->count++] = node;
+			node = node->left;
+		}
+		iter->leaf = node;
+	}
+
+	return true;
+}
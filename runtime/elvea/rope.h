@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: ropes, which are balanced trees of immutable chunks of bytes. They are used to represent large strings     *
+ * which are edited in place: inserting and concatenating only copy the nodes along one path of the tree, and the      *
+ * bytes are only made contiguous when they are needed.                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_ROPE_H
+#define ELVEA_ROPE_H
+
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maximum height of a rope. Ropes are AVL trees, so this is much more than needed for 2^32 bytes.
+#define ELVEA_ROPE_MAX_HEIGHT 64
+
+typedef struct elvea_rope_t elvea_rope_t;
+
+// A node of a rope. Leaves hold bytes, and inner nodes hold the concatenation of their children. Nodes are never
+// modified after they have been created, so they can be shared between several ropes. They are reference counted, and
+// belong to the thread which created them.
+struct elvea_rope_t
+{
+	// Number of references to the node.
+	uint32_t ref_count;
+
+	// Height of the tree rooted at this node (leaves have a height of 0).
+	uint32_t height;
+
+	// Number of bytes in the tree rooted at this node.
+	elvea_size_t size;
+
+	// Number of bytes allocated for the nodes of the tree rooted at this node. A node which appears several times in
+	// the tree is counted each time.
+	size_t footprint;
+
+	// Children of an inner node.
+	elvea_rope_t *left, *right;
+
+	// Bytes of a leaf (they are not nul-terminated).
+	char data[1];
+};
+
+// Iterator over the chunks of a rope, from left to right.
+typedef struct elvea_rope_iter_t
+{
+	// Nodes whose right child hasn't been visited.
+	elvea_rope_t *stack[ELVEA_ROPE_MAX_HEIGHT];
+	int count;
+
+	// Next leaf, and offset of the first byte to visit in it.
+	elvea_rope_t *leaf;
+	elvea_size_t offset;
+} elvea_rope_iter_t;
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Create a rope which holds a copy of [size] bytes, with [size] > 0. Returns NULL if memory allocation failed, after
+// reporting the error.
+elvea_rope_t *elvea_rope_new(elvea_thread_t *thread, const char *data, elvea_size_t size);
+
+// Create a rope which holds [left] followed by [right]. The arguments are not modified. Returns NULL if memory
+// allocation failed.
+elvea_rope_t *elvea_rope_concat(elvea_thread_t *thread, elvea_rope_t *left, elvea_rope_t *right);
+
+// Create a rope which holds the bytes of [rope] with [size] bytes inserted at [offset] (in base 0), with
+// offset <= elvea_rope_size(rope), or 0 if [rope] is NULL. The rope is not modified. Returns NULL if memory allocation
+// failed.
+elvea_rope_t *elvea_rope_insert(elvea_thread_t *thread, elvea_rope_t *rope, elvea_size_t offset, const char *data,
+								elvea_size_t size);
+
+// Copy [size] bytes starting at [offset] (in base 0) into [buffer]. The range must be within the rope.
+void elvea_rope_copy(const elvea_rope_t *rope, elvea_size_t offset, char *buffer, elvea_size_t size);
+
+static inline
+void elvea_rope_retain(elvea_rope_t *rope)
+{
+	rope->ref_count++;
+}
+
+// Release a reference to a rope, which may be NULL. Nodes are freed when they are no longer referenced.
+void elvea_rope_release(elvea_thread_t *thread, elvea_rope_t *rope);
+
+static inline
+elvea_size_t elvea_rope_size(const elvea_rope_t *rope)
+{
+	return rope->size;
+}
+
+// Get the number of bytes allocated for the nodes of a rope. Nodes may be shared with other ropes.
+static inline
+size_t elvea_rope_footprint(const elvea_rope_t *rope)
+{
+	return rope->footprint;
+}
+
+// Start iterating over the bytes of a rope, from a given offset (in base 0).
+void elvea_rope_iter_init(elvea_rope_iter_t *iter, elvea_rope_t *rope, elvea_size_t offset);
+
+// Get the next chunk of contiguous bytes. Returns false when the end of the rope has been reached.
+bool elvea_rope_iter_next(elvea_rope_iter_t *iter, const char **data, elvea_size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_ROPE_H
@@ -29,6 +29,9 @@
 #include <time.h>
 #include <elvea/runtime.h>
 #include <elvea/thread.h>
+#include <elvea/hash.h>
+#include <elvea/utils/helpers.h>
+#include <elvea/utils/slab.h>
 
 static void* default_alloc(void* ptr, size_t old_size, size_t new_size)
 {
@@ -47,7 +50,14 @@ static void* default_alloc(void* ptr, size_t old_size, size_t new_size)
 elvea_thread_t * elvea_initialize(elvea_runtime_t *runtime, elvea_allocator_t alloc, elvea_error_callback_t error_handler)
 {
 	srand((unsigned int) time(NULL));
+#if ELVEA_USE_SLAB_ALLOCATOR
+	runtime->alloc = (alloc == NULL) ? elvea_slab_alloc : alloc;
+#else
 	runtime->alloc = (alloc == NULL) ? default_alloc : alloc;
+#endif
+	runtime->error_handler = error_handler;
+	runtime->hash_key[0] = elvea_hash_mix64(((uint64_t) rand() << 32) ^ (uint64_t) rand() ^ elvea_clock_ns());
+	runtime->hash_key[1] = elvea_hash_mix64(runtime->hash_key[0] ^ (uint64_t) (uintptr_t) runtime);
 
 	elvea_thread_t *main_thread = (elvea_thread_t*) runtime->alloc(NULL, 0, sizeof(elvea_thread_t));
 
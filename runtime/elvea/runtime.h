@@ -43,6 +43,10 @@ struct elvea_runtime_t
 
 	// Main thread.
 	elvea_thread_t *thread;
+
+	// Secret key for hashing (see hash.h). It is shared by all the threads, since objects may be used by several
+	// threads and strings cache their hash.
+	uint64_t hash_key[2];
 };
 
 
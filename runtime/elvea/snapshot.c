@@ -0,0 +1,379 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/snapshot.h>
+#include <elvea/thread.h>
+#include <elvea/runtime.h>
+#include <elvea/class.h>
+#include <elvea/string.h>
+#include <elvea/table.h>
+
+// Set of addresses, with a value for each address. The snapshot's own data is allocated with the runtime's allocator,
+// like the collector's work stacks, so that it is not accounted for in the thread's memory budget.
+typedef struct ptr_map_t
+{
+	const void **keys;
+	uint64_t *values;
+	size_t count, capacity;
+} ptr_map_t;
+
+typedef struct snapshot_t
+{
+	elvea_thread_t *thread;
+	FILE *file;
+
+	// Class ids, and non-collectable objects which have been found so far.
+	ptr_map_t classes;
+	ptr_map_t objects;
+
+	// Non-collectable objects which have been found but not written yet.
+	elvea_object_t **pending;
+	size_t pending_count, pending_capacity;
+
+	// Edges of the object being written.
+	uint64_t *edges;
+	size_t edge_count, edge_capacity;
+
+	// Whether an allocation has failed.
+	bool failed;
+} snapshot_t;
+
+
+static void *grow(snapshot_t *snapshot, void *ptr, size_t *capacity, size_t item_size)
+{
+	size_t new_capacity = ELVEA_MAX(*capacity * 2, 64);
+	void *items = snapshot->thread->runtime->alloc(ptr, *capacity * item_size, new_capacity * item_size);
+
+	if (items == NULL)
+	{
+		snapshot->failed = true;
+		return NULL;
+	}
+	*capacity = new_capacity;
+
+	return items;
+}
+
+static size_t hash_ptr(const void *ptr, size_t capacity)
+{
+	uint64_t h = (uint64_t) (uintptr_t) ptr;
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+
+	return (size_t) h & (capacity - 1);
+}
+
+static uint64_t *map_find(ptr_map_t *map, const void *key)
+{
+	if (map->capacity == 0) {
+		return NULL;
+	}
+	for (size_t i = hash_ptr(key, map->capacity); map->keys[i] != NULL; i = (i + 1) & (map->capacity - 1))
+	{
+		if (map->keys[i] == key) {
+			return &map->values[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void map_put(snapshot_t *snapshot, ptr_map_t *map, const void *key, uint64_t value);
+
+static void map_rehash(snapshot_t *snapshot, ptr_map_t *map)
+{
+	elvea_allocator_t alloc = snapshot->thread->runtime->alloc;
+	ptr_map_t old = *map;
+	size_t capacity = ELVEA_MAX(old.capacity * 2, 64);
+	map->keys = (const void**) alloc(NULL, 0, capacity * sizeof(void*));
+	map->values = (uint64_t*) alloc(NULL, 0, capacity * sizeof(uint64_t));
+
+	if (map->keys == NULL || map->values == NULL)
+	{
+		alloc(map->keys, map->keys ? capacity * sizeof(void*) : 0, 0);
+		alloc(map->values, map->values ? capacity * sizeof(uint64_t) : 0, 0);
+		*map = old;
+		snapshot->failed = true;
+		return;
+	}
+	memset((void*) map->keys, 0, capacity * sizeof(void*));
+	map->count = 0;
+	map->capacity = capacity;
+
+	for (size_t i = 0; i < old.capacity; i++)
+	{
+		if (old.keys[i]) map_put(snapshot, map, old.keys[i], old.values[i]);
+	}
+	alloc((void*) old.keys, old.capacity * sizeof(void*), 0);
+	alloc(old.values, old.capacity * sizeof(uint64_t), 0);
+}
+
+static void map_put(snapshot_t *snapshot, ptr_map_t *map, const void *key, uint64_t value)
+{
+	// Keep the load factor under 1/2.
+	if (map->count * 2 >= map->capacity)
+	{
+		map_rehash(snapshot, map);
+		if (snapshot->failed) return;
+	}
+
+	size_t i = hash_ptr(key, map->capacity);
+
+	while (map->keys[i] != NULL) {
+		i = (i + 1) & (map->capacity - 1);
+	}
+	map->keys[i] = key;
+	map->values[i] = value;
+	map->count++;
+}
+
+static void map_free(snapshot_t *snapshot, ptr_map_t *map)
+{
+	snapshot->thread->runtime->alloc((void*) map->keys, map->capacity * sizeof(void*), 0);
+	snapshot->thread->runtime->alloc(map->values, map->capacity * sizeof(uint64_t), 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void write_varint(snapshot_t *snapshot, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		putc((int) (value & 0x7f) | 0x80, snapshot->file);
+		value >>= 7;
+	}
+	putc((int) value, snapshot->file);
+}
+
+static void write_bytes(snapshot_t *snapshot, const void *data, size_t size)
+{
+	write_varint(snapshot, size);
+	fwrite(data, 1, size, snapshot->file);
+}
+
+static uint64_t get_address(const void *ptr)
+{
+	return (uint64_t) (uintptr_t) ptr;
+}
+
+// Record a non-collectable object owned by the thread, which must be written later. Collectable objects are found in
+// the GC chain.
+static void discover_object(snapshot_t *snapshot, elvea_object_t *object)
+{
+	if (elvea_is_collectable(object) || object->isa->thread != snapshot->thread || map_find(&snapshot->objects, object)) {
+		return;
+	}
+	if (snapshot->pending_count == snapshot->pending_capacity)
+	{
+		elvea_object_t **pending = (elvea_object_t**) grow(snapshot, snapshot->pending, &snapshot->pending_capacity,
+				sizeof(elvea_object_t*));
+		if (pending == NULL) return;
+		snapshot->pending = pending;
+	}
+	map_put(snapshot, &snapshot->objects, object, 0);
+	snapshot->pending[snapshot->pending_count++] = object;
+}
+
+static void discover(snapshot_t *snapshot, elvea_variant_t *variant)
+{
+	if (elvea_check_object(variant)) {
+		discover_object(snapshot, elvea_as_object(variant));
+	}
+}
+
+// Get the number of references to an object, including those held by other threads and by scratch slots, which its
+// own count doesn't include, so that the analyzer treats objects which are only held from outside the heap as roots.
+// (The zero-count table holds a counted reference.)
+static uint64_t get_ref_count(elvea_thread_t *thread, elvea_object_t *object)
+{
+	elvea_recycler_t *gc = &thread->gc;
+	uint64_t count = elvea_object_total_count(object);
+
+	for (elvea_size_t i = 0; i < gc->scratch_top; i++)
+	{
+		if (elvea_check_object(&gc->scratch[i]) && elvea_as_object(&gc->scratch[i]) == object) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void add_edge(elvea_thread_t *thread, elvea_variant_t *variant, void *context)
+{
+	snapshot_t *snapshot = (snapshot_t*) context;
+	void *target = elvea_as_pointer(variant);
+
+	if (target == NULL) {
+		return;
+	}
+	if (snapshot->edge_count == snapshot->edge_capacity)
+	{
+		uint64_t *edges = (uint64_t*) grow(snapshot, snapshot->edges, &snapshot->edge_capacity, sizeof(uint64_t));
+		if (edges == NULL) return;
+		snapshot->edges = edges;
+	}
+	snapshot->edges[snapshot->edge_count++] = get_address(target);
+	discover(snapshot, variant);
+}
+
+static uint64_t get_class_id(snapshot_t *snapshot, elvea_class_t *klass)
+{
+	uint64_t *id = map_find(&snapshot->classes, klass);
+
+	if (id) {
+		return *id;
+	}
+
+	// Classes are normally written upfront, but instances of a class created by another thread may be found.
+	uint64_t new_id = snapshot->classes.count;
+	const char *name = klass->name ? klass->name : "";
+	map_put(snapshot, &snapshot->classes, klass, new_id);
+	putc(ELVEA_SNAPSHOT_CLASS, snapshot->file);
+	write_varint(snapshot, new_id);
+	write_bytes(snapshot, name, strlen(name));
+
+	return new_id;
+}
+
+static void write_object(elvea_thread_t *thread, elvea_object_t *object, void *context)
+{
+	snapshot_t *snapshot = (snapshot_t*) context;
+	size_t size = elvea_object_size(thread, object);
+	uint64_t kind = ELVEA_SNAPSHOT_OTHER;
+
+	if (elvea_is_collectable(object)) {
+		size += elvea_gc_header_size();
+	}
+	if (object->isa == thread->string_class)
+	{
+		kind = ELVEA_SNAPSHOT_STRING;
+		size += elvea_string_footprint((elvea_string_t*) object);
+	}
+	else if (object->isa == thread->table_class)
+	{
+		kind = ELVEA_SNAPSHOT_TABLE;
+		size += elvea_table_footprint((elvea_table_t*) object);
+	}
+
+	snapshot->edge_count = 0;
+	elvea_gc_for_each_reference(thread, object, add_edge, snapshot);
+	uint64_t class_id = get_class_id(snapshot, object->isa);
+
+	putc(ELVEA_SNAPSHOT_OBJECT, snapshot->file);
+	write_varint(snapshot, get_address(object));
+	write_varint(snapshot, class_id);
+	write_varint(snapshot, kind);
+	write_varint(snapshot, size);
+	write_varint(snapshot, get_ref_count(thread, object));
+	write_varint(snapshot, snapshot->edge_count);
+
+	for (size_t i = 0; i < snapshot->edge_count; i++) {
+		write_varint(snapshot, snapshot->edges[i]);
+	}
+
+	if (kind == ELVEA_SNAPSHOT_STRING)
+	{
+		elvea_string_t *string = (elvea_string_t*) object;
+		char prefix[ELVEA_SNAPSHOT_PREFIX_SIZE];
+		elvea_size_t prefix_size = ELVEA_MIN(string->size, ELVEA_SNAPSHOT_PREFIX_SIZE);
+
+		// Large strings may be ropes, which must not be flattened here.
+		elvea_string_read(string, 0, prefix, prefix_size);
+		write_varint(snapshot, string->size);
+		write_bytes(snapshot, prefix, prefix_size);
+	}
+	else if (kind == ELVEA_SNAPSHOT_TABLE)
+	{
+		write_varint(snapshot, elvea_table_length(thread, (elvea_table_t*) object));
+	}
+}
+
+static void write_slot(elvea_alias_t *slot, size_t size, void *context)
+{
+	snapshot_t *snapshot = (snapshot_t*) context;
+	void *target = elvea_as_pointer(&slot->variant);
+
+	putc(ELVEA_SNAPSHOT_SLOT, snapshot->file);
+	write_varint(snapshot, get_address(slot));
+	write_varint(snapshot, size);
+	write_varint(snapshot, target ? get_address(target) : 0);
+	discover(snapshot, &slot->variant);
+}
+
+bool elvea_snapshot_write(elvea_thread_t *thread, FILE *file)
+{
+	snapshot_t snapshot;
+	memset(&snapshot, 0, sizeof(snapshot_t));
+	snapshot.thread = thread;
+	snapshot.file = file;
+
+	fwrite(ELVEA_SNAPSHOT_MAGIC, 1, 8, file);
+	write_varint(&snapshot, ELVEA_SNAPSHOT_VERSION);
+
+	for (elvea_class_t *klass = thread->classes; klass != NULL; klass = klass->next) {
+		get_class_id(&snapshot, klass);
+	}
+	elvea_gc_for_each_object(thread, write_object, &snapshot);
+	elvea_arena_for_each_slot(&thread->gc.arena, write_slot, &snapshot);
+
+	// Objects which are only held by scratch slots or by the zero-count table can't be found otherwise.
+	for (elvea_size_t i = 0; i < thread->gc.scratch_top; i++) {
+		discover(&snapshot, &thread->gc.scratch[i]);
+	}
+	for (elvea_size_t i = 0; i < thread->gc.zct.count; i++) {
+		discover_object(&snapshot, thread->gc.zct.items[i]);
+	}
+
+	// Writing an object may discover more objects.
+	while (snapshot.pending_count > 0 && ! snapshot.failed) {
+		write_object(thread, snapshot.pending[--snapshot.pending_count], &snapshot);
+	}
+
+	putc(ELVEA_SNAPSHOT_END, file);
+	write_varint(&snapshot, elvea_memory_used(thread));
+	write_varint(&snapshot, thread->gc.arena.page_count);
+	write_varint(&snapshot, thread->gc.arena.empty_count);
+
+	map_free(&snapshot, &snapshot.classes);
+	map_free(&snapshot, &snapshot.objects);
+	thread->runtime->alloc(snapshot.pending, snapshot.pending_capacity * sizeof(elvea_object_t*), 0);
+	thread->runtime->alloc(snapshot.edges, snapshot.edge_capacity * sizeof(uint64_t), 0);
+
+	return ! snapshot.failed && fflush(file) == 0 && ! ferror(file);
+}
+
+bool elvea_snapshot_save(elvea_thread_t *thread, const char *path)
+{
+	FILE *file = fopen(path, "wb");
+
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = elvea_snapshot_write(thread, file);
+
+	return (fclose(file) == 0) && ok;
+}
@@ -0,0 +1,95 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: heap snapshots. A snapshot records every object a thread can find, with its class, its size and the        *
+ * objects it refers to, as well as the slots of the thread's arena. It is written in a compact binary format which is *
+ * meant to be analyzed offline with the elvea-heap tool (see tools/elvea_heap.c), which computes dominator trees and  *
+ * retained sizes.                                                                                                     *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_SNAPSHOT_H
+#define ELVEA_SNAPSHOT_H
+
+#include <stdio.h>
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Snapshot format. All the integers are unsigned LEB128 varints, and addresses identify objects and arena slots.
+ *
+ *     header:  ELVEA_SNAPSHOT_MAGIC (8 bytes), version
+ *     class:   ELVEA_SNAPSHOT_CLASS, id, name length, name
+ *     object:  ELVEA_SNAPSHOT_OBJECT, address, class id, kind, size, reference count, edge count, edges...
+ *              strings are followed by their length, prefix length and prefix; tables by their number of entries
+ *     slot:    ELVEA_SNAPSHOT_SLOT, address, size, address of the object or alias it refers to (0 if none)
+ *     end:     ELVEA_SNAPSHOT_END, memory used, arena pages, empty arena pages
+ *
+ * Classes are written before their instances. Edges are the addresses of the objects and aliases an object refers to;
+ * they may point to objects which are not in the snapshot (e.g. objects owned by another thread). Reference counts
+ * include the references held by other threads and by scratch slots, so that objects which are only held from outside
+ * the heap are roots.
+ */
+
+#define ELVEA_SNAPSHOT_MAGIC "ELVHEAP\0"
+#define ELVEA_SNAPSHOT_VERSION 1
+
+// Maximum number of bytes recorded for each string.
+#define ELVEA_SNAPSHOT_PREFIX_SIZE 64
+
+// Record tags.
+enum
+{
+	ELVEA_SNAPSHOT_END,
+	ELVEA_SNAPSHOT_CLASS,
+	ELVEA_SNAPSHOT_OBJECT,
+	ELVEA_SNAPSHOT_SLOT
+};
+
+// Kinds of objects.
+enum
+{
+	ELVEA_SNAPSHOT_OTHER,
+	ELVEA_SNAPSHOT_STRING,
+	ELVEA_SNAPSHOT_TABLE
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Write a snapshot of the thread's heap. Collectable objects are found in the GC chain, and other objects are found by
+// following references from collectable objects and arena slots: non-collectable objects which are only referenced by
+// native code are not recorded. This must be called by the thread's native thread; it doesn't allocate any memory from
+// the thread, so it can be used when the thread is close to its memory limit. Returns false if the snapshot could not
+// be written.
+bool elvea_snapshot_write(elvea_thread_t *thread, FILE *file);
+
+// Same as elvea_snapshot_write(), but the snapshot is written to a new file at [path].
+bool elvea_snapshot_save(elvea_thread_t *thread, const char *path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_SNAPSHOT_H
@@ -0,0 +1,827 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/sort.h>
+#include <elvea/variant.h>
+#include <elvea/class.h>
+#include <elvea/string.h>
+#include <elvea/thread.h>
+#include <elvea/utils/alloc.h>
+
+// Below this size, keys are sorted by insertion.
+#define SMALL_SORT 32
+
+// Number of bits per radix sort pass.
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+// Parameters of pdqsort (see O. Peters, "Pattern-defeating Quicksort", 2021).
+#define INSERTION_SORT_THRESHOLD 24
+#define NINTHER_THRESHOLD 128
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+
+// Size of the runs which are sorted by insertion before the merge sort merges them.
+#define MERGE_RUN 16
+
+#define SIGN_BIT (UINT64_C(1) << 63)
+
+// A string with its first 8 bytes as a big-endian integer, so that most comparisons don't touch the string.
+typedef struct string_item_t
+{
+	uint64_t prefix;
+	elvea_variant_t value;
+} string_item_t;
+
+// A variant with a copy of the value it refers to, which is the variant itself unless it is an alias. The copy doesn't
+// hold a reference: it is only used for comparisons, and it avoids following a pointer to the alias at each of them.
+typedef struct generic_item_t
+{
+	elvea_variant_t value;
+	elvea_variant_t key;
+} generic_item_t;
+
+typedef struct generic_sorter_t generic_sorter_t;
+
+typedef int (*item_compare_t)(generic_sorter_t*, const generic_item_t*, const generic_item_t*);
+
+struct generic_sorter_t
+{
+	elvea_thread_t *thread;
+
+	// Comparison function, which is chosen once from the types of the keys.
+	item_compare_t compare;
+
+	// Comparison callback of the class, if all the keys are objects of the same class.
+	elvea_compare_callback_t class_compare;
+};
+
+
+//----------------------------------------------------------------------------------------------------------------------
+// Radix sort for integers and numbers. Each value is mapped to an unsigned key which has the same order, the keys are
+// sorted, and the values are rebuilt from the keys.
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline
+uint64_t int_to_key(elvea_int_t i)
+{
+	return (uint64_t) i ^ SIGN_BIT;
+}
+
+static inline
+elvea_int_t key_to_int(uint64_t key)
+{
+	return (elvea_int_t) (key ^ SIGN_BIT);
+}
+
+// Flip all the bits of negative numbers and the sign bit of positive ones. All NaNs are sorted last.
+static inline
+uint64_t num_to_key(elvea_float_t n)
+{
+	uint64_t bits;
+
+	if (n != n) {
+		return UINT64_MAX;
+	}
+	memcpy(&bits, &n, sizeof bits);
+
+	return (bits & SIGN_BIT) ? ~bits : bits | SIGN_BIT;
+}
+
+static inline
+elvea_float_t key_to_num(uint64_t key)
+{
+	uint64_t bits = (key & SIGN_BIT) ? key ^ SIGN_BIT : ~key;
+	elvea_float_t n;
+	memcpy(&n, &bits, sizeof n);
+
+	return n;
+}
+
+static void insertion_sort_keys(uint64_t *keys, size_t count)
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		uint64_t key = keys[i];
+		size_t j = i;
+
+		for (; j > 0 && keys[j - 1] > key; j--) {
+			keys[j] = keys[j - 1];
+		}
+		keys[j] = key;
+	}
+}
+
+// LSD radix sort. The histograms of all the digits are computed in a single pass, and the passes in which all the keys
+// have the same digit are skipped: this is common in the high bytes of small integers and in the exponent of numbers.
+static void radix_sort(uint64_t *keys, uint64_t *buffer, size_t count)
+{
+	size_t histograms[RADIX_PASSES][RADIX_SIZE];
+	uint64_t *src = keys, *dst = buffer;
+
+	memset(histograms, 0, sizeof histograms);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i];
+
+		for (int pass = 0; pass < RADIX_PASSES; pass++) {
+			histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+		}
+	}
+
+	for (int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		size_t *histogram = histograms[pass];
+		int shift = pass * RADIX_BITS;
+
+		if (histogram[(keys[0] >> shift) & (RADIX_SIZE - 1)] == count) {
+			continue;
+		}
+
+		// Turn the histogram into offsets.
+		size_t offset = 0;
+		for (int digit = 0; digit < RADIX_SIZE; digit++)
+		{
+			size_t n = histogram[digit];
+			histogram[digit] = offset;
+			offset += n;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t key = src[i];
+			dst[histogram[(key >> shift) & (RADIX_SIZE - 1)]++] = key;
+		}
+
+		uint64_t *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != keys) {
+		memcpy(keys, src, count * sizeof(uint64_t));
+	}
+}
+
+static void sort_numeric(elvea_thread_t *thread, elvea_variant_t *variants, size_t count, bool integers)
+{
+	size_t size = (count <= SMALL_SORT ? count : 2 * count) * sizeof(uint64_t);
+	uint64_t *keys = (uint64_t*) elvea_alloc(thread, size);
+	bool sorted = true;
+
+	if (! elvea_check_memory(thread, keys)) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		keys[i] = integers ? int_to_key(elvea_as_int(&variants[i])) : num_to_key(elvea_as_num(&variants[i]));
+		if (i > 0 && keys[i] < keys[i - 1]) sorted = false;
+	}
+
+	if (sorted)
+	{
+		elvea_free(thread, keys, size);
+		return;
+	}
+	if (count <= SMALL_SORT) {
+		insertion_sort_keys(keys, count);
+	}
+	else {
+		radix_sort(keys, keys + count, count);
+	}
+
+	// Integers and numbers don't hold references, so they can be overwritten.
+	for (size_t i = 0; i < count; i++)
+	{
+		if (integers) {
+			elvea_box_int(&variants[i], key_to_int(keys[i]));
+		}
+		else {
+			elvea_box_num(&variants[i], key_to_num(keys[i]));
+		}
+	}
+
+	elvea_free(thread, keys, size);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+// Pattern-defeating quicksort for strings. Strings are compared by their prefix first, and by the rest of their bytes
+// only if the prefixes are equal. This is a refinement of the order of elvea_string_compare().
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline
+uint64_t get_prefix(const elvea_string_t *string)
+{
+	const uint8_t *data = (const uint8_t*) string->data;
+	size_t size = ELVEA_MIN(string->size, 8);
+	uint64_t prefix = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		prefix |= (uint64_t) data[i] << (56 - 8 * i);
+	}
+
+	return prefix;
+}
+
+static inline
+bool string_less(const string_item_t *a, const string_item_t *b)
+{
+	if (a->prefix != b->prefix) {
+		return a->prefix < b->prefix;
+	}
+
+	// The prefixes are padded with nul bytes, so if a string is shorter than 8 bytes, both strings are equal.
+	const elvea_string_t *s = (const elvea_string_t*) elvea_as_object(&a->value);
+	const elvea_string_t *t = (const elvea_string_t*) elvea_as_object(&b->value);
+
+	return s->size >= 8 && t->size >= 8 && strcmp(s->data + 8, t->data + 8) < 0;
+}
+
+static inline
+void swap_items(string_item_t *a, string_item_t *b)
+{
+	string_item_t tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static inline
+void sort2(string_item_t *a, string_item_t *b)
+{
+	if (string_less(b, a)) swap_items(a, b);
+}
+
+static inline
+void sort3(string_item_t *a, string_item_t *b, string_item_t *c)
+{
+	sort2(a, b);
+	sort2(b, c);
+	sort2(a, b);
+}
+
+static void insertion_sort(string_item_t *begin, string_item_t *end)
+{
+	if (begin == end) {
+		return;
+	}
+
+	for (string_item_t *cur = begin + 1; cur != end; cur++)
+	{
+		string_item_t *sift = cur;
+		string_item_t *sift_1 = cur - 1;
+
+		if (string_less(sift, sift_1))
+		{
+			string_item_t tmp = *sift;
+
+			do {
+				*sift-- = *sift_1;
+			} while (sift != begin && string_less(&tmp, --sift_1));
+			*sift = tmp;
+		}
+	}
+}
+
+// Insertion sort which assumes that the element before [begin] is not greater than any element in the range.
+static void unguarded_insertion_sort(string_item_t *begin, string_item_t *end)
+{
+	if (begin == end) {
+		return;
+	}
+
+	for (string_item_t *cur = begin + 1; cur != end; cur++)
+	{
+		string_item_t *sift = cur;
+		string_item_t *sift_1 = cur - 1;
+
+		if (string_less(sift, sift_1))
+		{
+			string_item_t tmp = *sift;
+
+			do {
+				*sift-- = *sift_1;
+			} while (string_less(&tmp, --sift_1));
+			*sift = tmp;
+		}
+	}
+}
+
+// Insertion sort which gives up after moving too many elements. Returns true if the range is sorted.
+static bool partial_insertion_sort(string_item_t *begin, string_item_t *end)
+{
+	size_t limit = 0;
+
+	if (begin == end) {
+		return true;
+	}
+
+	for (string_item_t *cur = begin + 1; cur != end; cur++)
+	{
+		string_item_t *sift = cur;
+		string_item_t *sift_1 = cur - 1;
+
+		if (string_less(sift, sift_1))
+		{
+			string_item_t tmp = *sift;
+
+			do {
+				*sift-- = *sift_1;
+			} while (sift != begin && string_less(&tmp, --sift_1));
+			*sift = tmp;
+			limit += (size_t) (cur - sift);
+		}
+		if (limit > PARTIAL_INSERTION_SORT_LIMIT) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void sift_down(string_item_t *items, size_t start, size_t count)
+{
+	size_t root = start;
+
+	while (2 * root + 1 < count)
+	{
+		size_t child = 2 * root + 1;
+
+		if (child + 1 < count && string_less(&items[child], &items[child + 1])) {
+			child++;
+		}
+		if (! string_less(&items[root], &items[child])) {
+			return;
+		}
+		swap_items(&items[root], &items[child]);
+		root = child;
+	}
+}
+
+static void heap_sort(string_item_t *begin, string_item_t *end)
+{
+	size_t count = (size_t) (end - begin);
+
+	for (size_t i = count / 2; i > 0; i--) {
+		sift_down(begin, i - 1, count);
+	}
+	for (size_t i = count - 1; i > 0; i--)
+	{
+		swap_items(&begin[0], &begin[i]);
+		sift_down(begin, 0, i);
+	}
+}
+
+// Partition the range around its first element, putting the elements which are equal to the pivot on the right.
+// Returns the position of the pivot, and sets [partitioned] if no element had to be moved.
+static string_item_t *partition_right(string_item_t *begin, string_item_t *end, bool *partitioned)
+{
+	string_item_t pivot = *begin;
+	string_item_t *first = begin;
+	string_item_t *last = end;
+
+	// The median of 3 guarantees that there is an element which is not less than the pivot.
+	while (string_less(++first, &pivot));
+
+	// If the first element is the only one which is less than the pivot, we need a guard.
+	if (first - 1 == begin) {
+		while (first < last && ! string_less(--last, &pivot));
+	}
+	else {
+		while (! string_less(--last, &pivot));
+	}
+
+	*partitioned = first >= last;
+
+	while (first < last)
+	{
+		swap_items(first, last);
+		while (string_less(++first, &pivot));
+		while (! string_less(--last, &pivot));
+	}
+
+	string_item_t *pivot_pos = first - 1;
+	*begin = *pivot_pos;
+	*pivot_pos = pivot;
+
+	return pivot_pos;
+}
+
+// Partition the range around its first element, putting the elements which are equal to the pivot on the left. This
+// is used when the pivot is equal to the element before the range, in which case all the elements on the left are
+// equal and don't need to be sorted.
+static string_item_t *partition_left(string_item_t *begin, string_item_t *end)
+{
+	string_item_t pivot = *begin;
+	string_item_t *first = begin;
+	string_item_t *last = end;
+
+	while (string_less(&pivot, --last));
+
+	if (last + 1 == end) {
+		while (first < last && ! string_less(&pivot, ++first));
+	}
+	else {
+		while (! string_less(&pivot, ++first));
+	}
+
+	while (first < last)
+	{
+		swap_items(first, last);
+		while (string_less(&pivot, --last));
+		while (! string_less(&pivot, ++first));
+	}
+
+	string_item_t *pivot_pos = last;
+	*begin = *pivot_pos;
+	*pivot_pos = pivot;
+
+	return pivot_pos;
+}
+
+static void pdqsort(string_item_t *begin, string_item_t *end, int bad_allowed, bool leftmost)
+{
+	for (;;)
+	{
+		size_t size = (size_t) (end - begin);
+
+		if (size < INSERTION_SORT_THRESHOLD)
+		{
+			if (leftmost) {
+				insertion_sort(begin, end);
+			}
+			else {
+				unguarded_insertion_sort(begin, end);
+			}
+			return;
+		}
+
+		// Choose the pivot as the median of 3, or as the pseudo-median of 9 for large ranges, and move it to the front.
+		size_t s2 = size / 2;
+		if (size > NINTHER_THRESHOLD)
+		{
+			sort3(begin, begin + s2, end - 1);
+			sort3(begin + 1, begin + (s2 - 1), end - 2);
+			sort3(begin + 2, begin + (s2 + 1), end - 3);
+			sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1));
+			swap_items(begin, begin + s2);
+		}
+		else
+		{
+			sort3(begin + s2, begin, end - 1);
+		}
+
+		// If the pivot is equal to the element before the range, many elements are probably equal: put them on the
+		// left, where they are already in place.
+		if (! leftmost && ! string_less(begin - 1, begin))
+		{
+			begin = partition_left(begin, end) + 1;
+			continue;
+		}
+
+		bool partitioned;
+		string_item_t *pivot_pos = partition_right(begin, end, &partitioned);
+		size_t l_size = (size_t) (pivot_pos - begin);
+		size_t r_size = (size_t) (end - (pivot_pos + 1));
+
+		if (l_size < size / 8 || r_size < size / 8)
+		{
+			// After too many bad partitions, fall back to heap sort, which is O(n log n) in the worst case.
+			if (--bad_allowed == 0)
+			{
+				heap_sort(begin, end);
+				return;
+			}
+
+			// Break the patterns which lead to bad partitions by swapping a few elements.
+			if (l_size >= INSERTION_SORT_THRESHOLD)
+			{
+				swap_items(begin, begin + l_size / 4);
+				swap_items(pivot_pos - 1, pivot_pos - l_size / 4);
+				if (l_size > NINTHER_THRESHOLD)
+				{
+					swap_items(begin + 1, begin + (l_size / 4 + 1));
+					swap_items(begin + 2, begin + (l_size / 4 + 2));
+					swap_items(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+					swap_items(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+				}
+			}
+			if (r_size >= INSERTION_SORT_THRESHOLD)
+			{
+				swap_items(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+				swap_items(end - 1, end - r_size / 4);
+				if (r_size > NINTHER_THRESHOLD)
+				{
+					swap_items(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+					swap_items(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+					swap_items(end - 2, end - (1 + r_size / 4));
+					swap_items(end - 3, end - (2 + r_size / 4));
+				}
+			}
+		}
+		// If the range was already partitioned, it may be sorted: try an insertion sort which gives up quickly.
+		else if (partitioned && partial_insertion_sort(begin, pivot_pos) && partial_insertion_sort(pivot_pos + 1, end))
+		{
+			return;
+		}
+
+		// Recurse into the left part and loop on the right part.
+		pdqsort(begin, pivot_pos, bad_allowed, leftmost);
+		begin = pivot_pos + 1;
+		leftmost = false;
+	}
+}
+
+static void sort_strings(elvea_thread_t *thread, elvea_variant_t *variants, size_t count)
+{
+	size_t size = count * sizeof(string_item_t);
+	string_item_t *items = (string_item_t*) elvea_alloc(thread, size);
+	int log2 = 0;
+
+	if (! elvea_check_memory(thread, items)) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		items[i].value = variants[i];
+		items[i].prefix = get_prefix((const elvea_string_t*) elvea_as_object(&variants[i]));
+	}
+	for (size_t n = count; n > 1; n >>= 1) {
+		log2++;
+	}
+
+	pdqsort(items, items + count, log2, true);
+
+	// This is a permutation, so the reference counts don't change.
+	for (size_t i = 0; i < count; i++) {
+		variants[i] = items[i].value;
+	}
+
+	elvea_free(thread, items, size);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+// Stable merge sort for everything else.
+//----------------------------------------------------------------------------------------------------------------------
+
+static int compare_variants(generic_sorter_t *sorter, const generic_item_t *a, const generic_item_t *b)
+{
+	return elvea_compare(sorter->thread, (elvea_variant_t*) &a->key, (elvea_variant_t*) &b->key);
+}
+
+static int compare_objects(generic_sorter_t *sorter, const generic_item_t *a, const generic_item_t *b)
+{
+	return sorter->class_compare(sorter->thread, elvea_as_object(&a->key), elvea_as_object(&b->key));
+}
+
+// Integers and numbers are compared directly, in the same order as the radix sort. Only the comparisons between an
+// integer and a number go through elvea_compare().
+static int compare_numbers(generic_sorter_t *sorter, const generic_item_t *a, const generic_item_t *b)
+{
+	if (elvea_check_int(&a->key) && elvea_check_int(&b->key))
+	{
+		elvea_int_t i1 = elvea_as_int(&a->key);
+		elvea_int_t i2 = elvea_as_int(&b->key);
+
+		return (i1 > i2) - (i1 < i2);
+	}
+	if (elvea_check_num(&a->key) && elvea_check_num(&b->key))
+	{
+		uint64_t k1 = num_to_key(elvea_as_num(&a->key));
+		uint64_t k2 = num_to_key(elvea_as_num(&b->key));
+
+		return (k1 > k2) - (k1 < k2);
+	}
+
+	return compare_variants(sorter, a, b);
+}
+
+static inline
+int compare_items(generic_sorter_t *sorter, const generic_item_t *a, const generic_item_t *b)
+{
+	return sorter->compare(sorter, a, b);
+}
+
+static void merge_sort(generic_sorter_t *sorter, generic_item_t *items, generic_item_t *buffer, size_t count)
+{
+	generic_item_t *src = items, *dst = buffer;
+	size_t sorted = 1;
+
+	// Sorted inputs are common, and would otherwise be copied back and forth at each level.
+	while (sorted < count && compare_items(sorter, &items[sorted - 1], &items[sorted]) <= 0) {
+		sorted++;
+	}
+	if (sorted == count) {
+		return;
+	}
+
+	for (size_t start = 0; start < count; start += MERGE_RUN)
+	{
+		size_t end = ELVEA_MIN(start + MERGE_RUN, count);
+
+		for (size_t i = start + 1; i < end; i++)
+		{
+			generic_item_t item = items[i];
+			size_t j = i;
+
+			for (; j > start && compare_items(sorter, &item, &items[j - 1]) < 0; j--) {
+				items[j] = items[j - 1];
+			}
+			items[j] = item;
+		}
+	}
+
+	for (size_t width = MERGE_RUN; width < count; width *= 2)
+	{
+		for (size_t lo = 0; lo < count; lo += 2 * width)
+		{
+			size_t mid = ELVEA_MIN(lo + width, count);
+			size_t hi = ELVEA_MIN(lo + 2 * width, count);
+			size_t i = lo, j = mid, k = lo;
+
+			// Runs which are already in order are copied.
+			if (mid == hi || compare_items(sorter, &src[mid - 1], &src[mid]) <= 0)
+			{
+				memcpy(dst + lo, src + lo, (hi - lo) * sizeof(generic_item_t));
+				continue;
+			}
+
+			// The branch on the comparison is unpredictable, so the next item is selected without it.
+			while (i < mid && j < hi)
+			{
+				size_t right = compare_items(sorter, &src[j], &src[i]) < 0;
+				dst[k++] = *(right ? &src[j] : &src[i]);
+				j += right;
+				i += 1 - right;
+			}
+			memcpy(dst + k, src + i, (mid - i) * sizeof(generic_item_t));
+			memcpy(dst + k + (mid - i), src + j, (hi - j) * sizeof(generic_item_t));
+		}
+
+		generic_item_t *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != items) {
+		memcpy(items, src, count * sizeof(generic_item_t));
+	}
+}
+
+// Types which can be compared with each other.
+static int get_type_group(elvea_variant_t *key)
+{
+	int type = elvea_get_type(key);
+
+	if (type & (ELVEA_TYPE_TRUE | ELVEA_TYPE_FALSE)) {
+		return ELVEA_TYPE_TRUE;
+	}
+	if (type & (ELVEA_TYPE_NUMBER | ELVEA_TYPE_INTEGER)) {
+		return ELVEA_TYPE_NUMBER;
+	}
+
+	return type;
+}
+
+// Raise an error before anything is moved if some keys can't be compared, and choose the comparison function. Returns
+// true if the keys can be sorted.
+static bool check_comparable(generic_sorter_t *sorter, generic_item_t *items, size_t count)
+{
+	elvea_variant_t *first = &items[0].key;
+	int group = get_type_group(first);
+	elvea_class_t *klass = elvea_check_object(first) ? elvea_as_object(first)->isa : NULL;
+
+	for (size_t i = 1; i < count; i++)
+	{
+		elvea_variant_t *key = &items[i].key;
+
+		if (get_type_group(key) != group)
+		{
+			elvea_compare(sorter->thread, first, key);
+			return false;
+		}
+		if (klass && elvea_as_object(key)->isa != klass) {
+			klass = NULL;
+		}
+	}
+
+	if (group == ELVEA_TYPE_OBJECT && elvea_as_object(first)->isa->compare == NULL)
+	{
+		elvea_compare(sorter->thread, first, first);
+		return false;
+	}
+
+	if (klass)
+	{
+		sorter->class_compare = klass->compare;
+		sorter->compare = compare_objects;
+	}
+	else if (group == ELVEA_TYPE_NUMBER) {
+		sorter->compare = compare_numbers;
+	}
+	else {
+		sorter->compare = compare_variants;
+	}
+
+	return true;
+}
+
+static void sort_generic(elvea_thread_t *thread, elvea_variant_t *variants, size_t count)
+{
+	size_t size = 2 * count * sizeof(generic_item_t);
+	generic_item_t *items = (generic_item_t*) elvea_alloc(thread, size);
+	generic_sorter_t sorter;
+
+	if (! elvea_check_memory(thread, items)) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		elvea_variant_t *key = &variants[i];
+		elvea_resolve_alias(thread, &key);
+		items[i].value = variants[i];
+		items[i].key = *key;
+	}
+
+	sorter.thread = thread;
+	if (check_comparable(&sorter, items, count))
+	{
+		merge_sort(&sorter, items, items + count, count);
+
+		for (size_t i = 0; i < count; i++) {
+			variants[i] = items[i].value;
+		}
+	}
+
+	elvea_free(thread, items, size);
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void elvea_sort(elvea_thread_t *thread, elvea_variant_t *variants, size_t count)
+{
+	elvea_class_t *klass = NULL;
+	bool same_class = true;
+	bool ropes = false;
+	int types = 0;
+
+	if (count < 2) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		types |= elvea_get_type(&variants[i]);
+
+		if (elvea_check_object(&variants[i]))
+		{
+			elvea_object_t *object = elvea_as_object(&variants[i]);
+			elvea_class_t *isa = object->isa;
+			if (klass == NULL) klass = isa;
+			else if (isa != klass) same_class = false;
+
+			// The string sort reads the bytes of flat strings directly.
+			if (isa == thread->string_class) ropes |= elvea_string_is_rope((elvea_string_t*) object);
+		}
+	}
+
+	if (types == ELVEA_TYPE_INTEGER) {
+		sort_numeric(thread, variants, count, true);
+	}
+	else if (types == ELVEA_TYPE_NUMBER) {
+		sort_numeric(thread, variants, count, false);
+	}
+	else if (types == ELVEA_TYPE_OBJECT && same_class && klass == thread->string_class && ! ropes) {
+		sort_strings(thread, variants, count);
+	}
+	else {
+		sort_generic(thread, variants, count);
+	}
+}
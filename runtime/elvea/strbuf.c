@@ -0,0 +1,407 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <elvea/strbuf.h>
+#include <elvea/string.h>
+#include <elvea/rope.h>
+#include <elvea/class.h>
+#include <elvea/thread.h>
+#include <elvea/utils/alloc.h>
+
+// Capacity of the string when the builder doesn't get a hint.
+#define MIN_CAPACITY 64
+
+// Chunks grow with the builder up to this size, so that the memory which is allocated but unused stays bounded.
+#define MAX_CHUNK_SIZE (1024 * 1024)
+
+// Enough for any integer, or for any number printed with 17 significant digits.
+#define NUMBER_SIZE 32
+
+// Numbers with at most this many digits after the decimal point are formatted without snprintf().
+#define MAX_FRACTION_DIGITS 8
+
+static const elvea_float_t POWERS_OF_TEN[MAX_FRACTION_DIGITS + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+
+struct elvea_strbuf_chunk_t
+{
+	elvea_strbuf_chunk_t *next;
+
+	// Number of bytes used.
+	size_t size;
+
+	// Number of bytes allocated after the header.
+	size_t capacity;
+
+	// Beginning of the char data (more is allocated after that).
+	char data[1];
+};
+
+#define CHUNK_HEADER_SIZE offsetof(elvea_strbuf_chunk_t, data)
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static
+void free_chunks(elvea_thread_t *thread, elvea_strbuf_t *self)
+{
+	elvea_strbuf_chunk_t *chunk = self->first_chunk;
+
+	while (chunk)
+	{
+		elvea_strbuf_chunk_t *next = chunk->next;
+		elvea_free(thread, chunk, CHUNK_HEADER_SIZE + chunk->capacity);
+		chunk = next;
+	}
+	self->first_chunk = self->last_chunk = NULL;
+}
+
+static
+void reset(elvea_strbuf_t *self, size_t capacity)
+{
+	self->string = NULL;
+	self->first_chunk = self->last_chunk = NULL;
+	self->cursor = self->end = NULL;
+	self->size = 0;
+	self->capacity = capacity;
+	self->failed = false;
+}
+
+// Record the number of bytes used in the string or in the last chunk.
+static
+void close_piece(elvea_strbuf_t *self)
+{
+	if (self->last_chunk) {
+		self->last_chunk->size = (size_t) (self->cursor - self->last_chunk->data);
+	}
+	else if (self->string) {
+		self->string->size = (elvea_size_t) (self->cursor - self->string->data);
+	}
+}
+
+// Make room for at least [count] more bytes, after the free space in the current piece has been used up.
+static
+bool grow(elvea_thread_t *thread, elvea_strbuf_t *self, size_t count)
+{
+	if (self->failed) {
+		return false;
+	}
+	if (ELVEA_NPOS - 1 - self->size < count)
+	{
+		elvea_throw(thread, ELVEA_ERROR_INDEX, "string capacity exceeded");
+		self->failed = true;
+		return false;
+	}
+
+	if (self->string == NULL)
+	{
+		size_t capacity = ELVEA_MAX(ELVEA_MAX(self->capacity, count), MIN_CAPACITY);
+		elvea_string_t *string = elvea_string_alloc(thread, (elvea_size_t) (capacity + 1));
+
+		if (! elvea_check_memory(thread, string))
+		{
+			self->failed = true;
+			return false;
+		}
+		self->string = string;
+		self->capacity = capacity;
+		self->cursor = string->data;
+		self->end = string->data + capacity;
+
+		return true;
+	}
+
+	size_t capacity = ELVEA_MAX(count, ELVEA_MIN(self->size, MAX_CHUNK_SIZE));
+	elvea_strbuf_chunk_t *chunk = (elvea_strbuf_chunk_t*) elvea_alloc(thread, CHUNK_HEADER_SIZE + capacity);
+
+	if (! elvea_check_memory(thread, chunk))
+	{
+		self->failed = true;
+		return false;
+	}
+
+	close_piece(self);
+	chunk->next = NULL;
+	chunk->size = 0;
+	chunk->capacity = capacity;
+	if (self->last_chunk) {
+		self->last_chunk->next = chunk;
+	}
+	else {
+		self->first_chunk = chunk;
+	}
+	self->last_chunk = chunk;
+	self->cursor = chunk->data;
+	self->end = chunk->data + capacity;
+
+	return true;
+}
+
+// Get a pointer to [count] contiguous free bytes, or NULL.
+static inline
+char *reserve(elvea_thread_t *thread, elvea_strbuf_t *self, size_t count)
+{
+	if ((size_t) (self->end - self->cursor) < count && ! grow(thread, self, count)) {
+		return NULL;
+	}
+
+	return self->cursor;
+}
+
+static inline
+void commit(elvea_strbuf_t *self, size_t count)
+{
+	self->cursor += count;
+	self->size += count;
+}
+
+// Write the digits of an integer backwards, ending before [end]. Returns a pointer to the first digit.
+static
+char *format_digits(char *end, uint64_t n, int min_digits)
+{
+	char *p = end;
+
+	do {
+		*--p = (char) ('0' + n % 10);
+		n /= 10;
+	} while (n > 0 || end - p < min_digits);
+
+	return p;
+}
+
+// Format a number which is exactly m / 10^k for a small k, such as a price or an integer, in fixed notation. This is
+// what "%.17g" prints once the digits which are not needed to read the number back are removed. Returns the length,
+// or 0 if the number needs snprintf().
+static
+int format_fixed(char *buffer, elvea_float_t n)
+{
+	elvea_float_t magnitude = fabs(n);
+
+	// Outside of this range, "%g" uses the exponent notation. This also excludes zero and NaN.
+	if (! (magnitude >= 1e-4 && magnitude < 1e15)) {
+		return 0;
+	}
+
+	for (int k = 0; k <= MAX_FRACTION_DIGITS; k++)
+	{
+		// Below 2^52, numbers are closer to each other than decimals with k digits after the point, so at most one of
+		// those decimals reads back to the number.
+		elvea_float_t scaled = magnitude * POWERS_OF_TEN[k];
+		if (scaled >= 4503599627370496.0) {
+			return 0;
+		}
+
+		// Division by a power of ten is correctly rounded, so if it gives the number back, so does strtod().
+		uint64_t m = (uint64_t) (scaled + 0.5);
+		if ((elvea_float_t) m / POWERS_OF_TEN[k] == magnitude)
+		{
+			char digits[NUMBER_SIZE];
+			char *end = digits + NUMBER_SIZE;
+			uint64_t unit = (uint64_t) POWERS_OF_TEN[k];
+			char *p = end;
+
+			if (k > 0)
+			{
+				p = format_digits(p, m % unit, k);
+				*--p = '.';
+			}
+			p = format_digits(p, m / unit, 1);
+			if (n < 0) *--p = '-';
+
+			memcpy(buffer, p, (size_t) (end - p));
+			return (int) (end - p);
+		}
+	}
+
+	return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void elvea_strbuf_init(elvea_thread_t *thread, elvea_strbuf_t *self, size_t capacity)
+{
+	reset(self, capacity);
+}
+
+void elvea_strbuf_append(elvea_thread_t *thread, elvea_strbuf_t *self, const char *data, elvea_index_t len)
+{
+	size_t size = (len < 0) ? strlen(data) : (size_t) len;
+	size_t available = (size_t) (self->end - self->cursor);
+
+	if (size == 0) {
+		return;
+	}
+
+	// Fill the current piece, and put the rest in a new chunk.
+	if (size > available)
+	{
+		if (available > 0)
+		{
+			memcpy(self->cursor, data, available);
+			commit(self, available);
+			data += available;
+			size -= available;
+		}
+		if (! grow(thread, self, size)) {
+			return;
+		}
+	}
+
+	memcpy(self->cursor, data, size);
+	commit(self, size);
+}
+
+void elvea_strbuf_append_char(elvea_thread_t *thread, elvea_strbuf_t *self, char c)
+{
+	char *p = reserve(thread, self, 1);
+
+	if (p)
+	{
+		*p = c;
+		commit(self, 1);
+	}
+}
+
+void elvea_strbuf_append_string(elvea_thread_t *thread, elvea_strbuf_t *self, const elvea_string_t *string)
+{
+	if (elvea_string_is_rope(string))
+	{
+		elvea_rope_iter_t iter;
+		const char *data;
+		elvea_size_t size;
+
+		elvea_rope_iter_init(&iter, string->rope, 0);
+		while (elvea_rope_iter_next(&iter, &data, &size)) {
+			elvea_strbuf_append(thread, self, data, size);
+		}
+	}
+	else
+	{
+		elvea_strbuf_append(thread, self, string->data, string->size);
+	}
+}
+
+void elvea_strbuf_append_int(elvea_thread_t *thread, elvea_strbuf_t *self, elvea_int_t i)
+{
+	char digits[NUMBER_SIZE];
+
+	// Work on the magnitude as an unsigned integer, which can represent the magnitude of INT64_MIN.
+	char *p = format_digits(digits + NUMBER_SIZE, (i < 0) ? 0 - (uint64_t) i : (uint64_t) i, 1);
+
+	if (i < 0) {
+		*--p = '-';
+	}
+
+	elvea_strbuf_append(thread, self, p, digits + NUMBER_SIZE - p);
+}
+
+void elvea_strbuf_append_num(elvea_thread_t *thread, elvea_strbuf_t *self, elvea_float_t n)
+{
+	char *p = reserve(thread, self, NUMBER_SIZE);
+	int len;
+
+	if (p == NULL) {
+		return;
+	}
+
+	len = format_fixed(p, n);
+
+	// Otherwise, find the smallest precision which gives the number back. Most numbers need 15 digits at most.
+	if (len == 0)
+	{
+		for (int precision = 15; precision <= 17; precision++)
+		{
+			len = snprintf(p, NUMBER_SIZE, "%.*g", precision, n);
+			if (n != n || strtod(p, NULL) == n) {
+				break;
+			}
+		}
+	}
+
+	commit(self, (size_t) len);
+}
+
+size_t elvea_strbuf_size(const elvea_strbuf_t *self)
+{
+	return self->size;
+}
+
+elvea_string_t *elvea_strbuf_finish(elvea_thread_t *thread, elvea_strbuf_t *self)
+{
+	elvea_string_t *string = self->string;
+	size_t size = self->size;
+
+	if (self->failed)
+	{
+		elvea_strbuf_clear(thread, self);
+		return NULL;
+	}
+	if (string == NULL) {
+		return elvea_string_alloc(thread, 1);
+	}
+
+	close_piece(self);
+
+	if (size != self->capacity)
+	{
+		elvea_size_t byte_count = thread->string_class->alloc_size + (elvea_size_t) size + 1;
+		elvea_string_t *tmp = (elvea_string_t*) elvea_renew(thread, string, byte_count);
+
+		if (! elvea_check_memory(thread, tmp))
+		{
+			elvea_strbuf_clear(thread, self);
+			return NULL;
+		}
+		string = tmp;
+		string->capacity = (elvea_size_t) size + 1;
+	}
+
+	char *data = string->data + string->size;
+	for (elvea_strbuf_chunk_t *chunk = self->first_chunk; chunk != NULL; chunk = chunk->next)
+	{
+		memcpy(data, chunk->data, chunk->size);
+		data += chunk->size;
+	}
+	free_chunks(thread, self);
+
+	// The string was allocated empty, so its cached hash and UTF-8 size are not set.
+	string->size = (elvea_size_t) size;
+	string->data[size] = '\0';
+	reset(self, 0);
+
+	return string;
+}
+
+void elvea_strbuf_clear(elvea_thread_t *thread, elvea_strbuf_t *self)
+{
+	free_chunks(thread, self);
+
+	if (self->string) {
+		elvea_delete(thread, self->string);
+	}
+	reset(self, 0);
+}
@@ -0,0 +1,98 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: string builder.                                                                                            *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_STRBUF_H
+#define ELVEA_STRBUF_H
+
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct elvea_strbuf_chunk_t elvea_strbuf_chunk_t;
+
+// A string builder, which collects pieces and creates a string from them at the end. The first bytes are written
+// directly in the string which will be returned. When it is full, the following bytes go into a list of chunks whose
+// size grows with the builder, so appending never moves the bytes which were already written. The builder doesn't hold
+// references and is usually allocated on the stack.
+typedef struct elvea_strbuf_t
+{
+	// String which holds the first bytes. It is not referenced until the builder is finished.
+	elvea_string_t *string;
+
+	// Chunks which hold the bytes which didn't fit in the string, from the first to the last.
+	elvea_strbuf_chunk_t *first_chunk;
+	elvea_strbuf_chunk_t *last_chunk;
+
+	// Free space in the string or in the last chunk.
+	char *cursor;
+	char *end;
+
+	// Total number of bytes.
+	size_t size;
+
+	// Capacity of the string, excluding the nul terminator.
+	size_t capacity;
+
+	// Whether an allocation failed. Further appends are ignored and finishing the builder returns NULL.
+	bool failed;
+} elvea_strbuf_t;
+
+
+// Initialize a builder. [capacity] is the expected size of the result: if it is large enough, the builder only
+// allocates the string. Nothing is allocated until the first append.
+void elvea_strbuf_init(elvea_thread_t *thread, elvea_strbuf_t *self, size_t capacity);
+
+// Append raw bytes. If [len] is negative, the length is computed with strlen().
+void elvea_strbuf_append(elvea_thread_t *thread, elvea_strbuf_t *self, const char *data, elvea_index_t len);
+
+// Append a single byte.
+void elvea_strbuf_append_char(elvea_thread_t *thread, elvea_strbuf_t *self, char c);
+
+// Append the content of a string.
+void elvea_strbuf_append_string(elvea_thread_t *thread, elvea_strbuf_t *self, const elvea_string_t *string);
+
+// Append an integer in decimal.
+void elvea_strbuf_append_int(elvea_thread_t *thread, elvea_strbuf_t *self, elvea_int_t i);
+
+// Append a number with the fewest digits which read back to the same number.
+void elvea_strbuf_append_num(elvea_thread_t *thread, elvea_strbuf_t *self, elvea_float_t n);
+
+// Get the number of bytes which have been appended.
+size_t elvea_strbuf_size(const elvea_strbuf_t *self);
+
+// Create a string from the builder's content and reset the builder. The builder's string is resized to the exact size
+// and returned: if everything fitted in it, nothing is copied. Otherwise, the chunks are copied after its first bytes.
+// Returns NULL if an allocation failed.
+elvea_string_t *elvea_strbuf_finish(elvea_thread_t *thread, elvea_strbuf_t *self);
+
+// Discard the builder's content and free its memory.
+void elvea_strbuf_clear(elvea_thread_t *thread, elvea_strbuf_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_STRBUF_H
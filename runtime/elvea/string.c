@@ -24,70 +24,14 @@
 
 #include <string.h>
 #include <elvea/string.h>
+#include <elvea/rope.h>
+#include <elvea/hash.h>
 #include <elvea/thread.h>
 #include <elvea/utils/helpers.h>
 #include <elvea/utils/alloc.h>
 #include <elvea/third_party/utf8.h>
 
 
-//----------------------------------------------------------------------------------------------------------------------
-
-// MurmurHash2 is released to the public domain by Austin Appleby
-
-static
-uint32_t murmur_hash32(const void *key, uint32_t len, uint32_t seed)
-{
-	// 'm' and 'r' are mixing constants generated offline.
-	// They're not really 'magic', they just happen to work well.
-
-	const unsigned int m = 0x5bd1e995;
-	const int r = 24;
-
-	// Initialize the hash to a 'random' value
-
-	uint32_t h = seed ^len;
-
-	// Mix 4 bytes at a time into the hash
-
-	const unsigned char *data = (const unsigned char *) key;
-
-	while (len >= 4) {
-		unsigned int k = *(unsigned int *) data;
-
-		k *= m;
-		k ^= k >> r;
-		k *= m;
-
-		h *= m;
-		h ^= k;
-
-		data += 4;
-		len -= 4;
-	}
-
-	// Handle the last few bytes of the input array
-
-	switch (len) {
-		case 3:
-			h ^= data[2] << 16;
-		case 2:
-			h ^= data[1] << 8;
-		case 1:
-			h ^= data[0];
-			h *= m;
-	};
-
-	// Do a few final mixes of the hash to ensure the last few
-	// bytes are well-incorporated.
-
-	h ^= h >> 13;
-	h *= m;
-	h ^= h >> 15;
-
-	return h;
-}
-
-
 //----------------------------------------------------------------------------------------------------------------------
 
 static
@@ -112,6 +56,7 @@ void reset_cache(elvea_string_t *self)
 static
 void update_size(elvea_string_t *self, elvea_size_t size)
 {
+	self->size = size;
 	self->data[size] = '\0';
 	self->hash = ELVEA_NPOS;
 	self->utf8_size = ELVEA_NPOS;
@@ -126,6 +71,9 @@ enum {
 static
 void trim_string(elvea_thread_t *thread, elvea_string_t **alias, int option)
 {
+	if (! elvea_string_flatten(thread, alias)) {
+		return;
+	}
 	elvea_string_t *self = *alias;
 	const char *str = self->data;
 	elvea_size_t start = 0;
@@ -202,11 +150,14 @@ bool reserve(elvea_thread_t *thread, elvea_string_t **alias, elvea_size_t capaci
 	else if (capacity > (self)->capacity)
 	{
 		elvea_size_t byte_count = thread->string_class->alloc_size + capacity;
-		elvea_string_t *tmp = (elvea_string_t*) elvea_realloc(thread, self, byte_count);
+		elvea_string_t *tmp = (elvea_string_t*) elvea_renew(thread, self, byte_count);
 
-		if (elvea_check_memory(thread, tmp)) {
-			*alias = tmp;
+		if (! elvea_check_memory(thread, tmp)) {
+			return false;
 		}
+
+		tmp->capacity = capacity;
+		*alias = tmp;
 	}
 
 	return true;
@@ -232,14 +183,225 @@ elvea_size_t normalize_offset(elvea_thread_t *thread, elvea_size_t size, elvea_i
 	return ELVEA_NPOS;
 }
 
+// Capacity of the char array of a rope, which only holds the nul terminator.
+#define ROPE_CAPACITY 1
+
+// Get a reference to a rope which holds the content of a string, or NULL if the string is empty. Ropes are shared
+// between the strings of a thread, but not with other threads since their reference counts are not atomic.
+static
+bool get_rope(elvea_thread_t *thread, const elvea_string_t *self, elvea_rope_t **rope)
+{
+	*rope = NULL;
+
+	if (self->rope != NULL && self->base.isa->thread == thread)
+	{
+		elvea_rope_retain(self->rope);
+		*rope = self->rope;
+	}
+	else if (self->rope != NULL)
+	{
+		char *buffer = (char*) elvea_alloc(thread, self->size);
+
+		if (! elvea_check_memory(thread, buffer)) {
+			return false;
+		}
+		elvea_rope_copy(self->rope, 0, buffer, self->size);
+		*rope = elvea_rope_new(thread, buffer, self->size);
+		elvea_free(thread, buffer, self->size);
+	}
+	else if (self->size > 0)
+	{
+		*rope = elvea_rope_new(thread, self->data, self->size);
+	}
+
+	return self->size == 0 || *rope != NULL;
+}
+
+// Replace the content of a string with a rope, whose reference is taken over. If the string is shared, it is replaced
+// by a new string.
+static
+bool set_rope(elvea_thread_t *thread, elvea_string_t **alias, elvea_rope_t *rope)
+{
+	elvea_string_t *self = *alias;
+
+	if (elvea_is_shared(self))
+	{
+		self = elvea_string_alloc(thread, ROPE_CAPACITY);
+
+		if (! elvea_check_memory(thread, self))
+		{
+			elvea_rope_release(thread, rope);
+			return false;
+		}
+		elvea_object_retain(thread, self);
+		elvea_object_release(thread, *alias);
+	}
+	else if (self->capacity > ROPE_CAPACITY)
+	{
+		// The char data is not needed anymore.
+		elvea_size_t byte_count = thread->string_class->alloc_size + ROPE_CAPACITY;
+		elvea_string_t *tmp = (elvea_string_t*) elvea_renew(thread, self, byte_count);
+
+		if (! elvea_check_memory(thread, tmp))
+		{
+			elvea_rope_release(thread, rope);
+			return false;
+		}
+		self = tmp;
+		self->capacity = ROPE_CAPACITY;
+	}
+
+	elvea_rope_release(thread, self->rope);
+	self->rope = rope;
+	update_size(self, 0);
+	self->size = elvea_rope_size(rope);
+	*alias = self;
+
+	return true;
+}
+
+// Insert bytes in a string which is (or is about to become) a rope.
+static
+void insert_rope(elvea_thread_t *thread, elvea_string_t **alias, elvea_size_t at, const char *str, elvea_size_t size)
+{
+	elvea_rope_t *rope, *result;
+
+	if (! get_rope(thread, *alias, &rope)) {
+		return;
+	}
+	result = elvea_rope_insert(thread, rope, at, str, size);
+	elvea_rope_release(thread, rope);
+
+	// The error has already been reported if the rope couldn't be created.
+	if (result != NULL) {
+		set_rope(thread, alias, result);
+	}
+}
+
+// Iterator over the chunks of a string. A flat string has a single chunk.
+typedef struct chunk_iter_t
+{
+	elvea_rope_iter_t rope;
+	const char *data;
+	elvea_size_t size;
+} chunk_iter_t;
+
+static
+void init_chunks(chunk_iter_t *iter, const elvea_string_t *self, elvea_size_t offset)
+{
+	if (self->rope != NULL)
+	{
+		elvea_rope_iter_init(&iter->rope, self->rope, offset);
+		iter->size = 0;
+	}
+	else
+	{
+		iter->rope.leaf = NULL;
+		iter->data = self->data + offset;
+		iter->size = self->size - offset;
+	}
+}
+
+static
+bool next_chunk(chunk_iter_t *iter, const char **data, elvea_size_t *size)
+{
+	if (iter->size > 0)
+	{
+		*data = iter->data;
+		*size = iter->size;
+		iter->size = 0;
+
+		return true;
+	}
+
+	return elvea_rope_iter_next(&iter->rope, data, size);
+}
+
+// Check whether [count] bytes match the bytes of a string starting at a given offset, which must be within range.
+static
+bool match_bytes(const elvea_string_t *self, elvea_size_t offset, const char *str, elvea_size_t count)
+{
+	chunk_iter_t iter;
+	const char *data;
+	elvea_size_t size;
+
+	init_chunks(&iter, self, offset);
+	while (count > 0 && next_chunk(&iter, &data, &size))
+	{
+		size = ELVEA_MIN(size, count);
+		if (memcmp(data, str, size) != 0) {
+			return false;
+		}
+		str += size;
+		count -= size;
+	}
+
+	return true;
+}
+
+// Compare the content of two strings with the semantics of strcmp(), without flattening them.
+static
+int compare_chunks(const elvea_string_t *self, const elvea_string_t *other)
+{
+	chunk_iter_t it1, it2;
+	const char *s1 = NULL, *s2 = NULL;
+	elvea_size_t n1 = 0, n2 = 0;
+
+	init_chunks(&it1, self, 0);
+	init_chunks(&it2, other, 0);
+
+	for (;;)
+	{
+		if (n1 == 0) next_chunk(&it1, &s1, &n1);
+		if (n2 == 0) next_chunk(&it2, &s2, &n2);
+
+		// The end of a string behaves like its nul terminator.
+		if (n1 == 0 || n2 == 0) {
+			return (n1 == 0 && n2 == 0) ? 0 : (n1 == 0) ? -(*s2 != '\0') : (*s1 != '\0');
+		}
+		elvea_size_t count = ELVEA_MIN(n1, n2);
+		const char *nul = (const char*) memchr(s1, '\0', count);
+		if (nul) count = (elvea_size_t) (nul - s1) + 1;
+
+		int result = memcmp(s1, s2, count);
+		if (result != 0 || nul) {
+			return result;
+		}
+		s1 += count;
+		s2 += count;
+		n1 -= count;
+		n2 -= count;
+	}
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
+// This is the size of the string's own block: the nodes of a rope may be shared between strings, so they are counted
+// separately (see elvea_string_footprint()).
+static
+size_t get_size(elvea_thread_t *thread, const elvea_string_t *self)
+{
+	return thread->string_class->alloc_size + self->capacity;
+}
+
 void elvea_string_init_class(elvea_class_t *klass)
 {
 	klass->hash = (elvea_hash_callback_t) elvea_string_hash;
 	klass->equal = (elvea_equal_callback_t) elvea_string_equal;
 	klass->compare = (elvea_compare_callback_t) elvea_string_compare;
 	klass->clone = (elvea_clone_callback_t) elvea_string_clone;
+	klass->size = (elvea_size_callback_t) get_size;
+	klass->finalize = (elvea_finalize_callback_t) elvea_string_finalize;
+}
+
+void elvea_string_finalize(elvea_thread_t *thread, elvea_string_t *self)
+{
+	elvea_rope_release(thread, self->rope);
+}
+
+size_t elvea_string_footprint(const elvea_string_t *self)
+{
+	return self->rope ? elvea_rope_footprint(self->rope) : 0;
 }
 
 elvea_string_t *elvea_string_new(elvea_thread_t *thread, const char *str, elvea_index_t len)
@@ -254,6 +416,7 @@ elvea_string_t *elvea_string_new(elvea_thread_t *thread, const char *str, elvea_
 
 	self->size = size;
 	self->capacity = capacity;
+	self->rope = NULL;
 	strncpy(self->data, str, size);
 	update_size(self, size);
 
@@ -270,6 +433,7 @@ elvea_string_t *elvea_string_alloc(elvea_thread_t *thread, elvea_size_t capacity
 
 	self->size = 0;
 	self->capacity = capacity;
+	self->rope = NULL;
 	update_size(self, 0);
 
 	return self;
@@ -282,7 +446,29 @@ bool elvea_string_is_valid(elvea_thread_t *thread, elvea_string_t *self)
 	if (self->utf8_size == ELVEA_NPOS)
 	{
 		elvea_size_t size;
-		ok = utf8_strlen(self->data, self->size, &size);
+
+		if (self->rope != NULL)
+		{
+			// The decoder's state carries over from one chunk to the next.
+			elvea_rope_iter_t iter;
+			const char *data;
+			elvea_size_t count;
+			uint32_t state = UTF8_ACCEPT, codepoint;
+
+			size = 0;
+			elvea_rope_iter_init(&iter, self->rope, 0);
+			while (elvea_rope_iter_next(&iter, &data, &count))
+			{
+				for (elvea_size_t i = 0; i < count; i++) {
+					size += (utf8_decode(&state, &codepoint, (uint8_t) data[i]) == UTF8_ACCEPT);
+				}
+			}
+			ok = (state == UTF8_ACCEPT);
+		}
+		else
+		{
+			ok = utf8_strlen(self->data, self->size, &size);
+		}
 
 		if (ok) {
 			self->utf8_size = size;
@@ -303,8 +489,22 @@ elvea_index_t elvea_string_length(elvea_thread_t *thread, elvea_string_t *self)
 
 elvea_size_t elvea_string_hash(elvea_thread_t *thread, elvea_string_t *self)
 {
-	if (self->hash == ELVEA_NPOS) {
-		self->hash = murmur_hash32(self->data, self->size, thread->seed);
+	if (self->hash == ELVEA_NPOS && self->rope != NULL)
+	{
+		elvea_hash_stream_t stream;
+		elvea_rope_iter_t iter;
+		const char *data;
+		elvea_size_t count;
+
+		elvea_hash_stream_init(thread, &stream, self->size);
+		elvea_rope_iter_init(&iter, self->rope, 0);
+		while (elvea_rope_iter_next(&iter, &data, &count)) {
+			elvea_hash_stream_update(&stream, data, count);
+		}
+		self->hash = elvea_hash_stream_final(&stream);
+	}
+	else if (self->hash == ELVEA_NPOS) {
+		self->hash = elvea_hash_data(thread, self->data, self->size);
 	}
 
 	return self->hash;
@@ -317,6 +517,9 @@ bool elvea_string_starts_with(elvea_thread_t *thread, const elvea_string_t *self
 	if (prefix_size > self->size) {
 		return false;
 	}
+	if (self->rope != NULL) {
+		return match_bytes(self, 0, prefix, prefix_size);
+	}
 
 	return (prefix_size <= self->size) && strncmp(self->data, prefix, prefix_size) == 0;
 
@@ -329,6 +532,9 @@ bool elvea_string_ends_with(elvea_thread_t *thread, const elvea_string_t *self,
 	if (suffix_size > self->size) {
 		return false;
 	}
+	if (self->rope != NULL) {
+		return match_bytes(self, self->size - suffix_size, suffix, suffix_size);
+	}
 	const char *start = self->data + self->size - suffix_size;
 
 	return strncmp(start, suffix, suffix_size) == 0;
@@ -348,6 +554,21 @@ elvea_index_t elvea_string_find(elvea_thread_t *thread, const elvea_string_t *se
 	if (self->size == 0 || self->size >= substring_size) {
 		return 0;
 	}
+	if (self->rope != NULL)
+	{
+		// Search in a flat copy, without changing the string.
+		char *data = (char*) elvea_alloc(thread, self->size + 1);
+
+		if (! elvea_check_memory(thread, data)) {
+			return 0;
+		}
+		elvea_rope_copy(self->rope, 0, data, self->size);
+		data[self->size] = '\0';
+		const char *found = strstr(data, substring);
+		elvea_free(thread, data, self->size + 1);
+
+		return (found == NULL) ? 0 : (elvea_index_t)(found - data);
+	}
 	const char *found = strstr(self->data, substring);
 
 	if (found == NULL) {
@@ -377,6 +598,12 @@ void elvea_string_append(elvea_thread_t *thread, elvea_string_t **alias, const c
 {
 	elvea_string_t *self = *alias;
 	elvea_size_t str_size = check_length(thread, str, len);
+
+	if (self->rope != NULL)
+	{
+		if (str_size > 0) insert_rope(thread, alias, self->size, str, str_size);
+		return;
+	}
 	elvea_size_t new_size = self->size + str_size;
 	elvea_size_t new_capacity = (self->capacity > new_size) ? self->capacity : get_next_capacity(new_size + 1);
 
@@ -419,6 +646,15 @@ void elvea_string_insert(elvea_thread_t *thread, elvea_string_t **alias, elvea_i
 	elvea_string_t *self = *alias;
 	elvea_size_t at = normalize_offset(thread, self->size, offset);
 	elvea_size_t current_size = self->size;
+
+	if (at == ELVEA_NPOS) {
+		return;
+	}
+	if (self->rope != NULL || current_size + str_size >= ELVEA_STRING_ROPE_THRESHOLD)
+	{
+		insert_rope(thread, alias, at, str, str_size);
+		return;
+	}
 	elvea_size_t new_capacity = current_size + str_size + 1;
 	bool ok = reserve(thread, &self, new_capacity, true);
 	if (!ok) return;
@@ -436,6 +672,10 @@ void elvea_string_insert(elvea_thread_t *thread, elvea_string_t **alias, elvea_i
 
 bool elvea_string_equal(elvea_thread_t *thread, const elvea_string_t *self, const elvea_string_t *other)
 {
+	if (self->rope != NULL || other->rope != NULL) {
+		return (self == other) || (self->size == other->size && compare_chunks(self, other) == 0);
+	}
+
 	return (self == other) || (self->size == other->size && strncmp(self->data, other->data, self->size) == 0);
 }
 
@@ -443,10 +683,137 @@ bool elvea_string_equal(elvea_thread_t *thread, const elvea_string_t *self, cons
 int elvea_string_compare(elvea_thread_t *thread, const elvea_string_t *self, const elvea_string_t *other)
 {
 	// TODO : use codepoints instead of bytes for string comparison
+	if (self->rope != NULL || other->rope != NULL) {
+		return compare_chunks(self, other);
+	}
+
 	return strcmp(self->data, other->data);
 }
 
 elvea_string_t *elvea_string_clone(elvea_thread_t *thread, const elvea_string_t *self)
 {
+	if (self->rope != NULL)
+	{
+		// The nodes are immutable, so the copy can share them.
+		elvea_string_t *clone = elvea_string_alloc(thread, ROPE_CAPACITY);
+		elvea_rope_t *rope;
+
+		if (! elvea_check_memory(thread, clone)) {
+			return NULL;
+		}
+		if (! get_rope(thread, self, &rope))
+		{
+			elvea_delete(thread, clone);
+			return NULL;
+		}
+		clone->rope = rope;
+		clone->size = self->size;
+
+		return clone;
+	}
+
 	return elvea_string_new(thread, self->data, self->size);
+}
+
+elvea_string_t *elvea_string_concat(elvea_thread_t *thread, const elvea_string_t *first, const elvea_string_t *second)
+{
+	if (ELVEA_ARCH64 && (size_t) first->size + second->size >= ELVEA_NPOS)
+	{
+		elvea_throw(thread, ELVEA_ERROR_INDEX, "string capacity exceeded");
+		return NULL;
+	}
+	elvea_size_t size = first->size + second->size;
+
+	if (size < ELVEA_STRING_ROPE_THRESHOLD)
+	{
+		elvea_string_t *self = elvea_string_alloc(thread, get_next_capacity(size + 1));
+
+		if (! elvea_check_memory(thread, self)) {
+			return NULL;
+		}
+		elvea_string_read(first, 0, self->data, first->size);
+		elvea_string_read(second, 0, self->data + first->size, second->size);
+		update_size(self, size);
+
+		return self;
+	}
+
+	elvea_string_t *self = elvea_string_alloc(thread, ROPE_CAPACITY);
+	elvea_rope_t *left = NULL, *right = NULL;
+
+	if (! elvea_check_memory(thread, self)) {
+		return NULL;
+	}
+	if (get_rope(thread, first, &left) && get_rope(thread, second, &right))
+	{
+		if (left == NULL || right == NULL)
+		{
+			// One of the strings is empty, so we can use the other string's rope.
+			self->rope = left ? left : right;
+			left = right = NULL;
+		}
+		else
+		{
+			self->rope = elvea_rope_concat(thread, left, right);
+		}
+	}
+	elvea_rope_release(thread, left);
+	elvea_rope_release(thread, right);
+
+	if (self->rope == NULL)
+	{
+		elvea_delete(thread, self);
+		return NULL;
+	}
+	self->size = size;
+
+	return self;
+}
+
+bool elvea_string_flatten(elvea_thread_t *thread, elvea_string_t **alias)
+{
+	elvea_string_t *self = *alias;
+	elvea_rope_t *rope = self->rope;
+	elvea_size_t size = self->size;
+
+	if (rope == NULL) {
+		return true;
+	}
+
+	if (elvea_is_shared(self))
+	{
+		elvea_string_t *tmp = elvea_string_alloc(thread, get_next_capacity(size + 1));
+
+		if (! elvea_check_memory(thread, tmp)) {
+			return false;
+		}
+		elvea_rope_copy(rope, 0, tmp->data, size);
+		update_size(tmp, size);
+		elvea_object_retain(thread, tmp);
+		elvea_object_release(thread, self);
+		self = tmp;
+	}
+	else
+	{
+		if (! reserve(thread, &self, get_next_capacity(size + 1), false)) {
+			return false;
+		}
+		elvea_rope_copy(rope, 0, self->data, size);
+		self->data[size] = '\0';
+		self->rope = NULL;
+		elvea_rope_release(thread, rope);
+	}
+	*alias = self;
+
+	return true;
+}
+
+void elvea_string_read(const elvea_string_t *self, elvea_size_t offset, char *buffer, elvea_size_t count)
+{
+	if (self->rope != NULL) {
+		elvea_rope_copy(self->rope, offset, buffer, count);
+	}
+	else if (count > 0) {
+		memcpy(buffer, self->data + offset, count);
+	}
 }
\ No newline at end of file
@@ -40,7 +40,7 @@ struct elvea_string_t
 	// Number of bytes in the string, excluding the nul terminator.
 	elvea_size_t size;
 
-	// Capacity of the char array, including the nul terminator. (capacity > size).
+	// Capacity of the char array, including the nul terminator. (capacity > size, unless the string is a rope).
 	elvea_size_t capacity;
 
 	// Cached hash value.
@@ -49,7 +49,12 @@ struct elvea_string_t
 	// Cached UTF-8 size.
 	elvea_size_t utf8_size;
 
-	// Beginning of the char data (more is allocated after that).
+	// If this is not NULL, the content of the string is held by this rope and the char data is empty. Large strings
+	// switch to this representation when they are edited in the middle (see rope.h).
+	struct elvea_rope_t *rope;
+
+	// Beginning of the char data (more is allocated after that). This is only valid if the string is not a rope: use
+	// elvea_string_flatten() or elvea_string_read() to access the bytes of any string.
 	char data[1];
 };
 
@@ -64,6 +69,28 @@ elvea_string_t *elvea_string_new(elvea_thread_t *thread, const char *str, elvea_
 // Allocate an empty string with a given capacity. (For internal use only.)
 elvea_string_t *elvea_string_alloc(elvea_thread_t *thread, elvea_size_t capacity);
 
+// Check whether the content of a string is held by a rope.
+static inline
+bool elvea_string_is_rope(const elvea_string_t *self)
+{
+	return self->rope != NULL;
+}
+
+// Make the content of a string contiguous, so that its data can be accessed directly. If the string is a rope, it is
+// converted in place if it is not shared, or replaced by a flat copy otherwise. Returns false if memory allocation
+// failed.
+bool elvea_string_flatten(elvea_thread_t *thread, elvea_string_t **alias);
+
+// Copy [count] bytes starting at byte [offset] (in base 0) into [buffer]. The range must be within the string.
+void elvea_string_read(const elvea_string_t *self, elvea_size_t offset, char *buffer, elvea_size_t count);
+
+// Release the rope held by a string, if any.
+void elvea_string_finalize(elvea_thread_t *thread, elvea_string_t *self);
+
+// Get the number of bytes used by the rope of a string, excluding the string itself, or 0 if the string is not a rope.
+// The rope's nodes may be shared with other strings.
+size_t elvea_string_footprint(const elvea_string_t *self);
+
 // Check that the string is valid UTF-8. This computes the string's length as a side effect.
 bool elvea_string_is_valid(elvea_thread_t *thread, elvea_string_t *self);
 
@@ -100,9 +127,14 @@ void elvea_string_append(elvea_thread_t *thread, elvea_string_t **alias, const c
 // Prepend a string at the beginning of another string.
 void elvea_string_prepend(elvea_thread_t *thread, elvea_string_t **alias, const char *str, elvea_index_t len);
 
-// Insert string at the given byte offset (in base 1).
+// Insert string at the given byte offset (in base 1). Large strings are converted to a rope, so that inserting takes
+// O(log n) time instead of moving the end of the string.
 void elvea_string_insert(elvea_thread_t *thread, elvea_string_t **alias, elvea_index_t offset, const char *str, elvea_index_t len);
 
+// Create a new string which holds the content of [first] followed by the content of [second]. If the result is large,
+// it is a rope which shares the nodes of the arguments' ropes.
+elvea_string_t *elvea_string_concat(elvea_thread_t *thread, const elvea_string_t *first, const elvea_string_t *second);
+
 // Compare two strings for equality.
 bool elvea_string_equal(elvea_thread_t *thread, const elvea_string_t *self, const elvea_string_t *other);
 
@@ -42,12 +42,14 @@
  * - changed keys and values from void* to elvea_variant_t                                                             *
  * - added a thread argument to all methods                                                                            *
  * - changed hash and equality to use elvea's instead of user-provided callbacks                                       *
+ * - allocate entries from a chunked node pool                                                                         *
  *                                                                                                                     *
  ***********************************************************************************************************************/
 
 #include <sys/types.h>
 #include <elvea/table.h>
 #include <elvea/thread.h>
+#include <elvea/gc.h>
 #include <elvea/utils/alloc.h>
 
 typedef struct table_node_t table_node_t;
@@ -60,12 +62,33 @@ struct table_node_t
 	elvea_size_t hash;
 };
 
+// Nodes are carved out of chunks which are owned by the table. Removed nodes are put on a free list and reused by
+// later insertions; chunks are only released when the table is finalized.
+typedef struct table_chunk_t
+{
+	struct table_chunk_t *next;
+	elvea_size_t count;
+	table_node_t nodes[];
+} table_chunk_t;
+
+// Number of nodes in the first chunk. Each new chunk is twice as large as the previous one, up to the maximum size.
+#define MIN_CHUNK_SIZE 8
+#define MAX_CHUNK_SIZE 1024
+
 struct elvea_table_t
 {
 	elvea_object_t base;
 	table_node_t **buckets;
 	elvea_size_t capacity;
 	elvea_size_t size;
+
+	// Number of keys and values which are collectable objects. The table is acyclic when this is 0.
+	elvea_size_t collectable_count;
+
+	// Node pool: the most recent chunk is first, and [chunk_used] nodes have been carved out of it so far.
+	table_chunk_t *chunks;
+	elvea_size_t chunk_used;
+	table_node_t *free_nodes;
 };
 
 uint32_t elvea_table_instance_size()
@@ -73,6 +96,12 @@ uint32_t elvea_table_instance_size()
 	return (uint32_t) sizeof(elvea_table_t);
 }
 
+void elvea_table_init_class(elvea_class_t *klass)
+{
+	klass->finalize = (elvea_finalize_callback_t) elvea_table_finalize;
+	klass->traverse = (elvea_traverse_callback_t) elvea_table_traverse;
+}
+
 elvea_table_t *elvea_table_new(elvea_thread_t *thread, elvea_size_t initial_capacity)
 {
 	elvea_table_t *self = (elvea_table_t *) elvea_new(thread, thread->table_class, true, 0);
@@ -85,6 +114,11 @@ elvea_table_t *elvea_table_new(elvea_thread_t *thread, elvea_size_t initial_capa
 	elvea_size_t minimum_capacity = initial_capacity * 4 / 3;
 	self->capacity = 1;
 	self->size = 0;
+	self->collectable_count = 0;
+	self->base.meta.acyclic = true;
+	self->chunks = NULL;
+	self->chunk_used = 0;
+	self->free_nodes = NULL;
 
 	while (self->capacity <= minimum_capacity)
 	{
@@ -95,7 +129,8 @@ elvea_table_t *elvea_table_new(elvea_thread_t *thread, elvea_size_t initial_capa
 
 	if (! elvea_check_memory(thread, self->buckets))
 	{
-		elvea_free(thread, self);
+		self->capacity = 0;
+		elvea_delete(thread, self);
 		return NULL;
 	}
 
@@ -113,6 +148,21 @@ elvea_size_t calculate_index(elvea_size_t bucket_count, elvea_size_t hash)
 	return hash & (bucket_count - 1);
 }
 
+static inline
+elvea_size_t is_collectable_value(const elvea_variant_t *value)
+{
+	return elvea_check_object(value) && elvea_is_collectable(elvea_as_object(value));
+}
+
+// Keep track of the number of collectable keys and values, so that the cycle collector can skip the table when it has
+// none.
+static inline
+void update_collectables(elvea_table_t *self, elvea_size_t added, elvea_size_t removed)
+{
+	self->collectable_count = self->collectable_count + added - removed;
+	self->base.meta.acyclic = (self->collectable_count == 0);
+}
+
 static void expand_if_necessary(elvea_thread_t *thread, elvea_table_t *self)
 {
 	// If the load factor exceeds 0.75...
@@ -140,41 +190,110 @@ static void expand_if_necessary(elvea_thread_t *thread, elvea_table_t *self)
 			}
 		}
 		// Copy over internals.
-		free(self->buckets);
+		elvea_free(thread, self->buckets, self->capacity * sizeof(table_node_t *));
 		self->buckets = new_buckets;
 		self->capacity = new_capacity;
 	}
 }
 
+static inline
+size_t chunk_byte_count(elvea_size_t count)
+{
+	return sizeof(table_chunk_t) + count * sizeof(table_node_t);
+}
+
+static table_node_t *alloc_node(elvea_thread_t *thread, elvea_table_t *self)
+{
+	table_node_t *node = self->free_nodes;
+
+	if (node != NULL)
+	{
+		self->free_nodes = node->next;
+		return node;
+	}
+
+	table_chunk_t *chunk = self->chunks;
+
+	if (chunk == NULL || self->chunk_used == chunk->count)
+	{
+		elvea_size_t count = chunk ? ELVEA_MIN(chunk->count * 2, MAX_CHUNK_SIZE) : MIN_CHUNK_SIZE;
+		chunk = (table_chunk_t*) elvea_alloc(thread, chunk_byte_count(count));
+
+		if (! elvea_check_memory(thread, chunk)) {
+			return NULL;
+		}
+		chunk->count = count;
+		chunk->next = self->chunks;
+		self->chunks = chunk;
+		self->chunk_used = 0;
+	}
+
+	return &chunk->nodes[self->chunk_used++];
+}
+
+static inline
+void recycle_node(elvea_table_t *self, table_node_t *node)
+{
+	node->next = self->free_nodes;
+	self->free_nodes = node;
+}
+
 void elvea_table_finalize(elvea_thread_t *thread, elvea_table_t *self)
 {
 	for (elvea_size_t i = 0; i < self->capacity; i++)
 	{
-		table_node_t *entry = self->buckets[i];
-		while (entry != NULL)
+		for (table_node_t *entry = self->buckets[i]; entry != NULL; entry = entry->next)
 		{
-			table_node_t *next = entry->next;
-			free(entry);
-			entry = next;
+			elvea_release(thread, &entry->key);
+			elvea_release(thread, &entry->value);
 		}
 	}
 
-	elvea_free(thread, self->buckets);
+	// Release all the nodes at once.
+	table_chunk_t *chunk = self->chunks;
+
+	while (chunk != NULL)
+	{
+		table_chunk_t *next = chunk->next;
+		elvea_free(thread, chunk, chunk_byte_count(chunk->count));
+		chunk = next;
+	}
+
+	elvea_free(thread, self->buckets, self->capacity * sizeof(table_node_t *));
+	self->chunks = NULL;
+	self->free_nodes = NULL;
 	// Don't free table itself.
 }
 
-static table_node_t *create_entry(elvea_thread_t *thread, elvea_variant_t *key, elvea_size_t hash, elvea_variant_t *value)
+int elvea_table_traverse(elvea_thread_t *thread, elvea_table_t *self, void *context)
 {
-	table_node_t *entry = (table_node_t*) elvea_calloc(thread, 1, sizeof(table_node_t));
+	for (elvea_size_t i = 0; i < self->capacity; i++)
+	{
+		for (table_node_t *entry = self->buckets[i]; entry != NULL; entry = entry->next)
+		{
+			elvea_gc_visit(thread, &entry->key, context);
+			elvea_gc_visit(thread, &entry->value, context);
+		}
+	}
+
+	return 0;
+}
 
-	if (! elvea_check_memory(thread, entry)) {
+static table_node_t *create_entry(elvea_thread_t *thread, elvea_table_t *self, elvea_variant_t *key, elvea_size_t hash,
+								  elvea_variant_t *value)
+{
+	table_node_t *entry = alloc_node(thread, self);
+
+	if (entry == NULL) {
 		return NULL;
 	}
 
+	elvea_zero(&entry->key);
+	elvea_zero(&entry->value);
+	entry->next = NULL;
 	elvea_copy(thread, &entry->key, key);
 	elvea_copy(thread, &entry->value, value);
 	entry->hash = hash;
-	//entry->next = NULL;
 
 	return entry;
 }
@@ -204,12 +323,13 @@ void elvea_table_set(elvea_thread_t *thread, elvea_table_t *self, elvea_variant_
 		// Add a new entry.
 		if (current == NULL)
 		{
-			*p = create_entry(thread, key, hash, value);
+			*p = create_entry(thread, self, key, hash, value);
 
 			if (*p != NULL)
 			{
 				self->size++;
-				expand_if_necessary(NULL, self);
+				update_collectables(self, is_collectable_value(key) + is_collectable_value(value), 0);
+				expand_if_necessary(thread, self);
 			}
 
 			return;
@@ -218,6 +338,7 @@ void elvea_table_set(elvea_thread_t *thread, elvea_table_t *self, elvea_variant_
 		// Replace existing entry.
 		if (equal_keys(thread, &current->key, current->hash, key, hash))
 		{
+			update_collectables(self, is_collectable_value(value), is_collectable_value(&current->value));
 			elvea_copy(thread, &current->value, value);
 			return;
 		}
@@ -262,9 +383,10 @@ bool elvea_table_remove(elvea_thread_t *thread, elvea_table_t *self, elvea_varia
 		if (equal_keys(thread, &current->key, current->hash, key, hash))
 		{
 			*p = current->next;
+			update_collectables(self, 0, is_collectable_value(&current->key) + is_collectable_value(&current->value));
 			elvea_release(thread, &current->key);
 			elvea_release(thread, &current->value);
-			elvea_free(thread, current);
+			recycle_node(self, current);
 			self->size--;
 
 			return true;
@@ -294,6 +416,17 @@ void elvea_table_apply(elvea_thread_t *thread, elvea_table_t *map, bool (*callba
 }
 
 // Is this useful for elvea?
+size_t elvea_table_footprint(elvea_table_t *self)
+{
+	size_t size = self->capacity * sizeof(table_node_t *);
+
+	for (table_chunk_t *chunk = self->chunks; chunk != NULL; chunk = chunk->next) {
+		size += chunk_byte_count(chunk->count);
+	}
+
+	return size;
+}
+
 elvea_size_t elvea_table_current_capacity(elvea_table_t *self)
 {
 	elvea_size_t bucketCount = self->capacity;
@@ -58,6 +58,8 @@ extern "C" {
 // Get size of an instance.
 uint32_t elvea_table_instance_size();
 
+void elvea_table_init_class(elvea_class_t *klass);
+
 
 /**
  * Creates a new table. Returns NULL if memory allocation fails.
@@ -71,6 +73,11 @@ elvea_table_t *elvea_table_new(elvea_thread_t *thread, elvea_size_t initial_capa
  */
 void elvea_table_finalize(elvea_thread_t *thread, elvea_table_t *self);
 
+/**
+ * Visit the keys and values held by the table for the cycle collector.
+ */
+int elvea_table_traverse(elvea_thread_t *thread, elvea_table_t *self, void *context);
+
 /**
  * Puts value for the given key in the map. Returns pre-existing value if
  * any.
@@ -83,6 +90,10 @@ void elvea_table_set(elvea_thread_t *thread, elvea_table_t *self, elvea_variant_
 /**
  * Gets a value from the map. Returns NULL if no entry for the given key is
  * found or if the value itself is NULL.
+ *
+ * The table keeps track of whether it holds collectable objects, so a
+ * collectable object must not be stored through the returned pointer: use
+ * elvea_table_set() instead.
  */
 elvea_variant_t * elvea_table_get(elvea_thread_t *thread, elvea_table_t *self, elvea_variant_t *key);
 /**
@@ -101,6 +112,11 @@ bool elvea_table_remove(elvea_thread_t *thread, elvea_table_t *self, elvea_varia
  */
 size_t elvea_table_length(elvea_thread_t *thread, elvea_table_t *map);
 
+/**
+ * Gets the number of bytes used by the map's buckets and entries, excluding the map itself.
+ */
+size_t elvea_table_footprint(elvea_table_t *self);
+
 /**
  * Invokes the given callback on each entry in the map. Stops iterating if
  * the callback returns false.
@@ -23,8 +23,10 @@
  ***********************************************************************************************************************/
 
 #include <stddef.h>
+#include <string.h>
 #include <elvea/elvea.h>
 #include <elvea/utils/alloc.h>
+#include <elvea/utils/helpers.h>
 
 void elvea_thread_init(elvea_runtime_t *rt, elvea_thread_t *thread)
 {
@@ -33,7 +35,19 @@ void elvea_thread_init(elvea_runtime_t *rt, elvea_thread_t *thread)
 	thread->has_thread = false;
 	thread->main_thread = false;
 	thread->next = NULL;
+	thread->region = NULL;
+	thread->spare_chunks = NULL;
+	thread->profiler = NULL;
+	thread->classes = NULL;
+	elvea_atomic_init_ptr(&thread->remote_frees, NULL);
+	elvea_atomic_init_ptr(&thread->remote_merges, NULL);
+	elvea_atomic_init_int(&thread->heap_state, ELVEA_HEAP_ATTACHED);
+	memset(&thread->memory, 0, sizeof(elvea_memory_budget_t));
+	elvea_set_memory_limits(thread, 0, 0);
 	elvea_gc_initialize(&thread->gc);
+#if ELVEA_ARENA_RESERVE_SIZE
+	elvea_arena_reserve(thread, &thread->gc.arena, ELVEA_ARENA_RESERVE_SIZE, ELVEA_ARENA_HUGE_PAGES);
+#endif
 
 	thread->bool_class   = elvea_class_new(thread, "bool", 0, 0, NULL);
 	thread->num_class    = elvea_class_new(thread, "num", 0, 0, NULL);
@@ -42,6 +56,7 @@ void elvea_thread_init(elvea_runtime_t *rt, elvea_thread_t *thread)
 	thread->iter_class   = elvea_class_new(thread, "iterator", sizeof(elvea_iterator_t), 0, NULL);
 
 	elvea_string_init_class(thread->string_class);
+	elvea_table_init_class(thread->table_class);
 }
 
 void elvea_thread_delete(elvea_thread_t *thread)
@@ -50,15 +65,25 @@ void elvea_thread_delete(elvea_thread_t *thread)
 		return;
 	}
 
+	// Objects may be handed back and forth between threads as they are finalized.
+	elvea_remote_drain(thread);
+	elvea_gc_destroy_pending(thread, 0);
 	elvea_thread_delete(thread->next);
-	elvea_gc_finalize(&thread->gc);
-	elvea_free(thread, thread->bool_class);
-	elvea_free(thread, thread->num_class);
-	elvea_free(thread, thread->string_class);
-	elvea_free(thread, thread->table_class);
-	elvea_free(thread, thread->iter_class);
-
-	thread->runtime->alloc(thread, 0, 0);
+	elvea_remote_drain(thread);
+	thread->gc.scratch_top = 0;
+	elvea_gc_reconcile(thread);
+	elvea_gc_collect_cycles(thread);
+	elvea_gc_destroy_pending(thread, 0);
+	elvea_profiler_stop(thread);
+	elvea_region_finalize(thread);
+	elvea_gc_finalize(thread, &thread->gc);
+	elvea_free(thread, thread->bool_class, sizeof(elvea_class_t));
+	elvea_free(thread, thread->num_class, sizeof(elvea_class_t));
+	elvea_free(thread, thread->string_class, sizeof(elvea_class_t));
+	elvea_free(thread, thread->table_class, sizeof(elvea_class_t));
+	elvea_free(thread, thread->iter_class, sizeof(elvea_class_t));
+
+	thread->runtime->alloc(thread, sizeof(elvea_thread_t), 0);
 }
 
 elvea_variant_t * elvea_alloc_variant(elvea_thread_t *thread)
@@ -71,8 +96,39 @@ void elvea_recycle_variant(elvea_thread_t *thread, elvea_variant_t *variant)
 	elvea_arena_recycle_variant(thread, &thread->gc.arena, variant);
 }
 
+elvea_thread_t *elvea_thread_new(elvea_runtime_t *rt)
+{
+	elvea_thread_t *thread = (elvea_thread_t*) rt->alloc(NULL, 0, sizeof(elvea_thread_t));
+
+	if (thread)
+	{
+		elvea_thread_init(rt, thread);
+		thread->next = rt->thread->next;
+		rt->thread->next = thread;
+	}
+
+	return thread;
+}
+
+void elvea_thread_detach(elvea_thread_t *thread)
+{
+	elvea_memory_reclaim(thread);
+	elvea_atomic_store_int(&thread->heap_state, ELVEA_HEAP_DETACHED);
+}
+
+void elvea_thread_attach(elvea_thread_t *thread)
+{
+	// The collector only holds the heap for a short time slice, so there's no need to block.
+	while (! elvea_atomic_cas_int(&thread->heap_state, ELVEA_HEAP_DETACHED, ELVEA_HEAP_ATTACHED)) {
+		thrd_yield();
+	}
+	elvea_thread_safe_point(thread);
+	elvea_memory_reclaim(thread);
+}
+
 elvea_alias_t * elvea_alloc_alias(elvea_thread_t *thread)
 {
+	elvea_thread_safe_point(thread);
 	return elvea_arena_alloc_alias(thread, &thread->gc.arena);
 }
 
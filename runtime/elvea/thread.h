@@ -28,7 +28,12 @@
 #define ELVEA_THREAD_H
 
 #include <elvea/gc.h>
+#include <elvea/region.h>
+#include <elvea/profiler.h>
+#include <elvea/remote.h>
+#include <elvea/utils/atomic.h>
 #include <elvea/error.h>
+#include <elvea/utils/alloc.h>
 #include <elvea/third_party/tinycthread/tinycthread.h>
 
 
@@ -38,14 +43,26 @@ extern "C" {
 
 
 
+// State of a thread's heap. A thread's objects may only be used by its native thread while the heap is attached, and
+// the background collector may only examine them while it holds the heap (see collector.h).
+enum
+{
+	ELVEA_HEAP_ATTACHED,
+	ELVEA_HEAP_DETACHED,
+	ELVEA_HEAP_COLLECTING
+};
+
 struct elvea_thread_t
 {
-	// Random seed for hashing.
+	// Random seed.
 	uint32_t seed;
 
 	// Thread-local garbage collector.
 	struct elvea_recycler_t gc;
 
+	// Memory usage and limits.
+	elvea_memory_budget_t memory;
+
 	// Global runtime.
 	elvea_runtime_t *runtime;
 
@@ -61,6 +78,28 @@ struct elvea_thread_t
 	// Chain threads together.
 	elvea_thread_t *next;
 
+	// Active region, if any.
+	elvea_region_t *region;
+
+	// Region chunks kept for reuse.
+	struct elvea_region_chunk_t *spare_chunks;
+
+	// Allocation profiler, if profiling is enabled.
+	elvea_profiler_t *profiler;
+
+	// All the classes created by this thread, most recent first.
+	elvea_class_t *classes;
+
+	// Aliases released by other threads, which this thread must reclaim (see remote.h).
+	elvea_atomic_ptr_t remote_frees;
+
+	// Objects whose shared reference count this thread must merge into its own, or which it must destroy (see
+	// remote.h).
+	elvea_atomic_ptr_t remote_merges;
+
+	// Whether the heap is attached, detached or held by the background collector.
+	elvea_atomic_int_t heap_state;
+
 	// Builtin classes.
 	elvea_class_t *bool_class;
 	elvea_class_t *num_class;
@@ -81,6 +120,38 @@ void elvea_thread_init(elvea_runtime_t *rt, elvea_thread_t *thread);
 // Finalize runtime.
 void elvea_thread_delete(elvea_thread_t *thread);
 
+// Create a thread which can be used from another native thread. It is chained to the runtime's main thread and
+// deleted by elvea_finalize(). This must be called from the main thread.
+elvea_thread_t *elvea_thread_new(elvea_runtime_t *rt);
+
+// Process work that other threads have deferred to this thread. This is cheap when there is nothing to do, and is
+// called regularly by the runtime; it must only be called by the native thread which uses [thread].
+static inline
+void elvea_thread_safe_point(elvea_thread_t *thread)
+{
+	if (elvea_atomic_load_ptr(&thread->remote_frees) != NULL || elvea_atomic_load_ptr(&thread->remote_merges) != NULL) {
+		elvea_remote_drain(thread);
+	}
+	if (thread->gc.collected.count > 0) {
+		elvea_gc_reclaim(thread);
+	}
+	if (thread->gc.pending.count > 0) {
+		elvea_gc_destroy_pending(thread, ELVEA_GC_DESTROY_BATCH);
+	}
+	if (thread->gc.zct.count >= ELVEA_GC_ZCT_SIZE) {
+		elvea_gc_reconcile(thread);
+	}
+}
+
+// Let the background collector examine the thread's objects. The native thread must not use any object or variant
+// owned by [thread] until it calls elvea_thread_attach(). This is meant to be called before the native thread blocks,
+// for instance while waiting for I/O. Threads are attached when they are created.
+void elvea_thread_detach(elvea_thread_t *thread);
+
+// Take the thread's heap back from the background collector, waiting for the current time slice to end if necessary,
+// and reclaim the garbage it has found.
+void elvea_thread_attach(elvea_thread_t *thread);
+
 // Get an uninitialized storage area large enough to hold a variant.
 elvea_variant_t * elvea_alloc_variant(elvea_thread_t *thread);
 
@@ -28,30 +28,174 @@
 #include <elvea/thread.h>
 #include <elvea/utils/alloc.h>
 
+// Compute the threshold for a given usage. [pending] is the size of the allocation being made, if any.
+static void update_threshold(elvea_memory_budget_t *memory, size_t pending)
+{
+	size_t threshold = SIZE_MAX;
+
+	if (memory->soft_limit)
+	{
+		// If we are still above the soft limit after reclaiming memory, wait until usage has grown by a quarter of
+		// the limit before trying again, otherwise we would collect on every allocation.
+		threshold = memory->soft_limit;
+		size_t used = memory->used + pending;
+		if (used >= threshold) threshold = used + memory->soft_limit / 4;
+	}
+
+	// Always check the hard limit.
+	if (memory->hard_limit && threshold > memory->hard_limit) {
+		threshold = memory->hard_limit;
+	}
+
+	memory->threshold = threshold;
+}
+
+// Check whether [size] more bytes can be allocated. This is only called when the threshold is exceeded.
+static bool check_limits(elvea_thread_t *thread, size_t size)
+{
+	elvea_memory_budget_t *memory = &thread->memory;
+
+	// The caller may be in the middle of updating objects which a collection could free or move, so memory is only
+	// reclaimed when the embedder calls elvea_memory_reclaim().
+	if (memory->soft_limit && !memory->collecting && memory->used + size > memory->soft_limit) {
+		memory->requested = true;
+	}
+	update_threshold(memory, size);
+
+	if (memory->hard_limit && memory->used + size > memory->hard_limit)
+	{
+		elvea_throw(thread, ELVEA_ERROR_MEMORY, "memory limit exceeded: cannot allocate %zu bytes (%zu bytes in use, "
+				"limit is %zu bytes)", size, memory->used, memory->hard_limit);
+		memory->reported = true;
+		return false;
+	}
+
+	return true;
+}
+
+static inline
+bool reserve_memory(elvea_thread_t *thread, size_t size)
+{
+	elvea_memory_budget_t *memory = &thread->memory;
+
+	if (memory->used + size > memory->threshold && ! check_limits(thread, size)) {
+		return false;
+	}
+
+	return true;
+}
+
+static inline
+void add_usage(elvea_memory_budget_t *memory, size_t size)
+{
+	memory->used += size;
+
+	if (memory->used > memory->peak) {
+		memory->peak = memory->used;
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
 void *elvea_alloc(elvea_thread_t *thread, size_t size)
 {
-	return thread->runtime->alloc(NULL, 0, size);
+	if (! reserve_memory(thread, size)) {
+		return NULL;
+	}
+
+	void *data = thread->runtime->alloc(NULL, 0, size);
+
+	if (data) {
+		add_usage(&thread->memory, size);
+	}
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler && data) elvea_profiler_on_alloc(thread, data, size);
+#endif
+	return data;
 }
 
 void *elvea_calloc(elvea_thread_t *thread, size_t count, size_t size)
 {
 	size = count * size;
+
+	// Don't go through elvea_alloc: the profiler expects the allocation routine to be the caller of its hook.
+	if (! reserve_memory(thread, size)) {
+		return NULL;
+	}
+
 	void *data = thread->runtime->alloc(NULL, 0, size);
 
-	if (data) {
+	if (data)
+	{
 		memset(data, 0, size);
+		add_usage(&thread->memory, size);
+	}
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler && data) elvea_profiler_on_alloc(thread, data, size);
+#endif
+	return data;
+}
+
+void *elvea_realloc(elvea_thread_t *thread, void *ptr, size_t old_size, size_t new_size)
+{
+	if (new_size > old_size && ! reserve_memory(thread, new_size - old_size)) {
+		return NULL;
 	}
 
+	void *data = thread->runtime->alloc(ptr, old_size, new_size);
+
+	if (data)
+	{
+		thread->memory.used -= old_size;
+		add_usage(&thread->memory, new_size);
+	}
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler && data)
+	{
+		if (ptr) elvea_profiler_on_realloc(thread, ptr, data, old_size, new_size);
+		else elvea_profiler_on_alloc(thread, data, new_size);
+	}
+#endif
 	return data;
 }
 
-void *elvea_realloc(elvea_thread_t *thread, void *ptr, size_t size)
+
+void elvea_free(elvea_thread_t *thread, void *ptr, size_t size)
+{
+	if (ptr == NULL) {
+		return;
+	}
+#if ELVEA_WITH_PROFILER
+	if (thread->profiler) elvea_profiler_on_free(thread, ptr);
+#endif
+	thread->runtime->alloc(ptr, size, 0);
+	thread->memory.used -= size;
+}
+
+void elvea_set_memory_limits(elvea_thread_t *thread, size_t soft_limit, size_t hard_limit)
 {
-	return thread->runtime->alloc(ptr, 0, size);
+	thread->memory.soft_limit = soft_limit;
+	thread->memory.hard_limit = hard_limit;
+	update_threshold(&thread->memory, 0);
 }
 
+void elvea_memory_reclaim(elvea_thread_t *thread)
+{
+	elvea_memory_budget_t *memory = &thread->memory;
+
+	if (! memory->requested || memory->collecting) {
+		return;
+	}
+	memory->requested = false;
+	memory->collecting = true;
+	memory->collections++;
+	elvea_gc_collect(thread);
+	memory->collecting = false;
+	update_threshold(memory, 0);
+}
 
-void elvea_free(elvea_thread_t *thread, void *ptr)
+size_t elvea_memory_used(elvea_thread_t *thread)
 {
-	thread->runtime->alloc(ptr, 0, 0);
+	return thread->memory.used;
 }
@@ -19,7 +19,10 @@
  * Created: 2017.01.17                                                                                                 *
  *                                                                                                                     *
  * Purpose: memory allocation routines. These functions are similar to malloc/calloc/realloc/free but use the          *
- * runtime's allocator (which, by default, uses realloc and free).                                                     *
+ * runtime's allocator (which, by default, uses realloc and free). Callers pass the size of the blocks they release,   *
+ * so that the allocator doesn't need to look it up and each thread can keep track of how much memory it uses. A       *
+ * thread can be given a soft memory limit, above which it tries to reclaim memory, and a hard limit, above which      *
+ * allocations fail with ELVEA_ERROR_MEMORY.                                                                           *
  *                                                                                                                     *
  ***********************************************************************************************************************/
 
@@ -34,17 +37,59 @@ extern "C" {
 #endif
 
 
+// Memory usage of a thread.
+typedef struct elvea_memory_budget_t
+{
+	// Number of bytes currently allocated by the thread.
+	size_t used;
+
+	// Highest value of used.
+	size_t peak;
+
+	// Limits, in bytes, or 0 if there is no limit.
+	size_t soft_limit, hard_limit;
+
+	// Usage above which the next allocation needs to check the limits.
+	size_t threshold;
+
+	// Number of times memory was reclaimed because the soft limit was exceeded.
+	size_t collections;
+
+	// Whether memory is being reclaimed.
+	bool collecting;
+
+	// Whether the soft limit was exceeded and memory must be reclaimed (see elvea_memory_reclaim()).
+	bool requested;
+
+	// Whether the last failed allocation has already been reported to the error handler.
+	bool reported;
+} elvea_memory_budget_t;
+
+
 // Allocate a block of uninitialized memory.
 void *elvea_alloc(elvea_thread_t *thread, size_t size);
 
 // Allocate a block of zero-initialized memory.
 void *elvea_calloc(elvea_thread_t *thread, size_t count, size_t size);
 
-// Reallocate a block of memory.
-void *elvea_realloc(elvea_thread_t *thread, void *ptr, size_t size);
+// Reallocate a block of memory. [old_size] must be the size that was requested for [ptr].
+void *elvea_realloc(elvea_thread_t *thread, void *ptr, size_t old_size, size_t new_size);
+
+// Free a block of memory. [size] must be the size that was requested for [ptr].
+void elvea_free(elvea_thread_t *thread, void *ptr, size_t size);
+
+// Set the thread's memory limits. When the soft limit is exceeded, the thread collects cycles and compacts its arena
+// at the next call to elvea_memory_reclaim(); allocations that would exceed the hard limit fail and raise
+// ELVEA_ERROR_MEMORY. A limit of 0 means no limit.
+void elvea_set_memory_limits(elvea_thread_t *thread, size_t soft_limit, size_t hard_limit);
+
+// If the soft limit has been exceeded since memory was last reclaimed, collect cycles and compact the arena. This may
+// destroy and move objects, so it is never done by allocations: it is called by elvea_thread_attach() and
+// elvea_thread_detach(), and embedders can call it when no object is being updated, e.g. between two tasks.
+void elvea_memory_reclaim(elvea_thread_t *thread);
 
-// Free a block of memory.
-void elvea_free(elvea_thread_t *thread, void *ptr);
+// Get the number of bytes currently allocated by the thread.
+size_t elvea_memory_used(elvea_thread_t *thread);
 
 
 #ifdef __cplusplus
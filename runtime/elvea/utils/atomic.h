@@ -0,0 +1,160 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: portable atomic operations. This is a thin layer over C11 atomics, with a fallback to the Interlocked      *
+ * functions when building with Visual C++, which doesn't provide <stdatomic.h>. Loads use acquire semantics and       *
+ * stores and read-modify-write operations use release or acquire-release semantics, which is what the lock-free       *
+ * queues in the runtime need.                                                                                         *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_ATOMIC_H
+#define ELVEA_ATOMIC_H
+
+#include <stdbool.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#	include <windows.h>
+#	define ELVEA_INTERLOCKED
+#else
+#	include <stdatomic.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef ELVEA_INTERLOCKED
+typedef void * volatile elvea_atomic_ptr_t;
+typedef LONG volatile elvea_atomic_int_t;
+#else
+typedef _Atomic(void*) elvea_atomic_ptr_t;
+typedef _Atomic(int) elvea_atomic_int_t;
+#endif
+
+
+static inline
+void elvea_atomic_init_ptr(elvea_atomic_ptr_t *ptr, void *value)
+{
+#ifdef ELVEA_INTERLOCKED
+	*ptr = value;
+#else
+	atomic_init(ptr, value);
+#endif
+}
+
+static inline
+void *elvea_atomic_load_ptr(elvea_atomic_ptr_t *ptr)
+{
+#ifdef ELVEA_INTERLOCKED
+	return *ptr;
+#else
+	return atomic_load_explicit(ptr, memory_order_acquire);
+#endif
+}
+
+static inline
+void *elvea_atomic_exchange_ptr(elvea_atomic_ptr_t *ptr, void *value)
+{
+#ifdef ELVEA_INTERLOCKED
+	return InterlockedExchangePointer((PVOID volatile *) ptr, value);
+#else
+	return atomic_exchange_explicit(ptr, value, memory_order_acq_rel);
+#endif
+}
+
+// If [ptr] holds [*expected], replace it with [desired] and return true. Otherwise, load the current value into
+// [*expected] and return false.
+static inline
+bool elvea_atomic_cas_ptr(elvea_atomic_ptr_t *ptr, void **expected, void *desired)
+{
+#ifdef ELVEA_INTERLOCKED
+	void *previous = InterlockedCompareExchangePointer((PVOID volatile *) ptr, desired, *expected);
+	bool done = (previous == *expected);
+	*expected = previous;
+	return done;
+#else
+	return atomic_compare_exchange_weak_explicit(ptr, expected, desired, memory_order_acq_rel, memory_order_acquire);
+#endif
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline
+void elvea_atomic_init_int(elvea_atomic_int_t *value, int initial)
+{
+#ifdef ELVEA_INTERLOCKED
+	*value = initial;
+#else
+	atomic_init(value, initial);
+#endif
+}
+
+static inline
+int elvea_atomic_load_int(elvea_atomic_int_t *value)
+{
+#ifdef ELVEA_INTERLOCKED
+	return (int) *value;
+#else
+	return atomic_load_explicit(value, memory_order_acquire);
+#endif
+}
+
+static inline
+void elvea_atomic_store_int(elvea_atomic_int_t *value, int desired)
+{
+#ifdef ELVEA_INTERLOCKED
+	InterlockedExchange(value, desired);
+#else
+	atomic_store_explicit(value, desired, memory_order_release);
+#endif
+}
+
+// Add [delta] to [value] and return the previous value.
+static inline
+int elvea_atomic_add_int(elvea_atomic_int_t *value, int delta)
+{
+#ifdef ELVEA_INTERLOCKED
+	return (int) InterlockedExchangeAdd(value, delta);
+#else
+	return atomic_fetch_add_explicit(value, delta, memory_order_acq_rel);
+#endif
+}
+
+// If [value] holds [expected], replace it with [desired] and return true. Otherwise, return false.
+static inline
+bool elvea_atomic_cas_int(elvea_atomic_int_t *value, int expected, int desired)
+{
+#ifdef ELVEA_INTERLOCKED
+	return InterlockedCompareExchange(value, desired, expected) == expected;
+#else
+	return atomic_compare_exchange_strong_explicit(value, &expected, desired, memory_order_acq_rel,
+			memory_order_acquire);
+#endif
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_ATOMIC_H
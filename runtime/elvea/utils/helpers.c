@@ -31,3 +31,22 @@
 
 #include <elvea/utils/helpers.h>
 
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+uint64_t elvea_clock_ns()
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (uint64_t) ((double) count.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
@@ -59,6 +59,9 @@ extern "C" {
 #endif
 
 
+// Monotonic clock, in nanoseconds.
+uint64_t elvea_clock_ns();
+
 static inline
 elvea_size_t get_next_capacity(elvea_size_t n)
 {
@@ -0,0 +1,394 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <string.h>
+#include <elvea/utils/slab.h>
+#include <elvea/utils/atomic.h>
+#include <elvea/third_party/tinycthread/tinycthread.h>
+
+#ifdef _WIN32
+#	include <malloc.h>
+#endif
+
+// Size of a span. Spans are aligned on their size, so that the span a block belongs to can be found by masking
+// the block's address.
+#define SPAN_SHIFT 16
+#define SPAN_SIZE ((size_t) 1 << SPAN_SHIFT)
+
+// The span map covers the lower 48 bits of the address space, which is what mainstream 64-bit platforms hand out to
+// user processes. Each leaf covers 2^20 spans (64 GiB).
+#define ADDRESS_BITS 48
+#define LEAF_BITS 20
+#define ROOT_SIZE ((size_t) 1 << (ADDRESS_BITS - SPAN_SHIFT - LEAF_BITS))
+#define LEAF_SIZE ((size_t) 1 << LEAF_BITS)
+
+// Space reserved at the beginning of each span for its header. This keeps blocks aligned on 16 bytes.
+#define SPAN_HEADER_SIZE 64
+
+// Largest block served by the slab. Larger blocks go to realloc/free.
+#define MAX_BLOCK_SIZE 1024
+
+// Number of size classes.
+#define CLASS_COUNT 20
+
+// Maximum number of free blocks a thread keeps in its cache for each class. When the limit is exceeded, half of them
+// are handed back to the shared pool.
+#define CACHE_LIMIT 128
+
+// Number of blocks moved from the shared pool to a thread cache when the cache is empty.
+#define REFILL_COUNT 32
+
+/*
+ * Size classes are tuned to the shapes the runtime actually allocates:
+ *   - 48 bytes: table nodes (two variants, a link and a hash), iterators, and table headers preceded by their GC header;
+ *   - 32 + capacity: strings, whose capacity doubles up to 32 bytes and then grows by 1.5x (see get_next_capacity);
+ *   - 8 * capacity: bucket arrays of tables, whose capacity is a power of 2.
+ * Classes are 16 bytes apart up to 128 bytes, and are then spaced so that internal fragmentation stays under 25%.
+ */
+static const uint16_t class_sizes[CLASS_COUNT] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024
+};
+
+// Map (size + 15) / 16 to a size class.
+static const uint8_t class_index[MAX_BLOCK_SIZE / 16 + 1] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11,
+	11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15,
+	15, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17,
+	17, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19,
+	19
+};
+
+typedef struct slab_block_t slab_block_t;
+
+// A free block.
+struct slab_block_t
+{
+	slab_block_t *next;
+};
+
+// Header at the beginning of each span. All the blocks in a span belong to the same class.
+typedef struct slab_span_t
+{
+	uint32_t size_class;
+} slab_span_t;
+
+// Shared state for a size class.
+typedef struct slab_class_t
+{
+	// Blocks which have been freed.
+	slab_block_t *free_list;
+
+	// Blocks are carved lazily from the most recent span, so that untouched memory is never written to.
+	char *bump, *end;
+} slab_class_t;
+
+// Thread-local cache.
+typedef struct slab_cache_t
+{
+	slab_block_t *free_list[CLASS_COUNT];
+	uint32_t count[CLASS_COUNT];
+
+	// True if the cache will be flushed when the thread exits.
+	bool registered;
+} slab_cache_t;
+
+static struct
+{
+	mtx_t lock;
+	slab_class_t classes[CLASS_COUNT];
+
+	// Used to flush a thread's cache when the thread exits.
+	tss_t exit_key;
+} heap;
+
+static once_flag heap_once = ONCE_FLAG_INIT;
+
+static _Thread_local slab_cache_t cache;
+
+// Two-level map from span numbers to a flag which is set if the span was allocated by the slab. It is used to find out
+// whether a block whose size is unknown belongs to a span, and can be read without locking: leaves are published
+// atomically and never freed, and a span's flag is set before any of its blocks is handed out. Leaves are allocated
+// with calloc(), so that their pages are only committed when they are written to.
+static elvea_atomic_ptr_t span_map[ROOT_SIZE];
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void flush_cache(void *unused)
+{
+	elvea_slab_flush();
+}
+
+static void init_heap(void)
+{
+	mtx_init(&heap.lock, mtx_plain);
+	tss_create(&heap.exit_key, flush_cache);
+}
+
+// Make sure that the calling thread's cache is flushed when the thread exits.
+static void register_cache(void)
+{
+	call_once(&heap_once, init_heap);
+	tss_set(heap.exit_key, &cache);
+	cache.registered = true;
+}
+
+static inline
+int get_class(size_t size)
+{
+	return (size <= MAX_BLOCK_SIZE) ? class_index[(size + 15) >> 4] : -1;
+}
+
+// Must be called with the lock held.
+static bool register_span(uintptr_t span)
+{
+	size_t index = (size_t) (span >> SPAN_SHIFT);
+
+	if ((uint64_t) span >> ADDRESS_BITS) {
+		return false;
+	}
+
+	elvea_atomic_ptr_t *root = &span_map[index >> LEAF_BITS];
+	uint8_t *leaf = (uint8_t*) elvea_atomic_load_ptr(root);
+
+	if (leaf == NULL)
+	{
+		leaf = (uint8_t*) calloc(LEAF_SIZE, 1);
+
+		if (leaf == NULL) {
+			return false;
+		}
+		elvea_atomic_exchange_ptr(root, leaf);
+	}
+	leaf[index & (LEAF_SIZE - 1)] = 1;
+
+	return true;
+}
+
+static inline
+bool is_span(uintptr_t span)
+{
+	size_t index = (size_t) (span >> SPAN_SHIFT);
+
+	if ((uint64_t) span >> ADDRESS_BITS) {
+		return false;
+	}
+
+	uint8_t *leaf = (uint8_t*) elvea_atomic_load_ptr(&span_map[index >> LEAF_BITS]);
+
+	return leaf && leaf[index & (LEAF_SIZE - 1)];
+}
+
+// Must be called with the lock held.
+static bool add_span(int size_class)
+{
+	void *memory;
+#ifdef _WIN32
+	memory = _aligned_malloc(SPAN_SIZE, SPAN_SIZE);
+#else
+	if (posix_memalign(&memory, SPAN_SIZE, SPAN_SIZE) != 0) {
+		memory = NULL;
+	}
+#endif
+	if (memory == NULL) {
+		return false;
+	}
+
+	if (! register_span((uintptr_t) memory))
+	{
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+		return false;
+	}
+
+	slab_span_t *span = (slab_span_t*) memory;
+	span->size_class = (uint32_t) size_class;
+
+	slab_class_t *klass = &heap.classes[size_class];
+	klass->bump = (char*) memory + SPAN_HEADER_SIZE;
+	klass->end = (char*) memory + SPAN_SIZE;
+
+	return true;
+}
+
+// Look up the class of a block whose size is unknown. Returns -1 if the block was not allocated from a span.
+static int find_class(void *ptr)
+{
+	uintptr_t span = ((uintptr_t) ptr) & ~((uintptr_t) SPAN_SIZE - 1);
+
+	return is_span(span) ? (int) ((slab_span_t*) span)->size_class : -1;
+}
+
+static bool refill_cache(int size_class)
+{
+	slab_class_t *klass = &heap.classes[size_class];
+	size_t block_size = class_sizes[size_class];
+	int count = 0;
+
+	if (! cache.registered) {
+		register_cache();
+	}
+	mtx_lock(&heap.lock);
+
+	while (count < REFILL_COUNT)
+	{
+		slab_block_t *block = klass->free_list;
+
+		if (block)
+		{
+			klass->free_list = block->next;
+		}
+		else
+		{
+			if ((size_t) (klass->end - klass->bump) < block_size && (count > 0 || !add_span(size_class))) {
+				break;
+			}
+			block = (slab_block_t*) klass->bump;
+			klass->bump += block_size;
+		}
+
+		block->next = cache.free_list[size_class];
+		cache.free_list[size_class] = block;
+		count++;
+	}
+
+	mtx_unlock(&heap.lock);
+	cache.count[size_class] += count;
+
+	return count > 0;
+}
+
+// Hand [count] blocks from the thread cache back to the shared pool.
+static void drain_cache(int size_class, uint32_t count)
+{
+	slab_block_t *first = cache.free_list[size_class];
+	slab_block_t *last = first;
+	uint32_t moved = 1;
+
+	if (first == NULL || count == 0) {
+		return;
+	}
+
+	for (; moved < count && last->next; ++moved) {
+		last = last->next;
+	}
+
+	cache.free_list[size_class] = last->next;
+	cache.count[size_class] -= moved;
+
+	mtx_lock(&heap.lock);
+	last->next = heap.classes[size_class].free_list;
+	heap.classes[size_class].free_list = first;
+	mtx_unlock(&heap.lock);
+}
+
+static void *allocate(size_t size)
+{
+	int size_class = get_class(size);
+
+	if (size_class < 0) {
+		return malloc(size);
+	}
+
+	if (cache.free_list[size_class] == NULL && !refill_cache(size_class)) {
+		return NULL;
+	}
+
+	slab_block_t *block = cache.free_list[size_class];
+	cache.free_list[size_class] = block->next;
+	cache.count[size_class]--;
+
+	return block;
+}
+
+static void release(void *ptr, int size_class)
+{
+	if (size_class < 0)
+	{
+		free(ptr);
+		return;
+	}
+
+	if (! cache.registered) {
+		register_cache();
+	}
+
+	slab_block_t *block = (slab_block_t*) ptr;
+	block->next = cache.free_list[size_class];
+	cache.free_list[size_class] = block;
+
+	if (++cache.count[size_class] > CACHE_LIMIT) {
+		drain_cache(size_class, CACHE_LIMIT / 2);
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void *elvea_slab_alloc(void *ptr, size_t old_size, size_t new_size)
+{
+	if (ptr == NULL) {
+		return (new_size == 0) ? NULL : allocate(new_size);
+	}
+
+	int old_class = (old_size != 0) ? get_class(old_size) : find_class(ptr);
+
+	if (new_size == 0)
+	{
+		release(ptr, old_class);
+		return NULL;
+	}
+
+	int new_class = get_class(new_size);
+
+	if (old_class == new_class) {
+		return (new_class < 0) ? realloc(ptr, new_size) : ptr;
+	}
+	if (old_class < 0 && new_class < 0) {
+		return realloc(ptr, new_size);
+	}
+
+	void *block = allocate(new_size);
+
+	if (block == NULL) {
+		return NULL;
+	}
+
+	// If the old block is large and its size is unknown, we know that it is larger than the new block.
+	size_t copy_size = (old_class >= 0) ? class_sizes[old_class] : (old_size ? old_size : new_size);
+	memcpy(block, ptr, ELVEA_MIN(copy_size, new_size));
+	release(ptr, old_class);
+
+	return block;
+}
+
+void elvea_slab_flush()
+{
+	for (int c = 0; c < CLASS_COUNT; ++c) {
+		drain_cache(c, cache.count[c]);
+	}
+}
@@ -0,0 +1,53 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: size-class slab allocator. This is a drop-in replacement for the default allocator which serves small      *
+ * blocks from per-class free lists carved out of 64 KiB spans, and forwards large blocks to realloc/free. Each native *
+ * thread keeps a small cache of free blocks per size class so that most allocations don't need any locking.           *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_SLAB_H
+#define ELVEA_SLAB_H
+
+#include <stddef.h>
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Slab allocator, which is compatible with elvea_allocator_t and can be passed to elvea_initialize(). Blocks of up to
+// 1024 bytes are served from size classes. If [old_size] is not 0, it must be the size that was requested when [ptr]
+// was (re)allocated: the size class is then found without any lookup. If it is 0, the block's span is looked up in a
+// map of the address space, which doesn't need any locking but is slightly slower.
+void *elvea_slab_alloc(void *ptr, size_t old_size, size_t new_size);
+
+// Give the calling thread's cached blocks back to the shared pool. This is done automatically when a native thread
+// which used the slab allocator exits, but a thread which is about to stay idle for a long time may call it earlier.
+void elvea_slab_flush();
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_SLAB_H
@@ -0,0 +1,97 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: see header.                                                                                                *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <elvea/utils/vmem.h>
+
+#if defined(_WIN32)
+#	include <windows.h>
+#elif defined(ELVEA_POSIX)
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+
+size_t elvea_vmem_page_size()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (size_t) info.dwPageSize;
+#elif defined(ELVEA_POSIX)
+	return (size_t) sysconf(_SC_PAGESIZE);
+#else
+	return 4096;
+#endif
+}
+
+void *elvea_vmem_reserve(size_t size)
+{
+#if defined(_WIN32)
+	return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#elif defined(ELVEA_POSIX)
+	void *address = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return (address == MAP_FAILED) ? NULL : address;
+#else
+	return NULL;
+#endif
+}
+
+void elvea_vmem_release(void *address, size_t size)
+{
+#if defined(_WIN32)
+	VirtualFree(address, 0, MEM_RELEASE);
+#elif defined(ELVEA_POSIX)
+	munmap(address, size);
+#endif
+}
+
+bool elvea_vmem_commit(void *address, size_t size)
+{
+#if defined(_WIN32)
+	return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#elif defined(ELVEA_POSIX)
+	return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+#else
+	return false;
+#endif
+}
+
+void elvea_vmem_decommit(void *address, size_t size)
+{
+#if defined(_WIN32)
+	VirtualFree(address, size, MEM_DECOMMIT);
+#elif defined(ELVEA_POSIX)
+	madvise(address, size, MADV_DONTNEED);
+#endif
+}
+
+void elvea_vmem_use_huge_pages(void *address, size_t size)
+{
+#if defined(ELVEA_POSIX) && defined(MADV_HUGEPAGE)
+	madvise(address, size, MADV_HUGEPAGE);
+#else
+	ELVEA_UNUSED(address);
+	ELVEA_UNUSED(size);
+#endif
+}
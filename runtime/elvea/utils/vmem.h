@@ -0,0 +1,63 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: virtual memory primitives. These functions reserve address space, commit and decommit pages, and give      *
+ * memory back to the operating system. They are used to back memory arenas with large virtual ranges (see arena.h).   *
+ * On platforms without virtual memory support, reservations fail and callers must fall back to the runtime's          *
+ * allocator.                                                                                                          *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#ifndef ELVEA_VMEM_H
+#define ELVEA_VMEM_H
+
+#include <stddef.h>
+#include <elvea/definitions.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Get the size of an operating system page.
+size_t elvea_vmem_page_size();
+
+// Reserve a range of address space without committing any memory. Returns NULL on failure.
+void *elvea_vmem_reserve(size_t size);
+
+// Release a range obtained with elvea_vmem_reserve().
+void elvea_vmem_release(void *address, size_t size);
+
+// Make pages in a reserved range accessible. Physical memory is only assigned when the pages are touched.
+bool elvea_vmem_commit(void *address, size_t size);
+
+// Give the physical memory backing committed pages back to the system. The pages remain accessible, but their
+// content is lost.
+void elvea_vmem_decommit(void *address, size_t size);
+
+// Ask the system to back a range with transparent huge pages, if it supports them.
+void elvea_vmem_use_huge_pages(void *address, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ELVEA_VMEM_H
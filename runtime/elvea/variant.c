@@ -24,11 +24,19 @@
 
 #include <float.h>
 #include <math.h>
+#include <string.h>
 #include <elvea/variant.h>
 #include <elvea/error.h>
+#include <elvea/hash.h>
 #include <elvea/thread.h>
+#include <elvea/runtime.h>
 #include "variant.h"
 
+#if defined(__SSE2__) && UINTPTR_MAX == UINT64_MAX && ! ELVEA_NAN_BOXING
+#include <emmintrin.h>
+#define SCAN_SSE2 1
+#endif
+
 static
 bool elvea_num_equal(double x, double y)
 {
@@ -37,9 +45,43 @@ bool elvea_num_equal(double x, double y)
 	return fabs(x-y) <= DBL_EPSILON * scale;
 }
 
+static inline
+bool is_numeric(const elvea_variant_t *variant)
+{
+	return elvea_get_type(variant) & (ELVEA_TYPE_NUMBER|ELVEA_TYPE_INTEGER);
+}
+
+// Convert an integer or a number to a number.
+static inline
+elvea_float_t to_float(const elvea_variant_t *variant)
+{
+	return elvea_check_int(variant) ? (elvea_float_t) elvea_as_int(variant) : elvea_as_num(variant);
+}
+
+// Compare an integer and a number exactly. Converting the integer to a number would round integers above 2^53, and
+// converting the number to an integer would truncate its fractional part. NaN is greater than any integer.
+static
+int compare_int_num(elvea_int_t i, elvea_float_t n)
+{
+	if (n != n || n >= 9223372036854775808.0) {
+		return -1;
+	}
+	if (n < -9223372036854775808.0) {
+		return 1;
+	}
+
+	elvea_int_t t = (elvea_int_t) n; // truncated towards 0
+	if (i != t) {
+		return (i < t) ? -1 : 1;
+	}
+	elvea_float_t fraction = n - (elvea_float_t) t;
+
+	return (fraction > 0) ? -1 : (fraction < 0);
+}
+
 const char *elvea_get_class_name(elvea_thread_t *thread, const elvea_variant_t *variant)
 {
-	switch (variant->type)
+	switch (elvea_get_type(variant))
 	{
 		case ELVEA_TYPE_NULL:
 			return "null";
@@ -48,11 +90,13 @@ const char *elvea_get_class_name(elvea_thread_t *thread, const elvea_variant_t *
 			return "bool";
 		case ELVEA_TYPE_NUMBER:
 			return "num";
+		case ELVEA_TYPE_INTEGER:
+			return "int";
 		case ELVEA_TYPE_OBJECT:
-			return variant->as.object->isa->name;
+			return elvea_as_object(variant)->isa->name;
 		case ELVEA_TYPE_ALIAS:
 		{
-			return elvea_get_class_name(thread, &variant->as.alias->variant);
+			return elvea_get_class_name(thread, &elvea_as_alias(variant)->variant);
 		}
 		default:
 			return "unknown";
@@ -62,19 +106,19 @@ const char *elvea_get_class_name(elvea_thread_t *thread, const elvea_variant_t *
 bool elvea_check_string(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	elvea_resolve_alias(thread, &variant);
-	return elvea_check_object(variant) && variant->as.object->isa == thread->string_class;
+	return elvea_check_object(variant) && elvea_as_object(variant)->isa == thread->string_class;
 }
 
 bool elvea_check_list(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	elvea_resolve_alias(thread, &variant);
-	return elvea_check_object(variant) && variant->as.object->isa == thread->list_class;
+	return elvea_check_object(variant) && elvea_as_object(variant)->isa == thread->list_class;
 }
 
 bool elvea_check_table(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	elvea_resolve_alias(thread, &variant);
-	return elvea_check_object(variant) && variant->as.object->isa == thread->table_class;
+	return elvea_check_object(variant) && elvea_as_object(variant)->isa == thread->table_class;
 }
 
 bool elvea_get_bool(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -83,7 +127,7 @@ bool elvea_get_bool(elvea_thread_t *thread, elvea_variant_t *variant)
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected a boolean, not a %s", elvea_get_class_name(thread, variant));
 	}
 
-	return variant->type == ELVEA_TYPE_TRUE;
+	return elvea_get_type(variant) == ELVEA_TYPE_TRUE;
 }
 
 elvea_float_t elvea_get_num(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -92,7 +136,16 @@ elvea_float_t elvea_get_num(elvea_thread_t *thread, elvea_variant_t *variant)
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected a number, not a %s", elvea_get_class_name(thread, variant));
 	}
 
-	return variant->type == ELVEA_TYPE_TRUE;
+	return elvea_as_num(variant);
+}
+
+elvea_int_t elvea_get_int(elvea_thread_t *thread, elvea_variant_t *variant)
+{
+	if (!elvea_check_int(variant)) {
+		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected an integer, not a %s", elvea_get_class_name(thread, variant));
+	}
+
+	return elvea_as_int(variant);
 }
 
 elvea_string_t *elvea_get_string(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -101,7 +154,7 @@ elvea_string_t *elvea_get_string(elvea_thread_t *thread, elvea_variant_t *varian
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected a string, not a %s", elvea_get_class_name(thread, variant));
 	}
 
-	return variant->as.string;
+	return (elvea_string_t*) elvea_as_object(variant);
 }
 
 elvea_list_t *elvea_get_list(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -110,7 +163,7 @@ elvea_list_t *elvea_get_list(elvea_thread_t *thread, elvea_variant_t *variant)
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected a list, not a %s", elvea_get_class_name(thread, variant));
 	}
 
-	return variant->as.list;
+	return (elvea_list_t*) elvea_as_object(variant);
 }
 
 elvea_table_t *elvea_get_table(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -119,7 +172,7 @@ elvea_table_t *elvea_get_table(elvea_thread_t *thread, elvea_variant_t *variant)
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "expected a table, not a %s", elvea_get_class_name(thread, variant));
 	}
 
-	return variant->as.table;
+	return (elvea_table_t*) elvea_as_object(variant);
 }
 
 elvea_string_t **elvea_get_string_ref(elvea_thread_t *thread, elvea_variant_t *variant)
@@ -155,7 +208,7 @@ elvea_table_t **elvea_get_table_ref(elvea_thread_t *thread, elvea_variant_t *var
 elvea_alias_t *elvea_make_alias(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	if (elvea_check_alias(variant)) {
-		return variant->as.alias;
+		return elvea_as_alias(variant);
 	}
 
 	// TODO: initialize alias!!
@@ -167,48 +220,63 @@ elvea_alias_t *elvea_make_alias(elvea_thread_t *thread, elvea_variant_t *variant
 static inline
 void raw_copy(elvea_variant_t *dst, const elvea_variant_t *src)
 {
-	dst->type = src->type;
-	dst->as = src->as;
+	*dst = *src;
 }
 
 void elvea_retain(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	if (elvea_check_object(variant)) {
-		elvea_object_retain(thread, variant->as.object);
+		elvea_object_retain(thread, elvea_as_object(variant));
 	}
 	else if (elvea_check_alias(variant)) {
-		elvea_alias_retain(thread, variant->as.alias);
+		elvea_alias_retain(thread, elvea_as_alias(variant));
 	}
 }
 
 void elvea_release(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	if (elvea_check_object(variant)) {
-		elvea_object_release(thread, variant->as.object);
+		elvea_object_release(thread, elvea_as_object(variant));
 	}
 	else if (elvea_check_alias(variant)) {
-		elvea_alias_release(thread, variant->as.alias);
+		elvea_alias_release(thread, elvea_as_alias(variant));
 	}
 }
 
+// The functions below update the variant before releasing its previous value: releasing a value may start a cycle
+// collection, which must not see a reference that is no longer accounted for.
+
 void elvea_copy(elvea_thread_t *thread, elvea_variant_t *dst, const elvea_variant_t *src)
 {
-	elvea_release(thread, dst);
+	// Coalesce the retain and release when the reference doesn't change.
+	void *ref = elvea_as_pointer(src);
+
+	if (ref && elvea_get_type(dst) == elvea_get_type(src) && elvea_as_pointer(dst) == ref) {
+		return;
+	}
+
+	elvea_variant_t old;
+	raw_copy(&old, dst);
 	raw_copy(dst, src);
 	elvea_retain(thread, dst);
+	elvea_release(thread, &old);
 }
 
 void elvea_move(elvea_thread_t *thread, elvea_variant_t *dst, elvea_variant_t *src)
 {
-	elvea_release(thread, dst);
+	elvea_variant_t old;
+	raw_copy(&old, dst);
 	raw_copy(dst, src);
-	elvea_zero(dst);
+	elvea_zero(src);
+	elvea_release(thread, &old);
 }
 
 void elvea_clear(elvea_thread_t *thread, elvea_variant_t *variant)
 {
-	elvea_release(thread, variant);
+	elvea_variant_t old;
+	raw_copy(&old, variant);
 	elvea_zero(variant);
+	elvea_release(thread, &old);
 }
 
 void elvea_swap(elvea_thread_t *thread, elvea_variant_t *variant1, elvea_variant_t *variant2)
@@ -220,30 +288,151 @@ void elvea_swap(elvea_thread_t *thread, elvea_variant_t *variant1, elvea_variant
 	raw_copy(variant2, &tmp);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+
+// The bulk operations check the types of the variants in blocks, and only handle the blocks which contain references one
+// variant at a time. Runs of blocks which don't contain any reference are copied or skipped at once.
+#define SCAN_BLOCK 8
+
+// Check whether any of the SCAN_BLOCK variants starting at [variants] holds an object or an alias.
+static inline
+bool has_references(const elvea_variant_t *variants)
+{
+#if SCAN_SSE2
+	// A variant is 16 bytes, and its type is in the third 32-bit lane. The other lanes may contain anything.
+	__m128i types = _mm_loadu_si128((const __m128i*) &variants[0]);
+	for (int i = 1; i < SCAN_BLOCK; i++) {
+		types = _mm_or_si128(types, _mm_loadu_si128((const __m128i*) &variants[i]));
+	}
+
+	return _mm_cvtsi128_si32(_mm_shuffle_epi32(types, _MM_SHUFFLE(2, 2, 2, 2))) & (ELVEA_TYPE_OBJECT|ELVEA_TYPE_ALIAS);
+#elif ELVEA_NAN_BOXING
+	// References are the only values in [8, 2^48).
+	bool found = false;
+	for (int i = 0; i < SCAN_BLOCK; i++) {
+		found |= (variants[i].as.bits - 8) < (ELVEA_BOX_NUMBER_OFFSET - 8);
+	}
+
+	return found;
+#else
+	unsigned int types = 0;
+	for (int i = 0; i < SCAN_BLOCK; i++) {
+		types |= variants[i].type;
+	}
+
+	return types & (ELVEA_TYPE_OBJECT|ELVEA_TYPE_ALIAS);
+#endif
+}
+
+// Find the end of the run of whole blocks starting at [start] in which neither [variants1] nor [variants2] (which may be
+// NULL) holds a reference.
+static inline
+size_t skip_values(const elvea_variant_t *variants1, const elvea_variant_t *variants2, size_t start, size_t count)
+{
+	size_t i = start;
+
+	while (i + SCAN_BLOCK <= count && ! has_references(variants1 + i) && ! (variants2 && has_references(variants2 + i))) {
+		i += SCAN_BLOCK;
+	}
+
+	return i;
+}
+
+// Get the end of the block which is handled one variant at a time after a run of values.
+static inline
+size_t block_end(size_t start, size_t count)
+{
+	return (count - start < SCAN_BLOCK) ? count : start + SCAN_BLOCK;
+}
+
+void elvea_retain_n(elvea_thread_t *thread, elvea_variant_t *variants, size_t count)
+{
+	size_t i = 0;
+
+	while (i < count)
+	{
+		i = skip_values(variants, NULL, i, count);
+
+		for (size_t end = block_end(i, count); i < end; i++) {
+			elvea_retain(thread, &variants[i]);
+		}
+	}
+}
+
+void elvea_release_n(elvea_thread_t *thread, elvea_variant_t *variants, size_t count)
+{
+	size_t i = 0;
+
+	while (i < count)
+	{
+		i = skip_values(variants, NULL, i, count);
+
+		for (size_t end = block_end(i, count); i < end; i++) {
+			elvea_release(thread, &variants[i]);
+		}
+	}
+}
+
+void elvea_copy_n(elvea_thread_t *thread, elvea_variant_t *dst, const elvea_variant_t *src, size_t count)
+{
+	size_t i = 0;
+
+	while (i < count)
+	{
+		size_t start = i;
+		i = skip_values(dst, src, i, count);
+		memcpy(dst + start, src + start, (i - start) * sizeof(elvea_variant_t));
+
+		for (size_t end = block_end(i, count); i < end; i++) {
+			elvea_copy(thread, &dst[i], &src[i]);
+		}
+	}
+}
+
+void elvea_move_n(elvea_thread_t *thread, elvea_variant_t *dst, elvea_variant_t *src, size_t count)
+{
+	size_t i = 0;
+
+	// The references held by the source are transferred, so only the destination needs to be checked. A variant whose
+	// bytes are all 0 is null in both layouts.
+	while (i < count)
+	{
+		size_t start = i;
+		i = skip_values(dst, NULL, i, count);
+		memcpy(dst + start, src + start, (i - start) * sizeof(elvea_variant_t));
+		memset(src + start, 0, (i - start) * sizeof(elvea_variant_t));
+
+		for (size_t end = block_end(i, count); i < end; i++) {
+			elvea_move(thread, &dst[i], &src[i]);
+		}
+	}
+}
+
 bool elvea_equal(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t *other)
 {
 	elvea_resolve_alias(thread, &self);
 	elvea_resolve_alias(thread, &other);
 
-	if (self->type != other->type)
+	if (elvea_get_type(self) != elvea_get_type(other))
 	{
 		if (elvea_check_bool(self) && elvea_check_bool(other))
 		{
-			return self->type == other->type;
+			return elvea_get_type(self) == elvea_get_type(other);
 		}
-		else if (elvea_check_num(self) && elvea_check_num(other))
+		else if (is_numeric(self) && is_numeric(other))
 		{
-			elvea_float_t n1 = self->as.number;
-			elvea_float_t n2 = other->as.number;
-
-			return elvea_num_equal(n1, n2);
+			// An integer and a number are only equal if the number has exactly the same value.
+			if (elvea_check_int(self)) {
+				return compare_int_num(elvea_as_int(self), elvea_as_num(other)) == 0;
+			}
+			return compare_int_num(elvea_as_int(other), elvea_as_num(self)) == 0;
 		}
 
 		// Different types, can't be equal.
 		return false;
 	}
 
-	switch (self->type)
+	switch (elvea_get_type(self))
 	{
 		case ELVEA_TYPE_NULL:
 		case ELVEA_TYPE_TRUE:
@@ -251,21 +440,24 @@ bool elvea_equal(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t
 			return true;
 
 		case ELVEA_TYPE_NUMBER:
-			return elvea_num_equal(self->as.number, other->as.number);
+			return elvea_num_equal(elvea_as_num(self), elvea_as_num(other));
+
+		case ELVEA_TYPE_INTEGER:
+			return elvea_as_int(self) == elvea_as_int(other);
 
 		case ELVEA_TYPE_OBJECT:
 		{
-			elvea_equal_callback_t equal = self->as.object->isa->equal;
+			elvea_equal_callback_t equal = elvea_as_object(self)->isa->equal;
 
 			if (equal) {
-				return equal(thread, self->as.object, other->as.object);
+				return equal(thread, elvea_as_object(self), elvea_as_object(other));
 			}
 
 			// If the type doesn't implement equals$(), try to use compare$().
-			elvea_compare_callback_t cmp = self->as.object->isa->compare;
+			elvea_compare_callback_t cmp = elvea_as_object(self)->isa->compare;
 
 			if (cmp) {
-				return cmp(thread, self->as.object, other->as.object) == 0;
+				return cmp(thread, elvea_as_object(self), elvea_as_object(other)) == 0;
 			}
 
 			elvea_throw(thread, ELVEA_ERROR_RUNTIME, "Type %s does not support comparison for equality.\n"
@@ -287,28 +479,28 @@ int elvea_compare(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t
 	elvea_resolve_alias(thread, &self);
 	elvea_resolve_alias(thread, &other);
 
-	if (self->type != other->type)
+	if (elvea_get_type(self) != elvea_get_type(other))
 	{
 		if (elvea_check_bool(self) && elvea_check_bool(other))
 		{
-			int b1 = self->type & ELVEA_TYPE_TRUE;
-			int b2 = other->type & ELVEA_TYPE_TRUE;
+			int b1 = elvea_get_type(self) & ELVEA_TYPE_TRUE;
+			int b2 = elvea_get_type(other) & ELVEA_TYPE_TRUE;
 
 			return b1 - b2;
 		}
-		else if (elvea_check_num(self) && elvea_check_num(other))
+		else if (is_numeric(self) && is_numeric(other))
 		{
-			elvea_float_t n1 = self->as.number;
-			elvea_float_t n2 = other->as.number;
-
-			return (int) (n1 - n2);
+			if (elvea_check_int(self)) {
+				return compare_int_num(elvea_as_int(self), elvea_as_num(other));
+			}
+			return -compare_int_num(elvea_as_int(other), elvea_as_num(self));
 		}
 
 		elvea_throw(thread, ELVEA_ERROR_TYPE, "Cannot compare values of type %s and %s",
 					elvea_get_class_name(thread, self), elvea_get_class_name(thread, other));
 	}
 
-	switch (self->type)
+	switch (elvea_get_type(self))
 	{
 		case ELVEA_TYPE_NULL:
 		case ELVEA_TYPE_TRUE:
@@ -317,17 +509,24 @@ int elvea_compare(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t
 
 		case ELVEA_TYPE_NUMBER:
 		{
-			elvea_float_t n1 = self->as.number;
-			elvea_float_t n2 = other->as.number;
+			elvea_float_t n1 = elvea_as_num(self);
+			elvea_float_t n2 = elvea_as_num(other);
 
 			return elvea_num_equal(n1, n2) ? 0 : ((n1 - n2) < 0 ? -1 : 1);
 		}
+		case ELVEA_TYPE_INTEGER:
+		{
+			elvea_int_t i1 = elvea_as_int(self);
+			elvea_int_t i2 = elvea_as_int(other);
+
+			return (i1 > i2) - (i1 < i2);
+		}
 		case ELVEA_TYPE_OBJECT:
 		{
-			elvea_compare_callback_t cmp = self->as.object->isa->compare;
+			elvea_compare_callback_t cmp = elvea_as_object(self)->isa->compare;
 
 			if (cmp) {
-				return cmp(thread, self->as.object, other->as.object);
+				return cmp(thread, elvea_as_object(self), elvea_as_object(other));
 			}
 
 			elvea_throw(thread, ELVEA_ERROR_RUNTIME, "Type %s does not support comparison.\n"
@@ -348,69 +547,231 @@ elvea_size_t elvea_hash(elvea_thread_t *thread, elvea_variant_t *variant)
 {
 	elvea_resolve_alias(thread, &variant);
 
-	switch (variant->type)
+	switch (elvea_get_type(variant))
 	{
 		case ELVEA_TYPE_TRUE:
-			return 7;
-
 		case ELVEA_TYPE_FALSE:
-			return 11;
+			return elvea_hash_fold(elvea_hash_mix64(thread->runtime->hash_key[1] + elvea_get_type(variant)));
 
 		case ELVEA_TYPE_NUMBER:
-			return variant->as.bits.x + variant->as.bits.y;
+			return elvea_hash_num(thread, elvea_as_num(variant));
+
+		case ELVEA_TYPE_INTEGER:
+			return elvea_hash_int(thread, elvea_as_int(variant));
 
 		case ELVEA_TYPE_OBJECT:
 		{
-			elvea_hash_callback_t hash = variant->as.object->isa->hash;
+			elvea_hash_callback_t hash = elvea_as_object(variant)->isa->hash;
 
 			if (hash) {
-				return hash(thread, variant->as.object);
+				return hash(thread, elvea_as_object(variant));
 			}
 		}
 		default:
 			elvea_throw(thread, ELVEA_ERROR_RUNTIME, "Type %s is not hashable", elvea_get_class_name(thread, variant));
 	}
 }
-void elvea_init_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b);
-void elvea_init_num(elvea_thread_t *thread, elvea_variant_t *variant, double n);
-void elvea_init_object(elvea_thread_t *thread, elvea_variant_t *variant, void *object);
-void elvea_set_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b);
-void elvea_set_num(elvea_thread_t *thread, elvea_variant_t *value, double n);
-void elvea_set_object(elvea_thread_t *thread, elvea_variant_t *value, void *object);
+
 
 void elvea_init_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b)
 {
-	variant->type = b ? ELVEA_TYPE_TRUE : ELVEA_TYPE_FALSE;
+	elvea_box_bool(variant, b);
 }
 
 void elvea_init_num(elvea_thread_t *thread, elvea_variant_t *variant, double n)
 {
-	variant->type = ELVEA_TYPE_NUMBER;
-	variant->as.number = n;
+	elvea_box_num(variant, n);
+}
+
+void elvea_init_int(elvea_thread_t *thread, elvea_variant_t *variant, elvea_int_t i)
+{
+	elvea_box_int(variant, i);
 }
 
 void elvea_init_object(elvea_thread_t *thread, elvea_variant_t *variant, void *object)
 {
-	variant->type = ELVEA_TYPE_OBJECT;
-	variant->as.any = object;
-	elvea_retain(thread, variant->as.any);
+	elvea_box_object(variant, object);
+	elvea_retain(thread, variant);
 }
 
 void elvea_set_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b)
 {
-	elvea_release(thread, variant);
+	elvea_variant_t old;
+	raw_copy(&old, variant);
 	elvea_init_bool(thread, variant, b);
+	elvea_release(thread, &old);
 }
 
 void elvea_set_num(elvea_thread_t *thread, elvea_variant_t *value, double n)
 {
-	elvea_release(thread, value);
+	elvea_variant_t old;
+	raw_copy(&old, value);
 	elvea_init_num(thread, value, n);
+	elvea_release(thread, &old);
 }
 
 
 void elvea_set_object(elvea_thread_t *thread, elvea_variant_t *value, void *object)
 {
-	elvea_release(thread, value);
+	elvea_variant_t old;
+	raw_copy(&old, value);
 	elvea_init_object(thread, value, object);
+	elvea_release(thread, &old);
+}
+
+void elvea_set_int(elvea_thread_t *thread, elvea_variant_t *value, elvea_int_t i)
+{
+	elvea_variant_t old;
+	raw_copy(&old, value);
+	elvea_init_int(thread, value, i);
+	elvea_release(thread, &old);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Integer arithmetic with overflow detection. These return false if the result doesn't fit in an integer.
+
+static inline
+bool add_int(elvea_int_t x, elvea_int_t y, elvea_int_t *result)
+{
+#if defined(__GNUC__)
+	return ! __builtin_add_overflow(x, y, result);
+#else
+	if ((y > 0 && x > INT64_MAX - y) || (y < 0 && x < INT64_MIN - y)) {
+		return false;
+	}
+	*result = x + y;
+	return true;
+#endif
+}
+
+static inline
+bool sub_int(elvea_int_t x, elvea_int_t y, elvea_int_t *result)
+{
+#if defined(__GNUC__)
+	return ! __builtin_sub_overflow(x, y, result);
+#else
+	if ((y < 0 && x > INT64_MAX + y) || (y > 0 && x < INT64_MIN + y)) {
+		return false;
+	}
+	*result = x - y;
+	return true;
+#endif
+}
+
+static inline
+bool mul_int(elvea_int_t x, elvea_int_t y, elvea_int_t *result)
+{
+#if defined(__GNUC__)
+	return ! __builtin_mul_overflow(x, y, result);
+#else
+	if (x > 0 ? (y > INT64_MAX / x || y < INT64_MIN / x) : (x < -1 && (y < INT64_MAX / x || y > INT64_MIN / x))) {
+		return false;
+	}
+	if (x == -1 && y == INT64_MIN) {
+		return false;
+	}
+	*result = x * y;
+	return true;
+#endif
+}
+
+// Resolve the operands of an arithmetic operation if they are aliases, and check that they are numeric. Returns true
+// if any operand was resolved, in which case the operation must be retried.
+static
+bool resolve_operands(elvea_thread_t *thread, elvea_variant_t **x, elvea_variant_t **y, const char *op)
+{
+	if (elvea_check_alias(*x) || elvea_check_alias(*y))
+	{
+		elvea_resolve_alias(thread, x);
+		elvea_resolve_alias(thread, y);
+		return true;
+	}
+	if (! is_numeric(*x) || ! is_numeric(*y)) {
+		elvea_throw(thread, ELVEA_ERROR_TYPE, "Cannot %s values of type %s and %s", op,
+					elvea_get_class_name(thread, *x), elvea_get_class_name(thread, *y));
+	}
+
+	return false;
+}
+
+// Store the result of an operation. This avoids releasing the previous value when it's not a reference, which is the
+// common case.
+static inline
+void store_int(elvea_thread_t *thread, elvea_variant_t *result, elvea_int_t i)
+{
+	if (elvea_get_type(result) & (ELVEA_TYPE_OBJECT|ELVEA_TYPE_ALIAS)) {
+		elvea_set_int(thread, result, i);
+	}
+	else {
+		elvea_box_int(result, i);
+	}
+}
+
+static inline
+void store_num(elvea_thread_t *thread, elvea_variant_t *result, elvea_float_t n)
+{
+	if (elvea_get_type(result) & (ELVEA_TYPE_OBJECT|ELVEA_TYPE_ALIAS)) {
+		elvea_set_num(thread, result, n);
+	}
+	else {
+		elvea_box_num(result, n);
+	}
+}
+
+// Integers are checked first so that the common case doesn't need to resolve aliases.
+
+void elvea_add(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y)
+{
+	elvea_int_t i;
+
+	if (elvea_check_int(x) && elvea_check_int(y) && add_int(elvea_as_int(x), elvea_as_int(y), &i)) {
+		store_int(thread, result, i);
+	}
+	else if (resolve_operands(thread, &x, &y, "add")) {
+		elvea_add(thread, result, x, y);
+	}
+	else {
+		store_num(thread, result, to_float(x) + to_float(y));
+	}
+}
+
+void elvea_sub(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y)
+{
+	elvea_int_t i;
+
+	if (elvea_check_int(x) && elvea_check_int(y) && sub_int(elvea_as_int(x), elvea_as_int(y), &i)) {
+		store_int(thread, result, i);
+	}
+	else if (resolve_operands(thread, &x, &y, "subtract")) {
+		elvea_sub(thread, result, x, y);
+	}
+	else {
+		store_num(thread, result, to_float(x) - to_float(y));
+	}
+}
+
+void elvea_mul(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y)
+{
+	elvea_int_t i;
+
+	if (elvea_check_int(x) && elvea_check_int(y) && mul_int(elvea_as_int(x), elvea_as_int(y), &i)) {
+		store_int(thread, result, i);
+	}
+	else if (resolve_operands(thread, &x, &y, "multiply")) {
+		elvea_mul(thread, result, x, y);
+	}
+	else {
+		store_num(thread, result, to_float(x) * to_float(y));
+	}
+}
+
+void elvea_div(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y)
+{
+	if (resolve_operands(thread, &x, &y, "divide")) {
+		elvea_div(thread, result, x, y);
+	}
+	else {
+		store_num(thread, result, to_float(x) / to_float(y));
+	}
 }
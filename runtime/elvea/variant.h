@@ -42,19 +42,55 @@ typedef enum elvea_type_t
 	ELVEA_TYPE_NUMBER  = 1 << 2,
 	ELVEA_TYPE_OBJECT  = 1 << 3,
 	ELVEA_TYPE_ALIAS   = 1 << 4,
+	ELVEA_TYPE_INTEGER = 1 << 5,
 	ELVEA_TYPE_OPAQUE  = 1 == 5
 } elvea_type_t;
 
 
 //----------------------------------------------------------------------------------------------------------------------
 
+#if ELVEA_NAN_BOXING
+
+#if UINTPTR_MAX != UINT64_MAX
+#error "NaN boxing requires 64-bit pointers"
+#endif
+
+// Polymorphic container for any elvea value, packed in a single 64-bit word:
+//   0, 1 and 2                   null, true and false (the values of the corresponding types)
+//   pointer                      object (objects are at least 8-byte aligned and use 48-bit addresses)
+//   pointer | 1                  alias
+//   double bits + 2^48           number (NaNs are canonicalized, so the sum never overflows)
+//   0xfffc << 48 | 50-bit value  integer
+// Integers which don't fit in 50 bits are stored as numbers.
+// Since an object is stored as a plain pointer, references to the payload of strings, lists and tables (see
+// elvea_get_string_ref()) work in both layouts.
+struct elvea_variant_t
+{
+	union
+	{
+		uint64_t        bits;
+		elvea_string_t *string;
+		elvea_list_t   *list;
+		elvea_table_t  *table;
+		elvea_object_t *object;
+	} as;
+};
+
+#define ELVEA_BOX_NUMBER_OFFSET (UINT64_C(1) << 48)
+#define ELVEA_BOX_CANONICAL_NAN UINT64_C(0x7ff8000000000000)
+#define ELVEA_BOX_ALIAS_TAG     UINT64_C(1)
+#define ELVEA_BOX_INTEGER_TAG   UINT64_C(0xfffc000000000000)
+#define ELVEA_BOX_INTEGER_BITS  50
+
+#else
+
 // Polymorphic container for any elvea value. (This is implemented as a tagged union.)
 struct elvea_variant_t
 {
 	union
 	{
 		elvea_float_t   number;
-		elvea_size_t    integer; // for iterators only
+		elvea_int_t     integer;
 		elvea_string_t *string;
 		elvea_list_t   *list;
 		elvea_table_t  *table;
@@ -71,6 +107,153 @@ struct elvea_variant_t
 	elvea_type_t type;
 };
 
+#endif
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Representation of a variant. These functions don't check the type of the payload and don't manage reference counts:
+// they are the only place where the layout of a variant is known, and they should be used instead of its fields.
+
+static inline
+elvea_type_t elvea_get_type(const elvea_variant_t *variant)
+{
+#if ELVEA_NAN_BOXING
+	uint64_t bits = variant->as.bits;
+
+	if (bits <= ELVEA_TYPE_FALSE) {
+		return (elvea_type_t) bits;
+	}
+	if (bits < ELVEA_BOX_NUMBER_OFFSET) {
+		return (bits & ELVEA_BOX_ALIAS_TAG) ? ELVEA_TYPE_ALIAS : ELVEA_TYPE_OBJECT;
+	}
+
+	return (bits >= ELVEA_BOX_INTEGER_TAG) ? ELVEA_TYPE_INTEGER : ELVEA_TYPE_NUMBER;
+#else
+	return variant->type;
+#endif
+}
+
+static inline
+elvea_float_t elvea_as_num(const elvea_variant_t *variant)
+{
+#if ELVEA_NAN_BOXING
+	union { uint64_t bits; elvea_float_t number; } u;
+	u.bits = variant->as.bits - ELVEA_BOX_NUMBER_OFFSET;
+	return u.number;
+#else
+	return variant->as.number;
+#endif
+}
+
+static inline
+elvea_int_t elvea_as_int(const elvea_variant_t *variant)
+{
+#if ELVEA_NAN_BOXING
+	// Sign-extend the payload.
+	return (elvea_int_t) (variant->as.bits << (64 - ELVEA_BOX_INTEGER_BITS)) >> (64 - ELVEA_BOX_INTEGER_BITS);
+#else
+	return variant->as.integer;
+#endif
+}
+
+static inline
+elvea_object_t *elvea_as_object(const elvea_variant_t *variant)
+{
+	return variant->as.object;
+}
+
+static inline
+elvea_alias_t *elvea_as_alias(const elvea_variant_t *variant)
+{
+#if ELVEA_NAN_BOXING
+	return (elvea_alias_t*) (uintptr_t) (variant->as.bits & ~ELVEA_BOX_ALIAS_TAG);
+#else
+	return variant->as.alias;
+#endif
+}
+
+// Get the object or alias referenced by the variant, or NULL if it holds an immediate value.
+static inline
+void *elvea_as_pointer(const elvea_variant_t *variant)
+{
+	switch (elvea_get_type(variant))
+	{
+		case ELVEA_TYPE_OBJECT:
+			return elvea_as_object(variant);
+		case ELVEA_TYPE_ALIAS:
+			return elvea_as_alias(variant);
+		default:
+			return NULL;
+	}
+}
+
+static inline
+void elvea_box_bool(elvea_variant_t *variant, bool b)
+{
+#if ELVEA_NAN_BOXING
+	variant->as.bits = b ? ELVEA_TYPE_TRUE : ELVEA_TYPE_FALSE;
+#else
+	variant->type = b ? ELVEA_TYPE_TRUE : ELVEA_TYPE_FALSE;
+#endif
+}
+
+static inline
+void elvea_box_num(elvea_variant_t *variant, elvea_float_t n)
+{
+#if ELVEA_NAN_BOXING
+	union { uint64_t bits; elvea_float_t number; } u;
+	u.number = n;
+	if (n != n) u.bits = ELVEA_BOX_CANONICAL_NAN;
+	variant->as.bits = u.bits + ELVEA_BOX_NUMBER_OFFSET;
+#else
+	variant->type = ELVEA_TYPE_NUMBER;
+	variant->as.number = n;
+#endif
+}
+
+static inline
+void elvea_box_int(elvea_variant_t *variant, elvea_int_t i)
+{
+#if ELVEA_NAN_BOXING
+	const elvea_int_t limit = (elvea_int_t) 1 << (ELVEA_BOX_INTEGER_BITS - 1);
+
+	if (i < -limit || i >= limit) {
+		elvea_box_num(variant, (elvea_float_t) i);
+	}
+	else {
+		variant->as.bits = ELVEA_BOX_INTEGER_TAG | ((uint64_t) i & ~ELVEA_BOX_INTEGER_TAG);
+	}
+#else
+	variant->type = ELVEA_TYPE_INTEGER;
+	variant->as.integer = i;
+#endif
+}
+
+static inline
+void elvea_box_object(elvea_variant_t *variant, void *object)
+{
+#if ELVEA_NAN_BOXING
+	assert(((uintptr_t) object & 7) == 0 && (uint64_t) (uintptr_t) object < ELVEA_BOX_NUMBER_OFFSET);
+	variant->as.object = (elvea_object_t*) object;
+#else
+	variant->type = ELVEA_TYPE_OBJECT;
+	variant->as.object = (elvea_object_t*) object;
+#endif
+}
+
+static inline
+void elvea_box_alias(elvea_variant_t *variant, elvea_alias_t *alias)
+{
+#if ELVEA_NAN_BOXING
+	assert(((uintptr_t) alias & ELVEA_BOX_ALIAS_TAG) == 0 && (uint64_t) (uintptr_t) alias < ELVEA_BOX_NUMBER_OFFSET);
+	variant->as.bits = (uint64_t) (uintptr_t) alias | ELVEA_BOX_ALIAS_TAG;
+#else
+	variant->type = ELVEA_TYPE_ALIAS;
+	variant->as.alias = alias;
+#endif
+}
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -98,38 +281,44 @@ const char *elvea_get_class_name(elvea_thread_t *thread, const elvea_variant_t *
 static inline
 bool elvea_check_null(const elvea_variant_t *variant)
 {
-	return variant->type == ELVEA_TYPE_NULL;
+	return elvea_get_type(variant) == ELVEA_TYPE_NULL;
 }
 
 static inline
 bool elvea_check_bool(const elvea_variant_t *variant)
 {
-	return variant->type & ELVEA_TYPE_BOOLEAN;
+	return elvea_get_type(variant) & ELVEA_TYPE_BOOLEAN;
 }
 
 static inline
 bool elvea_check_num(const elvea_variant_t *variant)
 {
-	return variant->type == ELVEA_TYPE_NUMBER;
+	return elvea_get_type(variant) == ELVEA_TYPE_NUMBER;
+}
+
+static inline
+bool elvea_check_int(const elvea_variant_t *variant)
+{
+	return elvea_get_type(variant) == ELVEA_TYPE_INTEGER;
 }
 
 static inline
 bool elvea_check_object(const elvea_variant_t *variant)
 {
-	return variant->type == ELVEA_TYPE_OBJECT;
+	return elvea_get_type(variant) == ELVEA_TYPE_OBJECT;
 }
 
 static inline
 bool elvea_check_alias(const elvea_variant_t *variant)
 {
-	return variant->type == ELVEA_TYPE_ALIAS;
+	return elvea_get_type(variant) == ELVEA_TYPE_ALIAS;
 }
 
 static inline
 void elvea_resolve_alias(elvea_thread_t *thread, elvea_variant_t **variant)
 {
 	while (elvea_check_alias(*variant)) {
-		*variant = &(*variant)->as.alias->variant;
+		*variant = &elvea_as_alias(*variant)->variant;
 	}
 }
 
@@ -147,6 +336,8 @@ bool elvea_get_bool(elvea_thread_t *thread, elvea_variant_t *variant);
 
 elvea_float_t elvea_get_num(elvea_thread_t *thread, elvea_variant_t *variant);
 
+elvea_int_t elvea_get_int(elvea_thread_t *thread, elvea_variant_t *variant);
+
 elvea_string_t *elvea_get_string(elvea_thread_t *thread, elvea_variant_t *variant);
 
 elvea_list_t *elvea_get_list(elvea_thread_t *thread, elvea_variant_t *variant);
@@ -165,7 +356,11 @@ elvea_table_t **elvea_get_table_ref(elvea_thread_t *thread, elvea_variant_t *var
 static inline
 void elvea_zero(elvea_variant_t *variant)
 {
+#if ELVEA_NAN_BOXING
+	variant->as.bits = ELVEA_TYPE_NULL;
+#else
 	variant->type = ELVEA_TYPE_NULL;
+#endif
 }
 
 void elvea_retain(elvea_thread_t *thread, elvea_variant_t *variant);
@@ -178,6 +373,17 @@ void elvea_move(elvea_thread_t *thread, elvea_variant_t *dst, elvea_variant_t *s
 
 void elvea_swap(elvea_thread_t *thread, elvea_variant_t *variant1, elvea_variant_t *variant2);
 
+// Bulk versions of the functions above, which operate on arrays of [count] variants. The arrays must not overlap. These
+// are much faster than a loop when most of the variants don't hold a reference.
+
+void elvea_retain_n(elvea_thread_t *thread, elvea_variant_t *variants, size_t count);
+
+void elvea_release_n(elvea_thread_t *thread, elvea_variant_t *variants, size_t count);
+
+void elvea_copy_n(elvea_thread_t *thread, elvea_variant_t *dst, const elvea_variant_t *src, size_t count);
+
+void elvea_move_n(elvea_thread_t *thread, elvea_variant_t *dst, elvea_variant_t *src, size_t count);
+
 bool elvea_equal(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t *other);
 
 int elvea_compare(elvea_thread_t *thread, elvea_variant_t *self, elvea_variant_t *other);
@@ -186,6 +392,39 @@ elvea_size_t elvea_hash(elvea_thread_t *thread, elvea_variant_t *variant);
 
 void elvea_clear(elvea_thread_t *thread, elvea_variant_t *variant);
 
+
+// Initialize an uninitialized variant with a value. Objects are retained.
+
+void elvea_init_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b);
+
+void elvea_init_num(elvea_thread_t *thread, elvea_variant_t *variant, double n);
+
+void elvea_init_int(elvea_thread_t *thread, elvea_variant_t *variant, elvea_int_t i);
+
+void elvea_init_object(elvea_thread_t *thread, elvea_variant_t *variant, void *object);
+
+// Replace the value of a variant, releasing the previous value.
+
+void elvea_set_bool(elvea_thread_t *thread, elvea_variant_t *variant, bool b);
+
+void elvea_set_num(elvea_thread_t *thread, elvea_variant_t *value, double n);
+
+void elvea_set_int(elvea_thread_t *thread, elvea_variant_t *value, elvea_int_t i);
+
+void elvea_set_object(elvea_thread_t *thread, elvea_variant_t *value, void *object);
+
+// Arithmetic. The operands must be integers or numbers, and the result replaces the value of [result], which may be
+// one of the operands. Operations on integers produce an integer, unless the result overflows, in which case it is
+// promoted to a number, as is the result of any operation involving a number. Division always produces a number.
+
+void elvea_add(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y);
+
+void elvea_sub(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y);
+
+void elvea_mul(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y);
+
+void elvea_div(elvea_thread_t *thread, elvea_variant_t *result, elvea_variant_t *x, elvea_variant_t *y);
+
 #ifdef __cplusplus
 }
 #endif
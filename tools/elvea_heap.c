@@ -0,0 +1,846 @@
+/***********************************************************************************************************************
+ *                                                                                                                     *
+ * Copyright (C) 2017-2018 Julien Eychenne                                                                             *
+ *                                                                                                                     *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated        *
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the *
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to     *
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:                     *
+ *                                                                                                                     *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of    *
+ * the Software.                                                                                                       *
+ *                                                                                                                     *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO    *
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE      *
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, *
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      *
+ * SOFTWARE.                                                                                                           *
+ *                                                                                                                     *
+ * Created: 2026.10.17                                                                                                 *
+ *                                                                                                                     *
+ * Purpose: offline heap snapshot analyzer. Reads a snapshot written by elvea_snapshot_write(), computes the dominator *
+ * tree of the object graph with the Lengauer-Tarjan algorithm and reports retained sizes per class, the objects which *
+ * retain the most memory, and the largest strings and tables. Objects which are referenced from outside the heap      *
+ * (i.e. whose reference count is larger than the number of references found in the snapshot) are treated as roots.    *
+ *                                                                                                                     *
+ ***********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <elvea/snapshot.h>
+
+// Marks unvisited vertices and empty lists.
+#define NONE UINT32_MAX
+
+// Class id used for arena slots.
+#define SLOT_CLASS UINT32_MAX
+
+// Default number of entries in each "top" list.
+#define DEFAULT_TOP_COUNT 20
+
+typedef struct node_t
+{
+	uint64_t address;
+	uint64_t size;
+
+	// Number of bytes in a string, or number of entries in a table.
+	uint64_t length;
+
+	// Edges, as indices in the edge array.
+	size_t edge_start, edge_count;
+
+	// Prefix of a string, as an offset in the snapshot.
+	size_t prefix_start, prefix_size;
+
+	uint32_t class_id;
+	uint32_t kind;
+	uint32_t ref_count;
+} node_t;
+
+typedef struct heap_t
+{
+	// Contents of the snapshot file.
+	unsigned char *data;
+	size_t size, position;
+
+	// Class names.
+	char **classes;
+	size_t class_count, class_capacity;
+
+	node_t *nodes;
+	size_t node_count, node_capacity;
+
+	// Targets of the edges: addresses when the snapshot is read, then vertex numbers (see resolve_edges()).
+	uint64_t *edges;
+	size_t edge_count, edge_capacity;
+
+	uint64_t memory_used, page_count, empty_page_count;
+} heap_t;
+
+// Vertex 0 is a virtual root which points to all the roots, and vertex i is node i-1.
+typedef struct graph_t
+{
+	uint32_t vertex_count;
+
+	// Successors and predecessors, in compressed row format.
+	uint32_t *succ_start, *succ;
+	uint32_t *pred_start, *pred;
+
+	// Immediate dominator of each vertex (NONE if unreachable), vertices in DFS order, and number of reachable vertices.
+	uint32_t *idom;
+	uint32_t *order;
+	uint32_t reachable_count;
+
+	// Number of roots.
+	uint32_t root_count;
+
+	uint64_t *retained;
+} graph_t;
+
+
+static void fail(const char *message)
+{
+	fprintf(stderr, "elvea-heap: %s\n", message);
+	exit(1);
+}
+
+static void *xrealloc(void *ptr, size_t size)
+{
+	void *result = realloc(ptr, size ? size : 1);
+	if (result == NULL) fail("out of memory");
+	return result;
+}
+
+static void *xcalloc(size_t count, size_t size)
+{
+	void *result = calloc(count ? count : 1, size);
+	if (result == NULL) fail("out of memory");
+	return result;
+}
+
+static void reserve(void **items, size_t *capacity, size_t count, size_t item_size)
+{
+	if (count == *capacity)
+	{
+		*capacity = *capacity ? *capacity * 2 : 64;
+		*items = xrealloc(*items, *capacity * item_size);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Reading
+//----------------------------------------------------------------------------------------------------------------------
+
+static unsigned char read_byte(heap_t *heap)
+{
+	if (heap->position >= heap->size) fail("truncated snapshot");
+	return heap->data[heap->position++];
+}
+
+static uint64_t read_varint(heap_t *heap)
+{
+	uint64_t value = 0;
+	unsigned int shift = 0;
+	unsigned char byte;
+
+	do {
+		byte = read_byte(heap);
+		if (shift > 63) fail("corrupt snapshot");
+		value |= (uint64_t) (byte & 0x7f) << shift;
+		shift += 7;
+	}
+	while (byte & 0x80);
+
+	return value;
+}
+
+// Skip a length-prefixed byte string and return its offset.
+static size_t read_bytes(heap_t *heap, size_t *size)
+{
+	*size = (size_t) read_varint(heap);
+	size_t start = heap->position;
+
+	if (*size > heap->size - start) fail("truncated snapshot");
+	heap->position += *size;
+
+	return start;
+}
+
+static void read_class(heap_t *heap)
+{
+	uint64_t id = read_varint(heap);
+	size_t size;
+	size_t start = read_bytes(heap, &size);
+
+	if (id != heap->class_count) fail("corrupt snapshot: unexpected class id");
+	reserve((void**) &heap->classes, &heap->class_capacity, heap->class_count, sizeof(char*));
+	char *name = (char*) xrealloc(NULL, size + 1);
+	memcpy(name, heap->data + start, size);
+	name[size] = '\0';
+	heap->classes[heap->class_count++] = name;
+}
+
+static node_t *new_node(heap_t *heap)
+{
+	reserve((void**) &heap->nodes, &heap->node_capacity, heap->node_count, sizeof(node_t));
+	node_t *node = &heap->nodes[heap->node_count++];
+	memset(node, 0, sizeof(node_t));
+	node->edge_start = heap->edge_count;
+
+	return node;
+}
+
+static void add_edge(heap_t *heap, uint64_t address)
+{
+	reserve((void**) &heap->edges, &heap->edge_capacity, heap->edge_count, sizeof(uint64_t));
+	heap->edges[heap->edge_count++] = address;
+}
+
+static void read_object(heap_t *heap)
+{
+	node_t *node = new_node(heap);
+	node->address = read_varint(heap);
+	node->class_id = (uint32_t) read_varint(heap);
+	node->kind = (uint32_t) read_varint(heap);
+	node->size = read_varint(heap);
+	node->ref_count = (uint32_t) read_varint(heap);
+	uint64_t edge_count = read_varint(heap);
+
+	if (node->class_id >= heap->class_count) fail("corrupt snapshot: unknown class");
+	for (uint64_t i = 0; i < edge_count; i++) {
+		add_edge(heap, read_varint(heap));
+	}
+	node->edge_count = (size_t) edge_count;
+
+	if (node->kind == ELVEA_SNAPSHOT_STRING)
+	{
+		node->length = read_varint(heap);
+		node->prefix_start = read_bytes(heap, &node->prefix_size);
+	}
+	else if (node->kind == ELVEA_SNAPSHOT_TABLE)
+	{
+		node->length = read_varint(heap);
+	}
+}
+
+static void read_slot(heap_t *heap)
+{
+	node_t *node = new_node(heap);
+	node->address = read_varint(heap);
+	node->size = read_varint(heap);
+	node->class_id = SLOT_CLASS;
+	uint64_t target = read_varint(heap);
+
+	if (target != 0)
+	{
+		add_edge(heap, target);
+		node->edge_count = 1;
+	}
+}
+
+static void read_snapshot(heap_t *heap, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	size_t capacity = 0;
+
+	if (file == NULL) {
+		fail("cannot open snapshot");
+	}
+	memset(heap, 0, sizeof(heap_t));
+
+	while (! feof(file))
+	{
+		reserve((void**) &heap->data, &capacity, heap->size, 1);
+		heap->size += fread(heap->data + heap->size, 1, capacity - heap->size, file);
+		if (ferror(file)) fail("cannot read snapshot");
+	}
+	fclose(file);
+
+	if (heap->size < 8 || memcmp(heap->data, ELVEA_SNAPSHOT_MAGIC, 8) != 0) {
+		fail("not a heap snapshot");
+	}
+	heap->position = 8;
+
+	if (read_varint(heap) != ELVEA_SNAPSHOT_VERSION) {
+		fail("unsupported snapshot version");
+	}
+
+	while (true)
+	{
+		switch (read_byte(heap))
+		{
+			case ELVEA_SNAPSHOT_CLASS:
+				read_class(heap);
+				break;
+			case ELVEA_SNAPSHOT_OBJECT:
+				read_object(heap);
+				break;
+			case ELVEA_SNAPSHOT_SLOT:
+				read_slot(heap);
+				break;
+			case ELVEA_SNAPSHOT_END:
+				heap->memory_used = read_varint(heap);
+				heap->page_count = read_varint(heap);
+				heap->empty_page_count = read_varint(heap);
+				return;
+			default:
+				fail("corrupt snapshot: unknown record");
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Graph
+//----------------------------------------------------------------------------------------------------------------------
+
+static size_t hash_address(uint64_t address, size_t capacity)
+{
+	address ^= address >> 33;
+	address *= UINT64_C(0xff51afd7ed558ccd);
+	address ^= address >> 33;
+
+	return (size_t) address & (capacity - 1);
+}
+
+// Replace the addresses in the edge array by vertex numbers, or NONE for objects which are not in the snapshot.
+static void resolve_edges(heap_t *heap)
+{
+	size_t capacity = 64;
+	while (capacity < heap->node_count * 2) capacity *= 2;
+	uint32_t *table = (uint32_t*) xrealloc(NULL, capacity * sizeof(uint32_t));
+	memset(table, 0xff, capacity * sizeof(uint32_t));
+
+	for (size_t i = 0; i < heap->node_count; i++)
+	{
+		size_t h = hash_address(heap->nodes[i].address, capacity);
+		while (table[h] != NONE) h = (h + 1) & (capacity - 1);
+		table[h] = (uint32_t) i;
+	}
+
+	for (size_t i = 0; i < heap->edge_count; i++)
+	{
+		uint64_t address = heap->edges[i];
+		size_t h = hash_address(address, capacity);
+		uint32_t vertex = NONE;
+
+		for (; table[h] != NONE; h = (h + 1) & (capacity - 1))
+		{
+			if (heap->nodes[table[h]].address == address)
+			{
+				vertex = table[h] + 1;
+				break;
+			}
+		}
+		heap->edges[i] = vertex;
+	}
+	free(table);
+}
+
+static void build_graph(heap_t *heap, graph_t *graph)
+{
+	uint32_t n = (uint32_t) heap->node_count + 1;
+	uint32_t *in_degree = (uint32_t*) xcalloc(n, sizeof(uint32_t));
+	size_t edge_count = 0;
+
+	memset(graph, 0, sizeof(graph_t));
+	graph->vertex_count = n;
+	resolve_edges(heap);
+
+	for (size_t i = 0; i < heap->edge_count; i++)
+	{
+		if (heap->edges[i] != NONE)
+		{
+			in_degree[heap->edges[i]]++;
+			edge_count++;
+		}
+	}
+
+	// Objects which are referenced from outside the heap are roots, as well as arena slots which are not referenced by
+	// any object (e.g. variants allocated by native code).
+	bool *is_root = (bool*) xcalloc(n, sizeof(bool));
+
+	for (uint32_t v = 1; v < n; v++)
+	{
+		node_t *node = &heap->nodes[v - 1];
+		is_root[v] = (in_degree[v] == 0) || (node->class_id != SLOT_CLASS && node->ref_count > in_degree[v]);
+		if (is_root[v]) graph->root_count++;
+	}
+	edge_count += graph->root_count;
+
+	graph->succ_start = (uint32_t*) xcalloc(n + 1, sizeof(uint32_t));
+	graph->succ = (uint32_t*) xcalloc(edge_count, sizeof(uint32_t));
+	size_t k = 0;
+
+	for (uint32_t v = 1; v < n; v++)
+	{
+		if (is_root[v]) graph->succ[k++] = v;
+	}
+
+	for (uint32_t v = 1; v < n; v++)
+	{
+		node_t *node = &heap->nodes[v - 1];
+		graph->succ_start[v] = (uint32_t) k;
+
+		for (size_t i = 0; i < node->edge_count; i++)
+		{
+			uint64_t target = heap->edges[node->edge_start + i];
+			if (target != NONE) graph->succ[k++] = (uint32_t) target;
+		}
+	}
+	graph->succ_start[n] = (uint32_t) k;
+
+	// Predecessors.
+	uint32_t *count = (uint32_t*) xcalloc(n + 1, sizeof(uint32_t));
+	for (size_t i = 0; i < k; i++) count[graph->succ[i] + 1]++;
+	for (uint32_t v = 0; v < n; v++) count[v + 1] += count[v];
+	graph->pred_start = count;
+	graph->pred = (uint32_t*) xcalloc(edge_count, sizeof(uint32_t));
+	uint32_t *fill = (uint32_t*) xrealloc(NULL, (n + 1) * sizeof(uint32_t));
+	memcpy(fill, count, (n + 1) * sizeof(uint32_t));
+
+	for (uint32_t v = 0; v < n; v++)
+	{
+		for (uint32_t i = graph->succ_start[v]; i < graph->succ_start[v + 1]; i++) {
+			graph->pred[fill[graph->succ[i]]++] = v;
+		}
+	}
+
+	free(fill);
+	free(is_root);
+	free(in_degree);
+}
+
+// Find the vertex with the smallest semi-dominator on the path from v to the root of its tree in the forest, with path
+// compression. This is iterative, since paths can be as long as the heap is deep.
+static uint32_t eval(uint32_t v, uint32_t *ancestor, uint32_t *label, const uint32_t *semi, uint32_t *stack)
+{
+	if (ancestor[v] == NONE) {
+		return v;
+	}
+
+	uint32_t count = 0;
+	for (uint32_t u = v; ancestor[ancestor[u]] != NONE; u = ancestor[u]) {
+		stack[count++] = u;
+	}
+	while (count > 0)
+	{
+		uint32_t u = stack[--count];
+
+		if (semi[label[ancestor[u]]] < semi[label[u]]) {
+			label[u] = label[ancestor[u]];
+		}
+		ancestor[u] = ancestor[ancestor[u]];
+	}
+
+	return label[v];
+}
+
+// Lengauer-Tarjan dominator algorithm (see T. Lengauer and R.E. Tarjan, "A Fast Algorithm for Finding Dominators in a
+// Flowgraph", 1979), simple version.
+static void compute_dominators(graph_t *graph)
+{
+	uint32_t n = graph->vertex_count;
+	uint32_t *semi = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *parent = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *ancestor = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *label = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *bucket = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *next = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *stack = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *cursor = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *vertex = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *idom = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t count = 0, depth = 0;
+
+	for (uint32_t v = 0; v < n; v++)
+	{
+		semi[v] = parent[v] = ancestor[v] = idom[v] = bucket[v] = NONE;
+		label[v] = v;
+	}
+
+	// Number the vertices in DFS order.
+	semi[0] = count;
+	vertex[count++] = 0;
+	stack[depth] = 0;
+	cursor[depth++] = graph->succ_start[0];
+
+	while (depth > 0)
+	{
+		uint32_t v = stack[depth - 1];
+
+		if (cursor[depth - 1] == graph->succ_start[v + 1])
+		{
+			depth--;
+			continue;
+		}
+
+		uint32_t w = graph->succ[cursor[depth - 1]++];
+
+		if (semi[w] == NONE)
+		{
+			parent[w] = v;
+			semi[w] = count;
+			vertex[count++] = w;
+			stack[depth] = w;
+			cursor[depth++] = graph->succ_start[w];
+		}
+	}
+
+	for (uint32_t i = count - 1; i > 0; i--)
+	{
+		uint32_t w = vertex[i];
+
+		for (uint32_t j = graph->pred_start[w]; j < graph->pred_start[w + 1]; j++)
+		{
+			uint32_t v = graph->pred[j];
+
+			if (semi[v] != NONE)
+			{
+				uint32_t u = eval(v, ancestor, label, semi, stack);
+				if (semi[u] < semi[w]) semi[w] = semi[u];
+			}
+		}
+
+		uint32_t s = vertex[semi[w]];
+		next[w] = bucket[s];
+		bucket[s] = w;
+		ancestor[w] = parent[w];
+
+		uint32_t p = parent[w];
+
+		for (uint32_t v = bucket[p]; v != NONE; v = next[v])
+		{
+			uint32_t u = eval(v, ancestor, label, semi, stack);
+			idom[v] = (semi[u] < semi[v]) ? u : p;
+		}
+		bucket[p] = NONE;
+	}
+
+	for (uint32_t i = 1; i < count; i++)
+	{
+		uint32_t w = vertex[i];
+		if (idom[w] != vertex[semi[w]]) idom[w] = idom[idom[w]];
+	}
+
+	graph->idom = idom;
+	graph->order = vertex;
+	graph->reachable_count = count;
+
+	free(semi);
+	free(parent);
+	free(ancestor);
+	free(label);
+	free(bucket);
+	free(next);
+	free(stack);
+	free(cursor);
+}
+
+// The retained size of a vertex is the size of all the vertices it dominates, including itself.
+static void compute_retained_sizes(heap_t *heap, graph_t *graph)
+{
+	graph->retained = (uint64_t*) xcalloc(graph->vertex_count, sizeof(uint64_t));
+
+	for (uint32_t v = 1; v < graph->vertex_count; v++) {
+		graph->retained[v] = heap->nodes[v - 1].size;
+	}
+	for (uint32_t i = graph->reachable_count - 1; i > 0; i--)
+	{
+		uint32_t w = graph->order[i];
+		graph->retained[graph->idom[w]] += graph->retained[w];
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Reports
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef struct class_stats_t
+{
+	const char *name;
+	uint64_t count, shallow, retained;
+} class_stats_t;
+
+// Data used by the comparison functions.
+static heap_t *sort_heap;
+static graph_t *sort_graph;
+
+static int compare_u64(uint64_t a, uint64_t b)
+{
+	return (a < b) ? 1 : (a > b) ? -1 : 0;
+}
+
+static int by_retained_size(const void *a, const void *b)
+{
+	return compare_u64(sort_graph->retained[*(const uint32_t*) a], sort_graph->retained[*(const uint32_t*) b]);
+}
+
+static int by_string_length(const void *a, const void *b)
+{
+	return compare_u64(sort_heap->nodes[*(const uint32_t*) a - 1].length, sort_heap->nodes[*(const uint32_t*) b - 1].length);
+}
+
+static int by_class_retained_size(const void *a, const void *b)
+{
+	return compare_u64(((const class_stats_t*) a)->retained, ((const class_stats_t*) b)->retained);
+}
+
+static void print_size(uint64_t size)
+{
+	static const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+	double value = (double) size;
+	int unit = 0;
+
+	while (value >= 1024 && unit < 4)
+	{
+		value /= 1024;
+		unit++;
+	}
+	if (unit == 0) {
+		printf("%10" PRIu64 " B ", size);
+	}
+	else {
+		printf("%10.1f %s", value, units[unit]);
+	}
+}
+
+static const char *class_name(heap_t *heap, uint32_t v)
+{
+	uint32_t id = heap->nodes[v - 1].class_id;
+	return (id == SLOT_CLASS) ? "<arena slot>" : heap->classes[id];
+}
+
+// Print the beginning of a string, with control characters escaped.
+static void print_prefix(heap_t *heap, node_t *node)
+{
+	putchar('"');
+	for (size_t i = 0; i < node->prefix_size; i++)
+	{
+		unsigned char c = heap->data[node->prefix_start + i];
+
+		if (c == '"' || c == '\\') printf("\\%c", c);
+		else if (c < 0x20 || c == 0x7f) printf("\\x%02x", c);
+		else putchar(c);
+	}
+	putchar('"');
+	if (node->length > node->prefix_size) printf("...");
+}
+
+// Compute statistics per class. An object's retained size is only counted for its class if it is not dominated by
+// another instance of the same class, so that nested structures are not counted twice.
+static class_stats_t *get_class_stats(heap_t *heap, graph_t *graph, size_t *count)
+{
+	uint32_t n = graph->vertex_count;
+	size_t class_count = heap->class_count + 1;
+	class_stats_t *stats = (class_stats_t*) xcalloc(class_count, sizeof(class_stats_t));
+	uint64_t *active = (uint64_t*) xcalloc(class_count, sizeof(uint64_t));
+
+	for (size_t i = 0; i < heap->class_count; i++) {
+		stats[i].name = heap->classes[i];
+	}
+	stats[heap->class_count].name = "<arena slot>";
+
+	// Children of each vertex in the dominator tree.
+	uint32_t *child_start = (uint32_t*) xcalloc(n + 1, sizeof(uint32_t));
+	uint32_t *children = (uint32_t*) xcalloc(n, sizeof(uint32_t));
+	for (uint32_t i = 1; i < graph->reachable_count; i++) child_start[graph->idom[graph->order[i]] + 1]++;
+	for (uint32_t v = 0; v < n; v++) child_start[v + 1] += child_start[v];
+	uint32_t *fill = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	memcpy(fill, child_start, n * sizeof(uint32_t));
+	for (uint32_t i = 1; i < graph->reachable_count; i++)
+	{
+		uint32_t w = graph->order[i];
+		children[fill[graph->idom[w]]++] = w;
+	}
+
+	// Walk the dominator tree, keeping track of the classes of the vertices on the current path.
+	uint32_t *stack = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t *cursor = (uint32_t*) xrealloc(NULL, n * sizeof(uint32_t));
+	uint32_t depth = 0;
+	stack[depth] = 0;
+	cursor[depth++] = child_start[0];
+
+	while (depth > 0)
+	{
+		uint32_t v = stack[depth - 1];
+
+		if (cursor[depth - 1] == child_start[v + 1])
+		{
+			if (v != 0)
+			{
+				uint32_t id = heap->nodes[v - 1].class_id;
+				active[id == SLOT_CLASS ? heap->class_count : id]--;
+			}
+			depth--;
+			continue;
+		}
+
+		uint32_t w = children[cursor[depth - 1]++];
+		node_t *node = &heap->nodes[w - 1];
+		size_t id = (node->class_id == SLOT_CLASS) ? heap->class_count : node->class_id;
+
+		stats[id].count++;
+		stats[id].shallow += node->size;
+		if (active[id]++ == 0) stats[id].retained += graph->retained[w];
+
+		stack[depth] = w;
+		cursor[depth++] = child_start[w];
+	}
+
+	free(child_start);
+	free(children);
+	free(fill);
+	free(stack);
+	free(cursor);
+	free(active);
+	*count = class_count;
+
+	return stats;
+}
+
+static void report(heap_t *heap, graph_t *graph, size_t top_count)
+{
+	uint32_t n = graph->vertex_count;
+	uint64_t total = 0, unreachable = 0, unreachable_size = 0, slot_count = 0;
+
+	for (uint32_t v = 1; v < n; v++)
+	{
+		node_t *node = &heap->nodes[v - 1];
+		total += node->size;
+		if (node->class_id == SLOT_CLASS) slot_count++;
+
+		if (graph->idom[v] == NONE)
+		{
+			unreachable++;
+			unreachable_size += node->size;
+		}
+	}
+
+	printf("Snapshot: %" PRIu64 " objects, %" PRIu64 " arena slots, %zu references\n", n - 1 - slot_count, slot_count,
+			heap->edge_count);
+	printf("Total size:");
+	print_size(total);
+	printf("    memory used:");
+	print_size(heap->memory_used);
+	printf("    arena pages: %" PRIu64 " (%" PRIu64 " empty)\n", heap->page_count, heap->empty_page_count);
+	printf("Roots: %u    unreachable (garbage cycles awaiting collection): %" PRIu64 " objects,", graph->root_count,
+			unreachable);
+	print_size(unreachable_size);
+	printf("\n\n");
+
+	// Classes.
+	size_t class_count;
+	class_stats_t *stats = get_class_stats(heap, graph, &class_count);
+	qsort(stats, class_count, sizeof(class_stats_t), by_class_retained_size);
+	printf("Retained size per class:\n");
+	printf("  %-24s %12s %13s %13s\n", "class", "count", "shallow", "retained");
+
+	for (size_t i = 0; i < class_count; i++)
+	{
+		if (stats[i].count == 0) continue;
+		printf("  %-24s %12" PRIu64 " ", stats[i].name, stats[i].count);
+		print_size(stats[i].shallow);
+		printf(" ");
+		print_size(stats[i].retained);
+		printf("\n");
+	}
+	free(stats);
+
+	// Objects sorted by retained size.
+	uint32_t *vertices = (uint32_t*) xcalloc(n, sizeof(uint32_t));
+	uint32_t count = 0;
+	sort_heap = heap;
+	sort_graph = graph;
+
+	for (uint32_t v = 1; v < n; v++) {
+		if (graph->idom[v] != NONE) vertices[count++] = v;
+	}
+	qsort(vertices, count, sizeof(uint32_t), by_retained_size);
+
+	printf("\nObjects which retain the most memory:\n");
+	printf("  %-18s %-24s %13s %13s\n", "address", "class", "shallow", "retained");
+	for (uint32_t i = 0; i < count && i < top_count; i++)
+	{
+		uint32_t v = vertices[i];
+		printf("  0x%016" PRIx64 " %-24s ", heap->nodes[v - 1].address, class_name(heap, v));
+		print_size(heap->nodes[v - 1].size);
+		printf(" ");
+		print_size(graph->retained[v]);
+		printf("\n");
+	}
+
+	printf("\nLargest tables:\n");
+	printf("  %-18s %12s %13s\n", "address", "entries", "retained");
+	for (uint32_t i = 0, shown = 0; i < count && shown < top_count; i++)
+	{
+		node_t *node = &heap->nodes[vertices[i] - 1];
+		if (node->kind != ELVEA_SNAPSHOT_TABLE || node->class_id == SLOT_CLASS) continue;
+		printf("  0x%016" PRIx64 " %12" PRIu64 " ", node->address, node->length);
+		print_size(graph->retained[vertices[i]]);
+		printf("\n");
+		shown++;
+	}
+
+	// Strings, sorted by length.
+	count = 0;
+	for (uint32_t v = 1; v < n; v++)
+	{
+		node_t *node = &heap->nodes[v - 1];
+		if (node->kind == ELVEA_SNAPSHOT_STRING && node->class_id != SLOT_CLASS) vertices[count++] = v;
+	}
+	qsort(vertices, count, sizeof(uint32_t), by_string_length);
+
+	printf("\nLargest strings:\n");
+	printf("  %-18s %12s %6s  %s\n", "address", "length", "refs", "contents");
+	for (uint32_t i = 0; i < count && i < top_count; i++)
+	{
+		node_t *node = &heap->nodes[vertices[i] - 1];
+		printf("  0x%016" PRIx64 " %12" PRIu64 " %6u  ", node->address, node->length, node->ref_count);
+		print_prefix(heap, node);
+		printf("\n");
+	}
+	free(vertices);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+	size_t top_count = DEFAULT_TOP_COUNT;
+	const char *path = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			top_count = (size_t) strtoul(argv[++i], NULL, 10);
+		}
+		else if (path == NULL && argv[i][0] != '-') {
+			path = argv[i];
+		}
+		else {
+			path = NULL;
+			break;
+		}
+	}
+	if (path == NULL)
+	{
+		fprintf(stderr, "Usage: elvea-heap [-n count] snapshot\n");
+		return 2;
+	}
+
+	heap_t heap;
+	graph_t graph;
+	read_snapshot(&heap, path);
+
+	if (heap.node_count >= NONE - 1) {
+		fail("too many objects");
+	}
+	build_graph(&heap, &graph);
+	compute_dominators(&graph);
+	compute_retained_sizes(&heap, &graph);
+	report(&heap, &graph, top_count);
+
+	return 0;
+}
@@ -4,8 +4,22 @@
 
 
 CuSuite* string_test_suite();
+CuSuite* slab_test_suite();
+CuSuite* region_test_suite();
+CuSuite* arena_test_suite();
+CuSuite* profiler_test_suite();
+CuSuite* memory_test_suite();
 //CuSuite* set_test_suite();
-//CuSuite* table_test_suite();
+CuSuite* table_test_suite();
+CuSuite* remote_test_suite();
+CuSuite* gc_test_suite();
+CuSuite* collector_test_suite();
+CuSuite* snapshot_test_suite();
+CuSuite* variant_test_suite();
+CuSuite* hash_test_suite();
+CuSuite* sort_test_suite();
+CuSuite* strbuf_test_suite();
+CuSuite* rope_test_suite();
 
 int main()
 {
@@ -16,6 +30,21 @@ int main()
 	CuSuite *suite = CuSuiteNew();
 
 	CuSuiteAddSuite(suite, string_test_suite());
+	CuSuiteAddSuite(suite, slab_test_suite());
+	CuSuiteAddSuite(suite, region_test_suite());
+	CuSuiteAddSuite(suite, arena_test_suite());
+	CuSuiteAddSuite(suite, profiler_test_suite());
+	CuSuiteAddSuite(suite, memory_test_suite());
+	CuSuiteAddSuite(suite, table_test_suite());
+	CuSuiteAddSuite(suite, remote_test_suite());
+	CuSuiteAddSuite(suite, gc_test_suite());
+	CuSuiteAddSuite(suite, collector_test_suite());
+	CuSuiteAddSuite(suite, snapshot_test_suite());
+	CuSuiteAddSuite(suite, variant_test_suite());
+	CuSuiteAddSuite(suite, hash_test_suite());
+	CuSuiteAddSuite(suite, sort_test_suite());
+	CuSuiteAddSuite(suite, strbuf_test_suite());
+	CuSuiteAddSuite(suite, rope_test_suite());
 
 	printf("Running unit tests:\n\n");
 	CuSuiteRun(suite, thread);
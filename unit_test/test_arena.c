@@ -0,0 +1,85 @@
+#include "test.h"
+#include <elvea/arena.h>
+
+#define SLOT_COUNT (3 * ELVEA_PAGE_SIZE)
+
+static elvea_alias_t *aliases[SLOT_COUNT];
+
+static
+void test_arena_compact(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_arena_t arena;
+	elvea_arena_initialize(&arena);
+
+	for (int i = 0; i < SLOT_COUNT; ++i) {
+		aliases[i] = elvea_arena_alloc_alias(thread, &arena);
+		CuAssertTrue(tc, aliases[i]->meta.arena);
+	}
+	CuAssertIntEquals(tc, 3, (int) arena.page_count);
+
+	// Empty the first page, and leave a single slot in the second one.
+	for (int i = 0; i < 2 * ELVEA_PAGE_SIZE - 1; ++i) {
+		elvea_arena_recycle_alias(thread, &arena, aliases[i]);
+	}
+	CuAssertIntEquals(tc, 1, (int) arena.empty_count);
+
+	elvea_arena_compact(thread, &arena);
+	CuAssertIntEquals(tc, 2, (int) arena.page_count);
+	CuAssertIntEquals(tc, 0, (int) arena.empty_count);
+
+	// New slots come from the fullest page, which is the second one.
+	elvea_alias_t *alias = elvea_arena_alloc_alias(thread, &arena);
+	CuAssertTrue(tc, alias >= aliases[ELVEA_PAGE_SIZE] && alias < aliases[2 * ELVEA_PAGE_SIZE - 1]);
+	CuAssertIntEquals(tc, 2, (int) arena.page_count);
+
+	elvea_arena_finalize(thread, &arena);
+	CuAssertIntEquals(tc, 0, (int) arena.page_count);
+}
+
+static
+void test_arena_reserve(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_arena_t arena;
+	elvea_arena_initialize(&arena);
+
+	if (! elvea_arena_reserve(thread, &arena, 2 * 1024 * 1024, true)) {
+		return; // virtual memory is not supported on this platform
+	}
+
+	for (int i = 0; i < SLOT_COUNT; ++i) {
+		aliases[i] = elvea_arena_alloc_alias(thread, &arena);
+		aliases[i]->meta.ref_count = (uint32_t) i;
+	}
+	CuAssertTrue(tc, (char*) aliases[0] >= arena.range.base && (char*) aliases[0] < arena.range.base + arena.range.size);
+
+	// Empty the first page and give its memory back to the system.
+	for (int i = 0; i < ELVEA_PAGE_SIZE; ++i) {
+		elvea_arena_recycle_alias(thread, &arena, aliases[i]);
+	}
+	elvea_arena_compact(thread, &arena);
+	CuAssertIntEquals(tc, 2, (int) arena.page_count);
+	CuAssertIntEquals(tc, 1, (int) arena.range.released_count);
+
+	// The page's address is reused when we need a new page.
+	for (int i = 0; i < ELVEA_PAGE_SIZE; ++i) {
+		aliases[i] = elvea_arena_alloc_alias(thread, &arena);
+	}
+	CuAssertIntEquals(tc, 0, (int) arena.range.released_count);
+	CuAssertIntEquals(tc, 3, (int) arena.range.used);
+	CuAssertIntEquals(tc, SLOT_COUNT - 1, (int) aliases[SLOT_COUNT - 1]->meta.ref_count);
+
+	elvea_arena_finalize(thread, &arena);
+	CuAssertPtrEquals(tc, NULL, arena.range.base);
+}
+
+CuSuite* arena_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_arena_compact);
+	SUITE_ADD_TEST(suite, test_arena_reserve);
+
+	return suite;
+}
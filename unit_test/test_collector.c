@@ -0,0 +1,71 @@
+#include "test.h"
+#include <elvea/table.h>
+#include <elvea/utils/alloc.h>
+
+static
+void link_table(elvea_thread_t *thread, elvea_table_t *table, elvea_table_t *value)
+{
+	elvea_variant_t k, v;
+	elvea_init_num(thread, &k, 1);
+	elvea_init_object(thread, &v, value);
+	elvea_table_set(thread, table, &k, &v);
+	elvea_clear(thread, &v);
+}
+
+static
+void test_collector(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	const int count = 10000;
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t collections = thread->gc.collection_count;
+
+	elvea_collector_t *collector = elvea_collector_start(thread->runtime, 50000, 100000);
+	CuAssertPtrNotNull(tc, collector);
+	elvea_collector_add(collector, thread);
+
+	// Build a ring of tables and drop it.
+	elvea_table_t *first = elvea_table_new(thread, 1);
+	elvea_table_t *last = first;
+	elvea_object_retain(thread, first);
+	for (int i = 1; i < count; ++i)
+	{
+		elvea_table_t *t = elvea_table_new(thread, 1);
+		elvea_object_retain(thread, t);
+		link_table(thread, last, t);
+		if (last != first) elvea_object_release(thread, last);
+		last = t;
+	}
+	link_table(thread, last, first);
+	elvea_object_release(thread, last);
+	elvea_object_release(thread, first);
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+
+	// Let the collector find the garbage while the heap is detached.
+	for (int i = 0; i < 5000 && thread->gc.collection_count == collections; ++i)
+	{
+		struct timespec delay = { 0, 1000000 };
+		elvea_thread_detach(thread);
+		elvea_collector_wake(collector);
+		thrd_sleep(&delay, NULL);
+		elvea_thread_attach(thread);
+	}
+	CuAssertTrue(tc, thread->gc.collection_count > collections);
+
+	// The garbage was reclaimed by this thread when it attached its heap.
+	CuAssertIntEquals(tc, 0, (int) thread->gc.collected.count);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	elvea_collector_remove(collector, thread);
+	elvea_collector_stop(collector);
+}
+
+CuSuite* collector_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_collector);
+
+	return suite;
+}
@@ -0,0 +1,477 @@
+#include <string.h>
+#include "test.h"
+#include <elvea/string.h>
+#include <elvea/table.h>
+#include <elvea/utils/alloc.h>
+
+// Store [value] in [table] under a number key.
+static
+void link_table(elvea_thread_t *thread, elvea_table_t *table, double key, elvea_table_t *value)
+{
+	elvea_variant_t k, v;
+	elvea_init_num(thread, &k, key);
+	elvea_init_object(thread, &v, value);
+	elvea_table_set(thread, table, &k, &v);
+	elvea_clear(thread, &v);
+}
+
+static
+elvea_table_t *new_table(elvea_thread_t *thread)
+{
+	elvea_table_t *table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, table);
+	return table;
+}
+
+static
+void test_gc_cycle(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// Self-referencing table.
+	elvea_table_t *t1 = new_table(thread);
+	link_table(thread, t1, 1, t1);
+	elvea_object_release(thread, t1);
+
+	// Two tables referencing each other, with a string which is only reachable from the cycle.
+	elvea_table_t *t2 = new_table(thread);
+	elvea_table_t *t3 = new_table(thread);
+	link_table(thread, t2, 1, t3);
+	link_table(thread, t3, 1, t2);
+	STR(s, "hello");
+	elvea_variant_t k, v;
+	elvea_init_num(thread, &k, 2);
+	elvea_init_object(thread, &v, s);
+	elvea_table_set(thread, t3, &k, &v);
+	elvea_clear(thread, &v);
+	elvea_object_release(thread, s);
+	elvea_object_release(thread, t2);
+	elvea_object_release(thread, t3);
+
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+	CuAssertIntEquals(tc, 3, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_live_cycle(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// The cycle is reachable from [root], which is held from outside.
+	elvea_table_t *root = new_table(thread);
+	elvea_table_t *t1 = new_table(thread);
+	elvea_table_t *t2 = new_table(thread);
+	link_table(thread, root, 1, t1);
+	link_table(thread, t1, 1, t2);
+	link_table(thread, t2, 1, t1);
+	elvea_object_release(thread, t1);
+	elvea_object_release(thread, t2);
+
+	CuAssertIntEquals(tc, 0, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, 1, (int) elvea_table_length(thread, t1));
+	CuAssertIntEquals(tc, 1, (int) elvea_table_length(thread, t2));
+
+	// Once the root is gone, the cycle is garbage.
+	elvea_object_release(thread, root);
+	CuAssertIntEquals(tc, 2, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+// Build a ring of tables and return its first element, which is retained.
+static
+elvea_table_t *make_ring(elvea_thread_t *thread, int count)
+{
+	elvea_table_t *first = new_table(thread);
+	elvea_table_t *last = first;
+
+	for (int i = 1; i < count; ++i)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, last, 1, t);
+		if (last != first) elvea_object_release(thread, last);
+		last = t;
+	}
+	link_table(thread, last, 1, first);
+	elvea_object_release(thread, last);
+
+	return first;
+}
+
+static
+void test_gc_deep_cycle(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	const int count = 100000;
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// A long ring of tables: collecting it must not overflow the native stack.
+	elvea_object_release(thread, make_ring(thread, count));
+
+	elvea_gc_collect_cycles(thread);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_root_buffer(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t collections = thread->gc.collection_count;
+
+	// Filling the root buffer triggers a collection.
+	for (int i = 0; i < 2 * ELVEA_GC_ROOT_BUFFER_SIZE; ++i)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, t, 1, t);
+		elvea_object_release(thread, t);
+	}
+	CuAssertTrue(tc, thread->gc.collection_count > collections);
+
+	elvea_gc_collect_cycles(thread);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_incremental(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t collected = thread->gc.collected_count;
+
+	elvea_table_t *first = make_ring(thread, 1000);
+	elvea_object_release(thread, first);
+
+	// With no time budget, each step does a small amount of work.
+	int steps = 1;
+	while (elvea_gc_step(thread, 0)) {
+		steps++;
+	}
+	CuAssertTrue(tc, steps > 1);
+	CuAssertIntEquals(tc, 1000, (int) (thread->gc.collected_count - collected));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+	CuAssertTrue(tc, ! elvea_gc_step(thread, 0));
+}
+
+static
+void test_gc_incremental_abort(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t aborted = thread->gc.abort_count;
+
+	// The ring is alive while the collection starts, and the mutator modifies it before the collection completes.
+	elvea_table_t *first = make_ring(thread, 1000);
+	CuAssertTrue(tc, elvea_gc_step(thread, 0));
+	elvea_table_t *t = new_table(thread);
+	link_table(thread, first, 2, t);
+	link_table(thread, t, 1, first);
+	elvea_object_release(thread, t);
+	elvea_object_release(thread, first);
+
+	while (elvea_gc_step(thread, 0)) continue;
+	CuAssertIntEquals(tc, (int) aborted + 1, (int) thread->gc.abort_count);
+
+	// The aborted collection didn't reclaim anything: the garbage is found by the next one.
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+	while (elvea_gc_step(thread, 1000000)) continue;
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_sigma(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t aborted = thread->gc.abort_count;
+
+	elvea_table_t *first = make_ring(thread, 1000);
+	elvea_object_release(thread, first);
+	while (thread->gc.phase <= ELVEA_GC_MARK) {
+		elvea_gc_step(thread, 0);
+	}
+
+	// A reference which bypasses the barrier (e.g. taken by another thread) is caught by the sigma test.
+	elvea_ref(first);
+	while (elvea_gc_step(thread, 0)) continue;
+	CuAssertIntEquals(tc, (int) aborted + 1, (int) thread->gc.abort_count);
+	CuAssertIntEquals(tc, 1, (int) elvea_table_length(thread, first));
+
+	elvea_object_release(thread, first);
+	CuAssertIntEquals(tc, 1000, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_generations(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_gc_set_generations(thread, 2, 4);
+
+	// The cycle survives two minor collections while [root] holds it, and is promoted.
+	elvea_table_t *root = new_table(thread);
+	elvea_table_t *t1 = new_table(thread);
+	elvea_table_t *t2 = new_table(thread);
+	link_table(thread, root, 1, t1);
+	link_table(thread, t1, 1, t2);
+	link_table(thread, t2, 1, t1);
+	elvea_object_release(thread, t2);
+
+	for (int i = 0; i < 2; i++)
+	{
+		elvea_object_retain(thread, t1);
+		elvea_object_release(thread, t1);
+		while (elvea_gc_step(thread, 1000000)) continue;
+	}
+	elvea_object_release(thread, t1);
+	elvea_object_release(thread, root);
+	CuAssertIntEquals(tc, 1, (int) thread->gc.old_roots.count);
+
+	// Minor collections only reclaim young garbage.
+	elvea_table_t *t3 = new_table(thread);
+	link_table(thread, t3, 1, t3);
+	elvea_object_release(thread, t3);
+	elvea_size_t collected = thread->gc.collected_count;
+	while (elvea_gc_step(thread, 1000000)) continue;
+	CuAssertIntEquals(tc, 1, (int) (thread->gc.collected_count - collected));
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+
+	// A major collection reclaims the old cycle.
+	CuAssertIntEquals(tc, 2, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, 0, (int) thread->gc.old_roots.count);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	elvea_gc_set_generations(thread, ELVEA_GC_PROMOTION_AGE, ELVEA_GC_MAJOR_RATIO);
+}
+
+static
+void test_gc_acyclic(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t root_count = thread->gc.root_count;
+
+	// A table which only holds strings and numbers can't be part of a cycle, so it is not buffered.
+	elvea_table_t *t1 = new_table(thread);
+	STR(s, "hello");
+	elvea_variant_t k, v;
+	elvea_init_object(thread, &k, s);
+	elvea_init_num(thread, &v, 1);
+	elvea_table_set(thread, t1, &k, &v);
+	elvea_clear(thread, &k);
+	elvea_object_release(thread, s);
+	elvea_object_retain(thread, t1);
+	elvea_object_release(thread, t1);
+	CuAssertTrue(tc, ((elvea_object_t*) t1)->meta.acyclic);
+	CuAssertIntEquals(tc, (int) root_count, (int) thread->gc.root_count);
+
+	// It becomes cyclic when it holds a table, and acyclic again when the table is removed.
+	elvea_table_t *t2 = new_table(thread);
+	link_table(thread, t1, 2, t2);
+	CuAssertTrue(tc, ! ((elvea_object_t*) t1)->meta.acyclic);
+	elvea_init_num(thread, &k, 2);
+	elvea_table_remove(thread, t1, &k);
+	CuAssertTrue(tc, ((elvea_object_t*) t1)->meta.acyclic);
+
+	// An acyclic table which is only reachable from a garbage cycle is destroyed along with it.
+	link_table(thread, t2, 1, t1);
+	link_table(thread, t2, 2, t2);
+	elvea_object_release(thread, t1);
+	elvea_object_release(thread, t2);
+	CuAssertIntEquals(tc, 1, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_deferred(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+	elvea_size_t deferred = thread->gc.deferred_count;
+	elvea_variant_t *slots = elvea_gc_scratch_push(thread, 2);
+
+	// A new object which is only held by a scratch slot, and an object released by its last holder.
+	elvea_variant_t v;
+	STR(s, "hello");
+	elvea_init_object(thread, &v, s);
+	elvea_gc_scratch_set(thread, &slots[0], &v);
+	elvea_clear(thread, &v);
+	elvea_object_release(thread, s);
+	elvea_table_t *t = new_table(thread);
+	link_table(thread, t, 1, t);
+	elvea_init_object(thread, &v, t);
+	elvea_gc_scratch_set(thread, &slots[1], &v);
+	elvea_clear(thread, &v);
+	elvea_object_release(thread, t);
+	CuAssertTrue(tc, thread->gc.deferred_count > deferred);
+	CuAssertTrue(tc, ((elvea_object_t*) s)->meta.deferred);
+
+	// The slots keep the objects alive, including from the cycle collector.
+	elvea_gc_reconcile(thread);
+	CuAssertIntEquals(tc, 0, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, 1, (int) elvea_table_length(thread, t));
+	CuAssertIntEquals(tc, 5, (int) elvea_string_length(thread, s));
+
+	elvea_gc_scratch_pop(thread, 2);
+	CuAssertIntEquals(tc, 1, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_deferred_chain(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// Deferred objects are destroyed iteratively, so a long chain doesn't overflow the stack.
+	elvea_table_t *first = new_table(thread);
+	elvea_table_t *last = first;
+	for (int i = 1; i < 100000; i++)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, last, 1, t);
+		elvea_object_release(thread, t);
+		last = t;
+	}
+
+	elvea_gc_scratch_push(thread, 1);
+	elvea_object_release(thread, first);
+	elvea_gc_scratch_pop(thread, 1);
+	elvea_gc_collect_cycles(thread);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_gc_destroy_chain(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// A chain which is long enough to overflow the native stack if finalizers destroyed the next link recursively.
+	const int length = 1000000;
+	elvea_table_t *first = new_table(thread);
+	elvea_table_t *last = first;
+	for (int i = 1; i < length; i++)
+	{
+		elvea_table_t *t = new_table(thread);
+		link_table(thread, last, 1, t);
+		elvea_object_release(thread, t);
+		last = t;
+	}
+
+	// Only the first batch is destroyed right away.
+	elvea_object_release(thread, first);
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+	CuAssertTrue(tc, thread->gc.pending.count > 0);
+
+	// The rest is destroyed in batches at safe points.
+	size_t remaining = elvea_memory_used(thread);
+	elvea_thread_safe_point(thread);
+	CuAssertTrue(tc, elvea_memory_used(thread) < remaining);
+
+	CuAssertTrue(tc, ! elvea_gc_destroy_pending(thread, 0));
+	CuAssertIntEquals(tc, 0, (int) elvea_gc_collect_cycles(thread));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void count_collections(elvea_thread_t *thread, const elvea_gc_event_t *event, void *context)
+{
+	elvea_gc_event_t *last = (elvea_gc_event_t*) context;
+	*last = *event;
+}
+
+static
+void test_gc_stats(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_gc_collect_cycles(thread);
+	elvea_gc_event_t event;
+	memset(&event, 0, sizeof event);
+	elvea_gc_set_callback(thread, count_collections, &event);
+
+	elvea_gc_stats_t before, after;
+	elvea_gc_get_stats(thread, &before);
+
+	// Two tables referencing each other, one of which also refers to a live table.
+	elvea_table_t *live = new_table(thread);
+	elvea_table_t *t1 = new_table(thread);
+	elvea_table_t *t2 = new_table(thread);
+	link_table(thread, t1, 1, t2);
+	link_table(thread, t2, 1, t1);
+	link_table(thread, t2, 2, live);
+	elvea_object_release(thread, t1);
+	elvea_object_release(thread, t2);
+
+	elvea_gc_get_stats(thread, &after);
+	CuAssertIntEquals(tc, 3, (int) (after.object_count - before.object_count));
+	CuAssertTrue(tc, after.root_count > 0);
+
+	elvea_size_t collected = elvea_gc_collect_cycles(thread);
+	elvea_gc_set_callback(thread, NULL, NULL);
+	CuAssertIntEquals(tc, 2, (int) collected);
+	CuAssertTrue(tc, event.major);
+	CuAssertTrue(tc, ! event.aborted);
+	CuAssertIntEquals(tc, 2, (int) event.collected_count);
+	CuAssertTrue(tc, event.candidate_count > 0);
+	CuAssertTrue(tc, event.scanned_count >= event.candidate_count);
+	CuAssertTrue(tc, event.collected_bytes > 0);
+
+	elvea_gc_get_stats(thread, &after);
+	CuAssertIntEquals(tc, 1, (int) (after.collection_count - before.collection_count));
+	CuAssertIntEquals(tc, 2, (int) (after.collected_count - before.collected_count));
+	CuAssertIntEquals(tc, (int) event.collected_bytes, (int) (after.collected_bytes - before.collected_bytes));
+	CuAssertTrue(tc, after.freed_bytes - before.freed_bytes >= event.collected_bytes);
+	CuAssertIntEquals(tc, 1, (int) (after.object_count - before.object_count));
+	CuAssertIntEquals(tc, 0, (int) after.root_count);
+	CuAssertTrue(tc, after.empty_page_count <= after.page_count);
+
+	// Each collection is a pause, which is counted once in the histogram.
+	uint64_t pauses = 0;
+	for (int i = 0; i < ELVEA_GC_PAUSE_BUCKETS; i++) {
+		pauses += after.pauses[i] - before.pauses[i];
+	}
+	CuAssertTrue(tc, after.pause_count > before.pause_count);
+	CuAssertIntEquals(tc, (int) (after.pause_count - before.pause_count), (int) pauses);
+	CuAssertTrue(tc, after.max_pause_ns <= after.pause_ns);
+
+	elvea_object_release(thread, live);
+	elvea_gc_get_stats(thread, &after);
+	CuAssertIntEquals(tc, 0, (int) (after.object_count - before.object_count));
+}
+
+CuSuite* gc_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_gc_cycle);
+	SUITE_ADD_TEST(suite, test_gc_live_cycle);
+	SUITE_ADD_TEST(suite, test_gc_deep_cycle);
+	SUITE_ADD_TEST(suite, test_gc_root_buffer);
+	SUITE_ADD_TEST(suite, test_gc_incremental);
+	SUITE_ADD_TEST(suite, test_gc_incremental_abort);
+	SUITE_ADD_TEST(suite, test_gc_sigma);
+	SUITE_ADD_TEST(suite, test_gc_generations);
+	SUITE_ADD_TEST(suite, test_gc_acyclic);
+	SUITE_ADD_TEST(suite, test_gc_deferred);
+	SUITE_ADD_TEST(suite, test_gc_deferred_chain);
+	SUITE_ADD_TEST(suite, test_gc_destroy_chain);
+	SUITE_ADD_TEST(suite, test_gc_stats);
+
+	return suite;
+}
@@ -0,0 +1,164 @@
+#include <math.h>
+#include <string.h>
+#include "test.h"
+
+
+static
+void test_siphash(CuTest *tc)
+{
+	// Test vectors from the SipHash paper: the key is 00 01 .. 0f, and the message is 00 01 .. (len-1).
+	uint64_t key[2] = { UINT64_C(0x0706050403020100), UINT64_C(0x0f0e0d0c0b0a0908) };
+	uint8_t message[64];
+
+	for (int i = 0; i < 64; i++) {
+		message[i] = (uint8_t) i;
+	}
+	CuAssertTrue(tc, elvea_siphash(message, 0, key) == UINT64_C(0x726fdb47dd0e0e31));
+	CuAssertTrue(tc, elvea_siphash(message, 8, key) == UINT64_C(0x93f5f5799a932462));
+	CuAssertTrue(tc, elvea_siphash(message, 15, key) == UINT64_C(0xa129ca6149be45e5));
+	CuAssertTrue(tc, elvea_siphash(message, 63, key) == UINT64_C(0x958a324ceb064572));
+}
+
+static
+void test_hash_bytes(CuTest *tc)
+{
+	static uint8_t buffer[4096 + 16];
+	uint32_t state = 1;
+
+	for (size_t i = 0; i < sizeof buffer; i++) {
+		buffer[i] = (uint8_t) (state = state * 1103515245 + 12345) >> 16;
+	}
+
+	// Every length goes through a different path, and flipping any byte (including those which are read twice by the
+	// short paths, or which fall in the overlapping last stripe of the long path) must change the hash.
+	size_t lengths[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 48, 49, 100, 256, 257, 1000, 1024, 4096 };
+	for (size_t k = 0; k < sizeof lengths / sizeof lengths[0]; k++)
+	{
+		size_t len = lengths[k];
+		uint64_t h = elvea_hash_bytes(buffer, len, 42);
+
+		CuAssertTrue(tc, h == elvea_hash_bytes(buffer, len, 42));
+		CuAssertTrue(tc, h != elvea_hash_bytes(buffer, len, 43));
+		if (len < 4096) CuAssertTrue(tc, h != elvea_hash_bytes(buffer, len + 1, 42));
+
+		for (size_t i = 0; i < len; i++)
+		{
+			buffer[i] ^= 1;
+			CuAssertTrue(tc, h != elvea_hash_bytes(buffer, len, 42));
+			buffer[i] ^= 1;
+		}
+
+		// The hash doesn't depend on the alignment of the data.
+		uint8_t copy[4096 + 16];
+		memcpy(copy + 3, buffer, len);
+		CuAssertTrue(tc, h == elvea_hash_bytes(copy + 3, len, 42));
+	}
+}
+
+static
+void test_hash_stream(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	static uint8_t buffer[3000];
+	uint32_t state = 7;
+
+	for (size_t i = 0; i < sizeof buffer; i++) {
+		buffer[i] = (uint8_t) ((state = state * 1103515245 + 12345) >> 16);
+	}
+
+	// The result doesn't depend on how the input is split, including around stripe and block boundaries.
+	size_t lengths[] = { 0, 5, 8, 63, 256, 257, 320, 321, 1024, 1025, 1087, 3000 };
+	size_t pieces[] = { 1, 3, 8, 63, 64, 65, 1000, 5000 };
+	for (size_t k = 0; k < sizeof lengths / sizeof lengths[0]; k++)
+	{
+		size_t len = lengths[k];
+		elvea_size_t h = elvea_hash_data(thread, buffer, len);
+
+		for (size_t j = 0; j < sizeof pieces / sizeof pieces[0]; j++)
+		{
+			elvea_hash_stream_t stream;
+			elvea_hash_stream_init(thread, &stream, len);
+
+			for (size_t i = 0; i < len; i += pieces[j]) {
+				elvea_hash_stream_update(&stream, buffer + i, ELVEA_MIN(pieces[j], len - i));
+			}
+			CuAssertTrue(tc, h == elvea_hash_stream_final(&stream));
+		}
+	}
+}
+
+static
+void test_hash_values(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+
+	// Numbers which are equal to an integer hash like the integer.
+	CuAssertTrue(tc, elvea_hash_num(thread, 3.0) == elvea_hash_int(thread, 3));
+	CuAssertTrue(tc, elvea_hash_num(thread, -0.0) == elvea_hash_int(thread, 0));
+	CuAssertTrue(tc, elvea_hash_num(thread, -1e15) == elvea_hash_int(thread, -1000000000000000));
+	CuAssertTrue(tc, elvea_hash_num(thread, NAN) == elvea_hash_num(thread, -NAN));
+	CuAssertTrue(tc, elvea_hash_num(thread, 0.5) != elvea_hash_num(thread, 1.5));
+
+	// Sequential keys must use all the bits of the hash, since tables use the low bits.
+	enum { BUCKETS = 1024 };
+	bool used[BUCKETS] = { false };
+	int count = 0;
+
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		elvea_size_t h = elvea_hash_num(thread, i * 0.25 + 1e9);
+		count += ! used[h % BUCKETS];
+		used[h % BUCKETS] = true;
+	}
+	// About 63% of the buckets are used with a random function.
+	CuAssertTrue(tc, count > BUCKETS / 2);
+
+	STR(s1, "hello world");
+	STR(s2, "hello world");
+	CuAssertTrue(tc, elvea_string_hash(thread, s1) == elvea_string_hash(thread, s2));
+	CuAssertTrue(tc, elvea_string_hash(thread, s1) == elvea_hash_data(thread, "hello world", 11));
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+}
+
+static
+void test_hash_threads(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_thread_t *thread2 = elvea_thread_new(&runtime);
+
+	// Equal values hash alike on all the threads, including strings whose hash was cached by another thread.
+	STR(s1, "shared string");
+	elvea_string_hash(thread, s1);
+	elvea_string_t *s2 = elvea_string_new(thread2, "shared string", -1);
+	elvea_object_retain(thread2, s2);
+	elvea_variant_t v1, v2;
+	elvea_init_object(thread2, &v1, s1);
+	elvea_init_object(thread2, &v2, s2);
+	CuAssertTrue(tc, elvea_equal(thread2, &v1, &v2));
+	CuAssertTrue(tc, elvea_hash(thread2, &v1) == elvea_hash(thread2, &v2));
+	CuAssertTrue(tc, elvea_hash(thread, &v1) == elvea_hash(thread2, &v2));
+	CuAssertTrue(tc, elvea_hash_int(thread, 42) == elvea_hash_int(thread2, 42));
+	CuAssertTrue(tc, elvea_hash_num(thread, 0.5) == elvea_hash_num(thread2, 0.5));
+
+	elvea_clear(thread2, &v1);
+	elvea_clear(thread2, &v2);
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread2, s2);
+	elvea_finalize(&runtime);
+}
+
+
+CuSuite* hash_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_siphash);
+	SUITE_ADD_TEST(suite, test_hash_bytes);
+	SUITE_ADD_TEST(suite, test_hash_stream);
+	SUITE_ADD_TEST(suite, test_hash_values);
+	SUITE_ADD_TEST(suite, test_hash_threads);
+
+	return suite;
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include "test.h"
+#include <elvea/utils/alloc.h>
+
+static int error_count = 0;
+static int size_mismatches = 0;
+
+static
+void count_errors(int code, const char *message)
+{
+	error_count++;
+}
+
+// Allocator which remembers the size of each block and checks the size it is given on release.
+static
+void *checked_alloc(void *ptr, size_t old_size, size_t new_size)
+{
+	size_t *block = ptr ? ((size_t*) ptr) - 2 : NULL;
+
+	if (block && block[0] != old_size) {
+		size_mismatches++;
+	}
+	if (new_size == 0)
+	{
+		free(block);
+		return NULL;
+	}
+
+	block = (size_t*) realloc(block, new_size + 2 * sizeof(size_t));
+	block[0] = new_size;
+
+	return block + 2;
+}
+
+static
+void test_memory_sizes(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, checked_alloc, NULL);
+	size_t used = elvea_memory_used(thread);
+	size_mismatches = 0;
+
+	STR(s1, "hello");
+	for (int i = 0; i < 100; ++i) {
+		elvea_string_append(thread, &s1, " world", -1);
+	}
+	CuAssertTrue(tc, elvea_memory_used(thread) > used + 600);
+
+	elvea_region_begin(thread, ELVEA_REGION_PROMOTE);
+	STR(s2, "region");
+	elvea_string_append(thread, &s2, " string", -1);
+	elvea_object_release(thread, s2);
+	elvea_region_end(thread);
+
+	elvea_variant_t *v = elvea_alloc_variant(thread);
+	elvea_recycle_variant(thread, v);
+	elvea_gc_collect(thread);
+
+	elvea_object_release(thread, s1);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	elvea_finalize(&runtime);
+	CuAssertIntEquals(tc, 0, size_mismatches);
+}
+
+static
+void test_memory_limits(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, count_errors);
+	size_t used = elvea_memory_used(thread);
+
+	// Exceeding the soft limit doesn't reclaim memory during allocations, and the allocation succeeds.
+	elvea_set_memory_limits(thread, used + 100, 0);
+	elvea_string_t *s1 = elvea_string_alloc(thread, 200);
+	CuAssertPtrNotNull(tc, s1);
+	elvea_object_retain(thread, s1);
+	elvea_thread_safe_point(thread);
+	CuAssertIntEquals(tc, 0, (int) thread->memory.collections);
+
+	// Memory is reclaimed when the embedder asks for it, once.
+	elvea_memory_reclaim(thread);
+	elvea_memory_reclaim(thread);
+	CuAssertIntEquals(tc, 1, (int) thread->memory.collections);
+
+	// Small allocations don't trigger another collection right away.
+	STR(s2, "small");
+	CuAssertIntEquals(tc, 1, (int) thread->memory.collections);
+
+	// Exceeding the hard limit raises a single memory error.
+	error_count = 0;
+	elvea_set_memory_limits(thread, 0, elvea_memory_used(thread) + 1000);
+	CuAssertTrue(tc, elvea_string_alloc(thread, 2000) == NULL);
+	CuAssertIntEquals(tc, 1, error_count);
+
+	// Strings which can't grow are left untouched.
+	elvea_set_memory_limits(thread, 0, elvea_memory_used(thread) + 10);
+	elvea_string_append(thread, &s2, " string which is now too long for the memory limit", -1);
+	CuAssertIntEquals(tc, 2, error_count);
+	CuAssertStrEquals(tc, "small", s2->data);
+
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+	elvea_finalize(&runtime);
+}
+
+CuSuite* memory_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_memory_sizes);
+	SUITE_ADD_TEST(suite, test_memory_limits);
+
+	return suite;
+}
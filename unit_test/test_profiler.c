@@ -0,0 +1,186 @@
+#include <string.h>
+#include "test.h"
+#include <elvea/utils/alloc.h>
+
+static void sum_sites(void *context, void * const *frames, int depth, const elvea_alloc_stats_t *stats)
+{
+	*((uint64_t*) context) += stats->live_bytes;
+}
+
+static void get_leaf(void *context, void * const *frames, int depth, const elvea_alloc_stats_t *stats)
+{
+	*((void**) context) = depth > 0 ? frames[0] : NULL;
+}
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void alloc_block(elvea_thread_t *thread, void **block)
+{
+	*block = elvea_alloc(thread, 100);
+}
+
+static
+void test_profiler_classes(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	CuAssertTrue(tc, elvea_profiler_start(thread, 0));
+
+	STR(s1, "one");
+	STR(s2, "two");
+	STR(s3, "three");
+	elvea_table_t *t = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, t);
+	size_t size = elvea_object_size(thread, (elvea_object_t*) s1) + elvea_object_size(thread, (elvea_object_t*) s2);
+	elvea_object_release(thread, s3);
+
+	const elvea_alloc_stats_t *stats = elvea_profiler_class_stats(thread->string_class);
+	CuAssertIntEquals(tc, 3, (int) stats->alloc_count);
+	CuAssertIntEquals(tc, 2, (int) stats->live_count);
+	CuAssertIntEquals(tc, (int) size, (int) stats->live_bytes);
+	CuAssertTrue(tc, stats->peak_bytes > stats->live_bytes);
+	CuAssertIntEquals(tc, 1, (int) elvea_profiler_class_stats(thread->table_class)->live_count);
+
+	// Growing a string is accounted for as a new allocation.
+	elvea_string_append(thread, &s1, " hundred and twenty-three thousand four hundred and fifty-six", -1);
+	CuAssertIntEquals(tc, 2, (int) stats->live_count);
+	CuAssertIntEquals(tc, (int) elvea_object_size(thread, (elvea_object_t*) s1) +
+			(int) elvea_object_size(thread, (elvea_object_t*) s2), (int) stats->live_bytes);
+
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+	elvea_object_release(thread, t);
+	CuAssertIntEquals(tc, 0, (int) stats->live_count);
+	CuAssertIntEquals(tc, 0, (int) stats->live_bytes);
+
+	elvea_finalize(&runtime);
+}
+
+static
+void test_profiler_sites(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	void *blocks[10];
+	elvea_profiler_start(thread, 0);
+
+	for (int i = 0; i < 10; ++i) {
+		blocks[i] = elvea_alloc(thread, 100);
+	}
+	for (int i = 0; i < 5; ++i) {
+		elvea_free(thread, blocks[i], 100);
+	}
+
+	const elvea_alloc_stats_t *total = elvea_profiler_total(thread);
+	CuAssertIntEquals(tc, 10, (int) total->alloc_count);
+	CuAssertIntEquals(tc, 500, (int) total->live_bytes);
+	CuAssertIntEquals(tc, 1000, (int) total->peak_bytes);
+
+	uint64_t live = 0;
+	elvea_profiler_for_each_site(thread, sum_sites, &live);
+	CuAssertIntEquals(tc, 500, (int) live);
+
+	char buffer[65536];
+	FILE *file = tmpfile();
+	elvea_profiler_dump_collapsed(thread, file);
+	rewind(file);
+	size_t len = fread(buffer, 1, sizeof buffer - 1, file);
+	buffer[len] = '\0';
+	CuAssertTrue(tc, len > 4 && strcmp(buffer + len - 5, " 500\n") == 0);
+	fclose(file);
+
+	file = tmpfile();
+	elvea_profiler_dump_pprof(thread, file);
+	rewind(file);
+	len = fread(buffer, 1, sizeof buffer - 1, file);
+	buffer[len] = '\0';
+	CuAssertTrue(tc, strncmp(buffer, "heap profile: 5: 500 [10: 1000] @ heap_v2/1\n", 44) == 0);
+	CuAssertTrue(tc, strstr(buffer, "MAPPED_LIBRARIES:") != NULL);
+	fclose(file);
+
+	for (int i = 5; i < 10; ++i) {
+		elvea_free(thread, blocks[i], 100);
+	}
+	CuAssertIntEquals(tc, 0, (int) total->live_bytes);
+
+	elvea_profiler_stop(thread);
+	CuAssertTrue(tc, elvea_profiler_total(thread) == NULL);
+	elvea_finalize(&runtime);
+}
+
+static
+void test_profiler_sampling(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	const int count = 10000;
+	void **blocks = malloc(count * sizeof(void*));
+	elvea_profiler_start(thread, 4096);
+
+	for (int i = 0; i < count; ++i) {
+		blocks[i] = elvea_alloc(thread, 64);
+	}
+
+	// Sampled figures are estimates which should be close to the actual value.
+	const elvea_alloc_stats_t *total = elvea_profiler_total(thread);
+	CuAssertIntEquals(tc, count, (int) total->alloc_count);
+	CuAssertTrue(tc, total->live_bytes > 64 * count * 7 / 10 && total->live_bytes < 64 * count * 13 / 10);
+
+	for (int i = 0; i < count; ++i) {
+		elvea_free(thread, blocks[i], 64);
+	}
+	CuAssertIntEquals(tc, 0, (int) total->live_bytes);
+
+	free(blocks);
+	elvea_finalize(&runtime);
+}
+
+static
+void test_profiler_realloc(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	void *block;
+	elvea_profiler_start(thread, 0);
+
+	// The innermost frame belongs to the function which called the allocator.
+	alloc_block(thread, &block);
+	void *leaf = NULL;
+	elvea_profiler_for_each_site(thread, get_leaf, &leaf);
+#if defined(__GLIBC__) || defined(__APPLE__)
+	CuAssertTrue(tc, (char*) leaf > (char*) alloc_block && (char*) leaf < (char*) alloc_block + 256);
+#endif
+
+	// Resizing a block doesn't count as a new allocation.
+	block = elvea_realloc(thread, block, 100, 300);
+	block = elvea_realloc(thread, block, 300, 200);
+	const elvea_alloc_stats_t *total = elvea_profiler_total(thread);
+	CuAssertIntEquals(tc, 1, (int) total->alloc_count);
+	CuAssertIntEquals(tc, 300, (int) total->alloc_bytes);
+	CuAssertIntEquals(tc, 1, (int) total->live_count);
+	CuAssertIntEquals(tc, 200, (int) total->live_bytes);
+	CuAssertIntEquals(tc, 300, (int) total->peak_bytes);
+
+	uint64_t live = 0;
+	elvea_profiler_for_each_site(thread, sum_sites, &live);
+	CuAssertIntEquals(tc, 200, (int) live);
+
+	elvea_free(thread, block, 200);
+	CuAssertIntEquals(tc, 0, (int) total->live_count);
+	CuAssertIntEquals(tc, 0, (int) total->live_bytes);
+
+	elvea_finalize(&runtime);
+}
+
+CuSuite* profiler_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_profiler_classes);
+	SUITE_ADD_TEST(suite, test_profiler_sites);
+	SUITE_ADD_TEST(suite, test_profiler_sampling);
+	SUITE_ADD_TEST(suite, test_profiler_realloc);
+
+	return suite;
+}
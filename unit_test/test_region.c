@@ -0,0 +1,137 @@
+#include "test.h"
+
+static int error_count = 0;
+static char last_error[256];
+
+static
+void count_errors(int code, const char *message)
+{
+	error_count++;
+	snprintf(last_error, sizeof(last_error), "%s", message);
+}
+
+static
+void test_region_reset(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+
+	elvea_region_begin(thread, ELVEA_REGION_STRICT);
+	STR(s1, "hello");
+	CuAssertTrue(tc, s1->base.meta.region);
+
+	elvea_table_t *t = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, t);
+	CuAssertTrue(tc, ((elvea_object_t*) t)->meta.region);
+
+	// Growing a string keeps it in the region.
+	for (int i = 0; i < 100; ++i) {
+		elvea_string_append(thread, &s1, " world", -1);
+	}
+	CuAssertTrue(tc, s1->base.meta.region);
+	CuAssertIntEquals(tc, 605, (int) s1->size);
+
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, t);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+
+	// Objects created outside of a region come from the heap.
+	STR(s2, "heap");
+	CuAssertTrue(tc, !s2->base.meta.region);
+	elvea_object_release(thread, s2);
+}
+
+static
+void test_region_escape(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, count_errors);
+
+	// The escaped string remains valid after the region has ended.
+	elvea_region_begin(thread, ELVEA_REGION_PROMOTE);
+	STR(s1, "escaped");
+	CuAssertIntEquals(tc, 1, (int) elvea_region_end(thread));
+	CuAssertStrEquals(tc, "escaped", s1->data);
+
+	// It can still grow, in which case it moves to the heap.
+	elvea_string_append(thread, &s1, " string that is long enough to be moved", -1);
+	CuAssertTrue(tc, !s1->base.meta.region);
+	CuAssertStrEquals(tc, "escaped string that is long enough to be moved", s1->data);
+	elvea_object_release(thread, s1);
+
+	// Strict regions report escaped objects through the error handler.
+	error_count = 0;
+	elvea_region_begin(thread, ELVEA_REGION_STRICT);
+	STR(s2, "escaped");
+	elvea_region_end(thread);
+	CuAssertIntEquals(tc, 1, error_count);
+	CuAssertStrEquals(tc, "1 object(s) escaped their region", last_error);
+	elvea_object_release(thread, s2);
+
+	elvea_finalize(&runtime);
+}
+
+static
+void test_region_nested(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+
+	elvea_region_begin(thread, ELVEA_REGION_PROMOTE);
+	STR(outer, "outer");
+	elvea_region_begin(thread, ELVEA_REGION_PROMOTE);
+	STR(inner, "inner");
+	elvea_object_release(thread, inner);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+	elvea_object_release(thread, outer);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+	CuAssertPtrEquals(tc, NULL, thread->region);
+}
+
+static
+void test_region_nested_growth(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, count_errors);
+	error_count = 0;
+
+	// A string from the outer region which can't grow in place stays in the outer region when it grows inside a nested
+	// region, which it doesn't escape.
+	elvea_region_begin(thread, ELVEA_REGION_STRICT);
+	STR(outer, "outer");
+	STR(last, "last");
+	elvea_region_begin(thread, ELVEA_REGION_STRICT);
+	elvea_string_append(thread, &outer, " string which grows while a nested region is active", -1);
+	CuAssertTrue(tc, outer->base.meta.region);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+	CuAssertIntEquals(tc, 0, error_count);
+	CuAssertStrEquals(tc, "outer string which grows while a nested region is active", outer->data);
+
+	elvea_object_release(thread, outer);
+	elvea_object_release(thread, last);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+	CuAssertIntEquals(tc, 0, error_count);
+
+	// A string whose region has ended moves to the heap, even if another region is active.
+	elvea_region_begin(thread, ELVEA_REGION_PROMOTE);
+	STR(escaped, "escaped");
+	CuAssertIntEquals(tc, 1, (int) elvea_region_end(thread));
+	elvea_region_begin(thread, ELVEA_REGION_STRICT);
+	elvea_string_append(thread, &escaped, " string which grows in another region", -1);
+	CuAssertTrue(tc, !escaped->base.meta.region);
+	CuAssertIntEquals(tc, 0, (int) elvea_region_end(thread));
+	CuAssertIntEquals(tc, 0, error_count);
+	elvea_object_release(thread, escaped);
+
+	elvea_finalize(&runtime);
+}
+
+CuSuite* region_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_region_reset);
+	SUITE_ADD_TEST(suite, test_region_escape);
+	SUITE_ADD_TEST(suite, test_region_nested);
+	SUITE_ADD_TEST(suite, test_region_nested_growth);
+
+	return suite;
+}
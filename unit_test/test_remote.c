@@ -0,0 +1,222 @@
+#include "test.h"
+#include <elvea/utils/alloc.h>
+
+#define OBJECT_COUNT 10000
+
+typedef struct remote_context_t
+{
+	elvea_thread_t *thread;
+	elvea_string_t **strings;
+	elvea_alias_t *alias;
+} remote_context_t;
+
+// Release objects that belong to another thread.
+static int release_objects(void *arg)
+{
+	remote_context_t *context = (remote_context_t*) arg;
+
+	for (int i = 0; i < OBJECT_COUNT; ++i) {
+		elvea_object_release(context->thread, context->strings[i]);
+	}
+	elvea_alias_release(context->thread, context->alias);
+
+	return 0;
+}
+
+static
+void test_remote_free(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_thread_t *thread2 = elvea_thread_new(&runtime);
+	size_t used = elvea_memory_used(thread);
+	size_t used2 = elvea_memory_used(thread2);
+
+	remote_context_t context;
+	context.thread = thread2;
+	context.strings = (elvea_string_t**) malloc(OBJECT_COUNT * sizeof(elvea_string_t*));
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		context.strings[i] = elvea_string_new(thread, "owned by the main thread", -1);
+		elvea_object_retain(thread, context.strings[i]);
+	}
+
+	// The alias holds a reference to a string owned by the main thread.
+	STR(value, "value");
+	context.alias = elvea_alloc_alias(thread);
+	context.alias->meta.ref_count = 1;
+	elvea_init_object(thread, &context.alias->variant, value);
+	elvea_object_release(thread, value);
+
+	// Keep allocating while the other thread releases our objects.
+	thrd_t native_thread;
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, release_objects, &context));
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		STR(s, "temporary");
+		elvea_object_release(thread, s);
+	}
+	thrd_join(native_thread, NULL);
+
+	// Nothing was freed by the other thread.
+	CuAssertIntEquals(tc, (int) used2, (int) elvea_memory_used(thread2));
+	elvea_thread_safe_point(thread);
+	CuAssertPtrEquals(tc, NULL, elvea_atomic_load_ptr(&thread->remote_frees));
+	elvea_gc_collect(thread);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	free(context.strings);
+	elvea_finalize(&runtime);
+}
+
+typedef struct shared_context_t
+{
+	elvea_thread_t *thread;
+	elvea_string_t **strings;
+	int retain_count;
+	int release_count;
+} shared_context_t;
+
+// Retain and release objects that belong to another thread.
+static int share_objects(void *arg)
+{
+	shared_context_t *context = (shared_context_t*) arg;
+
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		for (int j = 0; j < context->retain_count; ++j) {
+			elvea_object_retain(context->thread, context->strings[i]);
+		}
+		for (int j = 0; j < context->release_count; ++j) {
+			elvea_object_release(context->thread, context->strings[i]);
+		}
+	}
+
+	return 0;
+}
+
+static
+void test_remote_shared(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_thread_t *thread2 = elvea_thread_new(&runtime);
+	size_t used = elvea_memory_used(thread);
+
+	shared_context_t context;
+	context.thread = thread2;
+	context.strings = (elvea_string_t**) malloc(OBJECT_COUNT * sizeof(elvea_string_t*));
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		context.strings[i] = elvea_string_new(thread, "shared with another thread", -1);
+		elvea_object_retain(thread, context.strings[i]);
+	}
+
+	// The other thread keeps one reference to each object, while the owner's count changes concurrently.
+	context.retain_count = 2;
+	context.release_count = 1;
+	thrd_t native_thread;
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, share_objects, &context));
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		elvea_object_retain(thread, context.strings[i]);
+		elvea_object_release(thread, context.strings[i]);
+	}
+	thrd_join(native_thread, NULL);
+	CuAssertPtrEquals(tc, NULL, elvea_atomic_load_ptr(&thread->remote_merges));
+	CuAssertTrue(tc, elvea_is_shared(context.strings[0]));
+
+	// The owner releases its references first: the objects are unbiased and stay alive.
+	for (int i = 0; i < OBJECT_COUNT; ++i) {
+		elvea_object_release(thread, context.strings[i]);
+	}
+	CuAssertTrue(tc, ((elvea_object_t*) context.strings[0])->meta.unbiased);
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+
+	// The other thread releases the last references, and the owner destroys the objects.
+	context.retain_count = 0;
+	context.release_count = 1;
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, share_objects, &context));
+	thrd_join(native_thread, NULL);
+	elvea_thread_safe_point(thread);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	free(context.strings);
+	elvea_finalize(&runtime);
+}
+
+typedef struct table_context_t
+{
+	elvea_thread_t *thread;
+	elvea_table_t *table;
+	bool retain;
+} table_context_t;
+
+// Retain or release a table that belongs to another thread.
+static int share_table(void *arg)
+{
+	table_context_t *context = (table_context_t*) arg;
+
+	if (context->retain) {
+		elvea_object_retain(context->thread, context->table);
+	}
+	else {
+		elvea_object_release(context->thread, context->table);
+	}
+
+	return 0;
+}
+
+static
+void test_remote_collect(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_thread_t *thread2 = elvea_thread_new(&runtime);
+	elvea_gc_collect_cycles(thread);
+	size_t used = elvea_memory_used(thread);
+
+	// The owner's count drops without reaching 0, so the table is buffered as a possible root.
+	table_context_t context;
+	context.thread = thread2;
+	context.table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, context.table);
+	elvea_object_retain(thread, context.table);
+	elvea_object_release(thread, context.table);
+
+	// The other thread retains the table, and the owner releases its last reference: the table is unbiased.
+	context.retain = true;
+	thrd_t native_thread;
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, share_table, &context));
+	thrd_join(native_thread, NULL);
+	elvea_object_release(thread, context.table);
+	CuAssertTrue(tc, ((elvea_object_t*) context.table)->meta.unbiased);
+
+	// The other thread releases the last reference while the table is still in the root buffer.
+	context.retain = false;
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, share_table, &context));
+	thrd_join(native_thread, NULL);
+	CuAssertTrue(tc, elvea_atomic_load_ptr(&thread->remote_merges) != NULL);
+
+	// The background collector can't take the table off the queue, and must not mistake it for garbage.
+	CuAssertTrue(tc, ! elvea_gc_step_detached(thread, UINT64_MAX));
+	CuAssertIntEquals(tc, 0, (int) thread->gc.collected.count);
+
+	// The owner reclaims the table before collecting cycles.
+	CuAssertIntEquals(tc, 0, (int) elvea_gc_collect_cycles(thread));
+	CuAssertPtrEquals(tc, NULL, elvea_atomic_load_ptr(&thread->remote_merges));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+
+	elvea_finalize(&runtime);
+}
+
+CuSuite* remote_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_remote_free);
+	SUITE_ADD_TEST(suite, test_remote_shared);
+	SUITE_ADD_TEST(suite, test_remote_collect);
+
+	return suite;
+}
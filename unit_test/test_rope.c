@@ -0,0 +1,349 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+
+// Check the invariants of a rope: heights and sizes are consistent, the tree is balanced and leaves are not empty.
+static
+bool check_rope(const elvea_rope_t *node)
+{
+	if (node->height == 0) {
+		return node->size > 0 && node->size <= ELVEA_ROPE_LEAF_SIZE;
+	}
+	uint32_t h1 = node->left->height, h2 = node->right->height;
+
+	return node->height == 1 + (ELVEA_MAX(h1, h2)) && h1 + 1 >= h2 && h2 + 1 >= h1 &&
+		   node->size == node->left->size + node->right->size && check_rope(node->left) && check_rope(node->right);
+}
+
+static
+bool rope_equals(const elvea_rope_t *rope, const char *expected, elvea_size_t size)
+{
+	char *buffer = (char*) malloc(size + 1);
+	elvea_rope_copy(rope, 0, buffer, size);
+	bool ok = elvea_rope_size(rope) == size && memcmp(buffer, expected, size) == 0;
+	free(buffer);
+
+	return ok;
+}
+
+static
+void fill_text(char *text, size_t size, uint32_t seed)
+{
+	for (size_t i = 0; i < size; i++) {
+		text[i] = (char) ('a' + (seed = seed * 1103515245 + 12345) % 26);
+	}
+}
+
+static
+void test_rope_insert(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { MAX_SIZE = 200000 };
+	char *expected = (char*) malloc(MAX_SIZE);
+	char piece[5000];
+	elvea_size_t size = 10000;
+	uint32_t seed = 1;
+	size_t used = elvea_memory_used(thread);
+
+	fill_text(expected, size, 42);
+	fill_text(piece, sizeof piece, 43);
+	elvea_rope_t *rope = elvea_rope_new(thread, expected, size);
+	CuAssertTrue(tc, rope != NULL && check_rope(rope) && rope_equals(rope, expected, size));
+
+	// Small and large pieces, at the beginning, in the middle and at the end.
+	for (int i = 0; i < 500; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		elvea_size_t count = (i % 10 == 0) ? (seed >> 8) % sizeof piece : (seed >> 8) % 16 + 1;
+		elvea_size_t offset = (i % 7 == 0) ? 0 : (i % 7 == 1) ? size : (seed >> 4) % (size + 1);
+
+		elvea_rope_t *result = elvea_rope_insert(thread, rope, offset, piece, count);
+		CuAssertTrue(tc, result != NULL);
+		memmove(expected + offset + count, expected + offset, size - offset);
+		memcpy(expected + offset, piece, count);
+		size += count;
+
+		// The original rope is not modified.
+		CuAssertTrue(tc, elvea_rope_size(rope) == size - count);
+		elvea_rope_release(thread, rope);
+		rope = result;
+		CuAssertTrue(tc, check_rope(rope));
+	}
+	CuAssertTrue(tc, rope_equals(rope, expected, size));
+	CuAssertTrue(tc, rope->height < 20);
+
+	elvea_rope_release(thread, rope);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+	free(expected);
+}
+
+static
+void test_rope_concat(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	char text[100000];
+	size_t used = elvea_memory_used(thread);
+	fill_text(text, sizeof text, 7);
+
+	// Concatenate ropes of very different heights in both directions.
+	elvea_rope_t *rope = elvea_rope_new(thread, text, 1);
+	elvea_size_t size = 1;
+
+	while (size < sizeof text)
+	{
+		elvea_size_t count = ELVEA_MIN(size * 3 / 2 + 1, sizeof text - size);
+		elvea_rope_t *piece = elvea_rope_new(thread, text + size, count);
+		elvea_rope_t *result = elvea_rope_concat(thread, rope, piece);
+		CuAssertTrue(tc, result != NULL && check_rope(result));
+
+		elvea_rope_release(thread, piece);
+		elvea_rope_release(thread, rope);
+		rope = result;
+		size += count;
+	}
+	CuAssertTrue(tc, rope_equals(rope, text, size));
+
+	elvea_rope_t *left = elvea_rope_new(thread, text, 10);
+	elvea_rope_t *result = elvea_rope_concat(thread, left, rope);
+	CuAssertTrue(tc, result != NULL && check_rope(result) && elvea_rope_size(result) == size + 10);
+	CuAssertTrue(tc, rope_equals(rope, text, size));
+
+	// Iterate from an offset in the middle of a leaf.
+	elvea_rope_iter_t iter;
+	const char *data;
+	elvea_size_t count, total = 0;
+	bool ok = true;
+
+	elvea_rope_iter_init(&iter, result, 12345);
+	while (elvea_rope_iter_next(&iter, &data, &count))
+	{
+		ok &= count > 0 && memcmp(data, text + 12345 - 10 + total, count) == 0;
+		total += count;
+	}
+	CuAssertTrue(tc, ok && total == size + 10 - 12345);
+
+	elvea_rope_release(thread, left);
+	elvea_rope_release(thread, result);
+	elvea_rope_release(thread, rope);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+static
+void test_rope_string(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { SIZE = ELVEA_STRING_ROPE_THRESHOLD + 1000 };
+	char *text = (char*) malloc(SIZE + 100);
+	fill_text(text, SIZE, 3);
+	text[SIZE] = '\0';
+	memcpy(text, "안녕", strlen("안녕"));
+
+	elvea_string_t *s1 = elvea_string_new(thread, text, SIZE);
+	elvea_object_retain(thread, s1);
+	elvea_string_t *s2 = s1;
+	elvea_object_retain(thread, s2);
+
+	// Editing a large string in the middle turns it into a rope. The shared string is not modified.
+	elvea_string_insert(thread, &s1, 1001, "hello", -1);
+	CuAssertTrue(tc, s1 != s2 && elvea_string_is_rope(s1) && !elvea_string_is_rope(s2));
+	CuAssertIntEquals(tc, 1, (int) s2->base.meta.ref_count);
+	elvea_string_append(thread, &s1, "!", -1);
+	elvea_string_prepend(thread, &s1, "<", -1);
+	CuAssertTrue(tc, elvea_string_is_rope(s1));
+
+	memmove(text + 1005, text + 1000, SIZE - 1000);
+	memcpy(text + 1000, "hello", 5);
+	memmove(text + 1, text, SIZE + 5);
+	text[0] = '<';
+	memcpy(text + SIZE + 6, "!", 2);
+	elvea_string_t *flat = elvea_string_new(thread, text, -1);
+	elvea_object_retain(thread, flat);
+	CuAssertTrue(tc, !elvea_string_is_rope(flat) && flat->size == s1->size);
+
+	// Ropes are hashed, measured and compared without being flattened.
+	CuAssertTrue(tc, elvea_string_hash(thread, s1) == elvea_string_hash(thread, flat));
+	CuAssertIntEquals(tc, (int) elvea_string_length(thread, flat), (int) elvea_string_length(thread, s1));
+	CuAssertTrue(tc, elvea_string_equal(thread, s1, flat) && elvea_string_equal(thread, flat, s1));
+	CuAssertIntEquals(tc, 0, elvea_string_compare(thread, s1, flat));
+	CuAssertTrue(tc, elvea_string_compare(thread, s1, s2) < 0 && elvea_string_compare(thread, s2, s1) > 0);
+	CuAssertTrue(tc, !elvea_string_equal(thread, s1, s2));
+	CuAssertTrue(tc, elvea_string_starts_with(thread, s1, "<안녕", -1));
+	CuAssertTrue(tc, elvea_string_ends_with(thread, s1, text + SIZE - 20, -1));
+	CuAssertTrue(tc, !elvea_string_ends_with(thread, s1, "?", -1));
+	CuAssertTrue(tc, elvea_string_is_rope(s1));
+
+	char buffer[16];
+	elvea_string_read(s1, 998, buffer, 10);
+	CuAssertTrue(tc, memcmp(buffer, text + 998, 10) == 0);
+
+	// A clone shares the rope.
+	elvea_string_t *clone = elvea_string_clone(thread, s1);
+	elvea_object_retain(thread, clone);
+	CuAssertTrue(tc, clone->rope == s1->rope && elvea_string_equal(thread, clone, flat));
+
+	// The string builder reads the chunks.
+	elvea_strbuf_t buf;
+	elvea_strbuf_init(thread, &buf, 0);
+	elvea_strbuf_append_string(thread, &buf, s1);
+	elvea_string_t *built = elvea_strbuf_finish(thread, &buf);
+	elvea_object_retain(thread, built);
+	CuAssertTrue(tc, !elvea_string_is_rope(built) && elvea_string_equal(thread, built, flat));
+
+	// Concatenation.
+	elvea_string_t *cat = elvea_string_concat(thread, s1, flat);
+	elvea_object_retain(thread, cat);
+	CuAssertTrue(tc, elvea_string_is_rope(cat) && cat->size == 2 * flat->size);
+	CuAssertTrue(tc, elvea_string_ends_with(thread, cat, text, flat->size));
+	elvea_string_t *small = elvea_string_concat(thread, s2, s2);
+	elvea_object_retain(thread, small);
+	CuAssertTrue(tc, elvea_string_is_rope(small) && small->size == 2 * s2->size);
+	elvea_object_release(thread, small);
+	small = elvea_string_new(thread, "abc", -1);
+	elvea_object_retain(thread, small);
+	elvea_string_t *tiny = elvea_string_concat(thread, small, small);
+	elvea_object_retain(thread, tiny);
+	CuAssertTrue(tc, !elvea_string_is_rope(tiny));
+	CuAssertStrEquals(tc, "abcabc", tiny->data);
+
+	// Flattening a shared rope creates a new string, and an unshared rope is flattened in place.
+	elvea_string_t *s3 = clone;
+	elvea_object_retain(thread, s3);
+	CuAssertTrue(tc, elvea_string_flatten(thread, &s3));
+	CuAssertTrue(tc, s3 != clone && !elvea_string_is_rope(s3) && elvea_string_is_rope(clone));
+	CuAssertStrEquals(tc, text, s3->data);
+	CuAssertTrue(tc, elvea_string_flatten(thread, &s1));
+	CuAssertTrue(tc, !elvea_string_is_rope(s1));
+	CuAssertStrEquals(tc, text, s1->data);
+
+	// Trimming flattens the string.
+	elvea_string_trim(thread, &cat);
+	CuAssertTrue(tc, !elvea_string_is_rope(cat));
+
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+	elvea_object_release(thread, s3);
+	elvea_object_release(thread, flat);
+	elvea_object_release(thread, clone);
+	elvea_object_release(thread, built);
+	elvea_object_release(thread, cat);
+	elvea_object_release(thread, small);
+	elvea_object_release(thread, tiny);
+	free(text);
+}
+
+static
+void test_rope_sort(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { COUNT = 6, SIZE = ELVEA_STRING_ROPE_THRESHOLD };
+	char *text = (char*) malloc(SIZE);
+	elvea_variant_t values[COUNT];
+	memset(text, 'x', SIZE);
+
+	// Strings which differ after their first bytes, half of which are ropes.
+	for (int i = 0; i < COUNT; i++)
+	{
+		char digit = (char) ('0' + (i * 5) % COUNT);
+		elvea_string_t *s;
+
+		if (i % 2 == 0)
+		{
+			s = elvea_string_new(thread, text, SIZE - 1);
+			elvea_string_insert(thread, &s, SIZE / 2, &digit, 1);
+		}
+		else
+		{
+			text[SIZE / 2 - 1] = digit;
+			s = elvea_string_new(thread, text, SIZE / 2 + 1);
+			text[SIZE / 2 - 1] = 'x';
+		}
+		CuAssertTrue(tc, elvea_string_is_rope(s) == (i % 2 == 0));
+		elvea_init_object(thread, &values[i], s);
+	}
+	elvea_sort(thread, values, COUNT);
+
+	for (int i = 0; i < COUNT; i++)
+	{
+		char c;
+		elvea_string_read(elvea_get_string(thread, &values[i]), SIZE / 2 - 1, &c, 1);
+		CuAssertIntEquals(tc, '0' + i, c);
+	}
+	elvea_release_n(thread, values, COUNT);
+	free(text);
+}
+
+
+static int error_count = 0;
+
+static
+void count_errors(int code, const char *message)
+{
+	error_count++;
+}
+
+static
+void test_rope_memory(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, count_errors);
+	enum { SIZE = ELVEA_STRING_ROPE_THRESHOLD * 2 };
+	char *text = (char*) malloc(SIZE);
+	char piece[6000];
+	fill_text(text, SIZE, 11);
+	fill_text(piece, sizeof piece, 12);
+
+	elvea_string_t *s = elvea_string_new(thread, text, SIZE);
+	elvea_object_retain(thread, s);
+	elvea_string_insert(thread, &s, 100, "x", 1);
+	CuAssertTrue(tc, elvea_string_is_rope(s));
+	elvea_size_t hash = elvea_string_hash(thread, s);
+
+	// When an insertion fails at any point, the string is left unchanged and the new nodes are released.
+	for (size_t limit = 0; limit < 12000; limit += 250)
+	{
+		size_t used = elvea_memory_used(thread);
+		error_count = 0;
+		elvea_set_memory_limits(thread, 0, used + limit);
+		elvea_string_insert(thread, &s, SIZE / 2, piece, sizeof piece);
+		elvea_set_memory_limits(thread, 0, 0);
+
+		if (s->size == SIZE + 1)
+		{
+			CuAssertIntEquals(tc, 1, error_count);
+			CuAssertTrue(tc, elvea_string_hash(thread, s) == hash && check_rope(s->rope));
+			CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+		}
+		else
+		{
+			CuAssertIntEquals(tc, 0, error_count);
+			CuAssertIntEquals(tc, SIZE + 1 + (int) sizeof piece, (int) s->size);
+			break;
+		}
+	}
+	CuAssertTrue(tc, s->size > SIZE + 1);
+
+	// The rope's nodes are not part of the string's size, and are reported separately.
+	size_t used = elvea_memory_used(thread);
+	size_t size = elvea_object_size(thread, (elvea_object_t*) s);
+	size_t footprint = elvea_string_footprint(s);
+	CuAssertTrue(tc, size < 100 && footprint > s->size);
+	elvea_object_release(thread, s);
+	CuAssertIntEquals(tc, (int) (size + footprint), (int) (used - elvea_memory_used(thread)));
+
+	elvea_finalize(&runtime);
+	free(text);
+}
+
+CuSuite* rope_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_rope_insert);
+	SUITE_ADD_TEST(suite, test_rope_concat);
+	SUITE_ADD_TEST(suite, test_rope_string);
+	SUITE_ADD_TEST(suite, test_rope_sort);
+	SUITE_ADD_TEST(suite, test_rope_memory);
+
+	return suite;
+}
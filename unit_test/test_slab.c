@@ -0,0 +1,103 @@
+#include <string.h>
+#include "test.h"
+#include <elvea/utils/slab.h>
+
+
+static
+void test_slab_classes(CuTest *tc)
+{
+	// Blocks of the same size must not overlap.
+	char *p1 = (char*) elvea_slab_alloc(NULL, 0, 48);
+	char *p2 = (char*) elvea_slab_alloc(NULL, 0, 48);
+	CuAssertPtrNotNull(tc, p1);
+	CuAssertPtrNotNull(tc, p2);
+	CuAssertTrue(tc, p1 + 48 <= p2 || p2 + 48 <= p1);
+	CuAssertTrue(tc, ((uintptr_t) p1 & 15) == 0);
+
+	// Sized and unsized frees are interchangeable.
+	elvea_slab_alloc(p1, 48, 0);
+	elvea_slab_alloc(p2, 0, 0);
+}
+
+static
+void test_slab_realloc(CuTest *tc)
+{
+	char *p = (char*) elvea_slab_alloc(NULL, 0, 12);
+	strcpy(p, "hello world");
+
+	// Grow within the slab, then into a large block, then shrink back, with and without the old size.
+	p = (char*) elvea_slab_alloc(p, 12, 300);
+	CuAssertStrEquals(tc, "hello world", p);
+	p = (char*) elvea_slab_alloc(p, 0, 5000);
+	CuAssertStrEquals(tc, "hello world", p);
+	p = (char*) elvea_slab_alloc(p, 5000, 20000);
+	CuAssertStrEquals(tc, "hello world", p);
+	p = (char*) elvea_slab_alloc(p, 0, 64);
+	CuAssertStrEquals(tc, "hello world", p);
+	CuAssertPtrEquals(tc, NULL, elvea_slab_alloc(p, 64, 0));
+}
+
+static
+void test_slab_runtime(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, elvea_slab_alloc, NULL);
+	STR(s1, "hello");
+
+	for (int i = 0; i < 100; ++i) {
+		elvea_string_append(thread, &s1, "!", -1);
+	}
+	CuAssertIntEquals(tc, 105, (int) s1->size);
+	elvea_object_release(thread, s1);
+	elvea_finalize(&runtime);
+	elvea_slab_flush();
+}
+
+static int use_slab(void *context)
+{
+	char *p1 = (char*) elvea_slab_alloc(NULL, 0, 600);
+	char *p2 = (char*) elvea_slab_alloc(NULL, 0, 600);
+	elvea_slab_alloc(p1, 600, 0);
+	elvea_slab_alloc(p2, 0, 0);
+	*((void**) context) = p2;
+
+	return 0;
+}
+
+static
+void test_slab_thread_exit(CuTest *tc)
+{
+	void *blocks[32];
+	void *freed = NULL;
+	bool found = false;
+	thrd_t native_thread;
+
+	// Blocks cached by a thread go back to the shared pool when the thread exits.
+	elvea_slab_flush();
+	CuAssertIntEquals(tc, thrd_success, thrd_create(&native_thread, use_slab, &freed));
+	thrd_join(native_thread, NULL);
+
+	for (int i = 0; i < 32; ++i)
+	{
+		blocks[i] = elvea_slab_alloc(NULL, 0, 600);
+		found = found || (blocks[i] == freed);
+	}
+	CuAssertTrue(tc, found);
+
+	for (int i = 0; i < 32; ++i) {
+		elvea_slab_alloc(blocks[i], 600, 0);
+	}
+	elvea_slab_flush();
+}
+
+CuSuite* slab_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_slab_classes);
+	SUITE_ADD_TEST(suite, test_slab_realloc);
+	SUITE_ADD_TEST(suite, test_slab_runtime);
+	SUITE_ADD_TEST(suite, test_slab_thread_exit);
+
+	return suite;
+}
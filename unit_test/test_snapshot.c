@@ -0,0 +1,201 @@
+#include <string.h>
+#include "test.h"
+#include <elvea/string.h>
+#include <elvea/table.h>
+#include <elvea/snapshot.h>
+
+// Records found in a snapshot.
+typedef struct snapshot_info_t
+{
+	int object_count, string_count, table_count, slot_count;
+	uint64_t table_address, table_entries, table_edge, table_ref_count;
+	uint64_t string_address, string_length, string_ref_count;
+	uint64_t slot_target;
+	char prefix[ELVEA_SNAPSHOT_PREFIX_SIZE + 1];
+	bool complete;
+} snapshot_info_t;
+
+static
+uint64_t read_varint(FILE *file)
+{
+	uint64_t value = 0;
+	int shift = 0, c;
+
+	do {
+		c = getc(file);
+		if (c == EOF) return 0;
+		value |= (uint64_t) (c & 0x7f) << shift;
+		shift += 7;
+	}
+	while (c & 0x80);
+
+	return value;
+}
+
+static
+void read_snapshot(FILE *file, snapshot_info_t *info)
+{
+	char magic[8];
+	memset(info, 0, sizeof(snapshot_info_t));
+	rewind(file);
+
+	if (fread(magic, 1, 8, file) != 8 || memcmp(magic, ELVEA_SNAPSHOT_MAGIC, 8) != 0 ||
+			read_varint(file) != ELVEA_SNAPSHOT_VERSION) {
+		return;
+	}
+
+	while (true)
+	{
+		int tag = getc(file);
+
+		if (tag == ELVEA_SNAPSHOT_CLASS)
+		{
+			read_varint(file);
+			uint64_t size = read_varint(file);
+			fseek(file, (long) size, SEEK_CUR);
+		}
+		else if (tag == ELVEA_SNAPSHOT_OBJECT)
+		{
+			uint64_t address = read_varint(file);
+			read_varint(file);
+			uint64_t kind = read_varint(file);
+			read_varint(file);
+			uint64_t ref_count = read_varint(file);
+			uint64_t edge_count = read_varint(file);
+			uint64_t edge = 0;
+			for (uint64_t i = 0; i < edge_count; i++) edge = read_varint(file);
+			info->object_count++;
+
+			if (kind == ELVEA_SNAPSHOT_STRING)
+			{
+				info->string_count++;
+				info->string_address = address;
+				info->string_ref_count = ref_count;
+				info->string_length = read_varint(file);
+				uint64_t size = read_varint(file);
+				if (fread(info->prefix, 1, (size_t) size, file) != size) return;
+				info->prefix[size] = '\0';
+			}
+			else if (kind == ELVEA_SNAPSHOT_TABLE)
+			{
+				info->table_count++;
+				info->table_address = address;
+				info->table_ref_count = ref_count;
+				info->table_entries = read_varint(file);
+				info->table_edge = edge;
+			}
+		}
+		else if (tag == ELVEA_SNAPSHOT_SLOT)
+		{
+			info->slot_count++;
+			read_varint(file);
+			read_varint(file);
+			info->slot_target = read_varint(file);
+		}
+		else
+		{
+			info->complete = (tag == ELVEA_SNAPSHOT_END);
+			return;
+		}
+	}
+}
+
+static
+void test_snapshot_write(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	FILE *file = tmpfile();
+	CuAssertPtrNotNull(tc, file);
+
+	// A table which holds a long string, and a heap variant which refers to the same string.
+	char text[200];
+	memset(text, 'x', sizeof text - 1);
+	text[sizeof text - 1] = '\0';
+	STR(s, text);
+	elvea_table_t *t = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, t);
+	elvea_variant_t k, v;
+	elvea_init_num(thread, &k, 1);
+	elvea_init_object(thread, &v, s);
+	elvea_table_set(thread, t, &k, &v);
+	elvea_clear(thread, &v);
+	elvea_variant_t *slot = elvea_alloc_variant(thread);
+	elvea_init_object(thread, slot, s);
+
+	// The snapshot doesn't allocate from the thread.
+	size_t used = elvea_memory_used(thread);
+	CuAssertTrue(tc, elvea_snapshot_write(thread, file));
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+	snapshot_info_t info;
+	read_snapshot(file, &info);
+	fclose(file);
+
+	CuAssertTrue(tc, info.complete);
+	CuAssertIntEquals(tc, 1, info.table_count);
+	CuAssertIntEquals(tc, 1, info.string_count);
+	CuAssertIntEquals(tc, 1, info.slot_count);
+	CuAssertTrue(tc, info.object_count >= 2);
+	CuAssertTrue(tc, info.table_address == (uint64_t) (uintptr_t) t);
+	CuAssertTrue(tc, info.table_entries == 1);
+	CuAssertTrue(tc, info.string_address == (uint64_t) (uintptr_t) s);
+	CuAssertTrue(tc, info.table_edge == info.string_address);
+	CuAssertTrue(tc, info.slot_target == info.string_address);
+	CuAssertTrue(tc, info.string_length == sizeof text - 1);
+	CuAssertIntEquals(tc, ELVEA_SNAPSHOT_PREFIX_SIZE, (int) strlen(info.prefix));
+
+	elvea_clear(thread, slot);
+	elvea_recycle_variant(thread, slot);
+	elvea_object_release(thread, t);
+	elvea_object_release(thread, s);
+}
+
+static
+void test_snapshot_counts(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, NULL);
+	elvea_thread_t *thread2 = elvea_thread_new(&runtime);
+	FILE *file = tmpfile();
+	CuAssertPtrNotNull(tc, file);
+
+	// A table which is only held by another thread.
+	elvea_table_t *t = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, t);
+	elvea_object_retain(thread2, t);
+	elvea_object_release(thread, t);
+
+	// A string which is only held by a scratch slot and by the zero-count table.
+	elvea_variant_t *scratch = elvea_gc_scratch_push(thread, 1);
+	STR(s, "scratch");
+	elvea_variant_t v;
+	elvea_init_object(thread, &v, s);
+	elvea_gc_scratch_set(thread, scratch, &v);
+	elvea_clear(thread, &v);
+	elvea_object_release(thread, s);
+	CuAssertTrue(tc, ((elvea_object_t*) s)->meta.deferred);
+
+	// Both are alive, so the analyzer must see them as roots.
+	CuAssertTrue(tc, elvea_snapshot_write(thread, file));
+	snapshot_info_t info;
+	read_snapshot(file, &info);
+	fclose(file);
+
+	CuAssertTrue(tc, info.complete);
+	CuAssertTrue(tc, info.table_address == (uint64_t) (uintptr_t) t);
+	CuAssertIntEquals(tc, 1, (int) info.table_ref_count);
+	CuAssertTrue(tc, info.string_address == (uint64_t) (uintptr_t) s);
+	CuAssertIntEquals(tc, 2, (int) info.string_ref_count);
+
+	elvea_gc_scratch_pop(thread, 1);
+	elvea_object_release(thread2, t);
+	elvea_finalize(&runtime);
+}
+
+CuSuite* snapshot_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+	SUITE_ADD_TEST(suite, test_snapshot_write);
+	SUITE_ADD_TEST(suite, test_snapshot_counts);
+
+	return suite;
+}
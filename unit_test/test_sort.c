@@ -0,0 +1,221 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+
+static int error_count = 0;
+
+static
+void count_errors(int code, const char *message)
+{
+	error_count++;
+}
+
+static
+int compare_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t*) a, y = *(const int64_t*) b;
+	return (x > y) - (x < y);
+}
+
+static
+int compare_cstrings(const void *a, const void *b)
+{
+	return strcmp(*(const char**) a, *(const char**) b);
+}
+
+static
+void test_sort_integers(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { COUNT = 1000 };
+	elvea_variant_t values[COUNT];
+	int64_t expected[COUNT];
+	uint32_t state = 1;
+
+	// Small integers share their high bytes, and the extremes exercise the sign handling.
+	for (size_t n = 10; n <= COUNT; n += COUNT - 10)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			state = state * 1103515245 + 12345;
+			expected[i] = (int64_t) (state >> 8) - (1 << 23);
+		}
+		expected[1] = INT64_MIN >> 14;
+		expected[n - 1] = INT64_MAX >> 14;
+		for (size_t i = 0; i < n; i++) {
+			elvea_init_int(thread, &values[i], expected[i]);
+		}
+
+		elvea_sort(thread, values, n);
+		qsort(expected, n, sizeof(int64_t), compare_int64);
+		for (size_t i = 0; i < n; i++) {
+			CuAssertTrue(tc, elvea_check_int(&values[i]) && elvea_as_int(&values[i]) == expected[i]);
+		}
+	}
+}
+
+static
+void test_sort_numbers(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	double specials[] = { NAN, INFINITY, -INFINITY, 0.0, -0.0, 4.9e-324, -4.9e-324, 1e308, -1e308, 0.5, -0.5 };
+	enum { SPECIALS = sizeof specials / sizeof specials[0], COUNT = 500 };
+	elvea_variant_t values[COUNT];
+	uint32_t state = 7;
+
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		state = state * 1103515245 + 12345;
+		double n = i < SPECIALS ? specials[i] : ((double) (state >> 8) - (1 << 23)) / 1024.0;
+		elvea_init_num(thread, &values[COUNT - 1 - i], n);
+	}
+
+	elvea_sort(thread, values, COUNT);
+
+	// Negative zero comes before zero, and NaN comes last.
+	CuAssertTrue(tc, elvea_check_num(&values[COUNT - 1]) && isnan(elvea_as_num(&values[COUNT - 1])));
+	CuAssertTrue(tc, elvea_as_num(&values[0]) == -INFINITY);
+	for (size_t i = 1; i < COUNT - 1; i++)
+	{
+		double a = elvea_as_num(&values[i - 1]), b = elvea_as_num(&values[i]);
+		CuAssertTrue(tc, elvea_check_num(&values[i]) && a <= b);
+		if (a == 0 && b == 0) CuAssertTrue(tc, signbit(a) || ! signbit(b));
+	}
+}
+
+static
+void test_sort_strings(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { COUNT = 600 };
+	elvea_variant_t values[COUNT];
+	elvea_string_t *strings[COUNT];
+	const char *expected[COUNT];
+	char buffer[32];
+	uint32_t state = 3;
+
+	// Many strings share their first 8 bytes, some are shorter than that, and there are duplicates.
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		state = state * 1103515245 + 12345;
+		switch (i % 4)
+		{
+			case 0: snprintf(buffer, sizeof buffer, "prefix__%u", (state >> 8) % 1000); break;
+			case 1: snprintf(buffer, sizeof buffer, "prefix_%u", (state >> 8) % 100); break;
+			case 2: snprintf(buffer, sizeof buffer, "%u", (state >> 8) % 100); break;
+			default: snprintf(buffer, sizeof buffer, "prefix__");
+		}
+		strings[i] = elvea_string_new(thread, buffer, -1);
+		elvea_init_object(thread, &values[i], strings[i]);
+		expected[i] = strings[i]->data;
+	}
+
+	// Random, sorted and reversed inputs.
+	qsort(expected, COUNT, sizeof(char*), compare_cstrings);
+	for (int round = 0; round < 3; round++)
+	{
+		if (round == 2)
+		{
+			for (size_t i = 0; i < COUNT / 2; i++)
+			{
+				elvea_variant_t tmp = values[i];
+				values[i] = values[COUNT - 1 - i];
+				values[COUNT - 1 - i] = tmp;
+			}
+		}
+		elvea_sort(thread, values, COUNT);
+		for (size_t i = 0; i < COUNT; i++) {
+			CuAssertStrEquals(tc, expected[i], elvea_get_string(thread, &values[i])->data);
+		}
+	}
+
+	// Sorting moves the references without retaining them.
+	for (size_t i = 0; i < COUNT; i++) {
+		CuAssertIntEquals(tc, 1, (int) strings[i]->base.meta.ref_count);
+	}
+	elvea_release_n(thread, values, COUNT);
+}
+
+static
+void test_sort_generic(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	enum { COUNT = 100 };
+	elvea_variant_t values[COUNT];
+	elvea_alias_t alias;
+
+	// Integers and numbers are compared by value. The sort is stable: since the integers come first, each integer
+	// comes before the number which is equal to it.
+	for (size_t i = 0; i < COUNT / 2; i++)
+	{
+		elvea_init_int(thread, &values[i], (elvea_int_t) (COUNT / 2 - i));
+		elvea_init_num(thread, &values[COUNT / 2 + i], (double) (COUNT / 2 - i));
+	}
+	elvea_sort(thread, values, COUNT);
+	for (size_t i = 0; i < COUNT; i += 2)
+	{
+		CuAssertTrue(tc, elvea_check_int(&values[i]) && elvea_as_int(&values[i]) == (elvea_int_t) (i / 2 + 1));
+		CuAssertTrue(tc, elvea_check_num(&values[i + 1]) && elvea_as_num(&values[i + 1]) == (double) (i / 2 + 1));
+	}
+
+	// Aliases are sorted by the value they refer to, and are moved as aliases.
+	elvea_init_num(thread, &alias.variant, 2.5);
+	elvea_init_num(thread, &values[0], 3);
+	elvea_box_alias(&values[1], &alias);
+	elvea_init_num(thread, &values[2], 1);
+	elvea_sort(thread, values, 3);
+	CuAssertTrue(tc, elvea_as_num(&values[0]) == 1 && elvea_as_alias(&values[1]) == &alias);
+	CuAssertTrue(tc, elvea_as_num(&values[2]) == 3);
+
+	elvea_init_bool(thread, &values[0], true);
+	elvea_init_bool(thread, &values[1], false);
+	elvea_sort(thread, values, 2);
+	CuAssertTrue(tc, ! elvea_get_bool(thread, &values[0]) && elvea_get_bool(thread, &values[1]));
+}
+
+static
+void test_sort_errors(CuTest *tc)
+{
+	elvea_runtime_t runtime;
+	elvea_thread_t *thread = elvea_initialize(&runtime, NULL, count_errors);
+	elvea_variant_t values[3];
+	STR(s, "string");
+
+	// Values which can't be compared raise an error and are left in place.
+	error_count = 0;
+	elvea_init_int(thread, &values[0], 2);
+	elvea_init_object(thread, &values[1], s);
+	elvea_init_int(thread, &values[2], 1);
+	elvea_sort(thread, values, 3);
+	CuAssertIntEquals(tc, 1, error_count);
+	CuAssertTrue(tc, elvea_as_int(&values[0]) == 2 && elvea_as_object(&values[1]) == (elvea_object_t*) s);
+	elvea_release_n(thread, values, 3);
+
+	elvea_table_t *t1 = elvea_table_new(thread, 8);
+	elvea_table_t *t2 = elvea_table_new(thread, 8);
+	elvea_init_object(thread, &values[0], t1);
+	elvea_init_object(thread, &values[2], t2);
+	elvea_init_object(thread, &values[1], t1);
+	elvea_sort(thread, values, 3);
+	CuAssertIntEquals(tc, 2, error_count);
+	CuAssertTrue(tc, elvea_as_object(&values[0]) == (elvea_object_t*) t1);
+
+	elvea_release_n(thread, values, 3);
+	elvea_object_release(thread, s);
+	elvea_finalize(&runtime);
+}
+
+
+CuSuite* sort_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_sort_integers);
+	SUITE_ADD_TEST(suite, test_sort_numbers);
+	SUITE_ADD_TEST(suite, test_sort_strings);
+	SUITE_ADD_TEST(suite, test_sort_generic);
+	SUITE_ADD_TEST(suite, test_sort_errors);
+
+	return suite;
+}
@@ -0,0 +1,112 @@
+#include <math.h>
+#include <string.h>
+#include "test.h"
+#include <elvea/utils/alloc.h>
+
+
+static
+void test_strbuf_append(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	STR(s, " world");
+	const char *expected = "hello world -42 -9223372036854775808 0.1 0.3333333333333333 1e+21 -inf";
+	int size = (int) strlen(expected);
+	elvea_strbuf_t buf;
+
+	elvea_strbuf_init(thread, &buf, 0);
+	elvea_strbuf_append(thread, &buf, "hello", -1);
+	elvea_strbuf_append_string(thread, &buf, s);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_int(thread, &buf, -42);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_int(thread, &buf, INT64_MIN);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_num(thread, &buf, 0.1);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_num(thread, &buf, 1.0 / 3.0);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_num(thread, &buf, 1e21);
+	elvea_strbuf_append_char(thread, &buf, ' ');
+	elvea_strbuf_append_num(thread, &buf, -INFINITY);
+	CuAssertIntEquals(tc, size, (int) elvea_strbuf_size(&buf));
+
+	// Everything fitted in the builder's string, which is returned with the exact size.
+	elvea_string_t *result = elvea_strbuf_finish(thread, &buf);
+	CuAssertStrEquals(tc, expected, result->data);
+	CuAssertIntEquals(tc, size, (int) result->size);
+	CuAssertIntEquals(tc, size + 1, (int) result->capacity);
+	CuAssertIntEquals(tc, 0, (int) result->base.meta.ref_count);
+	CuAssertIntEquals(tc, 0, (int) elvea_strbuf_size(&buf));
+
+	// The hash and the length are computed from the final content.
+	STR(copy, result->data);
+	elvea_object_retain(thread, result);
+	CuAssertTrue(tc, elvea_string_equal(thread, result, copy));
+	CuAssertTrue(tc, elvea_string_hash(thread, result) == elvea_string_hash(thread, copy));
+	CuAssertIntEquals(tc, size, (int) elvea_string_length(thread, result));
+
+	elvea_object_release(thread, result);
+	elvea_object_release(thread, copy);
+	elvea_object_release(thread, s);
+}
+
+static
+void test_strbuf_chunks(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	char expected[20000];
+	size_t size = 0;
+	elvea_strbuf_t buf;
+
+	// Pieces of various sizes, including some larger than a chunk, spill from the string into chunks.
+	elvea_strbuf_init(thread, &buf, 16);
+	for (int i = 0; size < sizeof expected - 1000; i++)
+	{
+		char piece[600];
+		size_t len = (size_t) (i * 37) % sizeof piece;
+
+		for (size_t k = 0; k < len; k++) {
+			piece[k] = (char) ('a' + (i + k) % 26);
+		}
+		elvea_strbuf_append(thread, &buf, piece, (elvea_index_t) len);
+		memcpy(expected + size, piece, len);
+		size += len;
+
+		elvea_strbuf_append_int(thread, &buf, i);
+		size += (size_t) sprintf(expected + size, "%d", i);
+	}
+	expected[size] = '\0';
+	CuAssertTrue(tc, buf.first_chunk != NULL);
+
+	elvea_string_t *result = elvea_strbuf_finish(thread, &buf);
+	CuAssertIntEquals(tc, (int) size, (int) result->size);
+	CuAssertIntEquals(tc, (int) size + 1, (int) result->capacity);
+	CuAssertStrEquals(tc, expected, result->data);
+	CuAssertTrue(tc, buf.string == NULL && buf.first_chunk == NULL);
+	elvea_delete(thread, result);
+
+	// An empty builder gives an empty string, and a discarded builder frees its memory.
+	result = elvea_strbuf_finish(thread, &buf);
+	CuAssertIntEquals(tc, 0, (int) result->size);
+	CuAssertStrEquals(tc, "", result->data);
+	elvea_delete(thread, result);
+
+	size_t used = elvea_memory_used(thread);
+	for (int i = 0; i < 1000; i++) {
+		elvea_strbuf_append(thread, &buf, "0123456789", 10);
+	}
+	CuAssertTrue(tc, elvea_memory_used(thread) > used);
+	elvea_strbuf_clear(thread, &buf);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+
+CuSuite* strbuf_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_strbuf_append);
+	SUITE_ADD_TEST(suite, test_strbuf_chunks);
+
+	return suite;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include "test.h"
+#include <elvea/table.h>
+#include <elvea/utils/alloc.h>
+
+
+static
+void test_table(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_table_t *table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, table);
+	STR(s1, "hello");
+	STR(s2, "world");
+	STR(s3, "john");
+	STR(s4, "smith");
+
+	elvea_variant_t key, value;
+
+	elvea_init_object(thread, &key, s1);
+	elvea_init_object(thread, &value, s2);
+	elvea_table_set(thread, table, &key, &value);
+	elvea_clear(thread, &key);
+	elvea_clear(thread, &value);
+
+	elvea_init_object(thread, &key, s3);
+	elvea_init_object(thread, &value, s4);
+	elvea_table_set(thread, table, &key, &value);
+	elvea_clear(thread, &key);
+	elvea_clear(thread, &value);
+
+	elvea_init_object(thread, &key, s1);
+	elvea_variant_t *res1 = elvea_table_get(thread, table, &key);
+	CuAssertTrue(tc, elvea_string_equal(thread, (elvea_string_t*) elvea_as_object(res1), s2));
+	elvea_clear(thread, &key);
+
+	elvea_init_object(thread, &key, s3);
+	elvea_variant_t *res2 = elvea_table_get(thread, table, &key);
+	CuAssertTrue(tc, elvea_string_equal(thread, (elvea_string_t*) elvea_as_object(res2), s4));
+	CuAssertTrue(tc, elvea_table_remove(thread, table, &key));
+	CuAssertTrue(tc, !elvea_table_contains(thread, table, &key));
+	CuAssertIntEquals(tc, 1, (int) elvea_table_length(thread, table));
+	elvea_clear(thread, &key);
+
+	elvea_object_release(thread, table);
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+	elvea_object_release(thread, s3);
+	elvea_object_release(thread, s4);
+}
+
+static
+void insert_keys(elvea_thread_t *thread, elvea_table_t *table, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char buffer[32];
+		elvea_variant_t key, value;
+		snprintf(buffer, sizeof buffer, "key%d", i);
+		elvea_init_object(thread, &key, elvea_string_new(thread, buffer, -1));
+		elvea_init_num(thread, &value, i);
+		elvea_table_set(thread, table, &key, &value);
+		elvea_clear(thread, &key);
+	}
+}
+
+static
+void remove_keys(elvea_thread_t *thread, elvea_table_t *table, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		char buffer[32];
+		elvea_variant_t key;
+		snprintf(buffer, sizeof buffer, "key%d", i);
+		elvea_init_object(thread, &key, elvea_string_new(thread, buffer, -1));
+		elvea_table_remove(thread, table, &key);
+		elvea_clear(thread, &key);
+	}
+}
+
+static
+void test_table_pool(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	size_t used = elvea_memory_used(thread);
+	elvea_table_t *table = elvea_table_new(thread, 8);
+	elvea_object_retain(thread, table);
+
+	insert_keys(thread, table, 1000);
+	CuAssertIntEquals(tc, 1000, (int) elvea_table_length(thread, table));
+	size_t full = elvea_memory_used(thread);
+
+	// Removed nodes are reused: refilling the table doesn't allocate any node.
+	remove_keys(thread, table, 1000);
+	CuAssertIntEquals(tc, 0, (int) elvea_table_length(thread, table));
+	insert_keys(thread, table, 1000);
+	CuAssertIntEquals(tc, (int) full, (int) elvea_memory_used(thread));
+
+	// Finalizing the table releases the nodes along with the keys and values.
+	elvea_object_release(thread, table);
+	CuAssertIntEquals(tc, (int) used, (int) elvea_memory_used(thread));
+}
+
+CuSuite* table_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_table);
+	SUITE_ADD_TEST(suite, test_table_pool);
+
+	return suite;
+}
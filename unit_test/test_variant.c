@@ -0,0 +1,234 @@
+#include <math.h>
+#include <string.h>
+#include "test.h"
+
+
+static
+void test_variant_types(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	STR(s, "hello");
+	elvea_variant_t v;
+
+	elvea_zero(&v);
+	CuAssertTrue(tc, elvea_check_null(&v));
+	CuAssertTrue(tc, !elvea_check_bool(&v) && !elvea_check_num(&v) && !elvea_check_object(&v));
+
+	elvea_init_bool(thread, &v, true);
+	CuAssertTrue(tc, elvea_check_bool(&v) && elvea_get_bool(thread, &v));
+	elvea_init_bool(thread, &v, false);
+	CuAssertTrue(tc, elvea_check_bool(&v) && !elvea_get_bool(thread, &v));
+	CuAssertTrue(tc, !elvea_check_null(&v) && !elvea_check_num(&v));
+
+	// Numbers must round-trip exactly, including the special values.
+	double numbers[] = { 0.0, -0.0, 1.0, -1.5, 1e308, -1e-308, 4.9e-324, INFINITY, -INFINITY };
+	for (size_t i = 0; i < sizeof numbers / sizeof numbers[0]; i++)
+	{
+		elvea_init_num(thread, &v, numbers[i]);
+		CuAssertTrue(tc, elvea_check_num(&v) && !elvea_check_object(&v) && !elvea_check_bool(&v));
+		double n = elvea_get_num(thread, &v);
+		CuAssertTrue(tc, memcmp(&numbers[i], &n, sizeof(double)) == 0);
+	}
+	elvea_init_num(thread, &v, NAN);
+	CuAssertTrue(tc, elvea_check_num(&v) && isnan(elvea_as_num(&v)));
+	elvea_init_num(thread, &v, -NAN);
+	CuAssertTrue(tc, elvea_check_num(&v) && isnan(elvea_as_num(&v)));
+
+	elvea_init_object(thread, &v, s);
+	CuAssertTrue(tc, elvea_check_object(&v) && elvea_check_string(thread, &v));
+	CuAssertTrue(tc, elvea_get_string(thread, &v) == s && *elvea_get_string_ref(thread, &v) == s);
+	CuAssertTrue(tc, elvea_as_pointer(&v) == s);
+	elvea_clear(thread, &v);
+	CuAssertTrue(tc, elvea_check_null(&v));
+
+	elvea_object_release(thread, s);
+}
+
+static
+void test_variant_alias(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_alias_t alias;
+	elvea_variant_t v, n;
+
+	elvea_init_num(thread, &alias.variant, 42);
+	elvea_box_alias(&v, &alias);
+	CuAssertTrue(tc, elvea_check_alias(&v) && !elvea_check_object(&v) && !elvea_check_num(&v));
+	CuAssertTrue(tc, elvea_as_alias(&v) == &alias && elvea_as_pointer(&v) == &alias);
+
+	// Comparisons go through the alias.
+	elvea_init_num(thread, &n, 42);
+	CuAssertTrue(tc, elvea_equal(thread, &v, &n));
+	CuAssertTrue(tc, elvea_hash(thread, &v) == elvea_hash(thread, &n));
+	CuAssertStrEquals(tc, "num", elvea_get_class_name(thread, &v));
+}
+
+static
+void test_variant_equal(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	STR(s1, "hello");
+	STR(s2, "hello");
+	elvea_variant_t a, b;
+
+	elvea_init_num(thread, &a, 1.5);
+	elvea_init_num(thread, &b, 1.5);
+	CuAssertTrue(tc, elvea_equal(thread, &a, &b) && elvea_hash(thread, &a) == elvea_hash(thread, &b));
+	elvea_init_bool(thread, &b, true);
+	CuAssertTrue(tc, !elvea_equal(thread, &a, &b));
+	elvea_init_bool(thread, &a, true);
+	CuAssertTrue(tc, elvea_equal(thread, &a, &b) && elvea_hash(thread, &a) == elvea_hash(thread, &b));
+
+	elvea_init_object(thread, &a, s1);
+	elvea_init_object(thread, &b, s2);
+	CuAssertTrue(tc, elvea_equal(thread, &a, &b) && elvea_hash(thread, &a) == elvea_hash(thread, &b));
+
+	// Copying a variant onto itself doesn't touch the reference count.
+	elvea_copy(thread, &b, &a);
+	CuAssertTrue(tc, elvea_as_object(&b) == (elvea_object_t*) s1);
+	CuAssertIntEquals(tc, 3, (int) s1->base.meta.ref_count);
+	elvea_copy(thread, &b, &a);
+	CuAssertIntEquals(tc, 3, (int) s1->base.meta.ref_count);
+
+	elvea_clear(thread, &a);
+	elvea_clear(thread, &b);
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+}
+
+static
+void test_variant_int(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	elvea_variant_t a, b, r;
+
+	// Integers round-trip exactly. In the NaN-boxed layout, integers that don't fit in 50 bits become numbers.
+	elvea_int_t integers[] = { 0, 1, -1, 42, -123456789, ((elvea_int_t) 1 << 49) - 1, -((elvea_int_t) 1 << 49) };
+	for (size_t i = 0; i < sizeof integers / sizeof integers[0]; i++)
+	{
+		elvea_init_int(thread, &a, integers[i]);
+		CuAssertTrue(tc, elvea_check_int(&a) && !elvea_check_num(&a) && !elvea_check_object(&a));
+		CuAssertTrue(tc, elvea_get_int(thread, &a) == integers[i]);
+	}
+#if ! ELVEA_NAN_BOXING
+	elvea_init_int(thread, &a, INT64_MIN);
+	CuAssertTrue(tc, elvea_check_int(&a) && elvea_get_int(thread, &a) == INT64_MIN);
+#endif
+	CuAssertStrEquals(tc, "int", elvea_get_class_name(thread, &a));
+
+	// Integer equality is exact, and integers are equal to numbers with the same value.
+	elvea_init_int(thread, &a, 3);
+	elvea_init_num(thread, &b, 3.0);
+	CuAssertTrue(tc, elvea_equal(thread, &a, &b) && elvea_equal(thread, &b, &a));
+	CuAssertTrue(tc, elvea_hash(thread, &a) == elvea_hash(thread, &b));
+	CuAssertIntEquals(tc, 0, elvea_compare(thread, &a, &b));
+	elvea_init_num(thread, &b, 3.5);
+	CuAssertTrue(tc, !elvea_equal(thread, &a, &b));
+	CuAssertIntEquals(tc, -1, elvea_compare(thread, &a, &b));
+	CuAssertIntEquals(tc, 1, elvea_compare(thread, &b, &a));
+	elvea_init_num(thread, &b, 2.75);
+	CuAssertIntEquals(tc, 1, elvea_compare(thread, &a, &b));
+	elvea_init_num(thread, &b, -1e300);
+	CuAssertIntEquals(tc, 1, elvea_compare(thread, &a, &b));
+
+#if ! ELVEA_NAN_BOXING
+	// Converting to a number would make these equal.
+	elvea_init_int(thread, &a, ((elvea_int_t) 1 << 53) + 1);
+	elvea_init_num(thread, &b, (double) ((elvea_int_t) 1 << 53));
+	CuAssertTrue(tc, !elvea_equal(thread, &a, &b));
+	CuAssertIntEquals(tc, 1, elvea_compare(thread, &a, &b));
+	elvea_init_int(thread, &b, ((elvea_int_t) 1 << 53) + 2);
+	CuAssertIntEquals(tc, -1, elvea_compare(thread, &a, &b));
+	CuAssertTrue(tc, elvea_hash(thread, &a) != elvea_hash(thread, &b));
+#endif
+
+	// Arithmetic stays in integers until it overflows.
+	elvea_init_int(thread, &a, 7);
+	elvea_init_int(thread, &b, -3);
+	elvea_zero(&r);
+	elvea_add(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_int(&r) && elvea_as_int(&r) == 4);
+	elvea_sub(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_int(&r) && elvea_as_int(&r) == 10);
+	elvea_mul(thread, &r, &r, &b);
+	CuAssertTrue(tc, elvea_check_int(&r) && elvea_as_int(&r) == -30);
+	elvea_div(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_num(&r) && elvea_as_num(&r) == 7.0 / -3.0);
+	elvea_init_num(thread, &b, 0.5);
+	elvea_add(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_num(&r) && elvea_as_num(&r) == 7.5);
+
+	elvea_init_int(thread, &a, INT64_MAX);
+	elvea_init_int(thread, &b, 2);
+	elvea_mul(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_num(&r) && elvea_as_num(&r) == 2.0 * (double) INT64_MAX);
+	elvea_add(thread, &r, &a, &b);
+	CuAssertTrue(tc, elvea_check_num(&r));
+}
+
+static
+void test_variant_bulk(CuTest *tc)
+{
+	GET_RUNTIME(thread, tc);
+	STR(s1, "hello");
+	STR(s2, "world");
+	enum { COUNT = 100 };
+	elvea_variant_t src[COUNT], dst[COUNT], tmp[COUNT];
+
+	// Long runs of numbers, with a few references in the middle and at the end.
+	for (int i = 0; i < COUNT; i++)
+	{
+		if (i == 20 || i == 21 || i == 99) {
+			elvea_init_object(thread, &src[i], s1);
+		}
+		else {
+			elvea_init_int(thread, &src[i], i);
+		}
+		elvea_zero(&dst[i]);
+		elvea_zero(&tmp[i]);
+	}
+	elvea_init_object(thread, &dst[50], s2);
+	CuAssertIntEquals(tc, 4, (int) s1->base.meta.ref_count);
+	CuAssertIntEquals(tc, 2, (int) s2->base.meta.ref_count);
+
+	elvea_copy_n(thread, dst, src, COUNT);
+	CuAssertIntEquals(tc, 7, (int) s1->base.meta.ref_count);
+	CuAssertIntEquals(tc, 1, (int) s2->base.meta.ref_count);
+	for (int i = 0; i < COUNT; i++) {
+		CuAssertTrue(tc, elvea_equal(thread, &src[i], &dst[i]));
+	}
+
+	elvea_retain_n(thread, dst, COUNT);
+	CuAssertIntEquals(tc, 10, (int) s1->base.meta.ref_count);
+	elvea_release_n(thread, dst, COUNT);
+	CuAssertIntEquals(tc, 7, (int) s1->base.meta.ref_count);
+
+	// Moving over references releases them, and leaves the source null.
+	elvea_init_object(thread, &tmp[3], s2);
+	elvea_move_n(thread, tmp, dst, COUNT);
+	CuAssertIntEquals(tc, 7, (int) s1->base.meta.ref_count);
+	CuAssertIntEquals(tc, 1, (int) s2->base.meta.ref_count);
+	for (int i = 0; i < COUNT; i++) {
+		CuAssertTrue(tc, elvea_check_null(&dst[i]) && elvea_equal(thread, &src[i], &tmp[i]));
+	}
+
+	elvea_release_n(thread, src, COUNT);
+	elvea_release_n(thread, tmp, COUNT);
+	CuAssertIntEquals(tc, 1, (int) s1->base.meta.ref_count);
+	elvea_object_release(thread, s1);
+	elvea_object_release(thread, s2);
+}
+
+
+CuSuite* variant_test_suite()
+{
+	CuSuite *suite = CuSuiteNew();
+
+	SUITE_ADD_TEST(suite, test_variant_types);
+	SUITE_ADD_TEST(suite, test_variant_alias);
+	SUITE_ADD_TEST(suite, test_variant_equal);
+	SUITE_ADD_TEST(suite, test_variant_int);
+	SUITE_ADD_TEST(suite, test_variant_bulk);
+
+	return suite;
+}